@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "payload_codec.hpp"
+
+// Compression ratio and speed of the payload codecs on 8-channel 48 kHz audio, coded in
+// 10 ms messages the way the publisher sends them. The signals stand in for what the
+// service captures: a mic array on speech, a music feed, a quiet room and plain noise.
+// Usage: codec_benchmark [seconds]
+namespace {
+
+const int kChannels = 8;
+const int kSampleRate = 48000;
+const size_t kMessageFrames = 480;
+
+enum class Signal {
+    Speech,
+    Music,
+    Room,
+    Noise
+};
+
+const char* signalName(Signal signal) {
+    switch (signal) {
+        case Signal::Speech:
+            return "speech";
+        case Signal::Music:
+            return "music";
+        case Signal::Room:
+            return "room";
+        case Signal::Noise:
+            return "noise";
+    }
+    return "";
+}
+
+// Full-scale fraction of every channel, frame by frame; channels of an array hear the same
+// source with their own delay, gain and self-noise
+std::vector<double> synthesize(Signal signal, size_t frames) {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+    std::vector<double> source(frames);
+    double pink = 0.0;
+
+    for (size_t i = 0; i < frames; i++) {
+        const double t = static_cast<double>(i) / kSampleRate;
+        double value = 0.0;
+        switch (signal) {
+            case Signal::Speech: {
+                // Voiced harmonics with a gliding pitch, chopped into syllables
+                double pitch = 120.0 + 30.0 * std::sin(2.0 * M_PI * 0.7 * t);
+                double envelope = std::max(0.0, std::sin(2.0 * M_PI * 3.5 * t));
+                for (int h = 1; h <= 12; h++) {
+                    value += std::sin(2.0 * M_PI * pitch * h * t) / h;
+                }
+                value *= 0.25 * envelope;
+                break;
+            }
+            case Signal::Music:
+                for (double note : {220.0, 277.18, 329.63, 440.0, 659.26}) {
+                    value += 0.12 * std::sin(2.0 * M_PI * note * t + 0.001 * note);
+                }
+                pink = 0.98 * pink + 0.02 * gaussian(rng);
+                value += 0.05 * pink;
+                break;
+            case Signal::Room:
+                pink = 0.99 * pink + 0.01 * gaussian(rng);
+                value = 0.002 * pink;
+                break;
+            case Signal::Noise:
+                value = 0.3 * gaussian(rng);
+                break;
+        }
+        source[i] = value;
+    }
+
+    std::vector<double> mixed(frames * kChannels);
+    for (int channel = 0; channel < kChannels; channel++) {
+        const size_t delay = static_cast<size_t>(channel * 3);
+        const double gain = 1.0 - 0.05 * channel;
+        for (size_t i = 0; i < frames; i++) {
+            double value = i >= delay ? gain * source[i - delay] : 0.0;
+            mixed[i * kChannels + channel] = value + 0.0001 * gaussian(rng);
+        }
+    }
+    return mixed;
+}
+
+std::vector<uint8_t> quantize(const std::vector<double>& samples, SampleFormat format) {
+    const size_t bytes = SampleSpec::sampleBytes(format);
+    const double scale = std::ldexp(1.0, static_cast<int>(bytes) * 8 - 1) - 1.0;
+    std::vector<uint8_t> data(samples.size() * bytes);
+    for (size_t i = 0; i < samples.size(); i++) {
+        double clamped = std::max(-1.0, std::min(1.0, samples[i]));
+        uint32_t value = static_cast<uint32_t>(static_cast<int32_t>(std::lround(clamped * scale)));
+        for (size_t b = 0; b < bytes; b++) {
+            data[i * bytes + b] = static_cast<uint8_t>(value >> (8 * b));
+        }
+    }
+    return data;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+    const size_t frames = static_cast<size_t>(seconds) * kSampleRate / kMessageFrames * kMessageFrames;
+
+    std::printf("%d channels at %d Hz in %zu-frame messages, %d s per case\n", kChannels, kSampleRate,
+                kMessageFrames, seconds);
+    std::printf("%-8s %-6s %8s %12s %12s %14s\n", "signal", "format", "ratio", "encode ns/fr", "decode ns/fr",
+                "Mbit/s coded");
+
+    DeltaRiceCodec codec;
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> decoded;
+
+    for (Signal signal : {Signal::Speech, Signal::Music, Signal::Room, Signal::Noise}) {
+        const std::vector<double> samples = synthesize(signal, frames);
+        for (SampleFormat format : {SampleFormat::Int16, SampleFormat::Int24}) {
+            const SampleSpec spec{format, SampleLayout::Interleaved};
+            const std::vector<uint8_t> audio = quantize(samples, format);
+            const size_t messageBytes = kMessageFrames * kChannels * spec.bytesPerSample();
+
+            size_t codedBytes = 0;
+            std::chrono::steady_clock::duration encodeTime{0};
+            std::chrono::steady_clock::duration decodeTime{0};
+            for (size_t offset = 0; offset < audio.size(); offset += messageBytes) {
+                auto start = std::chrono::steady_clock::now();
+                codec.encode(audio.data() + offset, kMessageFrames, kChannels, spec, encoded);
+                auto encodedAt = std::chrono::steady_clock::now();
+                if (!codec.decode(encoded.data(), encoded.size(), kMessageFrames, kChannels, spec, decoded) ||
+                    std::memcmp(decoded.data(), audio.data() + offset, messageBytes) != 0) {
+                    std::fprintf(stderr, "%s %s: round trip mismatch\n", signalName(signal),
+                                 SampleSpec::formatName(format).c_str());
+                    return 1;
+                }
+                decodeTime += std::chrono::steady_clock::now() - encodedAt;
+                encodeTime += encodedAt - start;
+                codedBytes += encoded.size();
+            }
+
+            const double encodeNs = std::chrono::duration<double, std::nano>(encodeTime).count() / frames;
+            const double decodeNs = std::chrono::duration<double, std::nano>(decodeTime).count() / frames;
+            std::printf("%-8s %-6s %8.2f %12.1f %12.1f %14.2f\n", signalName(signal),
+                        SampleSpec::formatName(format).c_str(), static_cast<double>(audio.size()) / codedBytes,
+                        encodeNs, decodeNs, codedBytes * 8.0 / seconds / 1e6);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "cpu_features.hpp"
+#include "sample_format.hpp"
+
+// Sample format conversion throughput of each kernel level, on one second of 8-channel
+// 48 kHz audio per pass (the block a publisher with --publish-format converts per second).
+// Usage: convert_benchmark [passes]
+namespace {
+
+struct Case {
+    const char* from;
+    const char* to;
+};
+
+const Case kCases[] = {
+    {"int16", "float32"},
+    {"int24", "float32"},
+    {"int32", "float32"},
+    {"float32", "int16"},
+    {"float32", "int24"},
+    {"int32", "int16"},
+    {"int16", "int32"},
+    {"int8", "int16"},
+    {"int16", "float32:planar"},
+    {"int24", "int16:planar"},
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int channels = 8;
+    const size_t frames = 48000;
+    const size_t samples = frames * channels;
+    int passes = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    std::mt19937 rng(1);
+    std::vector<uint8_t> input(samples * 4);
+    for (auto& byte : input) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    // Keep float input in range so no case measures only clamping
+    std::vector<float> floats(samples);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (auto& value : floats) {
+        value = dist(rng);
+    }
+    std::vector<uint8_t> output(samples * 4);
+
+    const SimdLevel detected = detectSimdLevel();
+    std::printf("%-10s -> %-16s %-8s %10s %10s %8s\n", "from", "to", "kernels", "ns/sample", "MSamples/s", "speedup");
+
+    for (const Case& c : kCases) {
+        SampleSpec from;
+        SampleSpec to;
+        SampleSpec::parse(c.from, from);
+        SampleSpec::parse(c.to, to);
+        SampleConverter converter(from, to, channels);
+        const void* src = from.format == SampleFormat::Float32 ? static_cast<const void*>(floats.data()) : input.data();
+        const size_t bytes = samples * from.bytesPerSample();
+
+        double scalarNs = 0.0;
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2}) {
+            if (static_cast<int>(level) > static_cast<int>(detected)) {
+                continue;
+            }
+            setSimdLevel(level);
+
+            converter.convert(src, bytes, output.data());  // Warm up
+            auto start = std::chrono::steady_clock::now();
+            for (int pass = 0; pass < passes; pass++) {
+                converter.convert(src, bytes, output.data());
+            }
+            double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            double nsPerSample = elapsed / (static_cast<double>(passes) * samples);
+            if (level == SimdLevel::Scalar) {
+                scalarNs = nsPerSample;
+            }
+
+            std::printf("%-10s -> %-16s %-8s %10.3f %10.1f %7.2fx\n", c.from, c.to, simdLevelName(level).c_str(),
+                        nsPerSample, 1000.0 / nsPerSample, scalarNs / nsPerSample);
+        }
+    }
+
+    setSimdLevel(detected);
+    return 0;
+}
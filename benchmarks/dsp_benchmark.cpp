@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "dsp_pipeline.hpp"
+#include "work_stealing_pool.hpp"
+
+// Throughput of a per-channel processing chain on 64-channel 48 kHz int24 audio (a MADI or
+// Dante bridge) in 10 ms blocks, with the channel groups split over 1 to N threads of a
+// work-stealing pool. Every run's output is checked against the single-thread one.
+// Usage: dsp_benchmark [seconds] [max_threads]
+namespace {
+
+const int kChannels = 64;
+const int kSampleRate = 48000;
+const size_t kBlockFrames = 480;
+const char* kChain = "dc,highpass:80,lowpass:16000,highpass:120,lowpass:12000,gain:3";
+
+// Interleaved int24 audio: a different tone per channel over low-level noise
+std::vector<uint8_t> synthesize(size_t frames) {
+    std::mt19937 rng(42);
+    std::normal_distribution<double> gaussian(0.0, 0.001);
+    std::vector<uint8_t> data(frames * kChannels * 3);
+    for (size_t i = 0; i < frames; i++) {
+        for (int channel = 0; channel < kChannels; channel++) {
+            double value = 0.25 * std::sin(2.0 * M_PI * (100.0 + 150.0 * channel) * i / kSampleRate) + gaussian(rng);
+            int32_t sample = static_cast<int32_t>(std::lround(value * 8388607.0));
+            uint8_t* out = &data[(i * kChannels + channel) * 3];
+            out[0] = static_cast<uint8_t>(sample);
+            out[1] = static_cast<uint8_t>(sample >> 8);
+            out[2] = static_cast<uint8_t>(sample >> 16);
+        }
+    }
+    return data;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int seconds = argc > 1 ? std::atoi(argv[1]) : 10;
+    const size_t maxThreads = argc > 2 ? static_cast<size_t>(std::atoi(argv[2]))
+                                       : std::max(1u, std::thread::hardware_concurrency());
+    const size_t frames = static_cast<size_t>(seconds) * kSampleRate / kBlockFrames * kBlockFrames;
+    const size_t blockBytes = kBlockFrames * kChannels * 3;
+
+    DspSettings settings;
+    if (!DspSettings::parse(kChain, settings)) {
+        return 1;
+    }
+    const SampleSpec int24{SampleFormat::Int24, SampleLayout::Interleaved};
+    const std::vector<uint8_t> input = synthesize(frames);
+
+    std::printf("%d channels at %d Hz in %zu-frame blocks, %d s per run, %d channels per task\n", kChannels,
+                kSampleRate, kBlockFrames, seconds, DspPipeline::kChannelsPerGroup);
+    std::printf("chain %s\n", kChain);
+    std::printf("%8s %12s %12s %10s %10s %12s\n", "threads", "ns/frame", "x realtime", "speedup", "efficiency",
+                "tasks stolen");
+
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::vector<uint8_t> reference;
+    double singleNs = 0.0;
+    for (size_t threads : threadCounts) {
+        std::shared_ptr<WorkStealingPool> pool;
+        DspPipeline pipeline(settings);
+        if (threads > 1) {
+            pool = std::make_shared<WorkStealingPool>(threads);
+            pipeline.setThreadPool(pool);
+        }
+        if (!pipeline.configure(int24, kChannels, kSampleRate)) {
+            return 1;
+        }
+
+        std::vector<uint8_t> audio = input;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t offset = 0; offset < audio.size(); offset += blockBytes) {
+            pipeline.process(audio.data() + offset, kBlockFrames);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if (reference.empty()) {
+            reference = audio;
+            singleNs = ns;
+        } else if (audio != reference) {
+            std::fprintf(stderr, "%zu threads: output differs from the single-thread run\n", threads);
+            return 1;
+        }
+
+        const double speedup = singleNs / ns;
+        std::printf("%8zu %12.1f %12.1f %10.2f %9.0f%% %12llu\n", threads, ns / frames, seconds * 1e9 / ns, speedup,
+                    100.0 * speedup / threads, static_cast<unsigned long long>(pool ? pool->getTasksStolen() : 0));
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "capture_journal.hpp"
+
+// Sustained write throughput of the capture journal for 16 channels of 48 kHz/32-bit audio,
+// appended in 10 ms blocks as the recorder thread does, with a flush every second of audio.
+// Usage: journal_benchmark [path] [seconds of audio] [journal MiB]
+int main(int argc, char* argv[]) {
+    const int sampleRate = 48000;
+    const int channels = 16;
+    const int bitDepth = 32;
+    const int blockFrames = sampleRate / 100;
+
+    std::string path = argc > 1 ? argv[1] : "journal_benchmark.jrnl";
+    double audioSeconds = argc > 2 ? std::atof(argv[2]) : 600.0;
+    uint64_t journalMb = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1024;
+
+    CaptureJournal journal(path);
+    if (!journal.create(sampleRate, channels, bitDepth, journalMb * 1024 * 1024)) {
+        return 1;
+    }
+
+    std::vector<int32_t> block(blockFrames * channels);
+    for (size_t i = 0; i < block.size(); i++) {
+        block[i] = static_cast<int32_t>(i * 2654435761u);
+    }
+    const size_t blockBytes = block.size() * sizeof(int32_t);
+
+    const uint64_t blocks = static_cast<uint64_t>(audioSeconds * 100);
+    std::vector<double> latencyUs;
+    latencyUs.reserve(blocks);
+
+    uint64_t timestamp = 1700000000000ull;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t b = 0; b < blocks; b++) {
+        auto before = std::chrono::steady_clock::now();
+        journal.append(block.data(), blockBytes, timestamp);
+        auto after = std::chrono::steady_clock::now();
+        latencyUs.push_back(std::chrono::duration<double, std::micro>(after - before).count());
+
+        timestamp += 10;
+        if (b % 100 == 99) {
+            journal.flush();
+        }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencyUs.begin(), latencyUs.end());
+    auto percentile = [&](double p) {
+        return latencyUs.empty() ? 0.0 : latencyUs[std::min(latencyUs.size() - 1, static_cast<size_t>(p * latencyUs.size()))];
+    };
+
+    double megabytes = static_cast<double>(journal.getBytesWritten()) / (1024 * 1024);
+    double requiredMbPerSecond = static_cast<double>(sampleRate) * channels * (bitDepth / 8) / (1024 * 1024);
+
+    // Read back the last second to check the journal holds what was written
+    ReadResult tail = journal.readRange(timestamp - 1000, timestamp);
+
+    std::printf("format            %d ch, %d Hz, %d-bit (%.2f MiB/s of audio)\n",
+                channels, sampleRate, bitDepth, requiredMbPerSecond);
+    std::printf("written           %.1f s of audio, %.1f MiB in %.2f s\n", audioSeconds, megabytes, elapsed);
+    std::printf("throughput        %.1f MiB/s (%.1fx real time)\n", megabytes / elapsed, audioSeconds / elapsed);
+    std::printf("append latency    p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+                percentile(0.50), percentile(0.99), percentile(0.999), latencyUs.empty() ? 0.0 : latencyUs.back());
+    std::printf("read back         %zu of %zu bytes for the last second\n",
+                tail.data.size(), static_cast<size_t>(sampleRate) * channels * (bitDepth / 8));
+
+    journal.close();
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,45 @@
+# FindOpus.cmake - Find the Opus codec library
+#
+# This module defines:
+#  Opus_FOUND - True if Opus is found
+#  Opus_INCLUDE_DIRS - The Opus include directories
+#  Opus_LIBRARIES - The Opus libraries to link against
+
+# Look for Opus includes (installed as <prefix>/include/opus/opus.h)
+find_path(Opus_INCLUDE_DIR
+  NAMES opus.h
+  PATH_SUFFIXES opus
+  PATHS
+    /usr/include
+    /usr/local/include
+    /opt/local/include
+    /sw/include
+  DOC "The Opus include directory"
+)
+
+# Find the Opus library
+find_library(Opus_LIBRARY
+  NAMES opus libopus
+  PATHS
+    /usr/lib
+    /usr/local/lib
+    /opt/local/lib
+    /sw/lib
+  DOC "The Opus library"
+)
+
+# Handle the QUIETLY and REQUIRED arguments and set Opus_FOUND
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(Opus
+  DEFAULT_MSG
+  Opus_LIBRARY Opus_INCLUDE_DIR
+)
+
+# Set output variables
+if(Opus_FOUND)
+  set(Opus_LIBRARIES ${Opus_LIBRARY})
+  set(Opus_INCLUDE_DIRS ${Opus_INCLUDE_DIR})
+endif()
+
+# Hide these variables in GUIs
+mark_as_advanced(Opus_INCLUDE_DIR Opus_LIBRARY)
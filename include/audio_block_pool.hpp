@@ -0,0 +1,117 @@
+#ifndef AUDIO_BLOCK_POOL_H
+#define AUDIO_BLOCK_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "capture_clock.hpp"
+#include "realtime_memory.hpp"
+
+class AudioBlockPool;
+
+// Discontinuities seen since the previous delivered block of the stream
+struct CaptureGap {
+    uint32_t inputOverflows = 0;   // Device reported input overflow (samples lost before capture)
+    uint32_t inputUnderflows = 0;  // Device reported input underflow (samples were padded)
+    uint64_t droppedFrames = 0;    // Frames captured but never handed out
+
+    bool empty() const { return inputOverflows == 0 && inputUnderflows == 0 && droppedFrames == 0; }
+};
+
+// One pre-allocated capture block. Storage and metadata live in the pool;
+// the fields are written by the producer before the block is handed out.
+struct AudioBlock {
+    uint8_t* data = nullptr;       // Interleaved sample bytes
+    size_t capacity = 0;           // Bytes available at data
+    size_t size = 0;               // Bytes in use
+    unsigned long frames = 0;      // Frames in use
+    uint64_t timestamp = 0;        // Capture time in milliseconds since epoch
+    CaptureTime time;              // Sample-accurate timing of the first frame
+    CaptureGap gap;                // Gaps between the previous delivered block and this one
+
+private:
+    friend class AudioBlockPool;
+    std::atomic<uint32_t> refCount{0};
+    std::atomic<uint32_t> nextFree{0};
+};
+
+// Ref-counted handle to a pooled block. Copying only bumps an atomic counter,
+// and the block returns to its pool when the last handle goes away, so handles
+// can be passed across threads without touching the heap.
+class AudioBlockHandle {
+public:
+    AudioBlockHandle() noexcept : pool_(nullptr), block_(nullptr) {}
+    AudioBlockHandle(const AudioBlockHandle& other) noexcept;
+    AudioBlockHandle(AudioBlockHandle&& other) noexcept;
+    AudioBlockHandle& operator=(const AudioBlockHandle& other) noexcept;
+    AudioBlockHandle& operator=(AudioBlockHandle&& other) noexcept;
+    ~AudioBlockHandle();
+
+    explicit operator bool() const { return block_ != nullptr; }
+
+    AudioBlock* operator->() const { return block_; }
+    AudioBlock& operator*() const { return *block_; }
+
+    const uint8_t* data() const { return block_->data; }
+    size_t size() const { return block_->size; }
+
+    // Drop this reference early
+    void reset() noexcept;
+
+private:
+    friend class AudioBlockPool;
+    AudioBlockHandle(AudioBlockPool* pool, AudioBlock* block) noexcept : pool_(pool), block_(block) {}
+
+    AudioBlockPool* pool_;
+    AudioBlock* block_;
+};
+
+// Fixed-size pool of equally sized capture blocks
+// acquire() and release are lock-free (tagged index free-list), so the real-time
+// capture thread can take blocks while consumers on other threads return them.
+// The pool must outlive every handle it has given out.
+class AudioBlockPool {
+public:
+    AudioBlockPool(size_t blockCount, size_t blockBytes);
+    ~AudioBlockPool();
+
+    AudioBlockPool(const AudioBlockPool&) = delete;
+    AudioBlockPool& operator=(const AudioBlockPool&) = delete;
+
+    // Take a free block; returns an empty handle when the pool is exhausted
+    AudioBlockHandle acquire();
+
+    size_t blockCount() const { return blockCount_; }
+    size_t blockCapacity() const { return blockBytes_; }
+
+    // Blocks currently free
+    size_t available() const { return freeCount_.load(std::memory_order_relaxed); }
+
+    // Number of acquire() calls that found the pool empty
+    uint64_t getExhaustedCount() const { return exhaustedCount_.load(std::memory_order_relaxed); }
+
+private:
+    friend class AudioBlockHandle;
+
+    void addRef(AudioBlock* block);
+    void release(AudioBlock* block);
+    void push(uint32_t index);
+
+    static uint64_t packHead(uint32_t index, uint32_t tag) { return (static_cast<uint64_t>(tag) << 32) | index; }
+
+    static constexpr uint32_t kInvalidIndex = 0xffffffffu;
+
+    size_t blockCount_;
+    size_t blockBytes_;
+    size_t stride_;
+    RealtimeBuffer storage_;
+    std::unique_ptr<AudioBlock[]> blocks_;
+
+    std::atomic<uint64_t> freeHead_;  // index in the low half, ABA tag in the high half
+    std::atomic<size_t> freeCount_;
+    std::atomic<uint64_t> exhaustedCount_;
+};
+
+#endif // AUDIO_BLOCK_POOL_H
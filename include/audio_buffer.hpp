@@ -3,42 +3,170 @@
 
 #include <vector>
 #include <mutex>
+#include <memory>
+#include <atomic>
 #include <cstdint>
+#include "realtime_memory.hpp"
+#include "ring_util.hpp"
+
+// Position of one reader in the buffered stream. Each consumer keeps its own cursor
+// and must only use it from one thread at a time.
+struct ReadCursor {
+    uint64_t position = 0;  // Absolute byte position of the next unread byte
+    uint64_t sequence = 0;  // Sequence number of the next chunk handed to this reader
+};
+
+// One chunk handed to a reader
+struct ReadResult {
+    std::vector<uint8_t> data;  // Whole frames, in capture order
+    uint64_t timestamp = 0;     // Capture time of the first frame in ms since epoch
+    uint64_t sequence = 0;      // Increments by one per non-empty chunk for this reader
+    uint64_t lostFrames = 0;    // Frames overwritten before this reader got to them
+
+    bool overrun() const { return lostFrames > 0; }
+};
 
 // AudioBuffer class to handle buffering of audio data
-// This helps ensure seamless audio output in case of brief interruptions
+// This helps ensure seamless audio output in case of brief interruptions.
+// The buffer is a ring addressed by absolute byte positions: the writer never waits and
+// overwrites the oldest audio when full, and every reader consumes the stream once through
+// its own cursor. A reader that is lapped by the writer skips ahead to the oldest audio
+// still held and is told how many frames it lost.
 class AudioBuffer {
 public:
-    explicit AudioBuffer(int sampleRate, int channels, int bitDepth, int bufferSizeMs = 5000, size_t bufferMinSend = 2048);
-    
-    // Add new audio data to the buffer
+    // Locked: writer and readers serialize on a mutex (writers on any thread)
+    // LockFree: wait-free writer for a real-time thread; readers copy and then check that
+    //           the writer did not overwrite what they copied, so they never see torn frames
+    enum class Mode {
+        Locked,
+        LockFree
+    };
+
+    explicit AudioBuffer(int sampleRate, int channels, int bitDepth, int bufferSizeMs = 5000, size_t bufferMinSend = 2048,
+                         Mode mode = Mode::Locked);
+
+    // Add new audio data to the buffer; timestamp is the capture time of the end of the data
     void addData(const void* data, size_t size, uint64_t timestamp);
-    
-    // Get buffered data (called by ZMQ publisher)
+
+    // Cursor positioned at the newest data (only audio added from now on), or at the oldest held
+    ReadCursor createCursor(bool fromOldest = false) const;
+
+    // Consume up to maxSize bytes for this cursor. Returns no data while less than the
+    // minimum send size (or maxSize, if smaller) is waiting.
+    ReadResult read(ReadCursor& cursor, size_t maxSize);
+
+    // Copy the audio captured between two timestamps (ms since epoch), without consuming it.
+    // The span is clamped to the audio still held; lostFrames counts requested frames that
+    // were already overwritten.
+    ReadResult readRange(uint64_t fromTimestamp, uint64_t toTimestamp);
+
+    // Get buffered data through the buffer's own cursor (called by ZMQ publisher)
     std::vector<uint8_t> getData(size_t maxSize, uint64_t& timestamp);
-    
-    // Clear the buffer
+
+    // Clear the buffer (for the buffer's own cursor; other readers are unaffected)
     void clear();
-    
+
     // Get the current buffer size in bytes
     size_t getCurrentSize() const;
-    
+
     // Get the maximum buffer size in bytes
     size_t getMaxSize() const;
+
+    // Resize the buffer, keeping the newest audio that fits; positions, cursors and the
+    // timestamp index carry over. With writerRunning in lock-free mode the bulk copy happens
+    // here and the writer switches rings at its next write after copying what it added since;
+    // returns false if the writer does not write within kResizeTimeoutMs (nothing changes).
+    // Without it, the lock-free writer must be stopped. Also false if the ring would be
+    // larger than kMaxBufferBytes.
+    bool resize(int bufferSizeMs, bool writerRunning = false);
+    static constexpr int kResizeTimeoutMs = 1000;
     
-    // Resize the buffer
-    void resize(int bufferSizeMs);
-    
+    // Largest ring, whatever the format: 1 GiB is ~170 s of 32-channel int32 at 48 kHz
+    static constexpr size_t kMaxBufferBytes = size_t(1) << 30;
+
+    Mode getMode() const { return mode_; }
+
+    // Total bytes ever added (the writer's position)
+    uint64_t getWritePosition() const { return head_.load(std::memory_order_acquire); }
+
+    // Bytes the buffer's own cursor lost because the writer lapped it
+    uint64_t getDroppedBytes() const { return droppedBytes_.load(std::memory_order_relaxed); }
+
 private:
-    std::vector<uint8_t> buffer_;
-    std::mutex bufferMutex_;
-    size_t maxSizeBytes_;
-    size_t currentPos_;
-    uint64_t currentTimestamp_;
+    void allocate(size_t minSizeBytes);
+    // Bytes of audio in bufferSizeMs, in 64 bits so long buffers of wide formats cannot wrap
+    uint64_t bytesForMs(int bufferSizeMs) const;
+    // Ring capacity for at least minSizeBytes; 0 if that is over kMaxBufferBytes
+    size_t capacityFor(uint64_t minSizeBytes) const;
+    void writeRing(const void* data, size_t size, uint64_t timestamp);
+
+    // Resize handoff: the writer claims the pending ring, then completeSwap() copies what was
+    // written since the bulk copy and makes the pending ring current
+    void takePendingRing();
+    void completeSwap();
+    ReadResult readRing(ReadCursor& cursor, size_t maxSize);
+
+    // Oldest position that is still intact given the writer's reserved end position
+    uint64_t oldestIntact(uint64_t reserved) const;
+    uint64_t alignUpToFrame(uint64_t position) const;
+
+    // Timestamp index: end position and timestamp of the most recent blocks
+    struct IndexEntry {
+        std::atomic<uint64_t> position;
+        std::atomic<uint64_t> timestamp;
+    };
+    static constexpr size_t kIndexEntries = 4096;  // A power of two
+
+    void appendIndex(uint64_t position, uint64_t timestamp);
+    // Byte position of the frame captured at timestamp, from a snapshot of the index
+    uint64_t positionAt(const std::vector<std::pair<uint64_t, uint64_t>>& index, uint64_t timestamp) const;
+
+    // Seqlock-protected (write position, timestamp) pair of the newest block
+    void storeLastWrite(uint64_t position, uint64_t timestamp);
+    void loadLastWrite(uint64_t& position, uint64_t& timestamp) const;
+
+    Mode mode_;
+    RealtimeBuffer ring_;
+    mutable std::mutex bufferMutex_;
+    size_t maxSizeBytes_;  // Ring capacity, a power of two
+    size_t mask_;
     int sampleRate_;
     int channels_;
-    int bytesPerSample_;
+    int bytesPerSample_;   // Bytes per frame (all channels)
     size_t bufferMinSend_;
+    size_t requestedMinSend_;
+
+    // Writer positions: reserved is bumped before bytes are overwritten, head after they are written
+    alignas(kCacheLineSize) std::atomic<uint64_t> reserved_;
+    std::atomic<uint64_t> head_;
+    std::atomic<uint64_t> validFrom_;  // Nothing before this position is held (set by resize)
+
+    // Index entries are overwritten in a ring; same reserve/publish scheme as the audio
+    std::unique_ptr<IndexEntry[]> index_;
+    std::atomic<uint64_t> indexReserved_;
+    std::atomic<uint64_t> indexCount_;
+
+    std::atomic<uint32_t> lastWriteSeq_;
+    std::atomic<uint64_t> lastWritePos_;
+    std::atomic<uint64_t> lastWriteTimestamp_;
+
+    // Resize handoff to the lock-free writer; the pending fields are written before
+    // kSwapPending is published and belong to whoever claims the swap
+    enum SwapState : uint32_t {
+        kSwapIdle,
+        kSwapPending,
+        kSwapClaimed,
+        kSwapDone
+    };
+    std::atomic<uint32_t> swapState_;
+    RealtimeBuffer pendingRing_;
+    size_t pendingSize_;
+    uint64_t pendingCopiedTo_;   // Bulk copy covered everything before this position
+    uint64_t pendingValidFrom_;  // and nothing before this one
+
+    // The buffer's own reader, used by getData/clear
+    alignas(kCacheLineSize) ReadCursor defaultCursor_;
+    std::atomic<uint64_t> droppedBytes_;
 };
 
-#endif // AUDIO_BUFFER_H 
\ No newline at end of file
+#endif // AUDIO_BUFFER_H
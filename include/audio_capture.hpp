@@ -5,34 +5,40 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <thread>
+#include <atomic>
 #include <portaudio.h>
-#include "audio_buffer.hpp"
+#include "audio_source.hpp"
+#include "thread_schedule.hpp"
 
-class AudioCapture {
+// PortAudio input device source
+class AudioCapture : public AudioSource {
 public:
+    // Callback: PortAudio calls us from its own thread.
+    // BlockingRead: the stream is opened without a callback and a dedicated thread calls
+    // Pa_ReadStream, which can be given a realtime priority and pinned to a core.
+    enum class CaptureMode { Callback, BlockingRead };
+
     AudioCapture(const std::string& deviceName, 
                  int sampleRate, 
                  int channels, 
                  int bitDepth,
                  int bufferSize);
-    ~AudioCapture();
+    ~AudioCapture() override;
 
-    bool initialize();
-    bool start();
-    bool stop();
-    bool isRunning() const;
+    bool initialize() override;
+    bool start() override;
+    bool stop() override;
+    bool isRunning() const override;
     
-    // Getters for current settings
-    int getSampleRate() const { return sampleRate_; }
-    int getChannels() const { return channels_; }
-    int getBitDepth() const { return bitDepth_; }
-    std::string getDeviceName() const { return deviceName_; }
+    std::string getDeviceName() const override { return deviceName_; }
     
-    // Setters that can be called via ZMQ commands
-    bool setSampleRate(int sampleRate);
+    // Select the capture mode before initialize(); readThreadSchedule only applies to BlockingRead
+    void setCaptureMode(CaptureMode mode, const ThreadSchedule& readThreadSchedule = ThreadSchedule());
+    CaptureMode getCaptureMode() const { return captureMode_; }
     
-    // Set callback for when new audio data is available
-    void setAudioDataCallback(std::function<void(const std::vector<uint8_t>&, uint64_t)> callback);
+    // Setters that can be called via ZMQ commands
+    bool setSampleRate(int sampleRate) override;
     
 private:
     static int paCallback(const void* inputBuffer, void* outputBuffer,
@@ -40,20 +46,22 @@ private:
                           const PaStreamCallbackTimeInfo* timeInfo,
                           PaStreamCallbackFlags statusFlags,
                           void* userData);
+    
+    // Blocking-read capture thread
+    void readLoop();
 
     std::string deviceName_;
-    int sampleRate_;
-    int channels_;
-    int bitDepth_;
-    int bufferSize_;  // in milliseconds
-    int bytesPerSample_;
     
     PaStream* stream_;
     bool isInitialized_;
-    bool isRunning_;
+    // Also cleared by the read thread when the device fails
+    std::atomic<bool> isRunning_;
     
-    std::shared_ptr<AudioBuffer> audioBuffer_;
-    std::function<void(const std::vector<uint8_t>&, uint64_t)> dataCallback_;
+    CaptureMode captureMode_;
+    ThreadSchedule readThreadSchedule_;
+    std::thread readThread_;
+    std::atomic<bool> readRunning_;
+    std::vector<uint8_t> readBuffer_;
 };
 
 #endif // AUDIO_CAPTURE_H 
\ No newline at end of file
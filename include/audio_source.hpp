@@ -0,0 +1,166 @@
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "audio_buffer.hpp"
+#include "audio_block_pool.hpp"
+#include "capture_clock.hpp"
+
+// Snapshot of a source's capture counters
+struct CaptureCounters {
+    uint64_t inputOverflows = 0;
+    uint64_t inputUnderflows = 0;
+    uint64_t framesCaptured = 0;
+    uint64_t framesDropped = 0;  // Captured but not handed to the callback (block pool exhausted)
+};
+
+// Receives each captured block on the capture thread. The handle may be copied
+// to keep the block alive after the call returns.
+using AudioDataCallback = std::function<void(const AudioBlockHandle&)>;
+
+// Anything that produces interleaved PCM blocks for the publishing pipeline
+// Implementations only decide where samples come from; timestamping, buffering and
+// block pooling are shared here so every source feeds the pipeline the same way.
+class AudioSource {
+public:
+    // Number of capture blocks that can be in flight at once
+    static constexpr size_t kBlockPoolSize = 64;
+
+    // Audio kept in the source's ring buffer for history requests, in milliseconds
+    static constexpr int kDefaultHistoryMs = 5000;
+
+    // Status flags for processInput
+    static constexpr unsigned kInputOverflow = 1u << 0;
+    static constexpr unsigned kInputUnderflow = 1u << 1;
+
+    AudioSource(int sampleRate, int channels, int bitDepth, int bufferSize);
+    virtual ~AudioSource() = default;
+
+    virtual bool initialize() = 0;
+    virtual bool start() = 0;
+    virtual bool stop() = 0;
+    virtual bool isRunning() const = 0;
+
+    // Getters for current settings
+    int getSampleRate() const { return sampleRate_; }
+    int getChannels() const { return channels_; }
+    int getBitDepth() const { return bitDepth_; }
+    virtual std::string getDeviceName() const = 0;
+
+    // Setters that can be called via ZMQ commands
+    virtual bool setSampleRate(int sampleRate) = 0;
+
+    // Set callback for when new audio data is available
+    void setAudioDataCallback(AudioDataCallback callback);
+
+    // Size the block pool for framesPerBuffer-sized blocks (done by initialize())
+    void prepareBlockPool(unsigned long framesPerBuffer);
+
+    // Capture hot path: timestamp and buffer the input and hand it to the data callback in a
+    // pooled block. adcTime/streamTime are the stream clock times in seconds (0 if unknown),
+    // statusFlags a combination of kInputOverflow/kInputUnderflow.
+    // Does not allocate or lock.
+    void processInput(const void* inputBuffer, unsigned long framesPerBuffer,
+                      double adcTime = 0.0, double streamTime = 0.0, unsigned statusFlags = 0);
+
+    // Counters since construction; safe to call from any thread
+    CaptureCounters getCaptureCounters() const;
+
+    // Length of the ring buffer. Resizes in place without dropping buffered audio, also while
+    // capturing (the capture thread switches buffers at its next block).
+    bool setHistoryMs(int historyMs);
+    int getHistoryMs() const { return historyMs_; }
+
+    std::shared_ptr<AudioBlockPool> getBlockPool() const { return blockPool_; }
+    std::shared_ptr<AudioBuffer> getAudioBuffer() const { return audioBuffer_; }
+
+protected:
+    // Frames per block for the configured buffer size
+    unsigned long getFramesPerBuffer() const { return (sampleRate_ * bufferSize_) / 1000; }
+
+    // Switch to a new sample format (e.g. taken from a file header); resets buffering and timing
+    void setFormat(int sampleRate, int channels, int bitDepth);
+
+    int sampleRate_;
+    int channels_;
+    int bitDepth_;
+    int bufferSize_;  // in milliseconds
+    int bytesPerSample_;
+    int historyMs_;
+
+    std::shared_ptr<AudioBuffer> audioBuffer_;
+    CaptureClock captureClock_;
+    std::shared_ptr<AudioBlockPool> blockPool_;
+    // Pools replaced by a larger one stay alive while their blocks may still be referenced
+    std::vector<std::shared_ptr<AudioBlockPool>> retiredPools_;
+    AudioDataCallback dataCallback_;
+
+    // Written by the capture thread only, read from anywhere
+    std::atomic<uint64_t> inputOverflows_;
+    std::atomic<uint64_t> inputUnderflows_;
+    std::atomic<uint64_t> framesCaptured_;
+    std::atomic<uint64_t> framesDropped_;
+    // Capture thread only: gaps not yet attached to a delivered block
+    CaptureGap pendingGap_;
+};
+
+// Base for sources that generate blocks on their own thread instead of a device callback
+class ThreadedAudioSource : public AudioSource {
+public:
+    enum class Pacing {
+        RealTime,          // One block per block duration, like a sound card
+        AsFastAsPossible   // Produce blocks as soon as the pipeline has a free one
+    };
+
+    ThreadedAudioSource(int sampleRate, int channels, int bitDepth, int bufferSize, Pacing pacing);
+    ~ThreadedAudioSource() override;
+
+    bool initialize() override;
+    bool start() override;
+    bool stop() override;
+    bool isRunning() const override;
+    bool setSampleRate(int sampleRate) override;
+
+    Pacing getPacing() const { return pacing_; }
+
+protected:
+    // Prepare the underlying source; may call setFormat()
+    virtual bool openSource() = 0;
+
+    // Fill frames of interleaved samples in the current format; return false to end the stream
+    virtual bool fillBlock(uint8_t* dest, unsigned long frames) = 0;
+
+    // Whether the source can produce a different sample rate than its native one
+    virtual bool canChangeSampleRate() const { return true; }
+
+private:
+    void generateLoop();
+
+    Pacing pacing_;
+    bool isInitialized_;
+    std::vector<uint8_t> scratch_;
+    std::thread generateThread_;
+    std::atomic<bool> running_;
+};
+
+// Create a source from a --input-source spec:
+//   device[:<name>]  PortAudio input (name, or deviceName when omitted, selects the device)
+//   file:<path>      WAV or raw PCM replay (.wav is parsed, anything else is raw in the given format)
+//   sine[:<hz>]      Synthetic sine tone (default 440 Hz)
+//   noise            Synthetic white noise
+// pacing is "realtime" or "fast" and applies to file and synthetic sources.
+// Returns nullptr for an unknown spec.
+std::shared_ptr<AudioSource> createAudioSource(const std::string& spec,
+                                               const std::string& deviceName,
+                                               int sampleRate,
+                                               int channels,
+                                               int bitDepth,
+                                               int bufferSize,
+                                               const std::string& pacing);
+
+#endif // AUDIO_SOURCE_H
@@ -0,0 +1,45 @@
+#ifndef CAPTURE_CLOCK_H
+#define CAPTURE_CLOCK_H
+
+#include <cstdint>
+
+// Timing information attached to every captured block
+struct CaptureTime {
+    uint64_t frameIndex = 0;    // Frames captured before this block since the stream was opened
+    double adcTime = 0.0;       // PortAudio inputBufferAdcTime in seconds (0 if unavailable)
+    uint64_t monotonicNs = 0;   // Capture time of the first frame on the steady clock
+    uint64_t epochNs = 0;       // monotonicNs mapped to the Unix epoch
+};
+
+// Derives sample-accurate block timestamps from the running frame count
+// The steady-clock time of frame 0 is tracked with a first-order filter, so
+// scheduling jitter in the callback is smoothed out while clock drift between the
+// sound card and the host is followed. Wall-clock time is derived through a smoothed
+// steady-to-system offset, so NTP steps are slewed instead of showing up as jumps.
+class CaptureClock {
+public:
+    explicit CaptureClock(int sampleRate);
+
+    // Forget all history and start counting frames from zero
+    void reset(int sampleRate);
+
+    // Stamp a block of frames. adcTime and streamTime come from PortAudio's
+    // PaStreamCallbackTimeInfo (inputBufferAdcTime and currentTime); pass 0 when unknown.
+    // Called once per block on the capture thread; does not allocate.
+    CaptureTime stamp(unsigned long frames, double adcTime, double streamTime);
+    
+    // Same, with the steady and system clocks read by the caller (in ns since their epochs)
+    CaptureTime stamp(unsigned long frames, double adcTime, double streamTime,
+                      int64_t steadyNowNs, int64_t systemNowNs);
+
+    uint64_t getFramesCaptured() const { return framesCaptured_; }
+
+private:
+    int sampleRate_;
+    uint64_t framesCaptured_;
+    bool anchored_;
+    double anchorNs_;        // Smoothed steady-clock time of frame 0
+    double epochOffsetNs_;   // Smoothed system_clock - steady_clock
+};
+
+#endif // CAPTURE_CLOCK_H
@@ -0,0 +1,111 @@
+#ifndef CAPTURE_JOURNAL_H
+#define CAPTURE_JOURNAL_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include "audio_buffer.hpp"
+#include "ring_reader.hpp"
+
+class AudioSource;
+
+// File-backed rolling history of one stream's audio.
+// The file is a fixed-size ring of segments, each holding a contiguous run of audio
+// (a gap or timestamp jump starts a new segment):
+//
+//   page 0    file header (magic "TSJRNL01", format, segment geometry)
+//   page 1..  segment table, one entry per segment
+//   then      segment data, segmentCount * segmentBytes
+//
+// The file is mapped shared, so everything appended is in the page cache the moment it
+// is written and survives a crash of this process; other processes can map the same file
+// read-only (openForReading) and query it while we write. Segment entries carry a
+// version that is odd while the segment is being recycled, so readers can detect that
+// the data they copied was overwritten.
+class CaptureJournal : public RingReader {
+public:
+    static constexpr int kDefaultSegmentMs = 1000;
+
+    explicit CaptureJournal(const std::string& path);
+    ~CaptureJournal() override;
+
+    // Open the file for writing, sized to sizeBytes. An existing journal with the same
+    // format and geometry is continued; anything else at the path is reinitialized.
+    bool create(int sampleRate, int channels, int bitDepth, uint64_t sizeBytes,
+                int segmentMs = kDefaultSegmentMs);
+
+    // Map an existing journal read-only (e.g. from another process)
+    bool openForReading();
+
+    void close();
+    bool isOpen() const { return base_ != nullptr; }
+
+    // Append audio whose first frame was captured at timestamp (ms since epoch).
+    // Only one thread may append.
+    void append(const void* data, size_t size, uint64_t timestamp);
+
+    // Copy the audio captured between two timestamps (ms since epoch). The copy stops at the
+    // first gap in the recording; lostFrames counts requested frames already recycled.
+    ReadResult readRange(uint64_t fromTimestamp, uint64_t toTimestamp) const;
+
+    // Timestamps of the oldest and newest audio held (0 when empty)
+    void getSpan(uint64_t& oldestTimestamp, uint64_t& newestTimestamp) const;
+
+    // Schedule write-back of dirty pages; does not wait for the disk
+    void flush();
+
+    // Continuously journal a source's ring buffer on a background thread, from the oldest
+    // audio it holds
+    bool start(std::shared_ptr<AudioSource> source);
+
+    const std::string& getPath() const { return path_; }
+    int getSampleRate() const;
+    int getChannels() const;
+    int getBitDepth() const;
+    uint64_t getBytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+
+protected:
+    // Restart the journal if the format changed; false if it cannot be recreated
+    bool onRing(AudioSource& source) override;
+    void onChunk(const ReadResult& chunk) override;
+    // Schedule write-back every kFlushInterval and on stop
+    void onCaughtUp(bool stopping) override;
+
+private:
+    struct FileHeader;
+    struct SegmentEntry;
+
+    bool mapFile(bool writable, uint64_t totalBytes);
+    void unmapFile();
+    void initializeLayout(int sampleRate, int channels, int bitDepth, uint64_t segmentBytes, uint64_t segmentCount);
+    bool layoutMatches(int sampleRate, int channels, int bitDepth, uint64_t segmentBytes, uint64_t segmentCount) const;
+    void resumeAfterNewestSegment();
+    void openSegment(uint64_t timestamp);
+
+    FileHeader* header() const;
+    SegmentEntry* segment(uint64_t index) const;
+    uint8_t* segmentData(uint64_t index) const;
+    uint64_t frameBytes() const;
+
+    std::string path_;
+    int fd_;
+    uint8_t* base_;
+    uint64_t mappedBytes_;
+    uint64_t sizeBytes_;
+    int segmentMs_;
+    // Held while mapping or unmapping, and by in-process readers
+    mutable std::mutex mapMutex_;
+
+    // Writer state
+    uint64_t currentSegment_;
+    uint64_t nextSequence_;
+    bool segmentOpen_;
+    uint64_t expectedTimestamp_;
+    std::atomic<uint64_t> bytesWritten_;
+    std::chrono::steady_clock::time_point nextFlush_;
+};
+
+#endif // CAPTURE_JOURNAL_H
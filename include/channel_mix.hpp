@@ -0,0 +1,59 @@
+#ifndef CHANNEL_MIX_H
+#define CHANNEL_MIX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Which input channels, at which gains, make up each output channel of a derived layout.
+// Written as output channels separated by ';', each a '+'-separated sum of
+// "[<gain>*]<input channel>" (zero-based), "mix" for the mean of all inputs or "all" to
+// pass every channel through:
+//   "0"            channel 0 only
+//   "1;0"          stereo with the sides swapped
+//   "0.5*0+0.5*1"  mono mix of a stereo pair
+//   "mix"          mono mix of however many channels the source has
+//   "all"          the source layout unchanged (e.g. to publish it at another rate)
+struct ChannelMatrix {
+    std::vector<std::vector<std::pair<int, float>>> outputs;  // (input channel, gain) terms
+    bool mixAll = false;
+    bool allChannels = false;
+    std::string spec;
+
+    // Parse a matrix spec; returns false and logs on malformed input
+    static bool parse(const std::string& spec, ChannelMatrix& matrix);
+};
+
+// Applies a channel matrix to one stream's audio. A matrix that only picks channels
+// (one term of gain 1 per output) copies samples in their own format, so it is exact;
+// anything else mixes in float, one output channel at a time over planar input, with
+// SSE2/AVX2 kernels per getSimdLevel().
+class ChannelMixer {
+public:
+    explicit ChannelMixer(const ChannelMatrix& matrix);
+
+    // Resolve the matrix for a source with this many channels; false (and logged, with no
+    // output channels left) if it names a channel the source does not have
+    bool setInputChannels(int channels);
+
+    int getInputChannels() const { return inputChannels_; }
+    int getOutputChannels() const { return static_cast<int>(terms_.size()); }
+    bool isSelection() const { return selection_; }
+    const ChannelMatrix& getMatrix() const { return matrix_; }
+
+    // Mix planar float input (inputChannels rows of frames) into planar float output
+    void mix(const float* input, size_t frames, float* output) const;
+
+    // Pick channels from interleaved samples of sampleBytes each (selection matrices only)
+    void select(const uint8_t* input, size_t frames, size_t sampleBytes, uint8_t* output) const;
+
+private:
+    ChannelMatrix matrix_;
+    int inputChannels_;
+    bool selection_;
+    std::vector<std::vector<std::pair<int, float>>> terms_;  // Resolved per output channel
+};
+
+#endif // CHANNEL_MIX_H
@@ -0,0 +1,29 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <string>
+
+// Vector instruction sets our kernels are built for. Kernels for every level are compiled
+// into the binary (AVX2 ones with a function target attribute) and picked at runtime,
+// so one build runs on any x86-64 CPU. Other architectures use the scalar kernels.
+enum class SimdLevel {
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// Best level this CPU supports
+SimdLevel detectSimdLevel();
+
+// Level the kernels currently dispatch to (the detected one unless overridden)
+SimdLevel getSimdLevel();
+
+// Force a level, e.g. to compare kernels; returns false if the CPU does not support it
+bool setSimdLevel(SimdLevel level);
+
+std::string simdLevelName(SimdLevel level);
+
+// Parse "scalar", "sse2" or "avx2"; returns false and logs on anything else
+bool parseSimdLevel(const std::string& name, SimdLevel& level);
+
+#endif // CPU_FEATURES_H
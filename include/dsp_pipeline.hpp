@@ -0,0 +1,248 @@
+#ifndef DSP_PIPELINE_H
+#define DSP_PIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_source.hpp"
+#include "mpsc_queue.hpp"
+#include "sample_format.hpp"
+#include "thread_schedule.hpp"
+#include "work_stealing_pool.hpp"
+
+// One stage of a processing chain as given on the command line
+struct DspStageSpec {
+    std::string type;    // gain, dc, highpass or lowpass
+    double value = 0.0;  // Gain in dB or cutoff in Hz
+};
+
+// Processing chain, written as a comma-separated list of "<type>[:<value>]" stages that run
+// in order, e.g. "dc,highpass:80,gain:6":
+//   gain:<db>       Multiply by a gain in dB
+//   dc[:<hz>]       Remove DC with a one-pole high-pass (default 5 Hz)
+//   highpass:<hz>   Second-order Butterworth high-pass
+//   lowpass:<hz>    Second-order Butterworth low-pass
+struct DspSettings {
+    std::vector<DspStageSpec> stages;
+
+    bool enabled() const { return !stages.empty(); }
+
+    // Parse a chain; returns false and logs on malformed input
+    static bool parse(const std::string& spec, DspSettings& settings);
+
+    std::string toString() const;
+};
+
+// A transform over float planar audio, in place. Stages keep per-channel state, so any
+// range of channels can be processed on its own.
+class DspStage {
+public:
+    explicit DspStage(const std::string& name) : name_(name) {}
+    virtual ~DspStage() = default;
+
+    const std::string& getName() const { return name_; }
+
+    // Set up for a stream format and clear the state; false if the stage cannot run at it
+    virtual bool configure(int sampleRate, int channels) = 0;
+
+    // Forget the signal history, as after a gap
+    virtual void reset() {}
+
+    // Process frames samples of channels [firstChannel, firstChannel + channelCount) of a
+    // planar block, each channel's samples frames apart
+    virtual void process(float* planar, size_t frames, int firstChannel, int channelCount) = 0;
+
+    // Build the stage for a spec; nullptr for an unknown type
+    static std::unique_ptr<DspStage> create(const DspStageSpec& spec);
+
+private:
+    std::string name_;
+};
+
+class GainStage : public DspStage {
+public:
+    explicit GainStage(double gainDb);
+
+    bool configure(int sampleRate, int channels) override;
+    void process(float* planar, size_t frames, int firstChannel, int channelCount) override;
+
+private:
+    float gain_;
+};
+
+// y[n] = x[n] - x[n-1] + r * y[n-1]
+class DcBlockStage : public DspStage {
+public:
+    explicit DcBlockStage(double cutoffHz);
+
+    bool configure(int sampleRate, int channels) override;
+    void reset() override;
+    void process(float* planar, size_t frames, int firstChannel, int channelCount) override;
+
+private:
+    double cutoffHz_;
+    float pole_;
+    std::vector<float> lastInput_;
+    std::vector<float> lastOutput_;
+};
+
+// RBJ cookbook biquad with Q = 1/sqrt(2), in transposed direct form II
+class BiquadStage : public DspStage {
+public:
+    enum class Type {
+        HighPass,
+        LowPass
+    };
+
+    BiquadStage(Type type, double cutoffHz);
+
+    bool configure(int sampleRate, int channels) override;
+    void reset() override;
+    void process(float* planar, size_t frames, int firstChannel, int channelCount) override;
+
+private:
+    Type type_;
+    double cutoffHz_;
+    float b0_, b1_, b2_, a1_, a2_;
+    std::vector<float> z1_;
+    std::vector<float> z2_;
+};
+
+// Time spent in one step of a pipeline, summed over the threads that ran it
+struct DspStageStats {
+    std::string name;
+    uint64_t blocks = 0;
+    uint64_t frames = 0;
+    uint64_t ns = 0;
+};
+
+// Runs a chain of stages over blocks in a stream's captured format: each block is converted
+// to float planar, passed through every stage and converted back in place. The conversions
+// are timed as the "to_float" and "from_float" steps around the stages.
+// With a thread pool, the channels are split into groups that run the whole chain as one
+// task each; process() returns once every group is done. Each channel is still processed
+// by exactly one thread in the same order, so the output does not depend on the split.
+// process() is not thread-safe; getStats() may be called from any thread.
+class DspPipeline {
+public:
+    // Channels per task when the stages run on a pool
+    static constexpr int kChannelsPerGroup = 4;
+
+    explicit DspPipeline(const DspSettings& settings);
+
+    DspPipeline(const DspPipeline&) = delete;
+    DspPipeline& operator=(const DspPipeline&) = delete;
+
+    // Set up for a stream format and clear every stage; false (and logged) if it cannot run
+    bool configure(const SampleSpec& spec, int channels, int sampleRate);
+    bool isConfigured() const { return configured_; }
+
+    // Forget the signal history of every stage
+    void reset();
+
+    // Split the stages across pool's threads by groups of channelsPerGroup (nullptr: run
+    // them on the calling thread). Not while process() runs.
+    void setThreadPool(std::shared_ptr<WorkStealingPool> pool, int channelsPerGroup = kChannelsPerGroup);
+    size_t getThreadCount() const { return pool_ ? pool_->getThreadCount() : 1; }
+
+    // Process frames of interleaved audio in the configured format, in place
+    void process(uint8_t* data, size_t frames);
+
+    size_t getStageCount() const { return stages_.size(); }
+
+    // Per step, in processing order: to_float, each stage, from_float
+    std::vector<DspStageStats> getStats() const;
+
+private:
+    struct StepCounters {
+        std::atomic<uint64_t> blocks{0};
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> ns{0};
+    };
+
+    void count(StepCounters& counters, size_t frames, uint64_t ns);
+    // Every stage over channels [firstChannel, firstChannel + channelCount) of planar_
+    void runStages(size_t frames, int firstChannel, int channelCount);
+
+    std::vector<std::unique_ptr<DspStage>> stages_;
+    std::unique_ptr<StepCounters[]> counters_;  // stages_.size() + 2
+    std::shared_ptr<WorkStealingPool> pool_;
+    int channelsPerGroup_;
+    bool configured_;
+    int channels_;
+    std::unique_ptr<SampleConverter> toFloat_;
+    std::unique_ptr<SampleConverter> fromFloat_;
+    std::vector<float> planar_;
+};
+
+// Runs a pipeline on its own thread between a source and the publisher. The capture
+// callback only queues the block (submit() never blocks or allocates); the worker processes
+// it in place and hands it to the output callback. Blocks that do not fit in the queue are
+// dropped and reported as dropped_frames in the gap of the next block that goes out.
+class DspWorker {
+public:
+    static constexpr size_t kQueueSize = AudioSource::kBlockPoolSize;
+
+    // stream only names the thread ("dsp <stream>"); pool, if any, takes the stages' work
+    DspWorker(size_t stream, const DspSettings& settings, AudioDataCallback output,
+              std::shared_ptr<WorkStealingPool> pool = nullptr);
+    ~DspWorker();
+
+    DspWorker(const DspWorker&) = delete;
+    DspWorker& operator=(const DspWorker&) = delete;
+
+    // The source's format is followed from block to block
+    bool start(std::shared_ptr<AudioSource> source);
+    void stop();
+    bool isRunning() const { return running_; }
+    void setThreadSchedule(const ThreadSchedule& schedule) { threadSchedule_ = schedule; }
+
+    // Capture thread: queue a block for processing
+    void submit(const AudioBlockHandle& block);
+
+    const DspSettings& getSettings() const { return settings_; }
+    std::vector<DspStageStats> getStageStats() const { return pipeline_.getStats(); }
+    size_t getThreadCount() const { return pipeline_.getThreadCount(); }
+    uint64_t getBlocksProcessed() const { return blocksProcessed_.load(std::memory_order_relaxed); }
+    uint64_t getFramesDropped() const { return framesDropped_.load(std::memory_order_relaxed); }
+    // Average time per block through the whole pipeline, and as a share of the audio's duration
+    double getProcessUsPerBlock() const;
+    double getProcessLoadPercent() const;
+
+private:
+    void processLoop();
+    void processBlock(const AudioBlockHandle& block);
+
+    size_t stream_;
+    DspSettings settings_;
+    AudioDataCallback output_;
+    DspPipeline pipeline_;
+    MpscQueue<AudioBlockHandle> queue_;
+
+    std::shared_ptr<AudioSource> source_;
+    ThreadSchedule threadSchedule_;
+    std::thread processThread_;
+    std::atomic<bool> running_;
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCondition_;
+
+    // Worker thread only: the format the pipeline is configured for
+    int sampleRate_;
+    int channels_;
+    int bitDepth_;
+
+    std::atomic<uint64_t> pendingDropFrames_;  // Dropped since the last block went out
+    std::atomic<uint64_t> framesDropped_;
+    std::atomic<uint64_t> blocksProcessed_;
+    std::atomic<uint64_t> framesProcessed_;
+    std::atomic<uint64_t> processNs_;
+    std::atomic<int> processRate_;  // Sample rate of the last processed block
+};
+
+#endif // DSP_PIPELINE_H
@@ -0,0 +1,72 @@
+#ifndef FEATURE_STREAM_H
+#define FEATURE_STREAM_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include "audio_buffer.hpp"
+#include "ring_reader.hpp"
+#include "spectral.hpp"
+
+class AudioSource;
+class ZmqPublisher;
+class ChannelMixer;
+class SampleConverter;
+
+// Computes spectral features of one stream on a background thread and publishes them on
+// the publisher stream registered for them (ZmqPublisher::addEncodedStream), reading the
+// source's ring buffer as a RingReader. Sources wider than mono are analyzed as a mono mix.
+// Each message holds the feature frames of one read of the ring, row by row, with the
+// capture time of the first one's window start.
+class FeatureStream : public RingReader {
+public:
+    FeatureStream(std::shared_ptr<ZmqPublisher> publisher, size_t publisherStream, const FeatureSettings& settings);
+    ~FeatureStream() override;
+
+    bool start(std::shared_ptr<AudioSource> source);
+
+    const FeatureSettings& getSettings() const { return settings_; }
+    size_t getPublisherStream() const { return publisherStream_; }
+
+    // Values per feature frame for the current format, 0 before the first read
+    size_t getBins() const { return bins_.load(std::memory_order_relaxed); }
+    // Cost: feature frames so far, and time spent converting and analyzing audio for them
+    uint64_t getFramesComputed() const { return framesComputed_.load(std::memory_order_relaxed); }
+    uint64_t getComputeNs() const { return getProcessNs(); }
+    // Average per feature frame in microseconds, and as a share of the audio's duration
+    double getComputeUsPerFrame() const;
+    double getComputeLoadPercent() const;
+
+protected:
+    // Set up for the source's current format; false if it cannot be analyzed
+    bool onRing(AudioSource& source) override;
+    void onChunk(const ReadResult& chunk) override;
+
+private:
+    void process(const ReadResult& chunk);
+
+    std::shared_ptr<ZmqPublisher> publisher_;
+    size_t publisherStream_;
+    FeatureSettings settings_;
+
+    // Analysis thread only
+    int inputRate_;
+    int inputChannels_;
+    std::unique_ptr<SampleConverter> toFloat_;  // Captured format to float planar
+    std::unique_ptr<ChannelMixer> mixer_;       // Wider sources to mono
+    std::unique_ptr<SpectralAnalyzer> analyzer_;
+    std::vector<float> planar_;
+    std::vector<float> mixed_;
+    std::vector<float> features_;
+    uint64_t analyzerOrigin_;     // Frames read before the analyzer's frame 0
+    uint64_t framesRead_;         // Frames read (or lost) since configure()
+    uint64_t featureIndex_;
+    uint64_t pendingGapFrames_;   // Lost before the next feature frame
+
+    std::atomic<size_t> bins_;
+    std::atomic<uint64_t> framesComputed_;
+};
+
+#endif // FEATURE_STREAM_H
@@ -0,0 +1,44 @@
+#ifndef FILE_AUDIO_SOURCE_H
+#define FILE_AUDIO_SOURCE_H
+
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include "audio_source.hpp"
+
+// Replays a WAV or raw PCM file as if it were an input device, looping at the end
+// WAV files (PCM or WAVE_FORMAT_EXTENSIBLE PCM) supply their own format; raw files
+// are read in the format given to the constructor.
+class FileAudioSource : public ThreadedAudioSource {
+public:
+    // Lowest WAV sample rate accepted; buffers are sized in whole samples per millisecond
+    static constexpr int kMinSampleRate = 1000;
+    
+    FileAudioSource(const std::string& path,
+                    int sampleRate,
+                    int channels,
+                    int bitDepth,
+                    int bufferSize,
+                    Pacing pacing = Pacing::RealTime);
+    ~FileAudioSource() override;
+
+    std::string getDeviceName() const override { return "file:" + path_; }
+
+protected:
+    bool openSource() override;
+    bool fillBlock(uint8_t* dest, unsigned long frames) override;
+    bool canChangeSampleRate() const override { return !isWav_; }
+
+private:
+    bool parseWavHeader();
+
+    std::string path_;
+    std::ifstream file_;
+    bool isWav_;
+    bool unsignedSamples_;       // 8-bit WAV data is unsigned, PortAudio paInt8 is signed
+    std::streamoff dataStart_;
+    uint64_t dataBytes_;
+    uint64_t dataRemaining_;
+};
+
+#endif // FILE_AUDIO_SOURCE_H
@@ -0,0 +1,41 @@
+#ifndef LEVEL_METER_H
+#define LEVEL_METER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "sample_format.hpp"
+
+// Level sums of one channel over some frames, as full-scale fractions
+struct ChannelLevels {
+    double sumSquares = 0.0;
+    float peak = 0.0f;      // Largest magnitude
+    uint64_t clipped = 0;   // Samples at full scale in either direction
+};
+
+// Measures per-channel RMS, peak and clipped samples. Audio is converted to float planar
+// once, then each channel is summed in one pass with SSE2/AVX2 kernels per getSimdLevel().
+// Not thread-safe: keeps the converter and scratch space.
+class LevelMeter {
+public:
+    static constexpr double kMinDbfs = -120.0;  // Digital silence reads as this
+
+    // Add the levels of frames held in spec to levels (resized to channels if it is not)
+    void measure(const uint8_t* data, size_t frames, const SampleSpec& spec, int channels,
+                 std::vector<ChannelLevels>& levels);
+
+    // Full-scale fraction in dBFS, clamped to kMinDbfs
+    static double toDbfs(double value);
+
+    // {"rms_dbfs": [..], "peak_dbfs": [..], "clipped": [..]} for levels over frames,
+    // rounded to 0.1 dB
+    static nlohmann::json toJson(const std::vector<ChannelLevels>& levels, size_t frames);
+
+private:
+    std::unique_ptr<SampleConverter> toPlanar_;
+    std::vector<float> planar_;
+};
+
+#endif // LEVEL_METER_H
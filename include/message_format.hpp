@@ -10,6 +10,7 @@
 #include <nlohmann/json.hpp>
 #include <sstream>
 #include <iomanip>
+#include "audio_block_pool.hpp"
 
 using json = nlohmann::json;
 
@@ -57,6 +58,9 @@ struct StatusMessage : BaseMessage {
 // Helper function to get current timestamp in ISO 8601 format
 std::string getCurrentTimestamp();
 
+// The "gap" metadata object of an audio message: what was lost just before it
+json gapToJson(const CaptureGap& gap);
+
 } // namespace message_format
 
 
@@ -0,0 +1,98 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "ring_util.hpp"
+
+// Bounded lock-free multi-producer/single-consumer queue
+// Each slot carries a sequence number that tells producers and the consumer whose
+// turn it is (Vyukov's bounded queue), so tryPush never blocks and never allocates.
+// Capacity is rounded up to a power of two.
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t minCapacity)
+        : capacity_(roundUpPowerOfTwo(minCapacity < 2 ? 2 : minCapacity)),
+          mask_(capacity_ - 1),
+          slots_(new Slot[capacity_]),
+          enqueuePos_(0),
+          dequeuePos_(0) {
+        for (size_t i = 0; i < capacity_; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread: move item into the queue, returns false when full
+    bool tryPush(T&& item) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Slot* slot;
+
+        while (true) {
+            slot = &slots_[pos & mask_];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                // Slot is free for this position, try to claim it
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // Consumer has not freed this slot yet: full
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->value = std::move(item);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only: move the oldest item out, returns false when empty
+    bool tryPop(T& item) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Slot* slot = &slots_[pos & mask_];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+
+        if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1) < 0) {
+            return false;  // Nothing published at this position yet
+        }
+
+        item = std::move(slot->value);
+        slot->value = T();  // Release whatever the slot still references
+        dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+        slot->sequence.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of queued items
+    size_t size() const {
+        size_t dequeue = dequeuePos_.load(std::memory_order_relaxed);
+        size_t enqueue = enqueuePos_.load(std::memory_order_relaxed);
+        return enqueue >= dequeue ? enqueue - dequeue : 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    alignas(kCacheLineSize) std::atomic<size_t> enqueuePos_;
+    alignas(kCacheLineSize) std::atomic<size_t> dequeuePos_;
+};
+
+#endif // MPSC_QUEUE_H
@@ -0,0 +1,89 @@
+#ifndef OPUS_STREAM_H
+#define OPUS_STREAM_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include "audio_buffer.hpp"
+#include "ring_reader.hpp"
+
+class AudioSource;
+class ZmqPublisher;
+class ChannelMixer;
+class Resampler;
+class SampleConverter;
+struct OpusEncoder;
+
+// Encodes one stream's audio to Opus on a background thread and publishes each 20 ms
+// packet on the publisher stream registered for it (ZmqPublisher::addEncodedStream),
+// reading the source's ring buffer as a RingReader. Mono and stereo sources are encoded
+// as they are, wider ones as a mono mix; rates Opus does not take are resampled to 48 kHz.
+// Without libopus (TESSA_HAVE_OPUS unset) start() fails.
+class OpusStreamEncoder : public RingReader {
+public:
+    static constexpr int kFrameMs = 20;
+    static constexpr int kDefaultBitrate = 24000;
+    static constexpr int kMinBitrate = 6000;
+    static constexpr int kMaxBitrate = 510000;
+
+    OpusStreamEncoder(std::shared_ptr<ZmqPublisher> publisher, size_t publisherStream, int bitrate);
+    ~OpusStreamEncoder() override;
+
+    // Whether this build links libopus
+    static bool isAvailable();
+
+    bool start(std::shared_ptr<AudioSource> source);
+
+    int getBitrate() const { return bitrate_; }
+    size_t getPublisherStream() const { return publisherStream_; }
+
+    // Encode cost: packets so far, and time spent converting and encoding them
+    uint64_t getPacketsEncoded() const { return packetsEncoded_.load(std::memory_order_relaxed); }
+    uint64_t getEncodeNs() const { return getProcessNs(); }
+    // Average per packet in microseconds, and as a share of the audio's duration
+    double getEncodeUsPerPacket() const;
+    double getEncodeLoadPercent() const;
+
+protected:
+    // Set up the encoder for the source's current format; false if Opus cannot take it
+    bool onRing(AudioSource& source) override;
+    void onChunk(const ReadResult& chunk) override;
+    // Hand one packet of frames (at the encode rate) to the publisher, adding derived_from
+    virtual void publishPacket(std::vector<uint8_t> packet, size_t frames,
+                               std::map<std::string, nlohmann::json> metadata);
+
+private:
+    void resetState();
+    void process(const ReadResult& chunk);
+    void encodePending();
+
+    std::shared_ptr<ZmqPublisher> publisher_;
+    size_t publisherStream_;
+    int bitrate_;
+
+    // Encoder thread only
+    OpusEncoder* encoder_;
+    int inputRate_;
+    int inputChannels_;
+    int encodeRate_;
+    int encodeChannels_;
+    std::unique_ptr<SampleConverter> toFloat_;  // Captured format to float planar
+    std::unique_ptr<ChannelMixer> mixer_;       // Wider sources to mono
+    std::unique_ptr<Resampler> resampler_;      // Rates Opus does not take
+    std::vector<float> planar_;
+    std::vector<float> mixed_;
+    std::vector<float> resampled_;
+    std::vector<float> pending_;                // Interleaved, less than one packet's worth
+    double pendingTimestampMs_;                 // Capture time of the first pending frame
+    uint64_t pendingGapFrames_;                 // Lost before the pending audio, at the input rate
+    uint64_t packetIndex_;
+    std::vector<unsigned char> packet_;
+
+    std::atomic<uint64_t> packetsEncoded_;
+};
+
+#endif // OPUS_STREAM_H
@@ -0,0 +1,58 @@
+#ifndef PAYLOAD_CODEC_H
+#define PAYLOAD_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "sample_format.hpp"
+
+// Compresses the binary payload of data messages. Messages sent through a codec name it
+// in their metadata ("codec"), together with "payload_bytes", the size once decoded.
+// Codecs keep scratch space, so each instance belongs to one thread.
+class PayloadCodec {
+public:
+    virtual ~PayloadCodec() = default;
+
+    virtual std::string getName() const = 0;
+
+    // Encode frames of audio held in spec into output (replacing its contents). False when
+    // the codec cannot take this format; the caller then sends the payload as it is.
+    virtual bool encode(const uint8_t* data, size_t frames, int channels, const SampleSpec& spec,
+                        std::vector<uint8_t>& output) = 0;
+
+    // Decode a payload produced by encode with the same frames, channels and spec.
+    // False on a corrupt or truncated payload.
+    virtual bool decode(const uint8_t* data, size_t size, size_t frames, int channels, const SampleSpec& spec,
+                        std::vector<uint8_t>& output) = 0;
+
+    // Codec by name ("delta-rice"); "none" leaves codec empty. False (and logged) for
+    // unknown names.
+    static bool create(const std::string& name, std::unique_ptr<PayloadCodec>& codec);
+};
+
+// Lossless integer PCM codec in the style of FLAC's fixed predictors. Each channel of a
+// message picks the polynomial predictor (order 0 to 4) with the smallest residuals, and
+// may code its difference to the previous channel instead when channels are correlated.
+// Residuals are Rice coded in partitions of kPartitionSamples, each with its own parameter.
+// Float audio is not handled (encode returns false).
+class DeltaRiceCodec : public PayloadCodec {
+public:
+    static constexpr size_t kPartitionSamples = 256;
+    static constexpr int kMaxOrder = 4;
+
+    std::string getName() const override { return "delta-rice"; }
+
+    bool encode(const uint8_t* data, size_t frames, int channels, const SampleSpec& spec,
+                std::vector<uint8_t>& output) override;
+    bool decode(const uint8_t* data, size_t size, size_t frames, int channels, const SampleSpec& spec,
+                std::vector<uint8_t>& output) override;
+
+private:
+    std::vector<int64_t> samples_;    // Planar, one row per channel
+    std::vector<int64_t> candidate_;  // Difference to the previous channel
+    std::vector<uint64_t> coded_;     // Zigzagged residuals of the channel being coded
+};
+
+#endif // PAYLOAD_CODEC_H
@@ -0,0 +1,66 @@
+#ifndef PUBLISH_BATCHING_H
+#define PUBLISH_BATCHING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Latency bounds for adaptive publishing, written as "<min_ms>:<max_ms>" on the command line.
+// Disabled, the publisher sends one message per captured block.
+struct BatchingSettings {
+    bool adaptive = false;
+    int minLatencyMs = 5;
+    int maxLatencyMs = 100;
+
+    // Parse a bounds spec; returns false and logs on malformed input
+    static bool parse(const std::string& spec, BatchingSettings& settings);
+
+    std::string toString() const;
+};
+
+// Picks how much audio the publisher packs into one message and how often it flushes.
+// The sender thread reports, once per measurement window, the share of wall time it spent
+// working and the deepest outbound backlog it saw. Falling behind doubles the chunk (fewer,
+// larger messages cost less per frame on a busy socket); a run of idle windows halves it
+// again, back down to the low-latency end. Getters may be called from any thread.
+class BatchController {
+public:
+    static constexpr int kWindowMs = 100;          // Measurement window
+    static constexpr double kGrowLoad = 0.5;       // Busy share that makes us batch more
+    static constexpr double kShrinkLoad = 0.1;     // and the share below which we batch less
+    static constexpr int kShrinkAfterWindows = 10; // Idle windows before shrinking
+
+    explicit BatchController(const BatchingSettings& settings = BatchingSettings());
+
+    // Feed one window: busy share of wall time (0..1), deepest backlog in messages and
+    // the queue capacity it is measured against
+    void update(double senderLoad, size_t backlog, size_t backlogCapacity);
+
+    bool isAdaptive() const { return settings_.adaptive; }
+    const BatchingSettings& getSettings() const { return settings_; }
+
+    // Audio packed into one message; a partly filled message goes out once its first block
+    // has waited this long
+    int getChunkMs() const { return chunkMs_.load(std::memory_order_relaxed); }
+
+    // How often the sender wakes to flush messages and poll the buffer
+    int getFlushIntervalMs() const { return flushIntervalMs_.load(std::memory_order_relaxed); }
+
+    // Busy share of the last window, in percent
+    uint32_t getLoadPercent() const { return loadPercent_.load(std::memory_order_relaxed); }
+
+    // Chunk size in frames for a stream at sampleRate (at least one frame)
+    size_t chunkFrames(int sampleRate) const;
+
+private:
+    void setChunkMs(int chunkMs);
+
+    BatchingSettings settings_;
+    int idleWindows_;
+    std::atomic<int> chunkMs_;
+    std::atomic<int> flushIntervalMs_;
+    std::atomic<uint32_t> loadPercent_;
+};
+
+#endif // PUBLISH_BATCHING_H
@@ -0,0 +1,65 @@
+#ifndef REALTIME_MEMORY_H
+#define REALTIME_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Page-backed storage for buffers the capture path touches (rings, block pools)
+// Memory comes straight from mmap and every page is written once on allocation, so
+// the capture thread never takes a first-touch page fault. After RealtimeMemory::lockAll()
+// the pages are also locked. With huge pages enabled,
+// buffers of 2 MB and more are backed by explicit huge pages when the system has them
+// reserved, and by transparent huge pages otherwise.
+class RealtimeBuffer {
+public:
+    RealtimeBuffer() : data_(nullptr), size_(0), mappedSize_(0), hugePages_(false) {}
+    explicit RealtimeBuffer(size_t bytes);
+    ~RealtimeBuffer();
+
+    RealtimeBuffer(const RealtimeBuffer&) = delete;
+    RealtimeBuffer& operator=(const RealtimeBuffer&) = delete;
+    RealtimeBuffer(RealtimeBuffer&& other) noexcept;
+    RealtimeBuffer& operator=(RealtimeBuffer&& other) noexcept;
+
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool usesHugePages() const { return hugePages_; }
+
+private:
+    void release();
+
+    uint8_t* data_;
+    size_t size_;
+    size_t mappedSize_;
+    bool hugePages_;
+};
+
+// Process-wide realtime memory settings
+class RealtimeMemory {
+public:
+    // Bytes of stack touched by prefaultStack()
+    static constexpr size_t kStackPrefaultBytes = 256 * 1024;
+
+    // Back large RealtimeBuffers with huge pages; set before sources are created
+    static void setHugePages(bool enabled);
+    static bool getHugePages();
+
+    // mlockall(MCL_CURRENT), then mlock each RealtimeBuffer and prefaulted stack from here
+    // on. Not MCL_FUTURE: that would lock and read in every later mapping, journal files
+    // included. Logs and returns false if the limit is too low.
+    static bool lockAll();
+    static bool isLocked();
+
+    // Touch the top of the calling thread's stack so it is resident (and locked, after
+    // lockAll()) before real-time work
+    static void prefaultStack();
+
+    // Bytes currently held by RealtimeBuffers
+    static size_t getBufferBytes();
+
+    // Locked memory reported by the kernel (VmLck), 0 where unavailable
+    static size_t getLockedBytes();
+};
+
+#endif // REALTIME_MEMORY_H
@@ -0,0 +1,63 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Streaming sample rate converter for planar float audio.
+// Polyphase windowed-sinc (Kaiser, about 80 dB stopband): the rate ratio is reduced to
+// L/M and each of the L output phases gets its own filter, so every output sample is a
+// single dot product over the input. Ratios with more than kMaxPhases phases (e.g.
+// 44100 -> 44101) interpolate between neighbouring phase filters instead. The filter
+// cuts off just below the lower of the two Nyquist rates, so downsampling does not alias.
+// Dot products use SSE2/AVX2 kernels per getSimdLevel().
+class Resampler {
+public:
+    // Zero crossings of the sinc on each side, at the lower of the two rates
+    static constexpr int kDefaultZeroCrossings = 32;
+    static constexpr int kMaxPhases = 512;
+
+    Resampler(int inputRate, int outputRate, int channels, int zeroCrossings = kDefaultZeroCrossings);
+
+    // Resample frames of planar input (channels rows of frames). Output frames are written
+    // planar into output (resized to channels rows of the returned count). firstOutputOffset
+    // is where the first output frame falls, in input frames from the first frame of this
+    // input; it is negative when it lies in audio handed in earlier.
+    size_t process(const float* input, size_t frames, std::vector<float>& output, double& firstOutputOffset);
+
+    // Forget buffered input, as after a gap
+    void reset();
+    // Count output frames as produced without computing them, e.g. over a span not sent
+    void skip(uint64_t outputFrames) { outputFrames_ += outputFrames; }
+
+    int getInputRate() const { return inputRate_; }
+    int getOutputRate() const { return outputRate_; }
+    int getChannels() const { return channels_; }
+    int getTaps() const { return taps_; }
+    uint64_t getOutputFrames() const { return outputFrames_; }
+
+private:
+    void buildFilters(int zeroCrossings);
+
+    int inputRate_;
+    int outputRate_;
+    int channels_;
+    uint64_t up_;    // L
+    uint64_t down_;  // M
+    int taps_;       // Per phase, a multiple of 8
+    int phases_;     // Filters stored (plus one extra for interpolation)
+    bool interpolate_;
+    std::vector<float> filters_;  // (phases_ + 1) rows of taps_, one per fractional delay
+
+    // Per channel: taps_ - 1 samples of history followed by the current input
+    std::vector<std::vector<float>> history_;
+    uint64_t position_;  // Input sample at or before the next output, in history coordinates
+    uint64_t phase_;     // and how far past it the output lies, as phase_ / L
+    uint64_t outputFrames_;
+
+    // Window start and phase of each output in the current call
+    std::vector<std::pair<size_t, uint64_t>> schedule_;
+};
+
+#endif // RESAMPLER_H
@@ -0,0 +1,72 @@
+#ifndef RING_READER_H
+#define RING_READER_H
+
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include "audio_buffer.hpp"
+#include "thread_schedule.hpp"
+
+class AudioSource;
+
+// Tails a source's ring buffer on a background thread through its own cursor, so the
+// capture thread and the raw stream never wait for it (the journal, Opus and features
+// consumers). Every interval the thread reads whatever the ring has gained, chunk by chunk,
+// and hands each chunk to onChunk(). When the source replaces its ring on a format change,
+// a fresh cursor is taken and onRing() sets up for the new format first.
+// Derived classes must stop() in their destructor, while their hooks can still run.
+class RingReader {
+public:
+    virtual ~RingReader();
+
+    RingReader(const RingReader&) = delete;
+    RingReader& operator=(const RingReader&) = delete;
+
+    bool start(std::shared_ptr<AudioSource> source);
+    void stop();
+    bool isRunning() const { return running_; }
+    // Applied by the reader thread when it starts
+    void setThreadSchedule(const ThreadSchedule& schedule) { threadSchedule_ = schedule; }
+
+    const std::string& getThreadName() const { return threadName_; }
+    // Time spent in onChunk() so far
+    uint64_t getProcessNs() const { return processNs_.load(std::memory_order_relaxed); }
+
+protected:
+    // fromOldest starts each cursor at the oldest audio the ring holds instead of the newest
+    RingReader(const std::string& threadName, size_t chunkBytes, std::chrono::milliseconds interval,
+               bool fromOldest = false);
+
+    // Reader thread: set up for the source's current format after it replaced its ring (and
+    // before the first read); false skips the ring's audio until the next one
+    virtual bool onRing(AudioSource& source) = 0;
+    // Reader thread: the next chunk; chunk.lostFrames counts the audio the writer overwrote
+    // before we could read it
+    virtual void onChunk(const ReadResult& chunk) = 0;
+    // Reader thread: after each pass that caught up with the writer, and once when stopping
+    virtual void onCaughtUp(bool stopping) { (void)stopping; }
+
+    std::shared_ptr<AudioSource> source_;
+
+private:
+    void readLoop();
+
+    std::string threadName_;
+    size_t chunkBytes_;
+    std::chrono::milliseconds interval_;
+    bool fromOldest_;
+
+    ThreadSchedule threadSchedule_;
+    std::thread readThread_;
+    std::atomic<bool> running_;
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCondition_;
+    std::atomic<uint64_t> processNs_;
+};
+
+#endif // RING_READER_H
@@ -0,0 +1,26 @@
+#ifndef RING_UTIL_H
+#define RING_UTIL_H
+
+#include <cstddef>
+#include <limits>
+
+// Destructive interference size used to keep producer and consumer state on separate cache lines
+constexpr size_t kCacheLineSize = 64;
+
+// Round up to the next power of two (minimum 1), so ring positions can be masked instead of
+// wrapped; 0 if it does not fit in a size_t
+inline size_t roundUpPowerOfTwo(size_t value) {
+    // Past the largest power of two the shift below would wrap to 0 and never end
+    const size_t largest = ~(std::numeric_limits<size_t>::max() >> 1);
+    if (value > largest) {
+        return 0;
+    }
+
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+#endif // RING_UTIL_H
@@ -0,0 +1,75 @@
+#ifndef SAMPLE_FORMAT_H
+#define SAMPLE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// PCM sample encodings: the PortAudio integer formats (little-endian, packed 24-bit)
+// and 32-bit float in [-1, 1)
+enum class SampleFormat {
+    Int8,
+    Int16,
+    Int24,
+    Int32,
+    Float32
+};
+
+// Interleaved: frame by frame (L R L R ...). Planar: channel by channel (L L ... R R ...).
+enum class SampleLayout {
+    Interleaved,
+    Planar
+};
+
+struct SampleSpec {
+    SampleFormat format = SampleFormat::Int16;
+    SampleLayout layout = SampleLayout::Interleaved;
+
+    bool operator==(const SampleSpec& other) const { return format == other.format && layout == other.layout; }
+    bool operator!=(const SampleSpec& other) const { return !(*this == other); }
+
+    size_t bytesPerSample() const { return sampleBytes(format); }
+    int bitDepth() const { return static_cast<int>(sampleBytes(format)) * 8; }
+
+    // Written as "<format>[:planar|:interleaved]", e.g. "float32:planar";
+    // formats are int8, int16, int24, int32 and float32
+    static bool parse(const std::string& spec, SampleSpec& sampleSpec);
+    std::string toString() const;
+
+    // Integer format captured at a bit depth (8, 16, 24 or 32)
+    static bool fromBitDepth(int bitDepth, SampleSpec& sampleSpec);
+
+    static size_t sampleBytes(SampleFormat format);
+    static std::string formatName(SampleFormat format);
+};
+
+// Convert count samples between formats (same layout). Integers are scaled by their full
+// range; narrowing rounds to nearest and saturates, float input is clamped to [-1, 1).
+// Dispatches to the scalar, SSE2 or AVX2 kernels per getSimdLevel().
+void convertSamples(const void* src, SampleFormat from, void* dst, SampleFormat to, size_t count);
+
+// Converts whole frames of one stream between sample specs. Not thread-safe: keeps
+// scratch space for layout changes.
+class SampleConverter {
+public:
+    SampleConverter(const SampleSpec& from, const SampleSpec& to, int channels);
+
+    const SampleSpec& getFrom() const { return from_; }
+    const SampleSpec& getTo() const { return to_; }
+    int getChannels() const { return channels_; }
+    bool isIdentity() const { return from_ == to_ || (from_.format == to_.format && channels_ == 1); }
+
+    size_t outputBytes(size_t inputBytes) const;
+
+    // Convert inputBytes of whole frames from src into dst, which must hold outputBytes(inputBytes)
+    void convert(const void* src, size_t inputBytes, void* dst);
+
+private:
+    SampleSpec from_;
+    SampleSpec to_;
+    int channels_;
+    std::vector<uint8_t> scratch_;
+};
+
+#endif // SAMPLE_FORMAT_H
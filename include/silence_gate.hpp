@@ -0,0 +1,111 @@
+#ifndef SILENCE_GATE_H
+#define SILENCE_GATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "level_meter.hpp"
+#include "sample_format.hpp"
+
+// Gate thresholds, written as "<threshold_db>[:<hangover_ms>[:<preroll_ms>]]" on the
+// command line, e.g. "-50:300:200". Disabled, every message goes out.
+struct GateSettings {
+    bool enabled = false;
+    double thresholdDb = -50.0;  // dBFS a message must exceed to count as activity
+    int hangoverMs = 300;        // Keep sending this long after the last active message
+    int preRollMs = 200;         // Send this much of the silence before an onset
+
+    // Parse a gate spec; returns false and logs on malformed input
+    static bool parse(const std::string& spec, GateSettings& settings);
+
+    std::string toString() const;
+};
+
+// Decides per message whether a stream is active, and replaces silent spans with compact
+// markers. A message is active when its energy is above the threshold and also clearly
+// above the tracked noise floor (a minimum-statistics floor that drops at once and rises
+// slowly), so steady room tone above the threshold still gates. Energy is measured with
+// the LevelMeter kernels.
+//
+// After activity the gate stays open for the hangover. While closed, the latest pre-roll
+// worth of silent messages is held back and sent ahead of the next onset, so word
+// beginnings survive; older silence is folded into a marker: the first suppressed
+// message's metadata with "silence": true and "frames" covering the whole span (at most
+// kMaxMarkerMs, or up to the next gap), sent with an empty payload. Timing fields of
+// audio and markers together cover every frame, so timestamps stay continuous.
+// Used from the sender thread only; the counters may be read from any thread.
+class SilenceGate {
+public:
+    static constexpr int kMaxMarkerMs = 1000;
+    static constexpr double kNoiseMarginDb = 6.0;     // Activity must exceed the floor by this
+    static constexpr double kFloorRiseDbPerSec = 3.0; // How fast the floor follows louder noise
+    static constexpr double kMinLevelDb = -120.0;     // Digital silence reads as this
+
+    // What to send, in order: audio with its metadata, or a marker (no data)
+    struct Output {
+        bool silence = false;
+        const uint8_t* data = nullptr;
+        size_t bytes = 0;
+        size_t frames = 0;
+        std::map<std::string, nlohmann::json> metadata;
+    };
+
+    explicit SilenceGate(const GateSettings& settings);
+
+    // Route one message of frames held in spec, captured at sampleRate. outputs is replaced
+    // with what goes out now; held-back audio in it stays valid until the next call.
+    void process(const uint8_t* data, size_t bytes, size_t frames, const SampleSpec& spec, int sampleRate,
+                 const std::map<std::string, nlohmann::json>& metadata, std::vector<Output>& outputs);
+
+    // Whatever is held back, as markers (e.g. before stopping)
+    void flush(std::vector<Output>& outputs);
+
+    const GateSettings& getSettings() const { return settings_; }
+    bool isOpen() const { return open_.load(std::memory_order_relaxed); }
+    double getLevelDb() const { return levelDb_.load(std::memory_order_relaxed); }
+    double getNoiseFloorDb() const { return noiseFloorDb_.load(std::memory_order_relaxed); }
+    uint64_t getFramesPassed() const { return framesPassed_.load(std::memory_order_relaxed); }
+    uint64_t getFramesSuppressed() const { return framesSuppressed_.load(std::memory_order_relaxed); }
+
+private:
+    struct Held {
+        std::vector<uint8_t> data;
+        size_t frames = 0;
+        std::map<std::string, nlohmann::json> metadata;
+    };
+
+    // Mean square of the message in dBFS, with the noise floor updated
+    bool isActive(const uint8_t* data, size_t frames, const SampleSpec& spec, size_t samples, int sampleRate);
+    void emitAudio(const uint8_t* data, size_t bytes, size_t frames,
+                   const std::map<std::string, nlohmann::json>& metadata, std::vector<Output>& outputs);
+    void foldIntoMarker(Held& held, int sampleRate, std::vector<Output>& outputs);
+    void emitMarker(std::vector<Output>& outputs);
+
+    GateSettings settings_;
+    std::atomic<bool> open_;
+    size_t hangoverLeft_;  // Frames
+
+    std::deque<Held> held_;       // Pre-roll candidates, oldest first
+    size_t heldFrames_;
+    std::deque<Held> released_;   // Sent this call; recycled on the next
+    std::vector<Held> spare_;     // Recycled buffers
+
+    size_t markerFrames_;
+    std::map<std::string, nlohmann::json> markerMetadata_;
+
+    LevelMeter meter_;
+    std::vector<ChannelLevels> levels_;
+    double floorDb_;
+
+    std::atomic<double> levelDb_;
+    std::atomic<double> noiseFloorDb_;
+    std::atomic<uint64_t> framesPassed_;
+    std::atomic<uint64_t> framesSuppressed_;
+};
+
+#endif // SILENCE_GATE_H
@@ -0,0 +1,115 @@
+#ifndef SPECTRAL_H
+#define SPECTRAL_H
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Feature frames to compute, written as "<window_ms>:<hop_ms>[:<mel_bands>[:<hann|hamming>]]"
+// on the command line, e.g. "25:10:64". Zero mel bands publishes the power spectrum itself.
+struct FeatureSettings {
+    bool enabled = false;
+    int windowMs = 25;
+    int hopMs = 10;
+    int melBands = 64;
+    std::string window = "hann";
+    bool half = true;  // Publish float16 rather than float32 values
+
+    // Parse a feature spec; returns false and logs on malformed input
+    static bool parse(const std::string& spec, FeatureSettings& settings);
+    // "float16" or "float32"
+    static bool parseFormat(const std::string& name, FeatureSettings& settings);
+
+    std::string toString() const;
+};
+
+// Forward FFT of real input of a power-of-two size, computed as a complex FFT of half the
+// size on even/odd sample pairs and split into the size / 2 + 1 non-negative frequency bins
+class RealFft {
+public:
+    explicit RealFft(size_t size);
+
+    size_t getSize() const { return size_; }
+
+    // Transform size samples; spectrum is resized to size / 2 + 1 bins
+    void forward(const float* input, std::vector<std::complex<float>>& spectrum);
+
+private:
+    size_t size_;
+    std::vector<size_t> bitReverse_;                 // Of the half-size FFT
+    std::vector<std::complex<float>> twiddles_;      // e^(-2 pi i k / (size / 2))
+    std::vector<std::complex<float>> splitTwiddles_; // e^(-2 pi i k / size)
+    std::vector<std::complex<float>> work_;
+};
+
+// Triangular filters evenly spaced on the mel scale (HTK formula) from 0 Hz to Nyquist,
+// each weighting a run of power spectrum bins
+class MelFilterBank {
+public:
+    MelFilterBank(int bands, size_t fftSize, int sampleRate);
+
+    int getBands() const { return static_cast<int>(filters_.size()); }
+
+    // Band energies of a power spectrum of fftSize / 2 + 1 bins
+    void apply(const float* power, float* bands) const;
+
+    static double hzToMel(double hz);
+    static double melToHz(double mel);
+
+private:
+    struct Filter {
+        size_t firstBin = 0;
+        std::vector<float> weights;
+    };
+    std::vector<Filter> filters_;
+};
+
+// Short-time spectra of a mono stream: every hop, the last window of audio is windowed,
+// transformed and reduced to log power per bin or mel band (dB, full-scale sine = 0 dB,
+// floored at kMinDb). Streams in any chunk size; not thread-safe.
+class SpectralAnalyzer {
+public:
+    static constexpr double kMinDb = -120.0;
+
+    SpectralAnalyzer(const FeatureSettings& settings, int sampleRate);
+
+    size_t getWindowFrames() const { return windowFrames_; }
+    size_t getHopFrames() const { return hopFrames_; }
+    size_t getFftSize() const { return fft_.getSize(); }
+    size_t getBins() const { return bins_; }  // Values per feature frame
+
+    // Add frames of audio and compute every window it completes, appending getBins() values
+    // per window to features. Returns the number of windows; firstWindowStart is where the
+    // first of them starts, in frames since construction or the last reset().
+    size_t process(const float* input, size_t frames, std::vector<float>& features, uint64_t& firstWindowStart);
+
+    // Forget buffered audio, as after a gap; the next window starts at the next input frame
+    void reset();
+
+private:
+    void computeWindow(const float* samples, float* output);
+
+    size_t windowFrames_;
+    size_t hopFrames_;
+    size_t bins_;
+    RealFft fft_;
+    std::unique_ptr<MelFilterBank> melBank_;  // Null for the plain power spectrum
+    std::vector<float> window_;               // Zero-padded to the FFT size
+    float powerScale_;
+
+    std::vector<float> history_;  // Input from historyStart_ on
+    uint64_t historyStart_;
+    uint64_t nextWindow_;
+    std::vector<float> frame_;
+    std::vector<std::complex<float>> spectrum_;
+    std::vector<float> power_;
+};
+
+// IEEE 754 half precision, rounded to nearest even; overflow becomes infinity
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+#endif // SPECTRAL_H
@@ -0,0 +1,42 @@
+#ifndef SYNTHETIC_AUDIO_SOURCE_H
+#define SYNTHETIC_AUDIO_SOURCE_H
+
+#include <string>
+#include <cstdint>
+#include "audio_source.hpp"
+
+// Generates a test signal in the configured format, identical on every channel
+class SyntheticAudioSource : public ThreadedAudioSource {
+public:
+    enum class Waveform {
+        Sine,
+        Noise
+    };
+
+    SyntheticAudioSource(Waveform waveform,
+                         double frequency,
+                         int sampleRate,
+                         int channels,
+                         int bitDepth,
+                         int bufferSize,
+                         Pacing pacing = Pacing::RealTime);
+    ~SyntheticAudioSource() override;
+
+    std::string getDeviceName() const override;
+
+protected:
+    bool openSource() override;
+    bool fillBlock(uint8_t* dest, unsigned long frames) override;
+
+private:
+    // Next sample in [-1, 1)
+    double nextValue();
+
+    Waveform waveform_;
+    double frequency_;
+    double amplitude_;
+    double phase_;
+    uint64_t noiseState_;
+};
+
+#endif // SYNTHETIC_AUDIO_SOURCE_H
@@ -0,0 +1,41 @@
+#ifndef THREAD_SCHEDULE_H
+#define THREAD_SCHEDULE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Scheduling policy, priority and CPU affinity for one of our threads
+// Written as "<policy>[:<priority>][@<cpus>]" on the command line, e.g. "fifo:80@3",
+// "rr:20@2-3" or "@0,1" (affinity only). Policies are other, fifo and rr.
+struct ThreadSchedule {
+    enum class Policy { Inherit, Other, Fifo, RoundRobin };
+
+    Policy policy = Policy::Inherit;  // Inherit leaves the policy and priority alone
+    int priority = 0;                 // 1-99 for fifo/rr
+    std::vector<int> cpus;            // Empty: run on any CPU
+
+    bool isDefault() const { return policy == Policy::Inherit && cpus.empty(); }
+
+    // Parse a schedule spec; returns false and logs on malformed input
+    static bool parse(const std::string& spec, ThreadSchedule& schedule);
+
+    // Apply to the calling thread. Logs and returns false if the OS refuses
+    // (e.g. no CAP_SYS_NICE for realtime policies); the thread keeps running either way.
+    bool applyToCurrentThread(const std::string& threadName) const;
+
+    // Settings the calling thread actually runs with
+    static ThreadSchedule ofCurrentThread();
+
+    // Native SCHED_* value for policy (SCHED_OTHER for Inherit)
+    int nativePolicy() const;
+
+    std::string toString() const;
+};
+
+// Process-wide record of the effective schedule of each named thread, for STATUS
+void recordThreadSchedule(const std::string& threadName);  // Reads the calling thread
+void recordThreadSchedule(const std::string& threadName, const std::string& description);
+std::map<std::string, std::string> recordedThreadSchedules();
+
+#endif // THREAD_SCHEDULE_H
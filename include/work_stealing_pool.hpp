@@ -0,0 +1,82 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ring_util.hpp"
+#include "thread_schedule.hpp"
+
+// Fork-join pool for splitting one block of work into independent tasks, e.g. the channel
+// groups of a planar block. run() deals the task indices out as a contiguous range per
+// thread; a thread that finishes its range steals single tasks from the end of the others',
+// so an uneven split evens out. The calling thread works too, and run() returns only once
+// every task has finished, so whatever the tasks wrote is complete and visible afterwards.
+// Ranges are claimed with compare-and-swap on a packed begin/end word; only joining and
+// leaving a run take a lock. Several threads may call run() at once (one per stream): each
+// run gets its own ranges and idle workers help whichever runs still have tasks.
+class WorkStealingPool {
+public:
+    // threads counts a caller; 0 means one per hardware thread. The workers start with
+    // schedule (e.g. the callers' --worker-sched) so they keep up with a realtime caller.
+    explicit WorkStealingPool(size_t threads = 0, const ThreadSchedule& schedule = ThreadSchedule());
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t getThreadCount() const { return threadCount_; }
+
+    // Call task(i) once for every i in [0, count), spread over the pool's threads
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    // Tasks run by a thread other than the one they were dealt to
+    uint64_t getTasksStolen() const { return tasksStolen_.load(std::memory_order_relaxed); }
+
+private:
+    // Spins on the join before the caller sleeps until the last task is done
+    static constexpr int kJoinSpins = 4000;
+
+    // One thread's share of a run: begin in the high half, end in the low half
+    struct alignas(kCacheLineSize) TaskRange {
+        std::atomic<uint64_t> bounds{0};
+    };
+
+    // One run() in progress. Slots are kept and reused, so a run does not allocate once
+    // there have been as many concurrent runs before.
+    struct Run {
+        std::unique_ptr<TaskRange[]> ranges;
+        const std::function<void(size_t)>* task = nullptr;
+        std::atomic<size_t> pending{0};  // Tasks not yet finished
+        size_t active = 0;               // Workers inside, under mutex_
+        bool inUse = false;              // Listed for workers, under mutex_
+    };
+
+    void workerLoop(size_t index);
+    // A listed run with tasks nobody has claimed yet; under mutex_
+    Run* findRun() const;
+    bool hasUnclaimed(const Run& run) const;
+    // Run tasks from the thread's own range, then steal until every range is empty
+    void work(Run& run, size_t self);
+    bool popFront(TaskRange& range, uint32_t& task);
+    bool stealBack(TaskRange& range, uint32_t& task);
+
+    size_t threadCount_;
+    ThreadSchedule schedule_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeCondition_;  // Workers: a run was listed, or stopping
+    std::condition_variable doneCondition_;  // Callers: a worker left a run
+    std::vector<std::unique_ptr<Run>> runs_;
+    bool stopping_;
+    std::atomic<uint64_t> tasksStolen_;
+};
+
+#endif // WORK_STEALING_POOL_H
@@ -7,28 +7,71 @@
 #include <memory>
 #include <functional>
 #include <unordered_map>
+#include <vector>
 #include <zmq.hpp>
-#include "audio_capture.hpp"
+#include "audio_source.hpp"
 #include "zmq_publisher.hpp"
 #include "message_format.hpp"
+#include "thread_schedule.hpp"
+#include "capture_journal.hpp"
+#include "dsp_pipeline.hpp"
+#include "feature_stream.hpp"
+#include "opus_stream.hpp"
 
+// An audio source the handler controls, and the publisher stream its status goes to
+struct ControlledStream {
+    std::string streamId;
+    std::shared_ptr<AudioSource> source;
+    size_t publisherStream;
+    std::shared_ptr<CaptureJournal> journal;  // Optional file-backed history
+    std::shared_ptr<OpusStreamEncoder> opus;  // Optional Opus topic, reported in STATUS
+    std::shared_ptr<FeatureStream> features;  // Optional feature topic, reported in STATUS
+    std::shared_ptr<DspWorker> dsp;           // Optional processing chain, reported in STATUS
+};
+
+// Control commands on a ROUTER socket. Commands that act on a source take an
+// optional trailing stream id ("STOP mic2"); without one they apply to every stream.
+// GET_HISTORY <from_ms> <to_ms> [stream] answers with the text response followed by
+// the buffered audio as binary frames of up to one second each; GET_JOURNAL does the
+// same from the stream's capture journal.
 class ZmqHandler {
 public:
     ZmqHandler(const std::string& address, 
                const std::string& topic,
-               std::shared_ptr<AudioCapture> audioCapture,
-               std::shared_ptr<ZmqPublisher> zmqPublisher);
+               std::shared_ptr<AudioSource> audioSource,
+               std::shared_ptr<ZmqPublisher> zmqPublisher,
+               std::shared_ptr<zmq::context_t> context = nullptr);
     ~ZmqHandler();
 
+    // Make another source addressable by stream id (before start()).
+    // The constructor's source is stream 0 of the publisher.
+    void addStream(const std::string& streamId, std::shared_ptr<AudioSource> source, size_t publisherStream);
+    
+    // Serve GET_JOURNAL for a stream (index in the order streams were added, 0 = constructor's)
+    void setJournal(size_t stream, std::shared_ptr<CaptureJournal> journal);
+    // Report a stream's Opus encoder in STATUS (same indexing)
+    void setOpusEncoder(size_t stream, std::shared_ptr<OpusStreamEncoder> encoder);
+    // Report a stream's feature computation in STATUS (same indexing)
+    void setFeatureStream(size_t stream, std::shared_ptr<FeatureStream> features);
+    // Report a stream's processing chain in STATUS (same indexing)
+    void setDspWorker(size_t stream, std::shared_ptr<DspWorker> dsp);
+
     bool initialize();
     bool start();
     bool stop();
     bool isRunning() const;
     
+    // Run one command line ("NAME args") and return the text response. Called by the
+    // handler thread; binary reply frames are only sent from there.
+    std::string handleCommand(const std::string& command);
+    
     // Flag to control whether to echo status messages to stdout
     void setVerboseMode(bool verbose) { verboseMode_ = verbose; }
     bool getVerboseMode() const { return verboseMode_; }
     
+    // Scheduling for the handler thread, applied when it starts
+    void setThreadSchedule(const ThreadSchedule& schedule) { threadSchedule_ = schedule; }
+    
     // Getters
     std::string getAddress() const { return address_; }
     std::string getTopic() const { return topic_; }
@@ -36,28 +79,53 @@ public:
 private:
     void handleLoop();
     
+    // Resolve an optional trailing stream id; rest receives the remaining arguments
+    void selectStreams(const std::string& args, std::string& rest, std::vector<const ControlledStream*>& selected) const;
+    std::string streamLabel(const ControlledStream& stream) const;
+    void publishSourceStatus(const ControlledStream& stream, bool running, const char* event);
+    
+    // Apply handler to each selected stream and join the per-stream responses
+    std::string forEachStream(const std::string& args, bool takesArguments,
+                              const std::function<std::string(const ControlledStream&, const std::string&)>& handler);
+    
     // Command handlers
-    std::string handleStatus();
-    std::string handleSetSampleRate(const std::string& args);
-    std::string handleStop();
-    std::string handleStart();
+    std::string handleStatus(const ControlledStream& stream);
+    std::string handleSetSampleRate(const ControlledStream& stream, const std::string& args);
+    std::string handleSetBufferMs(const ControlledStream& stream, const std::string& args);
+    std::string handleStop(const ControlledStream& stream);
+    std::string handleStart(const ControlledStream& stream);
+    std::string handleGetHistory(const std::string& args);
+    std::string handleGetJournal(const std::string& args);
+    
+    // Shared by the history commands: pick one stream and parse "<from_ms> <to_ms>"
+    const ControlledStream* parseHistoryRequest(const std::string& command, const std::string& args,
+                                                uint64_t& fromTimestamp, uint64_t& toTimestamp,
+                                                std::string& error) const;
+    // Queue audio as binary reply frames and describe it in the text response
+    std::string replyWithAudio(ReadResult& audio, uint64_t fromTimestamp,
+                               int sampleRate, int channels, int bitDepth);
     std::string handleGetDevices();
     std::string handleSetVerbose(const std::string& args);
     
     std::string address_;
     std::string topic_;
     
-    std::unique_ptr<zmq::context_t> context_;
+    // Shared with the publisher when given to the constructor
+    std::shared_ptr<zmq::context_t> context_;
     std::unique_ptr<zmq::socket_t> dealerSocket_;
     
-    std::shared_ptr<AudioCapture> audioCapture_;
+    std::vector<ControlledStream> streams_;
     std::shared_ptr<ZmqPublisher> zmqPublisher_;
     
+    ThreadSchedule threadSchedule_;
     std::thread handleThread_;
     std::atomic<bool> running_;
     std::atomic<bool> initialized_;
     std::atomic<bool> verboseMode_;
     
+    // Binary frames sent after the text response of the current command (handler thread only)
+    std::vector<zmq::message_t> replyFrames_;
+    
     // Map of command strings to handler functions
     std::unordered_map<
         std::string, 
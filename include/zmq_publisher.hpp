@@ -6,19 +6,83 @@
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <zmq.hpp>
-#include "audio_buffer.hpp"
-#include "audio_capture.hpp"
+#include "audio_source.hpp"
+#include "channel_mix.hpp"
+#include "level_meter.hpp"
 #include "message_format.hpp"
+#include "mpsc_queue.hpp"
+#include "payload_codec.hpp"
+#include "publish_batching.hpp"
+#include "resampler.hpp"
+#include "sample_format.hpp"
+#include "silence_gate.hpp"
+#include "thread_schedule.hpp"
 
+// Message handed to the sender thread. Audio carries a pooled block so enqueueing
+// from the capture thread never allocates; status carries its already serialized JSON,
+// and encoded audio its JSON and payload, both built by the encoder's thread.
+struct OutboundMessage {
+    enum class Kind {
+        Audio,
+        Status,
+        Encoded
+    };
+    
+    Kind kind = Kind::Audio;
+    size_t stream = 0;          // Index returned by ZmqPublisher::addStream
+    AudioBlockHandle block;
+    std::shared_ptr<const std::string> json;
+    std::shared_ptr<const std::vector<uint8_t>> payload;
+    size_t frames = 0;          // Audio frames an encoded payload holds
+};
+
+// Per-stream publishing counters, updated by the capture and sender threads
+struct PublishCounters {
+    std::atomic<uint64_t> framesPublished{0};
+    std::atomic<uint64_t> framesDropped{0};     // Dropped because the outbound queue was full
+    std::atomic<uint64_t> pendingGapFrames{0};  // Dropped since the last block that went out
+};
+
+// One published audio stream: its own stream_id and topic on the shared PUB socket
+struct PublishedStream {
+    std::string streamId;
+    std::string topic;
+    std::shared_ptr<AudioSource> source;
+    std::shared_ptr<PublishCounters> counters;
+    
+    // Rate the stream goes out at, 0 for the captured rate; changed by any thread
+    std::shared_ptr<std::atomic<int>> outputRate;
+    
+    // Derived streams only: computed from the parent stream's audio on the sender thread
+    size_t parent = 0;
+    std::shared_ptr<ChannelMixer> mixer;
+    
+    // Encoded streams only: produced from the parent's audio by an encoder thread
+    std::string encoding;
+    
+    bool isDerived() const { return mixer != nullptr; }
+    bool isEncoded() const { return !encoding.empty(); }
+};
+
+// Publishes audio and status for one or more streams on a single PUB socket
+// Only the sender thread (publishLoop) touches pubSocket_ while the publisher is running;
+// every other thread hands messages over through an MPSC queue.
 class ZmqPublisher {
 public:
+    // Messages that can wait for the sender thread before new audio is dropped
+    static constexpr size_t kOutboundQueueSize = 256;
+    
+
     ZmqPublisher(const std::string& address, 
                  const std::string& topic,
-                 std::shared_ptr<AudioBuffer> audioBuffer,
-                 std::shared_ptr<AudioCapture> audioCapture,
+                 std::shared_ptr<AudioSource> audioSource,
                  const std::string& serviceName,
-                 const std::string& streamId = "");
+                 const std::string& streamId = "",
+                 std::shared_ptr<zmq::context_t> context = nullptr);
     ~ZmqPublisher();
 
     bool initialize();
@@ -29,28 +93,193 @@ public:
     std::string getAddress() const { return address_; }
     std::string getTopic() const { return topic_; }
     
-    // Used by AudioCapture to send new data directly
-    void publishAudioData(const std::vector<uint8_t>& data, uint64_t timestamp);
+    // Register another stream on the same socket (before start()); returns its index.
+    // The stream given to the constructor is index 0.
+    size_t addStream(const std::string& streamId, const std::string& topic, std::shared_ptr<AudioSource> source);
+    // Register a stream computed from another one's audio through a channel matrix (before
+    // start()), published next to it once per block; returns its index, or 0 on error
+    size_t addDerivedStream(const std::string& streamId, const std::string& topic, size_t parent,
+                            const ChannelMatrix& matrix, int outputRate = 0);
+    std::vector<size_t> getDerivedStreams(size_t parent) const;
+    // Register a stream whose messages an encoder builds from a captured stream's audio
+    // (before start()); returns its index, or 0 on error
+    size_t addEncodedStream(const std::string& streamId, const std::string& topic, size_t parent,
+                            const std::string& encoding);
+    
+    // Queue one encoded packet of frames of audio; metadata describes it and gets the
+    // stream's codec. For encoder threads (allocates); dropped if the queue is full.
+    bool publishEncodedAudio(size_t stream, std::vector<uint8_t> packet, size_t frames,
+                             std::map<std::string, nlohmann::json> metadata);
+    
+    // Resample a stream to this rate on the sender thread (0: publish at the captured rate).
+    // The device keeps running at its own rate; takes effect from the next block.
+    bool setOutputRate(size_t stream, int sampleRate);
+    int getOutputRate(size_t stream) const;  // The rate the stream is published at
+    
+    size_t getStreamCount() const { return streams_.size(); }
+    const PublishedStream& getStream(size_t stream) const { return streams_[stream]; }
+    
+    // Used by the AudioSource to send new data directly. Safe to call from the
+    // real-time capture thread: it only enqueues, and drops the block if the queue is full.
+    void publishAudioData(const AudioBlockHandle& block) { publishAudioData(0, block); }
+    void publishAudioData(size_t stream, const AudioBlockHandle& block);
 
-    // Publish a status message
-    void publishStatusMessage(const std::map<std::string, nlohmann::json>& status, bool echo = false);
+    // Publish a status message (queued for the sender thread while running)
+    void publishStatusMessage(const std::map<std::string, nlohmann::json>& status, bool echo = false) {
+        publishStatusMessage(0, status, echo);
+    }
+    void publishStatusMessage(size_t stream, const std::map<std::string, nlohmann::json>& status, bool echo = false);
+    
+    // Audio blocks dropped because the sender thread fell behind
+    uint64_t getDroppedBlocks() const { return droppedBlocks_.load(std::memory_order_relaxed); }
+    
+    // Messages waiting for the sender thread
+    size_t getQueuedMessages() const { return outboundQueue_.size(); }
+    
+    // Scheduling for the sender thread, applied when it starts
+    void setThreadSchedule(const ThreadSchedule& schedule) { threadSchedule_ = schedule; }
+    
+    // Pack consecutive blocks of a stream into larger messages as the sender falls behind
+    // (set before start())
+    void setBatching(const BatchingSettings& settings);
+    const BatchController& getBatchController() const { return *batchController_; }
+    
+    // Convert published audio to this format and layout, whatever the sources capture
+    // (set before start()). Without it audio goes out as captured.
+    void setPublishFormat(const SampleSpec& spec);
+    std::string getPublishFormat() const;
+    
+    // Compress audio payloads with this codec (set before start(); nullptr sends them raw).
+    // Payloads the codec cannot take, or would not shrink, still go out raw.
+    void setPayloadCodec(std::unique_ptr<PayloadCodec> codec);
+    std::string getPayloadCodec() const;
+    // Payload bytes before and after the codec, over the messages it coded
+    uint64_t getCodecInputBytes() const { return codecInputBytes_.load(std::memory_order_relaxed); }
+    uint64_t getCodecOutputBytes() const { return codecOutputBytes_.load(std::memory_order_relaxed); }
+    
+    // Meter per-channel RMS, peak and clipped samples of captured streams: every message
+    // carries them under "levels", and <stream topic>/levels gets them every intervalMs
+    // (set before start(); 0 turns metering off)
+    void setLevelMetering(int intervalMs);
+    int getLevelInterval() const { return levelIntervalMs_; }
+    
+    // Replace silent spans of captured streams (and the streams derived from them) with
+    // silence markers (set before start())
+    void setSilenceGate(const GateSettings& settings);
+    const GateSettings& getSilenceGateSettings() const { return gateSettings_; }
+    // The stream's gate while running, nullptr if it is not gated
+    const SilenceGate* getSilenceGate(size_t stream) const;
+    
+    // Blocks a message may hold, so batching never starves the capture block pool
+    static constexpr size_t kMaxBatchBlocks = AudioSource::kBlockPoolSize / 4;
     
 private:
+    // Levels of one captured stream since its last levels message
+    struct LevelWindow {
+        std::vector<ChannelLevels> levels;
+        size_t frames = 0;
+        std::map<std::string, nlohmann::json> timing;  // Of the window's first frame
+    };
+    
+    // Contiguous blocks of one stream waiting to go out as a single message
+    struct PendingBatch {
+        std::vector<AudioBlockHandle> blocks;
+        size_t frames = 0;
+        std::chrono::steady_clock::time_point firstQueued;
+    };
+    
     void publishLoop();
+    void drainOutboundQueue();
+    void sendMessage(const OutboundMessage& message);
+    void queueBatch(size_t stream, const AudioBlockHandle& block);
+    void flushBatch(size_t stream);
+    void flushDueBatches(std::chrono::steady_clock::time_point now);
+    void sendAudioBlocks(size_t stream, const AudioBlockHandle* blocks, size_t count);
+    // Send one message of captured audio on a stream and the streams derived from it
+    void publishCaptured(size_t streamIndex, const uint8_t* data, size_t frames, const SampleSpec& captured,
+                         std::map<std::string, nlohmann::json> metadata);
+    // Send a silence marker for frames of captured audio on a stream and its derived streams
+    void publishSilence(size_t streamIndex, size_t frames, const SampleSpec& captured,
+                        const std::map<std::string, nlohmann::json>& metadata);
+    bool sendSilenceMarker(size_t streamIndex, size_t frames, const SampleSpec& dataSpec, int channels,
+                           std::map<std::string, nlohmann::json> metadata);
+    void flushSilenceGates();
+    // Add the message's levels to its metadata and the stream's levels window
+    void meterLevels(size_t streamIndex, const uint8_t* data, size_t frames, const SampleSpec& captured,
+                     std::map<std::string, nlohmann::json>& metadata);
+    void sendLevels(size_t streamIndex, LevelWindow& window);
+    // Send audio held in dataSpec with the given channel count, converted to the published format
+    bool sendAudioFrames(size_t streamIndex, const uint8_t* data, size_t size, const SampleSpec& dataSpec,
+                         int channels, std::map<std::string, nlohmann::json> metadata);
+    // Send through the stream's resampler when its output rate differs from the captured one
+    bool sendAtStreamRate(size_t streamIndex, const uint8_t* data, size_t frames, const SampleSpec& dataSpec,
+                          int channels, std::map<std::string, nlohmann::json> metadata);
+    void publishDerived(size_t parent, const uint8_t* data, size_t frames, const SampleSpec& captured,
+                        const std::map<std::string, nlohmann::json>& metadata);
+    // Send a message without a payload: topic and JSON frames
+    void sendJsonFrames(const std::string& topic, const std::string& jsonString);
+    void sendEncodedFrames(const OutboundMessage& message);
     
     std::string address_;
     std::string topic_;
     std::string serviceName_;
-    std::string streamId_;
     
-    std::unique_ptr<zmq::context_t> context_;
+    // Shared with other components when given to the constructor
+    std::shared_ptr<zmq::context_t> context_;
     std::unique_ptr<zmq::socket_t> pubSocket_;
     
-    std::shared_ptr<AudioBuffer> audioBuffer_;
-    std::shared_ptr<AudioCapture> audioCapture_;
+    std::vector<PublishedStream> streams_;
+    ThreadSchedule threadSchedule_;
     std::thread publishThread_;
     std::atomic<bool> running_;
     std::atomic<bool> initialized_;
+    
+    MpscQueue<OutboundMessage> outboundQueue_;
+    std::atomic<uint64_t> droppedBlocks_;
+    
+    // Sender thread only, apart from the controller's getters
+    std::unique_ptr<BatchController> batchController_;
+    std::vector<PendingBatch> batches_;
+    std::vector<uint8_t> batchScratch_;
+    
+    bool convertFormat_;
+    SampleSpec publishFormat_;
+    std::vector<std::unique_ptr<SampleConverter>> converters_;  // Per stream, sender thread only
+    
+    // Payload compression, sender thread only apart from the counters
+    std::unique_ptr<PayloadCodec> codec_;
+    std::vector<uint8_t> codecInput_;
+    std::vector<uint8_t> codecOutput_;
+    std::atomic<uint64_t> codecInputBytes_;
+    std::atomic<uint64_t> codecOutputBytes_;
+    
+    // Derived stream indices per parent, and the sender's scratch for computing them
+    std::vector<std::vector<size_t>> derived_;
+    std::vector<std::unique_ptr<SampleConverter>> mixInputConverters_;  // Per parent, to float planar
+    std::vector<float> mixInput_;
+    std::vector<float> mixOutput_;
+    std::vector<uint8_t> derivedScratch_;
+    
+    // Per stream resamplers and the sender's float planar scratch for them
+    std::vector<std::unique_ptr<Resampler>> resamplers_;
+    std::vector<std::unique_ptr<SampleConverter>> resampleInputConverters_;
+    std::vector<float> resampleInput_;
+    std::vector<float> resampleOutput_;
+    
+    // Level metering, sender thread only
+    int levelIntervalMs_;
+    LevelMeter levelMeter_;
+    std::vector<ChannelLevels> messageLevels_;
+    std::vector<LevelWindow> levelWindows_;
+    
+    // Per captured stream silence gates, sender thread only apart from their counters
+    GateSettings gateSettings_;
+    std::vector<std::unique_ptr<SilenceGate>> gates_;
+    std::vector<SilenceGate::Output> gateOutputs_;
+    
+    // Lets non-real-time producers wake the sender thread early
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCondition_;
 };
 
 #endif // ZMQ_PUBLISHER_H 
\ No newline at end of file
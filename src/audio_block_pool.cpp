@@ -0,0 +1,129 @@
+#include "audio_block_pool.hpp"
+#include <iostream>
+
+AudioBlockHandle::AudioBlockHandle(const AudioBlockHandle& other) noexcept
+    : pool_(other.pool_), block_(other.block_) {
+    if (block_) {
+        pool_->addRef(block_);
+    }
+}
+
+AudioBlockHandle::AudioBlockHandle(AudioBlockHandle&& other) noexcept
+    : pool_(other.pool_), block_(other.block_) {
+    other.pool_ = nullptr;
+    other.block_ = nullptr;
+}
+
+AudioBlockHandle& AudioBlockHandle::operator=(const AudioBlockHandle& other) noexcept {
+    if (this != &other) {
+        if (other.block_) {
+            other.pool_->addRef(other.block_);
+        }
+        reset();
+        pool_ = other.pool_;
+        block_ = other.block_;
+    }
+    return *this;
+}
+
+AudioBlockHandle& AudioBlockHandle::operator=(AudioBlockHandle&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pool_ = other.pool_;
+        block_ = other.block_;
+        other.pool_ = nullptr;
+        other.block_ = nullptr;
+    }
+    return *this;
+}
+
+AudioBlockHandle::~AudioBlockHandle() {
+    reset();
+}
+
+void AudioBlockHandle::reset() noexcept {
+    if (block_) {
+        pool_->release(block_);
+        pool_ = nullptr;
+        block_ = nullptr;
+    }
+}
+
+AudioBlockPool::AudioBlockPool(size_t blockCount, size_t blockBytes)
+    : blockCount_(blockCount),
+      blockBytes_(blockBytes),
+      freeHead_(packHead(kInvalidIndex, 0)),
+      freeCount_(0),
+      exhaustedCount_(0) {
+    
+    // Keep every block on its own cache lines so neighbouring blocks never share one
+    const size_t alignment = 64;
+    stride_ = (blockBytes_ + alignment - 1) / alignment * alignment;
+    
+    // Allocate and pre-fault all storage up front so the hot path never touches the allocator.
+    // The mapping is page-aligned, so every block starts on a cache line.
+    storage_ = RealtimeBuffer(stride_ * blockCount_);
+    
+    blocks_ = std::make_unique<AudioBlock[]>(blockCount_);
+    for (size_t i = blockCount_; i-- > 0;) {
+        blocks_[i].data = storage_.data() + i * stride_;
+        blocks_[i].capacity = blockBytes_;
+        push(static_cast<uint32_t>(i));
+    }
+}
+
+AudioBlockPool::~AudioBlockPool() {
+    if (freeCount_.load() != blockCount_) {
+        std::cerr << "AudioBlockPool destroyed with " << (blockCount_ - freeCount_.load())
+                  << " blocks still in use" << std::endl;
+    }
+}
+
+AudioBlockHandle AudioBlockPool::acquire() {
+    uint64_t head = freeHead_.load(std::memory_order_acquire);
+    
+    while (true) {
+        uint32_t index = static_cast<uint32_t>(head);
+        if (index == kInvalidIndex) {
+            exhaustedCount_.fetch_add(1, std::memory_order_relaxed);
+            return AudioBlockHandle();
+        }
+        
+        // The tag changes on every update, so a stale next index fails the CAS
+        uint32_t next = blocks_[index].nextFree.load(std::memory_order_relaxed);
+        uint64_t newHead = packHead(next, static_cast<uint32_t>(head >> 32) + 1);
+        if (freeHead_.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+            freeCount_.fetch_sub(1, std::memory_order_relaxed);
+            
+            AudioBlock* block = &blocks_[index];
+            block->refCount.store(1, std::memory_order_relaxed);
+            block->size = 0;
+            block->frames = 0;
+            block->timestamp = 0;
+            block->time = CaptureTime();
+            return AudioBlockHandle(this, block);
+        }
+    }
+}
+
+void AudioBlockPool::addRef(AudioBlock* block) {
+    block->refCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioBlockPool::release(AudioBlock* block) {
+    if (block->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        push(static_cast<uint32_t>(block - blocks_.get()));
+    }
+}
+
+void AudioBlockPool::push(uint32_t index) {
+    uint64_t head = freeHead_.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    
+    do {
+        blocks_[index].nextFree.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        newHead = packHead(index, static_cast<uint32_t>(head >> 32) + 1);
+    } while (!freeHead_.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+    
+    freeCount_.fetch_add(1, std::memory_order_relaxed);
+}
@@ -1,129 +1,427 @@
 #include "audio_buffer.hpp"
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <new>
+#include <thread>
 
-AudioBuffer::AudioBuffer(int sampleRate, int channels, int bitDepth, int bufferSizeMs, size_t bufferMinSend)
-    : currentPos_(0), currentTimestamp_(0), sampleRate_(sampleRate), 
-    channels_(channels), bufferMinSend_(bufferMinSend) {
+namespace {
+
+// Copy absolute positions [start, end) between two power-of-two rings of different sizes
+void copyBetweenRings(const uint8_t* source, size_t sourceSize, uint8_t* dest, size_t destSize,
+                      uint64_t start, uint64_t end) {
+    while (start < end) {
+        size_t sourceOffset = static_cast<size_t>(start & (sourceSize - 1));
+        size_t destOffset = static_cast<size_t>(start & (destSize - 1));
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(end - start,
+                                           std::min(sourceSize - sourceOffset, destSize - destOffset)));
+        std::memcpy(dest + destOffset, source + sourceOffset, chunk);
+        start += chunk;
+    }
+}
+
+} // namespace
+
+AudioBuffer::AudioBuffer(int sampleRate, int channels, int bitDepth, int bufferSizeMs, size_t bufferMinSend, Mode mode)
+    : mode_(mode), maxSizeBytes_(0), mask_(0), sampleRate_(sampleRate),
+    channels_(channels), bufferMinSend_(bufferMinSend), requestedMinSend_(bufferMinSend),
+    reserved_(0), head_(0), validFrom_(0),
+    index_(new IndexEntry[kIndexEntries]()), indexReserved_(0), indexCount_(0),
+    lastWriteSeq_(0), lastWritePos_(0), lastWriteTimestamp_(0),
+    swapState_(kSwapIdle), pendingSize_(0), pendingCopiedTo_(0), pendingValidFrom_(0), droppedBytes_(0) {
     
     // Calculate bytes per sample
     bytesPerSample_ = (bitDepth / 8) * channels;
     
     // Calculate buffer size in bytes
-    int samplesPerMs = sampleRate / 1000;
-    maxSizeBytes_ = bufferSizeMs * samplesPerMs * bytesPerSample_;
-    bufferMinSend_ = std::max(bufferMinSend, maxSizeBytes_ / 2);
+    uint64_t sizeBytes = bytesForMs(bufferSizeMs);
+    if (capacityFor(sizeBytes) == 0) {
+        std::cerr << "Audio buffer of " << bufferSizeMs << " ms is over " << kMaxBufferBytes
+                  << " bytes, using " << kMaxBufferBytes << std::endl;
+        sizeBytes = kMaxBufferBytes;
+    }
+    allocate(sizeBytes);
+}
+
+uint64_t AudioBuffer::bytesForMs(int bufferSizeMs) const {
+    uint64_t samplesPerMs = static_cast<uint64_t>(std::max(sampleRate_, 0)) / 1000;
+    return static_cast<uint64_t>(std::max(bufferSizeMs, 0)) * samplesPerMs * static_cast<uint64_t>(bytesPerSample_);
+}
+
+size_t AudioBuffer::capacityFor(uint64_t minSizeBytes) const {
+    if (minSizeBytes > kMaxBufferBytes) {
+        return 0;
+    }
+    
+    // Capacity is a power of two so positions can be masked instead of wrapped
+    size_t capacity = roundUpPowerOfTwo(std::max<size_t>(static_cast<size_t>(minSizeBytes),
+                                                                         bytesPerSample_));
+    return capacity <= kMaxBufferBytes ? capacity : 0;
+}
+
+void AudioBuffer::allocate(size_t minSizeBytes) {
+    ring_ = RealtimeBuffer();
+    maxSizeBytes_ = capacityFor(minSizeBytes);
+    mask_ = maxSizeBytes_ - 1;
+    ring_ = RealtimeBuffer(maxSizeBytes_);
     
-    // Initialize buffer
-    buffer_.resize(maxSizeBytes_, 0);
+    // Readers wait for the minimum send size, so it must stay reachable
+    bufferMinSend_ = std::min(requestedMinSend_, maxSizeBytes_ / 2);
 }
 
 void AudioBuffer::addData(const void* data, size_t size, uint64_t timestamp) {
+    if (mode_ == Mode::LockFree) {
+        writeRing(data, size, timestamp);
+        return;
+    }
+    
     std::lock_guard<std::mutex> lock(bufferMutex_);
+    writeRing(data, size, timestamp);
+}
+
+void AudioBuffer::writeRing(const void* data, size_t size, uint64_t timestamp) {
+    // A resize is waiting for us to switch rings (one load on the fast path otherwise)
+    if (swapState_.load(std::memory_order_acquire) == kSwapPending) {
+        takePendingRing();
+    }
+    
+    const uint8_t* dataBytes = static_cast<const uint8_t*>(data);
+    uint64_t position = head_.load(std::memory_order_relaxed);
+    uint64_t end = position + size;
     
-    // If the incoming data is larger than the buffer, only take the most recent part
+    // If the incoming data is larger than the buffer, only the most recent part can be kept
     if (size > maxSizeBytes_) {
-        const uint8_t* dataBytes = static_cast<const uint8_t*>(data);
-        size_t offset = size - maxSizeBytes_;
-        
-        std::copy(dataBytes + offset, dataBytes + size, buffer_.begin());
-        currentPos_ = 0;
-        currentTimestamp_ = timestamp + (offset / bytesPerSample_ * 1000 / sampleRate_);
+        dataBytes += size - maxSizeBytes_;
+        position = end - maxSizeBytes_;
+        size = maxSizeBytes_;
+    }
+    
+    // Announce the overwrite before touching the bytes, so readers can tell what they
+    // copied may have changed underneath them (seqlock-style writer)
+    reserved_.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    // Copy data to buffer, handling wrap-around
+    size_t start = static_cast<size_t>(position & mask_);
+    size_t firstChunk = std::min(size, maxSizeBytes_ - start);
+    std::memcpy(ring_.data() + start, dataBytes, firstChunk);
+    std::memcpy(ring_.data(), dataBytes + firstChunk, size - firstChunk);
+    
+    head_.store(end, std::memory_order_release);
+    storeLastWrite(end, timestamp);
+    appendIndex(end, timestamp);
+}
+
+void AudioBuffer::appendIndex(uint64_t position, uint64_t timestamp) {
+    uint64_t count = indexCount_.load(std::memory_order_relaxed);
+    indexReserved_.store(count + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    IndexEntry& entry = index_[count & (kIndexEntries - 1)];
+    entry.position.store(position, std::memory_order_relaxed);
+    entry.timestamp.store(timestamp, std::memory_order_relaxed);
+    
+    indexCount_.store(count + 1, std::memory_order_release);
+}
+
+uint64_t AudioBuffer::oldestIntact(uint64_t reserved) const {
+    return reserved > maxSizeBytes_ ? reserved - maxSizeBytes_ : 0;
+}
+
+uint64_t AudioBuffer::alignUpToFrame(uint64_t position) const {
+    uint64_t frameBytes = static_cast<uint64_t>(bytesPerSample_);
+    return (position + frameBytes - 1) / frameBytes * frameBytes;
+}
+
+ReadCursor AudioBuffer::createCursor(bool fromOldest) const {
+    std::lock_guard<std::mutex> lock(bufferMutex_);
+    ReadCursor cursor;
+    if (fromOldest) {
+        uint64_t oldest = std::max(validFrom_.load(std::memory_order_acquire),
+                                   oldestIntact(reserved_.load(std::memory_order_acquire)));
+        cursor.position = alignUpToFrame(oldest);
     } else {
-        // Copy data to buffer, handling wrap-around
-        size_t remainingSpace = maxSizeBytes_ - currentPos_;
-        const uint8_t* dataBytes = static_cast<const uint8_t*>(data);
-        
-        if (size <= remainingSpace) {
-            // Data fits in remaining space
-            std::copy(dataBytes, dataBytes + size, buffer_.begin() + currentPos_);
-            currentPos_ = (currentPos_ + size) % maxSizeBytes_;
-        } else {
-            // Data wraps around buffer
-            std::copy(dataBytes, dataBytes + remainingSpace, buffer_.begin() + currentPos_);
-            std::copy(dataBytes + remainingSpace, dataBytes + size, buffer_.begin());
-            currentPos_ = size - remainingSpace;
-        }
-        
-        // Update timestamp
-        currentTimestamp_ = timestamp;
+        cursor.position = head_.load(std::memory_order_acquire);
     }
+    return cursor;
 }
 
-std::vector<uint8_t> AudioBuffer::getData(size_t maxSize, uint64_t& timestamp) {
+ReadResult AudioBuffer::read(ReadCursor& cursor, size_t maxSize) {
+    // Readers only contend with each other and resize(), never with a lock-free writer
     std::lock_guard<std::mutex> lock(bufferMutex_);
+    return readRing(cursor, maxSize);
+}
+
+ReadResult AudioBuffer::readRing(ReadCursor& cursor, size_t maxSize) {
+    ReadResult result;
+    const uint64_t frameBytes = static_cast<uint64_t>(bytesPerSample_);
     
-    std::vector<uint8_t> result;
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t oldest = alignUpToFrame(std::max(validFrom_.load(std::memory_order_acquire),
+                                              oldestIntact(reserved_.load(std::memory_order_acquire))));
     
-    if (buffer_.empty()) {
-        timestamp = currentTimestamp_;
-        return result;
+    // A reader the writer has lapped continues with the oldest audio still held
+    uint64_t start = std::min(cursor.position, head);
+    uint64_t lostBytes = 0;
+    if (start < oldest) {
+        lostBytes = oldest - start;
+        start = oldest;
+    }
+    
+    // Only hand out whole frames, and nothing until the minimum send size is waiting
+    uint64_t available = head > start ? head - start : 0;
+    size_t dataToReturn = static_cast<size_t>(std::min<uint64_t>(maxSize, available));
+    dataToReturn -= dataToReturn % frameBytes;
+    
+    if (dataToReturn > 0 && dataToReturn >= std::min(bufferMinSend_, maxSize)) {
+        result.data.resize(dataToReturn);
+        size_t ringStart = static_cast<size_t>(start & mask_);
+        size_t firstChunk = std::min(dataToReturn, maxSizeBytes_ - ringStart);
+        std::memcpy(result.data.data(), ring_.data() + ringStart, firstChunk);
+        std::memcpy(result.data.data() + firstChunk, ring_.data(), dataToReturn - firstChunk);
+    
+        // Anything the writer reserved while we copied may be torn; drop those frames
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t intact = alignUpToFrame(oldestIntact(reserved_.load(std::memory_order_relaxed)));
+        if (intact > start) {
+            size_t torn = static_cast<size_t>(std::min<uint64_t>(intact - start, dataToReturn));
+            result.data.erase(result.data.begin(), result.data.begin() + torn);
+            lostBytes += torn;
+            start += torn;
+            dataToReturn -= torn;
+        }
+    } else {
+        dataToReturn = 0;
+    }
+    
+    cursor.position = start + dataToReturn;
+    result.lostFrames = lostBytes / frameBytes;
+    
+    // The newest block's timestamp marks its end position; step back to the start of this chunk
+    uint64_t lastPos;
+    uint64_t lastTimestamp;
+    loadLastWrite(lastPos, lastTimestamp);
+    int64_t bytesBehind = static_cast<int64_t>(lastPos - start);
+    int64_t msOffset = (bytesBehind / static_cast<int64_t>(frameBytes)) * 1000 / sampleRate_;
+    result.timestamp = lastTimestamp - msOffset;
+    
+    if (!result.data.empty()) {
+        result.sequence = cursor.sequence++;
+    } else {
+        result.sequence = cursor.sequence;
     }
-    // Calculate how much data to return
-    size_t dataToReturn = std::min(maxSize, buffer_.size());
+    
+    return result;
+}
 
-    // If the amount of data to return is less than the minimum send size, return the current timestamp
-    if (dataToReturn < bufferMinSend_) {
-        timestamp = currentTimestamp_;
+uint64_t AudioBuffer::positionAt(const std::vector<std::pair<uint64_t, uint64_t>>& index, uint64_t timestamp) const {
+    // First block that ends at or after the timestamp; step back inside it by sample count
+    auto it = std::lower_bound(index.begin(), index.end(), timestamp,
+        [](const std::pair<uint64_t, uint64_t>& entry, uint64_t ts) { return entry.second < ts; });
+    if (it == index.end()) {
+        return index.back().first;
+    }
+    
+    uint64_t framesBack = (it->second - timestamp) * static_cast<uint64_t>(sampleRate_) / 1000;
+    uint64_t bytesBack = framesBack * static_cast<uint64_t>(bytesPerSample_);
+    return bytesBack < it->first ? it->first - bytesBack : 0;
+}
+
+ReadResult AudioBuffer::readRange(uint64_t fromTimestamp, uint64_t toTimestamp) {
+    std::lock_guard<std::mutex> lock(bufferMutex_);
+    ReadResult result;
+    
+    // Snapshot the index, then drop entries the writer may have overwritten while we copied
+    uint64_t count = indexCount_.load(std::memory_order_acquire);
+    uint64_t first = count > kIndexEntries ? count - kIndexEntries : 0;
+    std::vector<std::pair<uint64_t, uint64_t>> index;
+    index.reserve(count - first);
+    for (uint64_t i = first; i < count; i++) {
+        const IndexEntry& entry = index_[i & (kIndexEntries - 1)];
+        index.emplace_back(entry.position.load(std::memory_order_relaxed),
+                           entry.timestamp.load(std::memory_order_relaxed));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t reserved = indexReserved_.load(std::memory_order_relaxed);
+    if (reserved > kIndexEntries && reserved - kIndexEntries > first) {
+        size_t torn = static_cast<size_t>(std::min<uint64_t>(reserved - kIndexEntries - first, index.size()));
+        index.erase(index.begin(), index.begin() + torn);
+    }
+    
+    if (index.empty() || fromTimestamp > toTimestamp) {
         return result;
     }
     
-    // Copy data from buffer
-    result.resize(dataToReturn);
+    uint64_t start = positionAt(index, fromTimestamp);
+    uint64_t end = positionAt(index, toTimestamp);
     
-    // If current position is at the beginning, copy from the end of the buffer
-    if (currentPos_ == 0) {
-        std::copy(buffer_.end() - dataToReturn, buffer_.end(), result.begin());
-    } else {
-        // Start from current position - dataToReturn
-        size_t startPos = (currentPos_ >= dataToReturn) ? currentPos_ - dataToReturn : maxSizeBytes_ - (dataToReturn - currentPos_);
-        
-        if (startPos + dataToReturn <= maxSizeBytes_) {
-            // Data doesn't wrap around buffer
-            std::copy(buffer_.begin() + startPos, buffer_.begin() + startPos + dataToReturn, result.begin());
-        } else {
-            // Data wraps around buffer
-            size_t firstChunk = maxSizeBytes_ - startPos;
-            std::copy(buffer_.begin() + startPos, buffer_.end(), result.begin());
-            std::copy(buffer_.begin(), buffer_.begin() + (dataToReturn - firstChunk), result.begin() + firstChunk);
-        }
+    // Whatever the writer has already overwritten is reported, not returned
+    const uint64_t frameBytes = static_cast<uint64_t>(bytesPerSample_);
+    uint64_t oldest = alignUpToFrame(std::max(validFrom_.load(std::memory_order_acquire),
+                                              oldestIntact(reserved_.load(std::memory_order_acquire))));
+    uint64_t lostFrames = 0;
+    if (start < oldest) {
+        lostFrames = (std::min(oldest, end) - start) / frameBytes;
+        start = std::min(oldest, end);
     }
     
-    // Calculate timestamp for this data chunk
-    size_t msOffset = (dataToReturn / bytesPerSample_) * 1000 / sampleRate_;
-    timestamp = currentTimestamp_ - msOffset;
+    if (end > start) {
+        ReadCursor cursor;
+        cursor.position = start;
+        result = readRing(cursor, static_cast<size_t>(end - start));
+        result.sequence = 0;
+    }
+    result.lostFrames += lostFrames;
     
     return result;
 }
 
+std::vector<uint8_t> AudioBuffer::getData(size_t maxSize, uint64_t& timestamp) {
+    ReadResult result = read(defaultCursor_, maxSize);
+    
+    if (result.lostFrames > 0) {
+        droppedBytes_.fetch_add(result.lostFrames * bytesPerSample_, std::memory_order_relaxed);
+    }
+    
+    timestamp = result.timestamp;
+    return std::move(result.data);
+}
+
+void AudioBuffer::storeLastWrite(uint64_t position, uint64_t timestamp) {
+    // Single writer seqlock: odd sequence while the pair is being updated
+    uint32_t seq = lastWriteSeq_.load(std::memory_order_relaxed);
+    lastWriteSeq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    lastWritePos_.store(position, std::memory_order_relaxed);
+    lastWriteTimestamp_.store(timestamp, std::memory_order_relaxed);
+    lastWriteSeq_.store(seq + 2, std::memory_order_release);
+}
+
+void AudioBuffer::loadLastWrite(uint64_t& position, uint64_t& timestamp) const {
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = lastWriteSeq_.load(std::memory_order_acquire);
+        position = lastWritePos_.load(std::memory_order_relaxed);
+        timestamp = lastWriteTimestamp_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = lastWriteSeq_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
 void AudioBuffer::clear() {
+    // Skip the buffer's own reader past everything held; the writer may keep writing
     std::lock_guard<std::mutex> lock(bufferMutex_);
-    std::fill(buffer_.begin(), buffer_.end(), 0);
-    currentPos_ = 0;
-    currentTimestamp_ = 0;
+    defaultCursor_.position = head_.load(std::memory_order_acquire);
 }
 
 size_t AudioBuffer::getCurrentSize() const {
-    return buffer_.size();
+    // Bytes of audio currently held
+    std::lock_guard<std::mutex> lock(bufferMutex_);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t oldest = std::max(validFrom_.load(std::memory_order_acquire), oldestIntact(head));
+    return static_cast<size_t>(head - std::min(oldest, head));
 }
 
 size_t AudioBuffer::getMaxSize() const {
+    std::lock_guard<std::mutex> lock(bufferMutex_);
     return maxSizeBytes_;
 }
 
-void AudioBuffer::resize(int bufferSizeMs) {
+bool AudioBuffer::resize(int bufferSizeMs, bool writerRunning) {
+    // Readers stay out until the new ring is in place
     std::lock_guard<std::mutex> lock(bufferMutex_);
     
     // Calculate new buffer size in bytes
-    int samplesPerMs = sampleRate_ / 1000;
-    size_t newSizeBytes = bufferSizeMs * samplesPerMs * bytesPerSample_;
+    size_t newSizeBytes = capacityFor(bytesForMs(bufferSizeMs));
+    if (newSizeBytes == 0) {
+        std::cerr << "Audio buffer of " << bufferSizeMs << " ms is over " << kMaxBufferBytes << " bytes" << std::endl;
+        return false;
+    }
+    if (newSizeBytes == maxSizeBytes_) {
+        return true;
+    }
     
-    // Resize buffer
-    buffer_.resize(newSizeBytes, 0);
-    maxSizeBytes_ = newSizeBytes;
+    // Allocate (and pre-fault) once, off the capture thread
+    RealtimeBuffer newRing;
+    try {
+        newRing = RealtimeBuffer(newSizeBytes);
+    } catch (const std::bad_alloc&) {
+        std::cerr << "Failed to allocate " << newSizeBytes << " byte audio buffer" << std::endl;
+        return false;
+    }
+    
+    // Bulk copy of the newest audio that fits, to the same absolute positions in the new ring
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t from = std::max(validFrom_.load(std::memory_order_relaxed),
+                             oldestIntact(reserved_.load(std::memory_order_acquire)));
+    from = alignUpToFrame(std::max(from, head > newSizeBytes ? head - newSizeBytes : 0));
+    copyBetweenRings(ring_.data(), maxSizeBytes_, newRing.data(), newSizeBytes, std::min(from, head), head);
+    
+    // Anything the writer overwrote while we copied is not carried over
+    std::atomic_thread_fence(std::memory_order_acquire);
+    from = std::max(from, alignUpToFrame(oldestIntact(reserved_.load(std::memory_order_relaxed))));
     
-    // Reset position if it's now out of bounds
-    if (currentPos_ >= maxSizeBytes_) {
-        currentPos_ = 0;
+    pendingRing_ = std::move(newRing);
+    pendingSize_ = newSizeBytes;
+    pendingCopiedTo_ = head;
+    pendingValidFrom_ = from;
+    
+    if (mode_ == Mode::LockFree && writerRunning) {
+        // Hand the ring to the writer; it only has to copy what it wrote since our snapshot
+        swapState_.store(kSwapPending, std::memory_order_release);
+        
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kResizeTimeoutMs);
+        while (swapState_.load(std::memory_order_acquire) != kSwapDone) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                // Take the offer back unless the writer claimed it in the meantime
+                uint32_t expected = kSwapPending;
+                if (swapState_.compare_exchange_strong(expected, kSwapIdle, std::memory_order_acq_rel)) {
+                    pendingRing_ = RealtimeBuffer();
+                    std::cerr << "Audio buffer resize timed out waiting for the writer" << std::endl;
+                    return false;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        swapState_.store(kSwapIdle, std::memory_order_release);
+    } else {
+        // Locked mode: the writer waits on bufferMutex_; lock-free mode: there is no writer
+        completeSwap();
+    }
+    
+    // The writer swapped the old ring into pendingRing_; free it here, not on the capture thread
+    pendingRing_ = RealtimeBuffer();
+    bufferMinSend_ = std::min(requestedMinSend_, maxSizeBytes_ / 2);
+    
+    return true;
+}
+
+void AudioBuffer::takePendingRing() {
+    uint32_t expected = kSwapPending;
+    if (swapState_.compare_exchange_strong(expected, kSwapClaimed, std::memory_order_acq_rel)) {
+        completeSwap();
+        swapState_.store(kSwapDone, std::memory_order_release);
     }
-} 
\ No newline at end of file
+}
+
+void AudioBuffer::completeSwap() {
+    // Runs on the writer (or with the writer excluded), so head is stable and nothing is torn
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t from = pendingCopiedTo_;
+    uint64_t validFrom = pendingValidFrom_;
+    
+    // Lapped since the bulk copy: only the old ring's current contents are left to carry over
+    if (head - from > maxSizeBytes_) {
+        from = head - maxSizeBytes_;
+        validFrom = alignUpToFrame(from);
+    }
+    copyBetweenRings(ring_.data(), maxSizeBytes_, pendingRing_.data(), pendingSize_, from, head);
+    
+    // Swap rather than move, so the old mapping is released by resize() and not here
+    std::swap(ring_, pendingRing_);
+    maxSizeBytes_ = pendingSize_;
+    mask_ = maxSizeBytes_ - 1;
+    validFrom_.store(validFrom, std::memory_order_release);
+}
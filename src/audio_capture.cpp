@@ -1,7 +1,7 @@
 #include "audio_capture.hpp"
 #include "device_manager.hpp"
+#include "realtime_memory.hpp"
 #include <iostream>
-#include <chrono>
 #include <cstring>
 
 AudioCapture::AudioCapture(const std::string& deviceName, 
@@ -9,19 +9,23 @@ AudioCapture::AudioCapture(const std::string& deviceName,
                           int channels, 
                           int bitDepth,
                           int bufferSize)
-    : deviceName_(deviceName),
-      sampleRate_(sampleRate),
-      channels_(channels),
-      bitDepth_(bitDepth),
-      bufferSize_(bufferSize),
+    : AudioSource(sampleRate, channels, bitDepth, bufferSize),
+      deviceName_(deviceName),
       stream_(nullptr),
       isInitialized_(false),
-      isRunning_(false) {
-    
-    bytesPerSample_ = (bitDepth / 8);
+      isRunning_(false),
+      captureMode_(CaptureMode::Callback),
+      readRunning_(false) {
+}
+
+void AudioCapture::setCaptureMode(CaptureMode mode, const ThreadSchedule& readThreadSchedule) {
+    if (isInitialized_) {
+        std::cerr << "Capture mode must be set before the stream is opened" << std::endl;
+        return;
+    }
     
-    // Create audio buffer
-    audioBuffer_ = std::make_shared<AudioBuffer>(bufferSize, sampleRate, channels, bitDepth);
+    captureMode_ = mode;
+    readThreadSchedule_ = readThreadSchedule;
 }
 
 AudioCapture::~AudioCapture() {
@@ -103,17 +107,29 @@ bool AudioCapture::initialize() {
     inputParams.hostApiSpecificStreamInfo = nullptr;
     
     // Calculate frames per buffer (buffer size in ms to frames)
-    unsigned long framesPerBuffer = (sampleRate_ * bufferSize_) / 1000;
+    unsigned long framesPerBuffer = getFramesPerBuffer();
+    
+    // Pre-allocate capture blocks so the callback never allocates
+    prepareBlockPool(framesPerBuffer);
+    
+    // Frame counting starts over with every new stream
+    captureClock_.reset(sampleRate_);
+    
+    // The read thread reads into this; sized once so the loop never allocates
+    bool blockingRead = (captureMode_ == CaptureMode::BlockingRead);
+    if (blockingRead) {
+        readBuffer_.assign(framesPerBuffer * channels_ * bytesPerSample_, 0);
+    }
     
-    // Open stream
+    // Open stream; without a callback PortAudio expects Pa_ReadStream calls instead
     err = Pa_OpenStream(&stream_,
                        &inputParams,
                        nullptr,  // No output
                        sampleRate_,
                        framesPerBuffer,
                        paClipOff | paDitherOff,  // No clipping or dithering
-                       &AudioCapture::paCallback,
-                       this);
+                       blockingRead ? nullptr : &AudioCapture::paCallback,
+                       blockingRead ? nullptr : this);
     
     if (err != paNoError) {
         std::cerr << "Failed to open PortAudio stream: " << Pa_GetErrorText(err) << std::endl;
@@ -133,24 +149,43 @@ bool AudioCapture::start() {
         return true;  // Already running
     }
     
+    // The read thread gave up on a device error; reap it and reset the stream
+    if (readThread_.joinable()) {
+        stop();
+    }
+    
     PaError err = Pa_StartStream(stream_);
     if (err != paNoError) {
         std::cerr << "Failed to start PortAudio stream: " << Pa_GetErrorText(err) << std::endl;
         return false;
     }
     
+    // Set before the read thread exists, so a read that fails at once is not overwritten
     isRunning_ = true;
+    
+    if (captureMode_ == CaptureMode::BlockingRead) {
+        readRunning_ = true;
+        readThread_ = std::thread(&AudioCapture::readLoop, this);
+    }
+    
     return true;
 }
 
 bool AudioCapture::stop() {
-    if (!isRunning_) {
+    if (!isRunning_ && !readThread_.joinable()) {
         return true;  // Already stopped
     }
     
+    // The read thread returns from Pa_ReadStream within one buffer; the stream must
+    // not be stopped underneath it
+    readRunning_ = false;
+    if (readThread_.joinable()) {
+        readThread_.join();
+    }
+    
     if (stream_) {
         PaError err = Pa_StopStream(stream_);
-        if (err != paNoError) {
+        if (err != paNoError && err != paStreamIsStopped) {
             std::cerr << "Failed to stop PortAudio stream: " << Pa_GetErrorText(err) << std::endl;
             return false;
         }
@@ -174,7 +209,7 @@ bool AudioCapture::setSampleRate(int sampleRate) {
         stream_ = nullptr;
     }
     
-    sampleRate_ = sampleRate;
+    setFormat(sampleRate, channels_, bitDepth_);
     isInitialized_ = false;
     
     if (!initialize()) {
@@ -184,10 +219,6 @@ bool AudioCapture::setSampleRate(int sampleRate) {
     return true;
 }
 
-void AudioCapture::setAudioDataCallback(std::function<void(const std::vector<uint8_t>&, uint64_t)> callback) {
-    dataCallback_ = callback;
-}
-
 int AudioCapture::paCallback(const void* inputBuffer, void* outputBuffer,
                             unsigned long framesPerBuffer,
                             const PaStreamCallbackTimeInfo* timeInfo,
@@ -200,22 +231,58 @@ int AudioCapture::paCallback(const void* inputBuffer, void* outputBuffer,
         return paContinue;
     }
     
-    // Calculate buffer size in bytes
-    size_t bufferSizeBytes = framesPerBuffer * self->channels_ * (self->bitDepth_ / 8);
+    unsigned flags = 0;
+    if (statusFlags & paInputOverflow) {
+        flags |= kInputOverflow;
+    }
+    if (statusFlags & paInputUnderflow) {
+        flags |= kInputUnderflow;
+    }
     
-    // Get current timestamp in milliseconds
-    uint64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
+    if (timeInfo) {
+        self->processInput(inputBuffer, framesPerBuffer, timeInfo->inputBufferAdcTime, timeInfo->currentTime, flags);
+    } else {
+        self->processInput(inputBuffer, framesPerBuffer, 0.0, 0.0, flags);
+    }
     
-    // Add data to buffer
-    self->audioBuffer_->addData(inputBuffer, bufferSizeBytes, timestamp);
+    return paContinue;
+}
+
+void AudioCapture::readLoop() {
+    if (!readThreadSchedule_.isDefault()) {
+        readThreadSchedule_.applyToCurrentThread("capture");
+    }
+    recordThreadSchedule("capture " + deviceName_);
     
-    // If a callback is set, pass the data to it
-    if (self->dataCallback_) {
-        std::vector<uint8_t> data(static_cast<const uint8_t*>(inputBuffer),
-                                  static_cast<const uint8_t*>(inputBuffer) + bufferSizeBytes);
-        self->dataCallback_(data, timestamp);
+    if (RealtimeMemory::isLocked()) {
+        RealtimeMemory::prefaultStack();
     }
     
-    return paContinue;
-} 
\ No newline at end of file
+    unsigned long framesPerBuffer = getFramesPerBuffer();
+    
+    // Stream latency lets us back-date each block to its first frame
+    const PaStreamInfo* streamInfo = Pa_GetStreamInfo(stream_);
+    double inputLatency = streamInfo ? streamInfo->inputLatency : 0.0;
+    double blockDuration = static_cast<double>(framesPerBuffer) / sampleRate_;
+    
+    while (readRunning_) {
+        PaError err = Pa_ReadStream(stream_, readBuffer_.data(), framesPerBuffer);
+        
+        // An overflow still delivers a full buffer; samples before it were lost
+        unsigned flags = 0;
+        if (err == paInputOverflowed) {
+            flags |= kInputOverflow;
+        } else if (err != paNoError) {
+            // Report the source as stopped; stop() or start() reaps this thread
+            std::cerr << "PortAudio read failed: " << Pa_GetErrorText(err)
+                      << "; capture from " << deviceName_ << " stopped" << std::endl;
+            readRunning_ = false;
+            isRunning_ = false;
+            return;
+        }
+        
+        double streamTime = Pa_GetStreamTime(stream_);
+        double adcTime = streamTime - inputLatency - blockDuration;
+        processInput(readBuffer_.data(), framesPerBuffer, adcTime > 0.0 ? adcTime : 0.0, streamTime, flags);
+    }
+}
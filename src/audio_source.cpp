@@ -0,0 +1,298 @@
+#include "audio_source.hpp"
+#include "audio_capture.hpp"
+#include "file_audio_source.hpp"
+#include "synthetic_audio_source.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+AudioSource::AudioSource(int sampleRate, int channels, int bitDepth, int bufferSize)
+    : sampleRate_(sampleRate),
+      channels_(channels),
+      bitDepth_(bitDepth),
+      bufferSize_(bufferSize),
+      historyMs_(kDefaultHistoryMs),
+      captureClock_(sampleRate),
+      inputOverflows_(0),
+      inputUnderflows_(0),
+      framesCaptured_(0),
+      framesDropped_(0) {
+    
+    bytesPerSample_ = (bitDepth / 8);
+    
+    // Create audio buffer; the capture thread is its only writer, so it must never block
+    audioBuffer_ = std::make_shared<AudioBuffer>(sampleRate, channels, bitDepth, historyMs_, 2048, AudioBuffer::Mode::LockFree);
+}
+
+void AudioSource::setFormat(int sampleRate, int channels, int bitDepth) {
+    if (sampleRate == sampleRate_ && channels == channels_ && bitDepth == bitDepth_) {
+        return;
+    }
+    
+    sampleRate_ = sampleRate;
+    channels_ = channels;
+    bitDepth_ = bitDepth;
+    bytesPerSample_ = (bitDepth / 8);
+    
+    audioBuffer_ = std::make_shared<AudioBuffer>(sampleRate, channels, bitDepth, historyMs_, 2048, AudioBuffer::Mode::LockFree);
+    captureClock_.reset(sampleRate);
+}
+
+bool AudioSource::setHistoryMs(int historyMs) {
+    if (historyMs == historyMs_) {
+        return true;
+    }
+    
+    if (!audioBuffer_->resize(historyMs, isRunning())) {
+        return false;
+    }
+    
+    historyMs_ = historyMs;
+    return true;
+}
+
+void AudioSource::setAudioDataCallback(AudioDataCallback callback) {
+    dataCallback_ = callback;
+}
+
+void AudioSource::prepareBlockPool(unsigned long framesPerBuffer) {
+    size_t blockBytes = framesPerBuffer * channels_ * bytesPerSample_;
+    
+    if (blockPool_ && blockPool_->blockCapacity() >= blockBytes) {
+        return;  // Existing blocks are big enough
+    }
+    
+    if (blockPool_) {
+        retiredPools_.push_back(blockPool_);
+    }
+    blockPool_ = std::make_shared<AudioBlockPool>(kBlockPoolSize, blockBytes);
+}
+
+CaptureCounters AudioSource::getCaptureCounters() const {
+    CaptureCounters counters;
+    counters.inputOverflows = inputOverflows_.load(std::memory_order_relaxed);
+    counters.inputUnderflows = inputUnderflows_.load(std::memory_order_relaxed);
+    counters.framesCaptured = framesCaptured_.load(std::memory_order_relaxed);
+    counters.framesDropped = framesDropped_.load(std::memory_order_relaxed);
+    return counters;
+}
+
+void AudioSource::processInput(const void* inputBuffer, unsigned long framesPerBuffer,
+                               double adcTime, double streamTime, unsigned statusFlags) {
+    // Calculate buffer size in bytes
+    size_t bufferSizeBytes = framesPerBuffer * channels_ * bytesPerSample_;
+    
+    // Count device problems; this thread is the only writer, so plain stores are enough
+    if (statusFlags & kInputOverflow) {
+        inputOverflows_.store(inputOverflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        pendingGap_.inputOverflows++;
+    }
+    if (statusFlags & kInputUnderflow) {
+        inputUnderflows_.store(inputUnderflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        pendingGap_.inputUnderflows++;
+    }
+    framesCaptured_.store(framesCaptured_.load(std::memory_order_relaxed) + framesPerBuffer, std::memory_order_relaxed);
+    
+    // Stamp the block from the frame counter and the stream's ADC time
+    CaptureTime captureTime = captureClock_.stamp(framesPerBuffer, adcTime, streamTime);
+    uint64_t timestamp = captureTime.epochNs / 1000000;
+    
+    // Add data to buffer; the buffer stamps data by the time of its last frame
+    audioBuffer_->addData(inputBuffer, bufferSizeBytes, timestamp + framesPerBuffer * 1000ull / sampleRate_);
+    
+    // If a callback is set, pass the data to it in a pooled block
+    if (dataCallback_ && blockPool_) {
+        AudioBlockHandle block = blockPool_->acquire();
+        if (!block || block->capacity < bufferSizeBytes) {
+            // Pool exhausted or unexpected block size, drop this block and report it with the next one
+            framesDropped_.store(framesDropped_.load(std::memory_order_relaxed) + framesPerBuffer,
+                                 std::memory_order_relaxed);
+            pendingGap_.droppedFrames += framesPerBuffer;
+            return;
+        }
+        
+        std::memcpy(block->data, inputBuffer, bufferSizeBytes);
+        block->size = bufferSizeBytes;
+        block->frames = framesPerBuffer;
+        block->timestamp = timestamp;
+        block->time = captureTime;
+        block->gap = pendingGap_;
+        pendingGap_ = CaptureGap();
+        
+        dataCallback_(block);
+    }
+}
+
+ThreadedAudioSource::ThreadedAudioSource(int sampleRate, int channels, int bitDepth, int bufferSize, Pacing pacing)
+    : AudioSource(sampleRate, channels, bitDepth, bufferSize),
+      pacing_(pacing),
+      isInitialized_(false),
+      running_(false) {
+}
+
+ThreadedAudioSource::~ThreadedAudioSource() {
+    stop();
+}
+
+bool ThreadedAudioSource::initialize() {
+    if (isInitialized_) {
+        return true;
+    }
+    
+    if (!openSource()) {
+        return false;
+    }
+    
+    if (getFramesPerBuffer() == 0) {
+        std::cerr << "Buffer size too small for sample rate " << sampleRate_ << std::endl;
+        return false;
+    }
+    
+    // Pre-allocate the staging block and the capture blocks
+    scratch_.assign(getFramesPerBuffer() * channels_ * bytesPerSample_, 0);
+    prepareBlockPool(getFramesPerBuffer());
+    
+    // Frame counting starts over with every new stream
+    captureClock_.reset(sampleRate_);
+    
+    isInitialized_ = true;
+    return true;
+}
+
+bool ThreadedAudioSource::start() {
+    if (!isInitialized_ && !initialize()) {
+        return false;
+    }
+    
+    if (running_) {
+        return true;  // Already running
+    }
+    
+    // Reap a generator thread that ended on its own
+    if (generateThread_.joinable()) {
+        generateThread_.join();
+    }
+    
+    running_ = true;
+    generateThread_ = std::thread(&ThreadedAudioSource::generateLoop, this);
+    return true;
+}
+
+bool ThreadedAudioSource::stop() {
+    running_ = false;
+    
+    if (generateThread_.joinable()) {
+        generateThread_.join();
+    }
+    
+    return true;
+}
+
+bool ThreadedAudioSource::isRunning() const {
+    return running_;
+}
+
+bool ThreadedAudioSource::setSampleRate(int sampleRate) {
+    if (!canChangeSampleRate()) {
+        std::cerr << "Sample rate is fixed by source " << getDeviceName() << std::endl;
+        return false;
+    }
+    
+    stop();
+    
+    setFormat(sampleRate, channels_, bitDepth_);
+    isInitialized_ = false;
+    
+    return initialize();
+}
+
+void ThreadedAudioSource::generateLoop() {
+    const unsigned long frames = getFramesPerBuffer();
+    const auto blockDuration = std::chrono::nanoseconds(frames * 1000000000ull / sampleRate_);
+    auto nextBlock = std::chrono::steady_clock::now();
+    
+    while (running_) {
+        if (pacing_ == Pacing::AsFastAsPossible) {
+            // Back-pressure: wait for the pipeline to return a block instead of dropping
+            while (running_ && blockPool_->available() == 0) {
+                std::this_thread::yield();
+            }
+        }
+        
+        if (!fillBlock(scratch_.data(), frames)) {
+            std::cerr << "Audio source " << getDeviceName() << " ended" << std::endl;
+            running_ = false;
+            break;
+        }
+        
+        processInput(scratch_.data(), frames);
+        
+        if (pacing_ == Pacing::RealTime) {
+            nextBlock += blockDuration;
+            std::this_thread::sleep_until(nextBlock);
+        }
+    }
+}
+
+std::shared_ptr<AudioSource> createAudioSource(const std::string& spec,
+                                               const std::string& deviceName,
+                                               int sampleRate,
+                                               int channels,
+                                               int bitDepth,
+                                               int bufferSize,
+                                               const std::string& pacing) {
+    ThreadedAudioSource::Pacing sourcePacing;
+    if (pacing.empty() || pacing == "realtime") {
+        sourcePacing = ThreadedAudioSource::Pacing::RealTime;
+    } else if (pacing == "fast") {
+        sourcePacing = ThreadedAudioSource::Pacing::AsFastAsPossible;
+    } else {
+        std::cerr << "Unknown source pacing: " << pacing << std::endl;
+        return nullptr;
+    }
+    
+    // Split "kind:argument"
+    std::string kind = spec;
+    std::string argument;
+    size_t colonPos = spec.find(':');
+    if (colonPos != std::string::npos) {
+        kind = spec.substr(0, colonPos);
+        argument = spec.substr(colonPos + 1);
+    }
+    
+    if (kind.empty() || kind == "device") {
+        // "device:<name>" overrides the --input-device name
+        return std::make_shared<AudioCapture>(argument.empty() ? deviceName : argument,
+                                              sampleRate, channels, bitDepth, bufferSize);
+    }
+    
+    if (kind == "file") {
+        if (argument.empty()) {
+            std::cerr << "Missing file path in input source: " << spec << std::endl;
+            return nullptr;
+        }
+        return std::make_shared<FileAudioSource>(argument, sampleRate, channels, bitDepth, bufferSize, sourcePacing);
+    }
+    
+    if (kind == "sine") {
+        double frequency = 440.0;
+        if (!argument.empty()) {
+            try {
+                frequency = std::stod(argument);
+            } catch (...) {
+                std::cerr << "Invalid sine frequency: " << argument << std::endl;
+                return nullptr;
+            }
+        }
+        return std::make_shared<SyntheticAudioSource>(SyntheticAudioSource::Waveform::Sine, frequency,
+                                                      sampleRate, channels, bitDepth, bufferSize, sourcePacing);
+    }
+    
+    if (kind == "noise") {
+        return std::make_shared<SyntheticAudioSource>(SyntheticAudioSource::Waveform::Noise, 0.0,
+                                                      sampleRate, channels, bitDepth, bufferSize, sourcePacing);
+    }
+    
+    std::cerr << "Unknown input source: " << spec << std::endl;
+    return nullptr;
+}
@@ -0,0 +1,79 @@
+#include "capture_clock.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+// Weight of each new measurement in the smoothing filters
+constexpr double kSmoothing = 1.0 / 64.0;
+
+// Errors larger than this are treated as a discontinuity (stream restart, overrun) and re-anchor
+constexpr double kMinResyncThresholdNs = 50e6;
+
+int64_t nowNs(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+int64_t nowNs(std::chrono::system_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+} // namespace
+
+CaptureClock::CaptureClock(int sampleRate) {
+    reset(sampleRate);
+}
+
+void CaptureClock::reset(int sampleRate) {
+    sampleRate_ = sampleRate > 0 ? sampleRate : 1;
+    framesCaptured_ = 0;
+    anchored_ = false;
+    anchorNs_ = 0.0;
+    epochOffsetNs_ = 0.0;
+}
+
+CaptureTime CaptureClock::stamp(unsigned long frames, double adcTime, double streamTime) {
+    return stamp(frames, adcTime, streamTime, nowNs(std::chrono::steady_clock::now()),
+                 nowNs(std::chrono::system_clock::now()));
+}
+
+CaptureTime CaptureClock::stamp(unsigned long frames, double adcTime, double streamTime,
+                                int64_t steadyNow, int64_t systemNow) {
+    const double nsPerFrame = 1e9 / sampleRate_;
+    
+    // How long ago the first frame of this block hit the converter
+    double latencyNs;
+    if (adcTime > 0.0 && streamTime >= adcTime) {
+        latencyNs = (streamTime - adcTime) * 1e9;
+    } else {
+        latencyNs = frames * nsPerFrame;  // Assume the block has just been completed
+    }
+    
+    double measuredNs = steadyNow - latencyNs;
+    double frameOffsetNs = framesCaptured_ * nsPerFrame;
+    double errorNs = measuredNs - (anchorNs_ + frameOffsetNs);
+    
+    double resyncThresholdNs = std::max(kMinResyncThresholdNs, 2.0 * frames * nsPerFrame);
+    double measuredOffsetNs = static_cast<double>(systemNow - steadyNow);
+    
+    if (!anchored_ || std::fabs(errorNs) > resyncThresholdNs) {
+        anchorNs_ = measuredNs - frameOffsetNs;
+        if (!anchored_) {
+            epochOffsetNs_ = measuredOffsetNs;
+        }
+        anchored_ = true;
+    } else {
+        anchorNs_ += errorNs * kSmoothing;
+    }
+    epochOffsetNs_ += (measuredOffsetNs - epochOffsetNs_) * kSmoothing;
+    
+    CaptureTime time;
+    time.frameIndex = framesCaptured_;
+    time.adcTime = adcTime;
+    time.monotonicNs = static_cast<uint64_t>(anchorNs_ + frameOffsetNs);
+    time.epochNs = static_cast<uint64_t>(anchorNs_ + frameOffsetNs + epochOffsetNs_);
+    
+    framesCaptured_ += frames;
+    return time;
+}
@@ -0,0 +1,539 @@
+#include "capture_journal.hpp"
+#include "audio_source.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'S', 'J', 'R', 'N', 'L', '0', '1'};
+constexpr uint32_t kFormatVersion = 1;
+
+// A timestamp further than this from where the previous audio ended starts a new segment
+constexpr uint64_t kMaxTimestampJumpMs = 20;
+
+// Read the ring in chunks of up to this many bytes
+constexpr size_t kRecordChunkBytes = 256 * 1024;
+const auto kRecordInterval = std::chrono::milliseconds(20);
+const auto kFlushInterval = std::chrono::seconds(1);
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+uint64_t roundUp(uint64_t value, uint64_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+// On-disk structures; fixed-width fields only, shared between processes
+struct CaptureJournal::FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint32_t bitDepth;
+    uint64_t segmentBytes;
+    uint64_t segmentCount;
+    uint64_t tableOffset;
+    uint64_t dataOffset;
+};
+
+struct CaptureJournal::SegmentEntry {
+    std::atomic<uint64_t> version;         // Odd while the segment is being recycled
+    std::atomic<uint64_t> sequence;        // Increases with every segment opened; 0 = never used
+    std::atomic<uint64_t> startTimestamp;  // Capture time of the first frame, ms since epoch
+    std::atomic<uint64_t> bytes;           // Valid bytes; only grows until the segment is recycled
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "journal entries are shared between processes");
+
+CaptureJournal::CaptureJournal(const std::string& path)
+    : RingReader("journal " + path, kRecordChunkBytes, kRecordInterval, true),
+      path_(path),
+      fd_(-1),
+      base_(nullptr),
+      mappedBytes_(0),
+      sizeBytes_(0),
+      segmentMs_(kDefaultSegmentMs),
+      currentSegment_(0),
+      nextSequence_(1),
+      segmentOpen_(false),
+      expectedTimestamp_(0),
+      bytesWritten_(0) {
+}
+
+CaptureJournal::~CaptureJournal() {
+    stop();
+    close();
+}
+
+bool CaptureJournal::create(int sampleRate, int channels, int bitDepth, uint64_t sizeBytes, int segmentMs) {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    unmapFile();
+
+    uint64_t frameSize = static_cast<uint64_t>(channels) * (bitDepth / 8);
+    uint64_t segmentFrames = std::max<uint64_t>(1, static_cast<uint64_t>(sampleRate) * segmentMs / 1000);
+    uint64_t segmentBytes = segmentFrames * frameSize;
+    if (frameSize == 0 || segmentBytes == 0) {
+        std::cerr << "Invalid journal format for " << path_ << std::endl;
+        return false;
+    }
+
+    // Size the segment table for as many segments as fit, then give back what the table takes
+    uint64_t segmentCount = sizeBytes / segmentBytes;
+    auto dataOffsetFor = [](uint64_t count) {
+        return pageSize() + roundUp(count * sizeof(SegmentEntry), pageSize());
+    };
+    while (segmentCount > 0 && dataOffsetFor(segmentCount) + segmentCount * segmentBytes > sizeBytes) {
+        segmentCount--;
+    }
+    if (segmentCount < 2) {
+        std::cerr << "Journal " << path_ << " is too small: " << sizeBytes << " bytes hold fewer than 2 segments of "
+                  << segmentBytes << " bytes" << std::endl;
+        return false;
+    }
+    uint64_t totalBytes = dataOffsetFor(segmentCount) + segmentCount * segmentBytes;
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open journal " << path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) != totalBytes) {
+        // Reserve the blocks now, so a full disk fails here and not with SIGBUS while recording.
+        // Filesystems without fallocate get a sparse file instead.
+        int err = EOPNOTSUPP;
+#if defined(__linux__)
+        err = (ftruncate(fd_, 0) == 0) ? posix_fallocate(fd_, 0, static_cast<off_t>(totalBytes)) : errno;
+#endif
+        if (err == EOPNOTSUPP || err == EINVAL) {
+            err = (ftruncate(fd_, static_cast<off_t>(totalBytes)) == 0) ? 0 : errno;
+        }
+        if (err != 0) {
+            std::cerr << "Failed to size journal " << path_ << ": " << std::strerror(err) << std::endl;
+            unmapFile();
+            return false;
+        }
+    }
+
+    if (!mapFile(true, totalBytes)) {
+        return false;
+    }
+
+    sizeBytes_ = sizeBytes;
+    segmentMs_ = segmentMs;
+    if (layoutMatches(sampleRate, channels, bitDepth, segmentBytes, segmentCount)) {
+        resumeAfterNewestSegment();
+    } else {
+        initializeLayout(sampleRate, channels, bitDepth, segmentBytes, segmentCount);
+    }
+
+    return true;
+}
+
+bool CaptureJournal::openForReading() {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    unmapFile();
+
+    fd_ = ::open(path_.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        std::cerr << "Failed to open journal " << path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) < pageSize()) {
+        std::cerr << "Not a journal: " << path_ << std::endl;
+        unmapFile();
+        return false;
+    }
+
+    if (!mapFile(false, static_cast<uint64_t>(st.st_size))) {
+        return false;
+    }
+
+    const FileHeader* h = header();
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kFormatVersion ||
+        h->dataOffset + h->segmentCount * h->segmentBytes > mappedBytes_) {
+        std::cerr << "Not a journal: " << path_ << std::endl;
+        unmapFile();
+        return false;
+    }
+
+    return true;
+}
+
+void CaptureJournal::close() {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    unmapFile();
+}
+
+bool CaptureJournal::mapFile(bool writable, uint64_t totalBytes) {
+    int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* memory = mmap(nullptr, totalBytes, protection, MAP_SHARED, fd_, 0);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Failed to map journal " << path_ << ": " << std::strerror(errno) << std::endl;
+        unmapFile();
+        return false;
+    }
+
+    base_ = static_cast<uint8_t*>(memory);
+    mappedBytes_ = totalBytes;
+    return true;
+}
+
+void CaptureJournal::unmapFile() {
+    if (base_) {
+        msync(base_, mappedBytes_, MS_ASYNC);
+        munmap(base_, mappedBytes_);
+        base_ = nullptr;
+        mappedBytes_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    segmentOpen_ = false;
+}
+
+void CaptureJournal::initializeLayout(int sampleRate, int channels, int bitDepth,
+                                      uint64_t segmentBytes, uint64_t segmentCount) {
+    FileHeader* h = header();
+    std::memset(base_, 0, pageSize());
+    h->version = kFormatVersion;
+    h->sampleRate = static_cast<uint32_t>(sampleRate);
+    h->channels = static_cast<uint32_t>(channels);
+    h->bitDepth = static_cast<uint32_t>(bitDepth);
+    h->segmentBytes = segmentBytes;
+    h->segmentCount = segmentCount;
+    h->tableOffset = pageSize();
+    h->dataOffset = pageSize() + roundUp(segmentCount * sizeof(SegmentEntry), pageSize());
+
+    for (uint64_t i = 0; i < segmentCount; i++) {
+        SegmentEntry* entry = segment(i);
+        entry->version.store(0, std::memory_order_relaxed);
+        entry->sequence.store(0, std::memory_order_relaxed);
+        entry->startTimestamp.store(0, std::memory_order_relaxed);
+        entry->bytes.store(0, std::memory_order_relaxed);
+    }
+
+    // The magic goes in last, so a half-initialized file is never taken for a journal
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(h->magic, kMagic, sizeof(kMagic));
+
+    currentSegment_ = segmentCount - 1;
+    nextSequence_ = 1;
+}
+
+bool CaptureJournal::layoutMatches(int sampleRate, int channels, int bitDepth,
+                                   uint64_t segmentBytes, uint64_t segmentCount) const {
+    const FileHeader* h = header();
+    return std::memcmp(h->magic, kMagic, sizeof(kMagic)) == 0 &&
+           h->version == kFormatVersion &&
+           h->sampleRate == static_cast<uint32_t>(sampleRate) &&
+           h->channels == static_cast<uint32_t>(channels) &&
+           h->bitDepth == static_cast<uint32_t>(bitDepth) &&
+           h->segmentBytes == segmentBytes &&
+           h->segmentCount == segmentCount;
+}
+
+void CaptureJournal::resumeAfterNewestSegment() {
+    const FileHeader* h = header();
+    uint64_t newestSequence = 0;
+    currentSegment_ = h->segmentCount - 1;
+
+    for (uint64_t i = 0; i < h->segmentCount; i++) {
+        SegmentEntry* entry = segment(i);
+
+        // A segment we crashed in the middle of recycling holds nothing usable
+        uint64_t version = entry->version.load(std::memory_order_relaxed);
+        if (version & 1) {
+            entry->sequence.store(0, std::memory_order_relaxed);
+            entry->bytes.store(0, std::memory_order_relaxed);
+            entry->version.store(version + 1, std::memory_order_release);
+            continue;
+        }
+
+        uint64_t sequence = entry->sequence.load(std::memory_order_relaxed);
+        if (sequence > newestSequence) {
+            newestSequence = sequence;
+            currentSegment_ = i;
+        }
+    }
+
+    // New audio always starts a fresh segment after the newest one
+    nextSequence_ = newestSequence + 1;
+}
+
+void CaptureJournal::openSegment(uint64_t timestamp) {
+    currentSegment_ = (currentSegment_ + 1) % header()->segmentCount;
+    SegmentEntry* entry = segment(currentSegment_);
+
+    uint64_t version = entry->version.load(std::memory_order_relaxed);
+    entry->version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry->sequence.store(nextSequence_++, std::memory_order_relaxed);
+    entry->startTimestamp.store(timestamp, std::memory_order_relaxed);
+    entry->bytes.store(0, std::memory_order_relaxed);
+    entry->version.store(version + 2, std::memory_order_release);
+
+    segmentOpen_ = true;
+    expectedTimestamp_ = timestamp;
+}
+
+void CaptureJournal::append(const void* data, size_t size, uint64_t timestamp) {
+    if (!base_) {
+        return;
+    }
+
+    const FileHeader* h = header();
+    const uint64_t frameSize = frameBytes();
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    size -= size % frameSize;
+
+    // Keep every segment contiguous: a jump in time (lost audio, restart) starts a new one
+    uint64_t drift = timestamp > expectedTimestamp_ ? timestamp - expectedTimestamp_ : expectedTimestamp_ - timestamp;
+    if (!segmentOpen_ || drift > kMaxTimestampJumpMs) {
+        openSegment(timestamp);
+    }
+
+    while (size > 0) {
+        SegmentEntry* entry = segment(currentSegment_);
+        uint64_t used = entry->bytes.load(std::memory_order_relaxed);
+        if (used == h->segmentBytes) {
+            openSegment(expectedTimestamp_);
+            continue;
+        }
+
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(size, h->segmentBytes - used));
+        std::memcpy(segmentData(currentSegment_) + used, bytes, chunk);
+        entry->bytes.store(used + chunk, std::memory_order_release);
+
+        bytes += chunk;
+        size -= chunk;
+        bytesWritten_.fetch_add(chunk, std::memory_order_relaxed);
+
+        // Capture time of the next frame, derived from the sample count since the segment started
+        uint64_t frames = (used + chunk) / frameSize;
+        expectedTimestamp_ = entry->startTimestamp.load(std::memory_order_relaxed) + frames * 1000 / h->sampleRate;
+    }
+}
+
+ReadResult CaptureJournal::readRange(uint64_t fromTimestamp, uint64_t toTimestamp) const {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    ReadResult result;
+
+    if (!base_ || fromTimestamp >= toTimestamp) {
+        return result;
+    }
+
+    const FileHeader* h = header();
+    const uint64_t frameSize = frameBytes();
+    const uint64_t sampleRate = h->sampleRate;
+
+    struct Snapshot {
+        uint64_t index;
+        uint64_t version;
+        uint64_t sequence;
+        uint64_t startTimestamp;
+        uint64_t frames;
+    };
+
+    // Snapshot the table and order the segments by age
+    std::vector<Snapshot> segments;
+    for (uint64_t i = 0; i < h->segmentCount; i++) {
+        const SegmentEntry* entry = segment(i);
+        Snapshot snapshot;
+        snapshot.index = i;
+        snapshot.version = entry->version.load(std::memory_order_acquire);
+        snapshot.sequence = entry->sequence.load(std::memory_order_relaxed);
+        snapshot.startTimestamp = entry->startTimestamp.load(std::memory_order_relaxed);
+        snapshot.frames = entry->bytes.load(std::memory_order_acquire) / frameSize;
+        if (!(snapshot.version & 1) && snapshot.sequence != 0 && snapshot.frames > 0) {
+            segments.push_back(snapshot);
+        }
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const Snapshot& a, const Snapshot& b) { return a.sequence < b.sequence; });
+
+    if (segments.empty()) {
+        return result;
+    }
+
+    // Requested audio from before the oldest segment has been recycled
+    uint64_t oldest = segments.front().startTimestamp;
+    if (fromTimestamp < oldest) {
+        result.lostFrames = (std::min(toTimestamp, oldest) - fromTimestamp) * sampleRate / 1000;
+    }
+
+    bool started = false;
+    uint64_t previousEnd = 0;
+    for (const Snapshot& s : segments) {
+        uint64_t segmentEnd = s.startTimestamp + s.frames * 1000 / sampleRate;
+        if (!started && segmentEnd <= fromTimestamp) {
+            continue;
+        }
+        if (s.startTimestamp >= toTimestamp) {
+            break;
+        }
+
+        // Stop at a gap; the caller can ask again from the next segment
+        if (started && s.startTimestamp > previousEnd + kMaxTimestampJumpMs) {
+            break;
+        }
+
+        // Continuation segments are copied from their first frame, so rounding cannot skip frames
+        uint64_t firstFrame = 0;
+        if (!started && fromTimestamp > s.startTimestamp) {
+            firstFrame = (fromTimestamp - s.startTimestamp) * sampleRate / 1000;
+        }
+        uint64_t endFrame = std::min(s.frames, (toTimestamp - s.startTimestamp) * sampleRate / 1000);
+        if (endFrame <= firstFrame) {
+            continue;
+        }
+
+        size_t previousSize = result.data.size();
+        size_t copyBytes = static_cast<size_t>((endFrame - firstFrame) * frameSize);
+        result.data.resize(previousSize + copyBytes);
+        std::memcpy(result.data.data() + previousSize, segmentData(s.index) + firstFrame * frameSize, copyBytes);
+
+        // The writer recycled the segment while we copied it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (segment(s.index)->version.load(std::memory_order_relaxed) != s.version) {
+            result.data.resize(previousSize);
+            result.lostFrames += endFrame - firstFrame;
+            if (started) {
+                break;
+            }
+            continue;
+        }
+
+        if (!started) {
+            result.timestamp = s.startTimestamp + firstFrame * 1000 / sampleRate;
+            started = true;
+        }
+        previousEnd = s.startTimestamp + endFrame * 1000 / sampleRate;
+    }
+
+    return result;
+}
+
+void CaptureJournal::getSpan(uint64_t& oldestTimestamp, uint64_t& newestTimestamp) const {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    oldestTimestamp = 0;
+    newestTimestamp = 0;
+
+    if (!base_) {
+        return;
+    }
+
+    const FileHeader* h = header();
+    uint64_t oldestSequence = UINT64_MAX;
+    uint64_t newestSequence = 0;
+    for (uint64_t i = 0; i < h->segmentCount; i++) {
+        const SegmentEntry* entry = segment(i);
+        uint64_t sequence = entry->sequence.load(std::memory_order_relaxed);
+        uint64_t frames = entry->bytes.load(std::memory_order_relaxed) / frameBytes();
+        if (sequence == 0 || frames == 0) {
+            continue;
+        }
+
+        uint64_t start = entry->startTimestamp.load(std::memory_order_relaxed);
+        if (sequence < oldestSequence) {
+            oldestSequence = sequence;
+            oldestTimestamp = start;
+        }
+        if (sequence > newestSequence) {
+            newestSequence = sequence;
+            newestTimestamp = start + frames * 1000 / h->sampleRate;
+        }
+    }
+}
+
+void CaptureJournal::flush() {
+    if (base_) {
+        msync(base_, mappedBytes_, MS_ASYNC);
+    }
+}
+
+bool CaptureJournal::start(std::shared_ptr<AudioSource> source) {
+    if (isRunning()) {
+        return true;
+    }
+    if (!base_) {
+        return false;
+    }
+
+    nextFlush_ = std::chrono::steady_clock::now() + kFlushInterval;
+    return RingReader::start(source);
+}
+
+bool CaptureJournal::onRing(AudioSource& source) {
+    segmentOpen_ = false;
+
+    if (source.getSampleRate() != getSampleRate() || source.getChannels() != getChannels() ||
+        source.getBitDepth() != getBitDepth()) {
+        std::cerr << "Audio format changed, restarting journal " << path_ << std::endl;
+        return create(source.getSampleRate(), source.getChannels(), source.getBitDepth(), sizeBytes_, segmentMs_);
+    }
+    return true;
+}
+
+void CaptureJournal::onChunk(const ReadResult& chunk) {
+    // The ring's cursor reports lost audio as a timestamp jump, which starts a new segment
+    append(chunk.data.data(), chunk.data.size(), chunk.timestamp);
+}
+
+void CaptureJournal::onCaughtUp(bool stopping) {
+    if (stopping) {
+        flush();
+    } else if (std::chrono::steady_clock::now() >= nextFlush_) {
+        flush();
+        nextFlush_ += kFlushInterval;
+    }
+}
+
+int CaptureJournal::getSampleRate() const {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    return base_ ? static_cast<int>(header()->sampleRate) : 0;
+}
+
+int CaptureJournal::getChannels() const {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    return base_ ? static_cast<int>(header()->channels) : 0;
+}
+
+int CaptureJournal::getBitDepth() const {
+    std::lock_guard<std::mutex> lock(mapMutex_);
+    return base_ ? static_cast<int>(header()->bitDepth) : 0;
+}
+
+CaptureJournal::FileHeader* CaptureJournal::header() const {
+    return reinterpret_cast<FileHeader*>(base_);
+}
+
+CaptureJournal::SegmentEntry* CaptureJournal::segment(uint64_t index) const {
+    return reinterpret_cast<SegmentEntry*>(base_ + header()->tableOffset) + index;
+}
+
+uint8_t* CaptureJournal::segmentData(uint64_t index) const {
+    const FileHeader* h = header();
+    return base_ + h->dataOffset + index * h->segmentBytes;
+}
+
+uint64_t CaptureJournal::frameBytes() const {
+    const FileHeader* h = header();
+    return static_cast<uint64_t>(h->channels) * (h->bitDepth / 8);
+}
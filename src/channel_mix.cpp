@@ -0,0 +1,242 @@
+#include "channel_mix.hpp"
+#include "cpu_features.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TESSA_X86_KERNELS 1
+#define TESSA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+// dst = gain * src
+using ScaleFn = void (*)(const float* src, float gain, float* dst, size_t count);
+// dst += gain * src
+using AccumulateFn = void (*)(const float* src, float gain, float* dst, size_t count);
+
+void scaleScalar(const float* src, float gain, float* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = gain * src[i];
+    }
+}
+
+void accumulateScalar(const float* src, float gain, float* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] += gain * src[i];
+    }
+}
+
+#if defined(TESSA_X86_KERNELS)
+
+void scaleSse2(const float* src, float gain, float* dst, size_t count) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(g, _mm_loadu_ps(src + i)));
+    }
+    scaleScalar(src + i, gain, dst + i, count - i);
+}
+
+void accumulateSse2(const float* src, float gain, float* dst, size_t count) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 sum = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(g, _mm_loadu_ps(src + i)));
+        _mm_storeu_ps(dst + i, sum);
+    }
+    accumulateScalar(src + i, gain, dst + i, count - i);
+}
+
+// Multiply and add separately (no FMA) so every level rounds like the scalar code
+
+TESSA_TARGET_AVX2 void scaleAvx2(const float* src, float gain, float* dst, size_t count) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(g, _mm256_loadu_ps(src + i)));
+    }
+    scaleScalar(src + i, gain, dst + i, count - i);
+}
+
+TESSA_TARGET_AVX2 void accumulateAvx2(const float* src, float gain, float* dst, size_t count) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(g, _mm256_loadu_ps(src + i)));
+        _mm256_storeu_ps(dst + i, sum);
+    }
+    accumulateScalar(src + i, gain, dst + i, count - i);
+}
+
+#endif // TESSA_X86_KERNELS
+
+void selectKernels(ScaleFn& scale, AccumulateFn& accumulate) {
+    scale = scaleScalar;
+    accumulate = accumulateScalar;
+#if defined(TESSA_X86_KERNELS)
+    switch (getSimdLevel()) {
+        case SimdLevel::Avx2:
+            scale = scaleAvx2;
+            accumulate = accumulateAvx2;
+            break;
+        case SimdLevel::Sse2:
+            scale = scaleSse2;
+            accumulate = accumulateSse2;
+            break;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+}
+
+bool parseTerm(const std::string& term, std::pair<int, float>& parsed) {
+    std::string channel = term;
+    float gain = 1.0f;
+
+    size_t star = term.find('*');
+    if (star != std::string::npos) {
+        std::string gainText = term.substr(0, star);
+        char* end = nullptr;
+        gain = std::strtof(gainText.c_str(), &end);
+        if (gainText.empty() || *end != '\0') {
+            return false;
+        }
+        channel = term.substr(star + 1);
+    }
+
+    if (channel.empty() || channel.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    parsed = {std::atoi(channel.c_str()), gain};
+    return true;
+}
+
+} // namespace
+
+bool ChannelMatrix::parse(const std::string& spec, ChannelMatrix& matrix) {
+    ChannelMatrix parsed;
+    parsed.spec = spec;
+
+    if (spec == "mix" || spec == "all") {
+        parsed.mixAll = (spec == "mix");
+        parsed.allChannels = (spec == "all");
+        matrix = parsed;
+        return true;
+    }
+
+    std::stringstream outputs(spec);
+    std::string output;
+    while (std::getline(outputs, output, ';')) {
+        std::vector<std::pair<int, float>> terms;
+        std::stringstream sum(output);
+        std::string term;
+        while (std::getline(sum, term, '+')) {
+            std::pair<int, float> parsedTerm;
+            if (!parseTerm(term, parsedTerm)) {
+                std::cerr << "Invalid channel term '" << term << "' in '" << spec
+                          << "' (expected [<gain>*]<channel>)" << std::endl;
+                return false;
+            }
+            terms.push_back(parsedTerm);
+        }
+        if (terms.empty()) {
+            std::cerr << "Empty output channel in '" << spec << "'" << std::endl;
+            return false;
+        }
+        parsed.outputs.push_back(terms);
+    }
+
+    if (parsed.outputs.empty()) {
+        std::cerr << "Empty channel matrix" << std::endl;
+        return false;
+    }
+
+    matrix = parsed;
+    return true;
+}
+
+ChannelMixer::ChannelMixer(const ChannelMatrix& matrix)
+    : matrix_(matrix),
+      inputChannels_(0),
+      selection_(false) {
+}
+
+bool ChannelMixer::setInputChannels(int channels) {
+    std::vector<std::vector<std::pair<int, float>>> terms;
+    inputChannels_ = channels;
+    terms_.clear();
+
+    if (matrix_.mixAll) {
+        std::vector<std::pair<int, float>> mean;
+        for (int channel = 0; channel < channels; ++channel) {
+            mean.push_back({channel, 1.0f / static_cast<float>(channels)});
+        }
+        terms.push_back(mean);
+    } else if (matrix_.allChannels) {
+        for (int channel = 0; channel < channels; ++channel) {
+            terms.push_back({{channel, 1.0f}});
+        }
+    } else {
+        for (const auto& output : matrix_.outputs) {
+            for (const auto& term : output) {
+                if (term.first >= channels) {
+                    std::cerr << "Channel map '" << matrix_.spec << "' uses channel " << term.first
+                              << " but the source has " << channels << std::endl;
+                    return false;
+                }
+            }
+        }
+        terms = matrix_.outputs;
+    }
+
+    selection_ = true;
+    for (const auto& output : terms) {
+        if (output.size() != 1 || output[0].second != 1.0f) {
+            selection_ = false;
+        }
+    }
+
+    terms_ = terms;
+    return true;
+}
+
+void ChannelMixer::mix(const float* input, size_t frames, float* output) const {
+    ScaleFn scale;
+    AccumulateFn accumulate;
+    selectKernels(scale, accumulate);
+
+    for (size_t out = 0; out < terms_.size(); ++out) {
+        float* row = output + out * frames;
+        const auto& terms = terms_[out];
+        scale(input + terms[0].first * frames, terms[0].second, row, frames);
+        for (size_t t = 1; t < terms.size(); ++t) {
+            accumulate(input + terms[t].first * frames, terms[t].second, row, frames);
+        }
+    }
+}
+
+void ChannelMixer::select(const uint8_t* input, size_t frames, size_t sampleBytes, uint8_t* output) const {
+    const size_t inFrameBytes = inputChannels_ * sampleBytes;
+    const size_t outFrameBytes = terms_.size() * sampleBytes;
+
+    // Single channel out of many is the common case; keep it a tight loop
+    if (terms_.size() == 1) {
+        const uint8_t* in = input + terms_[0][0].first * sampleBytes;
+        for (size_t frame = 0; frame < frames; ++frame) {
+            std::memcpy(output + frame * sampleBytes, in + frame * inFrameBytes, sampleBytes);
+        }
+        return;
+    }
+
+    for (size_t frame = 0; frame < frames; ++frame) {
+        const uint8_t* in = input + frame * inFrameBytes;
+        uint8_t* out = output + frame * outFrameBytes;
+        for (size_t channel = 0; channel < terms_.size(); ++channel) {
+            std::memcpy(out + channel * sampleBytes, in + terms_[channel][0].first * sampleBytes, sampleBytes);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#include "cpu_features.hpp"
+#include <atomic>
+#include <iostream>
+
+namespace {
+
+std::atomic<int> gForcedLevel(-1);
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::Avx2;
+        }
+        return SimdLevel::Sse2;  // Part of the x86-64 baseline
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel getSimdLevel() {
+    int forced = gForcedLevel.load(std::memory_order_relaxed);
+    return forced < 0 ? detectSimdLevel() : static_cast<SimdLevel>(forced);
+}
+
+bool setSimdLevel(SimdLevel level) {
+    if (static_cast<int>(level) > static_cast<int>(detectSimdLevel())) {
+        std::cerr << "CPU does not support " << simdLevelName(level) << std::endl;
+        return false;
+    }
+
+    gForcedLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+    return true;
+}
+
+std::string simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar:
+            return "scalar";
+        case SimdLevel::Sse2:
+            return "sse2";
+        case SimdLevel::Avx2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+bool parseSimdLevel(const std::string& name, SimdLevel& level) {
+    if (name == "scalar") {
+        level = SimdLevel::Scalar;
+    } else if (name == "sse2") {
+        level = SimdLevel::Sse2;
+    } else if (name == "avx2") {
+        level = SimdLevel::Avx2;
+    } else {
+        std::cerr << "Unknown SIMD level '" << name << "' (expected scalar, sse2 or avx2)" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,450 @@
+#include "dsp_pipeline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDefaultDcCutoffHz = 5.0;
+constexpr double kMaxGainDb = 60.0;
+
+// The capture thread does not signal, so wake up often enough to keep latency low
+const auto kProcessIdleWait = std::chrono::milliseconds(1);
+
+uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+bool DspSettings::parse(const std::string& spec, DspSettings& settings) {
+    const char* usage = "(expected comma-separated gain:<db>, dc[:<hz>], highpass:<hz> or lowpass:<hz>)";
+    DspSettings parsed;
+    try {
+        std::istringstream stream(spec);
+        std::string entry;
+        while (std::getline(stream, entry, ',')) {
+            if (entry.empty()) {
+                continue;
+            }
+            DspStageSpec stage;
+            size_t colon = entry.find(':');
+            stage.type = entry.substr(0, colon);
+            bool hasValue = colon != std::string::npos;
+            if (hasValue) {
+                std::string value = entry.substr(colon + 1);
+                size_t used = 0;
+                stage.value = std::stod(value, &used);
+                if (used != value.size()) {
+                    throw std::invalid_argument(spec);
+                }
+            }
+
+            bool valid = false;
+            if (stage.type == "gain") {
+                valid = hasValue && std::fabs(stage.value) <= kMaxGainDb;
+            } else if (stage.type == "dc") {
+                if (!hasValue) {
+                    stage.value = kDefaultDcCutoffHz;
+                }
+                valid = stage.value > 0.0;
+            } else if (stage.type == "highpass" || stage.type == "lowpass") {
+                valid = hasValue && stage.value > 0.0;
+            }
+            if (!valid) {
+                throw std::invalid_argument(entry);
+            }
+            parsed.stages.push_back(stage);
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid processing chain '" << spec << "' " << usage << std::endl;
+        return false;
+    }
+
+    settings = parsed;
+    return true;
+}
+
+std::string DspSettings::toString() const {
+    if (stages.empty()) {
+        return "off";
+    }
+    std::ostringstream ss;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        ss << (i > 0 ? "," : "") << stages[i].type << ":" << stages[i].value;
+    }
+    return ss.str();
+}
+
+std::unique_ptr<DspStage> DspStage::create(const DspStageSpec& spec) {
+    if (spec.type == "gain") {
+        return std::make_unique<GainStage>(spec.value);
+    }
+    if (spec.type == "dc") {
+        return std::make_unique<DcBlockStage>(spec.value);
+    }
+    if (spec.type == "highpass") {
+        return std::make_unique<BiquadStage>(BiquadStage::Type::HighPass, spec.value);
+    }
+    if (spec.type == "lowpass") {
+        return std::make_unique<BiquadStage>(BiquadStage::Type::LowPass, spec.value);
+    }
+    return nullptr;
+}
+
+GainStage::GainStage(double gainDb)
+    : DspStage("gain"),
+      gain_(static_cast<float>(std::pow(10.0, gainDb / 20.0))) {
+}
+
+bool GainStage::configure(int, int) {
+    return true;
+}
+
+void GainStage::process(float* planar, size_t frames, int firstChannel, int channelCount) {
+    float* samples = planar + static_cast<size_t>(firstChannel) * frames;
+    const size_t count = static_cast<size_t>(channelCount) * frames;
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] *= gain_;
+    }
+}
+
+DcBlockStage::DcBlockStage(double cutoffHz)
+    : DspStage("dc"),
+      cutoffHz_(cutoffHz),
+      pole_(0.0f) {
+}
+
+bool DcBlockStage::configure(int sampleRate, int channels) {
+    if (cutoffHz_ * 2.0 >= sampleRate) {
+        std::cerr << "DC filter cutoff " << cutoffHz_ << " Hz is above Nyquist at " << sampleRate << " Hz" << std::endl;
+        return false;
+    }
+    pole_ = static_cast<float>(std::exp(-2.0 * kPi * cutoffHz_ / sampleRate));
+    lastInput_.assign(channels, 0.0f);
+    lastOutput_.assign(channels, 0.0f);
+    return true;
+}
+
+void DcBlockStage::reset() {
+    std::fill(lastInput_.begin(), lastInput_.end(), 0.0f);
+    std::fill(lastOutput_.begin(), lastOutput_.end(), 0.0f);
+}
+
+void DcBlockStage::process(float* planar, size_t frames, int firstChannel, int channelCount) {
+    for (int channel = firstChannel; channel < firstChannel + channelCount; ++channel) {
+        float* samples = planar + static_cast<size_t>(channel) * frames;
+        float x1 = lastInput_[channel];
+        float y1 = lastOutput_[channel];
+        for (size_t i = 0; i < frames; ++i) {
+            const float x = samples[i];
+            y1 = x - x1 + pole_ * y1;
+            x1 = x;
+            samples[i] = y1;
+        }
+        lastInput_[channel] = x1;
+        lastOutput_[channel] = y1;
+    }
+}
+
+BiquadStage::BiquadStage(Type type, double cutoffHz)
+    : DspStage(type == Type::HighPass ? "highpass" : "lowpass"),
+      type_(type),
+      cutoffHz_(cutoffHz),
+      b0_(1.0f), b1_(0.0f), b2_(0.0f), a1_(0.0f), a2_(0.0f) {
+}
+
+bool BiquadStage::configure(int sampleRate, int channels) {
+    if (cutoffHz_ * 2.0 >= sampleRate) {
+        std::cerr << getName() << " cutoff " << cutoffHz_ << " Hz is above Nyquist at " << sampleRate << " Hz"
+                  << std::endl;
+        return false;
+    }
+
+    const double w0 = 2.0 * kPi * cutoffHz_ / sampleRate;
+    const double alpha = std::sin(w0) / (2.0 * std::sqrt(0.5));
+    const double cosW0 = std::cos(w0);
+    const double a0 = 1.0 + alpha;
+    const double edge = type_ == Type::HighPass ? (1.0 + cosW0) / 2.0 : (1.0 - cosW0) / 2.0;
+    b0_ = static_cast<float>(edge / a0);
+    b1_ = static_cast<float>((type_ == Type::HighPass ? -2.0 : 2.0) * edge / a0);
+    b2_ = b0_;
+    a1_ = static_cast<float>(-2.0 * cosW0 / a0);
+    a2_ = static_cast<float>((1.0 - alpha) / a0);
+
+    z1_.assign(channels, 0.0f);
+    z2_.assign(channels, 0.0f);
+    return true;
+}
+
+void BiquadStage::reset() {
+    std::fill(z1_.begin(), z1_.end(), 0.0f);
+    std::fill(z2_.begin(), z2_.end(), 0.0f);
+}
+
+void BiquadStage::process(float* planar, size_t frames, int firstChannel, int channelCount) {
+    for (int channel = firstChannel; channel < firstChannel + channelCount; ++channel) {
+        float* samples = planar + static_cast<size_t>(channel) * frames;
+        float z1 = z1_[channel];
+        float z2 = z2_[channel];
+        for (size_t i = 0; i < frames; ++i) {
+            const float x = samples[i];
+            const float y = b0_ * x + z1;
+            z1 = b1_ * x - a1_ * y + z2;
+            z2 = b2_ * x - a2_ * y;
+            samples[i] = y;
+        }
+        z1_[channel] = z1;
+        z2_[channel] = z2;
+    }
+}
+
+DspPipeline::DspPipeline(const DspSettings& settings)
+    : channelsPerGroup_(kChannelsPerGroup),
+      configured_(false),
+      channels_(0) {
+    for (const DspStageSpec& spec : settings.stages) {
+        std::unique_ptr<DspStage> stage = DspStage::create(spec);
+        if (stage) {
+            stages_.push_back(std::move(stage));
+        }
+    }
+    counters_ = std::make_unique<StepCounters[]>(stages_.size() + 2);
+}
+
+bool DspPipeline::configure(const SampleSpec& spec, int channels, int sampleRate) {
+    configured_ = false;
+    if (channels <= 0 || sampleRate <= 0) {
+        return false;
+    }
+
+    const SampleSpec planarFloat{SampleFormat::Float32, SampleLayout::Planar};
+    toFloat_ = std::make_unique<SampleConverter>(spec, planarFloat, channels);
+    fromFloat_ = std::make_unique<SampleConverter>(planarFloat, spec, channels);
+    channels_ = channels;
+
+    for (const auto& stage : stages_) {
+        if (!stage->configure(sampleRate, channels)) {
+            return false;
+        }
+    }
+    configured_ = true;
+    return true;
+}
+
+void DspPipeline::reset() {
+    for (const auto& stage : stages_) {
+        stage->reset();
+    }
+}
+
+void DspPipeline::setThreadPool(std::shared_ptr<WorkStealingPool> pool, int channelsPerGroup) {
+    pool_ = pool;
+    channelsPerGroup_ = std::max(1, channelsPerGroup);
+}
+
+void DspPipeline::count(StepCounters& counters, size_t frames, uint64_t ns) {
+    counters.blocks.fetch_add(1, std::memory_order_relaxed);
+    counters.frames.fetch_add(frames, std::memory_order_relaxed);
+    counters.ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void DspPipeline::process(uint8_t* data, size_t frames) {
+    if (!configured_ || frames == 0) {
+        return;
+    }
+    const size_t bytes = frames * channels_ * toFloat_->getFrom().bytesPerSample();
+
+    auto start = std::chrono::steady_clock::now();
+    planar_.resize(frames * channels_);
+    toFloat_->convert(data, bytes, planar_.data());
+    count(counters_[0], frames, elapsedNs(start));
+
+    const size_t groups = (channels_ + channelsPerGroup_ - 1) / channelsPerGroup_;
+    if (pool_ && groups > 1) {
+        pool_->run(groups, [this, frames](size_t group) {
+            const int first = static_cast<int>(group) * channelsPerGroup_;
+            runStages(frames, first, std::min(channelsPerGroup_, channels_ - first));
+        });
+    } else {
+        runStages(frames, 0, channels_);
+    }
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        count(counters_[i + 1], frames, 0);
+    }
+
+    start = std::chrono::steady_clock::now();
+    fromFloat_->convert(planar_.data(), planar_.size() * sizeof(float), data);
+    count(counters_[stages_.size() + 1], frames, elapsedNs(start));
+}
+
+void DspPipeline::runStages(size_t frames, int firstChannel, int channelCount) {
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        stages_[i]->process(planar_.data(), frames, firstChannel, channelCount);
+        counters_[i + 1].ns.fetch_add(elapsedNs(start), std::memory_order_relaxed);
+    }
+}
+
+std::vector<DspStageStats> DspPipeline::getStats() const {
+    std::vector<DspStageStats> stats(stages_.size() + 2);
+    for (size_t i = 0; i < stats.size(); ++i) {
+        if (i == 0) {
+            stats[i].name = "to_float";
+        } else if (i == stats.size() - 1) {
+            stats[i].name = "from_float";
+        } else {
+            stats[i].name = stages_[i - 1]->getName();
+        }
+        stats[i].blocks = counters_[i].blocks.load(std::memory_order_relaxed);
+        stats[i].frames = counters_[i].frames.load(std::memory_order_relaxed);
+        stats[i].ns = counters_[i].ns.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+DspWorker::DspWorker(size_t stream, const DspSettings& settings, AudioDataCallback output,
+                     std::shared_ptr<WorkStealingPool> pool)
+    : stream_(stream),
+      settings_(settings),
+      output_(std::move(output)),
+      pipeline_(settings),
+      queue_(kQueueSize),
+      running_(false),
+      sampleRate_(0),
+      channels_(0),
+      bitDepth_(0),
+      pendingDropFrames_(0),
+      framesDropped_(0),
+      blocksProcessed_(0),
+      framesProcessed_(0),
+      processNs_(0),
+      processRate_(0) {
+    pipeline_.setThreadPool(pool);
+}
+
+DspWorker::~DspWorker() {
+    stop();
+}
+
+bool DspWorker::start(std::shared_ptr<AudioSource> source) {
+    if (running_) {
+        return true;
+    }
+    if (!source || !output_) {
+        return false;
+    }
+
+    source_ = source;
+    running_ = true;
+    processThread_ = std::thread(&DspWorker::processLoop, this);
+    return true;
+}
+
+void DspWorker::stop() {
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        running_ = false;
+    }
+    wakeCondition_.notify_all();
+
+    if (processThread_.joinable()) {
+        processThread_.join();
+    }
+}
+
+void DspWorker::submit(const AudioBlockHandle& block) {
+    if (!running_ || !block) {
+        return;
+    }
+    AudioBlockHandle queued = block;
+    if (!queue_.tryPush(std::move(queued))) {
+        framesDropped_.fetch_add(block->frames, std::memory_order_relaxed);
+        pendingDropFrames_.fetch_add(block->frames, std::memory_order_relaxed);
+    }
+}
+
+double DspWorker::getProcessUsPerBlock() const {
+    uint64_t blocks = getBlocksProcessed();
+    return blocks > 0 ? processNs_.load(std::memory_order_relaxed) / 1000.0 / blocks : 0.0;
+}
+
+double DspWorker::getProcessLoadPercent() const {
+    int rate = processRate_.load(std::memory_order_relaxed);
+    if (rate <= 0) {
+        return 0.0;
+    }
+    double audioNs = framesProcessed_.load(std::memory_order_relaxed) * 1e9 / rate;
+    return audioNs > 0.0 ? 100.0 * processNs_.load(std::memory_order_relaxed) / audioNs : 0.0;
+}
+
+void DspWorker::processBlock(const AudioBlockHandle& block) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Follow format changes of the source (file headers, sample rate changes)
+    const int sampleRate = source_->getSampleRate();
+    const int channels = source_->getChannels();
+    const int bitDepth = source_->getBitDepth();
+    if (sampleRate != sampleRate_ || channels != channels_ || bitDepth != bitDepth_) {
+        sampleRate_ = sampleRate;
+        channels_ = channels;
+        bitDepth_ = bitDepth;
+        SampleSpec spec;
+        if (!SampleSpec::fromBitDepth(bitDepth, spec) || !pipeline_.configure(spec, channels, sampleRate)) {
+            std::cerr << "Cannot process " << bitDepth << "-bit audio with " << channels
+                      << " channels, passing it through" << std::endl;
+        }
+    }
+
+    // Filter history does not carry across missing audio
+    uint64_t dropped = pendingDropFrames_.exchange(0, std::memory_order_relaxed);
+    block->gap.droppedFrames += dropped;
+    if (!block->gap.empty()) {
+        pipeline_.reset();
+    }
+
+    // Blocks captured just before a format change still have the old size: pass them through
+    const size_t bytesPerFrame = static_cast<size_t>(channels) * (bitDepth / 8);
+    if (pipeline_.isConfigured() && block->size == block->frames * bytesPerFrame) {
+        pipeline_.process(block->data, block->frames);
+        blocksProcessed_.fetch_add(1, std::memory_order_relaxed);
+        framesProcessed_.fetch_add(block->frames, std::memory_order_relaxed);
+        processNs_.fetch_add(elapsedNs(start), std::memory_order_relaxed);
+        processRate_.store(sampleRate, std::memory_order_relaxed);
+    }
+
+    output_(block);
+}
+
+void DspWorker::processLoop() {
+    const std::string threadName = "dsp " + std::to_string(stream_);
+    if (!threadSchedule_.isDefault()) {
+        threadSchedule_.applyToCurrentThread(threadName);
+    }
+    recordThreadSchedule(threadName);
+
+    AudioBlockHandle block;
+    while (running_) {
+        while (queue_.tryPop(block)) {
+            processBlock(block);
+            block.reset();
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wakeCondition_.wait_for(lock, kProcessIdleWait, [this] { return !running_; });
+    }
+
+    // Blocks queued before stop() still go out
+    while (queue_.tryPop(block)) {
+        processBlock(block);
+        block.reset();
+    }
+}
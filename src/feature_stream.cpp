@@ -0,0 +1,162 @@
+#include "feature_stream.hpp"
+#include "audio_source.hpp"
+#include "channel_mix.hpp"
+#include "message_format.hpp"
+#include "sample_format.hpp"
+#include "zmq_publisher.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Read the ring in chunks of up to this many bytes
+constexpr size_t kAnalyzeChunkBytes = 64 * 1024;
+const auto kAnalyzeInterval = std::chrono::milliseconds(10);
+
+} // namespace
+
+FeatureStream::FeatureStream(std::shared_ptr<ZmqPublisher> publisher, size_t publisherStream,
+                             const FeatureSettings& settings)
+    : RingReader("features " + std::to_string(publisherStream), kAnalyzeChunkBytes, kAnalyzeInterval),
+      publisher_(publisher),
+      publisherStream_(publisherStream),
+      settings_(settings),
+      inputRate_(0),
+      inputChannels_(0),
+      analyzerOrigin_(0),
+      framesRead_(0),
+      featureIndex_(0),
+      pendingGapFrames_(0),
+      bins_(0),
+      framesComputed_(0) {
+}
+
+FeatureStream::~FeatureStream() {
+    stop();
+}
+
+bool FeatureStream::start(std::shared_ptr<AudioSource> source) {
+    if (!publisher_) {
+        return false;
+    }
+    return RingReader::start(source);
+}
+
+double FeatureStream::getComputeUsPerFrame() const {
+    uint64_t frames = getFramesComputed();
+    return frames > 0 ? getComputeNs() / 1000.0 / frames : 0.0;
+}
+
+double FeatureStream::getComputeLoadPercent() const {
+    uint64_t audioNs = getFramesComputed() * static_cast<uint64_t>(settings_.hopMs) * 1000000ull;
+    return audioNs > 0 ? 100.0 * getComputeNs() / audioNs : 0.0;
+}
+
+bool FeatureStream::onRing(AudioSource& source) {
+    inputRate_ = source.getSampleRate();
+    inputChannels_ = source.getChannels();
+
+    SampleSpec captured;
+    if (inputChannels_ <= 0 || inputRate_ <= 0 || !SampleSpec::fromBitDepth(source.getBitDepth(), captured)) {
+        std::cerr << "Cannot compute features of " << source.getBitDepth() << "-bit audio" << std::endl;
+        return false;
+    }
+    toFloat_ = std::make_unique<SampleConverter>(captured, SampleSpec{SampleFormat::Float32, SampleLayout::Planar},
+                                                 inputChannels_);
+
+    mixer_.reset();
+    if (inputChannels_ > 1) {
+        ChannelMatrix mono;
+        ChannelMatrix::parse("mix", mono);
+        mixer_ = std::make_unique<ChannelMixer>(mono);
+        mixer_->setInputChannels(inputChannels_);
+    }
+
+    analyzer_ = std::make_unique<SpectralAnalyzer>(settings_, inputRate_);
+    bins_.store(analyzer_->getBins(), std::memory_order_relaxed);
+    analyzerOrigin_ = 0;
+    framesRead_ = 0;
+    pendingGapFrames_ = 0;
+    return true;
+}
+
+void FeatureStream::onChunk(const ReadResult& chunk) {
+    // Audio we never saw: no window spans it, and the next frame flags it
+    if (chunk.overrun()) {
+        analyzer_->reset();
+        analyzerOrigin_ += chunk.lostFrames;
+        framesRead_ += chunk.lostFrames;
+        pendingGapFrames_ += chunk.lostFrames;
+    }
+    process(chunk);
+}
+
+void FeatureStream::process(const ReadResult& chunk) {
+    const size_t frameBytes = inputChannels_ * toFloat_->getFrom().bytesPerSample();
+    const size_t frames = chunk.data.size() / frameBytes;
+    if (frames == 0) {
+        return;
+    }
+    const uint64_t chunkStart = framesRead_;
+    framesRead_ += frames;
+
+    planar_.resize(frames * inputChannels_);
+    toFloat_->convert(chunk.data.data(), frames * frameBytes, planar_.data());
+    const float* audio = planar_.data();
+    if (mixer_) {
+        mixed_.resize(frames);
+        mixer_->mix(audio, frames, mixed_.data());
+        audio = mixed_.data();
+    }
+
+    features_.clear();
+    uint64_t firstWindow = 0;
+    const size_t count = analyzer_->process(audio, frames, features_, firstWindow);
+    if (count == 0) {
+        return;
+    }
+
+    // The first window may have started in an earlier chunk
+    const double offsetFrames = static_cast<double>(analyzerOrigin_ + firstWindow) - static_cast<double>(chunkStart);
+    const double windowStartMs = static_cast<double>(chunk.timestamp) + offsetFrames * 1000.0 / inputRate_;
+
+    std::vector<uint8_t> payload;
+    if (settings_.half) {
+        payload.resize(features_.size() * sizeof(uint16_t));
+        uint16_t* values = reinterpret_cast<uint16_t*>(payload.data());
+        for (size_t i = 0; i < features_.size(); ++i) {
+            values[i] = floatToHalf(features_[i]);
+        }
+    } else {
+        payload.resize(features_.size() * sizeof(float));
+        std::memcpy(payload.data(), features_.data(), payload.size());
+    }
+
+    const std::string& parentId = publisher_->getStream(publisher_->getStream(publisherStream_).parent).streamId;
+    std::map<std::string, nlohmann::json> metadata;
+    metadata["unix_timestamp_ms"] = static_cast<uint64_t>(std::llround(windowStartMs));
+    metadata["window_start_ms"] = windowStartMs;
+    metadata["feature_index"] = featureIndex_;
+    metadata["feature_frames"] = count;
+    metadata["feature"] = settings_.melBands > 0 ? "mel" : "spectrum";
+    metadata["bins"] = analyzer_->getBins();
+    metadata["scale"] = "db";
+    metadata["window"] = settings_.window;
+    metadata["window_frames"] = analyzer_->getWindowFrames();
+    metadata["hop_frames"] = analyzer_->getHopFrames();
+    metadata["fft_size"] = analyzer_->getFftSize();
+    metadata["sample_rate"] = inputRate_;
+    metadata["sample_format"] = settings_.half ? "float16" : "float32";
+    metadata["derived_from"] = parentId;
+    if (pendingGapFrames_ > 0) {
+        metadata["gap"] = message_format::gapToJson(CaptureGap{0, 0, pendingGapFrames_});
+        pendingGapFrames_ = 0;
+    }
+    publisher_->publishEncodedAudio(publisherStream_, std::move(payload), count * analyzer_->getHopFrames(),
+                                    std::move(metadata));
+
+    featureIndex_ += count;
+    framesComputed_.fetch_add(count, std::memory_order_relaxed);
+}
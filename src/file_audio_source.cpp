@@ -0,0 +1,191 @@
+#include "file_audio_source.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+uint16_t readLE16(const uint8_t* bytes) {
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t readLE32(const uint8_t* bytes) {
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+bool hasWavExtension(const std::string& path) {
+    if (path.size() < 4) {
+        return false;
+    }
+    std::string extension = path.substr(path.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".wav";
+}
+
+} // namespace
+
+FileAudioSource::FileAudioSource(const std::string& path,
+                                 int sampleRate,
+                                 int channels,
+                                 int bitDepth,
+                                 int bufferSize,
+                                 Pacing pacing)
+    : ThreadedAudioSource(sampleRate, channels, bitDepth, bufferSize, pacing),
+      path_(path),
+      isWav_(hasWavExtension(path)),
+      unsignedSamples_(false),
+      dataStart_(0),
+      dataBytes_(0),
+      dataRemaining_(0) {
+}
+
+FileAudioSource::~FileAudioSource() {
+    // Stop the generator before this object's fillBlock goes away
+    stop();
+}
+
+bool FileAudioSource::openSource() {
+    file_.close();
+    file_.clear();
+    file_.open(path_, std::ios::binary);
+    if (!file_.is_open()) {
+        std::cerr << "Failed to open audio file: " << path_ << std::endl;
+        return false;
+    }
+    
+    if (isWav_) {
+        if (!parseWavHeader()) {
+            return false;
+        }
+    } else {
+        // Raw PCM: the whole file is sample data in the configured format
+        file_.seekg(0, std::ios::end);
+        dataStart_ = 0;
+        dataBytes_ = static_cast<uint64_t>(file_.tellg());
+        file_.seekg(0, std::ios::beg);
+    }
+    
+    if (bitDepth_ != 8 && bitDepth_ != 16 && bitDepth_ != 24 && bitDepth_ != 32) {
+        std::cerr << "Unsupported bit depth: " << bitDepth_ << std::endl;
+        return false;
+    }
+    
+    // Only replay whole frames
+    size_t frameBytes = channels_ * bytesPerSample_;
+    dataBytes_ -= dataBytes_ % frameBytes;
+    if (dataBytes_ == 0) {
+        std::cerr << "No audio data in file: " << path_ << std::endl;
+        return false;
+    }
+    
+    dataRemaining_ = dataBytes_;
+    return true;
+}
+
+bool FileAudioSource::parseWavHeader() {
+    uint8_t header[12];
+    if (!file_.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0) {
+        std::cerr << "Not a WAV file: " << path_ << std::endl;
+        return false;
+    }
+    
+    bool haveFormat = false;
+    int sampleRate = 0;
+    int channels = 0;
+    int bitDepth = 0;
+    
+    // Walk the chunk list until the data chunk
+    uint8_t chunkHeader[8];
+    while (file_.read(reinterpret_cast<char*>(chunkHeader), sizeof(chunkHeader))) {
+        uint32_t chunkSize = readLE32(chunkHeader + 4);
+        
+        if (std::memcmp(chunkHeader, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = {0};
+            size_t toRead = std::min<size_t>(chunkSize, sizeof(fmt));
+            if (chunkSize < 16 || !file_.read(reinterpret_cast<char*>(fmt), toRead)) {
+                std::cerr << "Invalid WAV format chunk: " << path_ << std::endl;
+                return false;
+            }
+            file_.seekg(chunkSize - toRead + (chunkSize & 1), std::ios::cur);
+            
+            uint16_t audioFormat = readLE16(fmt);
+            // WAVE_FORMAT_EXTENSIBLE keeps the real format code at the start of the sub-format GUID
+            if (audioFormat == 0xFFFE && chunkSize >= 26) {
+                audioFormat = readLE16(fmt + 24);
+            }
+            if (audioFormat != 1) {
+                std::cerr << "Unsupported WAV encoding " << audioFormat << " (only PCM): " << path_ << std::endl;
+                return false;
+            }
+            
+            channels = readLE16(fmt + 2);
+            sampleRate = static_cast<int>(readLE32(fmt + 4));
+            bitDepth = readLE16(fmt + 14);
+            haveFormat = true;
+        } else if (std::memcmp(chunkHeader, "data", 4) == 0) {
+            if (!haveFormat) {
+                std::cerr << "WAV data chunk before format chunk: " << path_ << std::endl;
+                return false;
+            }
+            
+            // A bad header must not reach setFormat: frame sizes and per-ms sizes divide by these
+            if (channels < 1 || sampleRate < kMinSampleRate ||
+                (bitDepth != 8 && bitDepth != 16 && bitDepth != 24 && bitDepth != 32)) {
+                std::cerr << "Unsupported WAV format (" << sampleRate << " Hz, " << channels << " channels, "
+                          << bitDepth << " bit): " << path_ << std::endl;
+                return false;
+            }
+            
+            dataStart_ = file_.tellg();
+            dataBytes_ = chunkSize;
+            
+            if (sampleRate != sampleRate_ || channels != channels_ || bitDepth != bitDepth_) {
+                std::cout << "Using format from " << path_ << ": " << sampleRate << " Hz, "
+                          << channels << " channels, " << bitDepth << " bit" << std::endl;
+            }
+            setFormat(sampleRate, channels, bitDepth);
+            unsignedSamples_ = (bitDepth == 8);
+            return true;
+        } else {
+            // Skip chunks we do not care about (chunks are padded to even sizes)
+            file_.seekg(chunkSize + (chunkSize & 1), std::ios::cur);
+        }
+    }
+    
+    std::cerr << "No data chunk in WAV file: " << path_ << std::endl;
+    return false;
+}
+
+bool FileAudioSource::fillBlock(uint8_t* dest, unsigned long frames) {
+    size_t needed = frames * channels_ * bytesPerSample_;
+    size_t filled = 0;
+    
+    while (filled < needed) {
+        // Loop back to the first frame at the end of the data
+        if (dataRemaining_ == 0) {
+            file_.clear();
+            file_.seekg(dataStart_, std::ios::beg);
+            dataRemaining_ = dataBytes_;
+        }
+        
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(needed - filled, dataRemaining_));
+        if (!file_.read(reinterpret_cast<char*>(dest + filled), chunk)) {
+            std::cerr << "Failed to read audio file: " << path_ << std::endl;
+            return false;
+        }
+        
+        filled += chunk;
+        dataRemaining_ -= chunk;
+    }
+    
+    if (unsignedSamples_) {
+        for (size_t i = 0; i < needed; i++) {
+            dest[i] ^= 0x80;
+        }
+    }
+    
+    return true;
+}
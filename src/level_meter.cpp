@@ -0,0 +1,168 @@
+#include "level_meter.hpp"
+#include "cpu_features.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TESSA_X86_KERNELS 1
+#define TESSA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+// Add the levels of count samples of one channel; magnitudes at or above clipLevel count as clipped
+using MeasureFn = void (*)(const float* samples, size_t count, float clipLevel, ChannelLevels& levels);
+
+void measureScalar(const float* samples, size_t count, float clipLevel, ChannelLevels& levels) {
+    float sum = 0.0f;
+    float peak = levels.peak;
+    uint64_t clipped = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const float magnitude = std::fabs(samples[i]);
+        sum += samples[i] * samples[i];
+        peak = std::max(peak, magnitude);
+        clipped += magnitude >= clipLevel ? 1 : 0;
+    }
+    levels.sumSquares += sum;
+    levels.peak = peak;
+    levels.clipped += clipped;
+}
+
+#if defined(TESSA_X86_KERNELS)
+
+void measureSse2(const float* samples, size_t count, float clipLevel, ChannelLevels& levels) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 clip = _mm_set1_ps(clipLevel);
+    __m128 sum = _mm_setzero_ps();
+    __m128 peak = _mm_setzero_ps();
+    __m128i clipped = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(samples + i);
+        __m128 magnitude = _mm_and_ps(x, absMask);
+        sum = _mm_add_ps(sum, _mm_mul_ps(x, x));
+        peak = _mm_max_ps(peak, magnitude);
+        // Compare masks are -1 per lane
+        clipped = _mm_sub_epi32(clipped, _mm_castps_si128(_mm_cmpge_ps(magnitude, clip)));
+    }
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, 1));
+    alignas(16) uint32_t counts[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(counts), clipped);
+
+    levels.sumSquares += _mm_cvtss_f32(sum);
+    levels.peak = std::max(levels.peak, _mm_cvtss_f32(peak));
+    levels.clipped += static_cast<uint64_t>(counts[0]) + counts[1] + counts[2] + counts[3];
+    measureScalar(samples + i, count - i, clipLevel, levels);
+}
+
+TESSA_TARGET_AVX2 void measureAvx2(const float* samples, size_t count, float clipLevel, ChannelLevels& levels) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 clip = _mm256_set1_ps(clipLevel);
+    __m256 sum = _mm256_setzero_ps();
+    __m256 peak = _mm256_setzero_ps();
+    __m256i clipped = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_loadu_ps(samples + i);
+        __m256 magnitude = _mm256_and_ps(x, absMask);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(x, x));
+        peak = _mm256_max_ps(peak, magnitude);
+        clipped = _mm256_sub_epi32(clipped, _mm256_castps_si256(_mm256_cmp_ps(magnitude, clip, _CMP_GE_OQ)));
+    }
+    __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+    __m128 peak4 = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+    peak4 = _mm_max_ps(peak4, _mm_movehl_ps(peak4, peak4));
+    peak4 = _mm_max_ss(peak4, _mm_shuffle_ps(peak4, peak4, 1));
+    alignas(32) uint32_t counts[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(counts), clipped);
+
+    levels.sumSquares += _mm_cvtss_f32(sum4);
+    levels.peak = std::max(levels.peak, _mm_cvtss_f32(peak4));
+    for (uint32_t lane : counts) {
+        levels.clipped += lane;
+    }
+    measureScalar(samples + i, count - i, clipLevel, levels);
+}
+
+#endif // TESSA_X86_KERNELS
+
+MeasureFn selectMeasure() {
+#if defined(TESSA_X86_KERNELS)
+    switch (getSimdLevel()) {
+        case SimdLevel::Avx2:
+            return measureAvx2;
+        case SimdLevel::Sse2:
+            return measureSse2;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return measureScalar;
+}
+
+// Smallest magnitude of a full-scale sample once converted to float: integers convert as
+// value / 2^(bits - 1), so the positive end sits one step below 1.0
+float clipLevel(SampleFormat format) {
+    if (format == SampleFormat::Float32) {
+        return 1.0f;
+    }
+    const double fullScale = std::ldexp(1.0, static_cast<int>(SampleSpec::sampleBytes(format)) * 8 - 1);
+    return static_cast<float>((fullScale - 1.0) / fullScale);
+}
+
+double roundTenth(double value) {
+    return std::round(value * 10.0) / 10.0;
+}
+
+} // namespace
+
+void LevelMeter::measure(const uint8_t* data, size_t frames, const SampleSpec& spec, int channels,
+                         std::vector<ChannelLevels>& levels) {
+    channels = std::max(1, channels);
+    if (levels.size() != static_cast<size_t>(channels)) {
+        levels.assign(channels, ChannelLevels());
+    }
+    if (frames == 0) {
+        return;
+    }
+
+    const SampleSpec floatPlanar{SampleFormat::Float32, SampleLayout::Planar};
+    const float* planar = reinterpret_cast<const float*>(data);
+    if (spec.format != SampleFormat::Float32 || (spec.layout != SampleLayout::Planar && channels > 1)) {
+        if (!toPlanar_ || toPlanar_->getFrom() != spec || toPlanar_->getChannels() != channels) {
+            toPlanar_ = std::make_unique<SampleConverter>(spec, floatPlanar, channels);
+        }
+        planar_.resize(frames * channels);
+        toPlanar_->convert(data, frames * channels * spec.bytesPerSample(), planar_.data());
+        planar = planar_.data();
+    }
+
+    const MeasureFn measureChannel = selectMeasure();
+    const float clip = clipLevel(spec.format);
+    for (int channel = 0; channel < channels; ++channel) {
+        measureChannel(planar + channel * frames, frames, clip, levels[channel]);
+    }
+}
+
+double LevelMeter::toDbfs(double value) {
+    return value > 0.0 ? std::max(kMinDbfs, 20.0 * std::log10(value)) : kMinDbfs;
+}
+
+nlohmann::json LevelMeter::toJson(const std::vector<ChannelLevels>& levels, size_t frames) {
+    nlohmann::json rms = nlohmann::json::array();
+    nlohmann::json peak = nlohmann::json::array();
+    nlohmann::json clipped = nlohmann::json::array();
+    for (const ChannelLevels& channel : levels) {
+        const double meanSquare = frames > 0 ? channel.sumSquares / frames : 0.0;
+        rms.push_back(roundTenth(toDbfs(std::sqrt(meanSquare))));
+        peak.push_back(roundTenth(toDbfs(channel.peak)));
+        clipped.push_back(channel.clipped);
+    }
+    return {{"rms_dbfs", rms}, {"peak_dbfs", peak}, {"clipped", clipped}};
+}
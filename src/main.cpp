@@ -12,7 +12,19 @@
 #include <algorithm>
 #include <cstdlib>
 
+#include "audio_source.hpp"
 #include "audio_capture.hpp"
+#include "thread_schedule.hpp"
+#include "realtime_memory.hpp"
+#include "capture_journal.hpp"
+#include "opus_stream.hpp"
+#include "feature_stream.hpp"
+#include "dsp_pipeline.hpp"
+#include "channel_mix.hpp"
+#include "cpu_features.hpp"
+#include "payload_codec.hpp"
+#include "sample_format.hpp"
+#include "silence_gate.hpp"
 #include "zmq_publisher.hpp"
 #include "zmq_handler.hpp"
 #include "device_manager.hpp"
@@ -105,19 +117,44 @@ std::string optionToEnvVar(const std::string& option) {
 // Command line argument parsing
 struct Arguments {
     std::string inputDevice;
+    std::string inputSource;
+    std::string sourcePacing;
+    std::string captureMode;
+    std::string captureSched;
+    std::string publisherSched;
+    std::string handlerSched;
+    std::string zmqIoSched;
+    std::string workerSched;
+    std::string publishLatency;  // "<min_ms>:<max_ms>" enables adaptive batching
+    std::string publishFormat;   // "<format>[:planar]", empty publishes as captured
+    std::string simdLevel;       // Override the detected kernel level
+    std::string payloadCodec;    // "none" or a PayloadCodec name
+    std::string silenceGate;     // "<threshold_db>[:<hangover_ms>[:<preroll_ms>]]", empty publishes everything
+    int levelIntervalMs;         // Level metering interval, 0 for off
+    std::string features;        // "<window_ms>:<hop_ms>[:<mel_bands>[:<window>]]", empty for off
+    std::string featureFormat;   // "float16" or "float32"
+    std::string dsp;             // Comma-separated processing stages, empty publishes as captured
+    int dspThreads;              // Threads splitting wide streams' processing, 0 for one per core
     std::string pubAddress;
     std::string pubTopic;
     std::string dealerAddress;
     std::string dealerTopic;
     std::string serviceName;
     std::string streamId;
+    std::vector<std::string> extraStreams;  // "<stream_id>=<source spec>"
+    std::vector<std::string> derivedStreams;  // "<stream_id>=[<parent stream_id>:]<channel matrix>[@<rate>]"
     int sampleRate;
     int channels;
     int bitDepth;
     int bufferSize;
-    size_t bufferMinSend;
+    int historyMs;
+    std::string journalPath;
+    uint64_t journalMb;
+    int opusBitrate;             // 0 disables the Opus topics
     bool listDevices;
     bool verbose;
+    bool realtimeMemory;
+    bool hugePages;
     std::string envFile;
 };
 
@@ -126,17 +163,66 @@ void printUsage(const char* programName) {
               << "Usage: " << programName << " [options]\n"
               << "Options:\n"
               << "  --input-device <device_name>     Audio input device name\n"
+              << "  --input-source <source>          Audio source: device, file:<path>, sine[:<hz>], noise (default: device)\n"
+              << "  --source-pacing <pacing>         File/synthetic pacing: realtime or fast (default: realtime)\n"
+              << "  --capture-mode <mode>            Device capture: callback or blocking (default: callback)\n"
+              << "  --capture-sched <sched>          Blocking capture thread scheduling, <policy>[:<prio>][@<cpus>]\n"
+              << "                                   (e.g. fifo:80@3; policies: other, fifo, rr)\n"
+              << "  --publisher-sched <sched>        Publisher sender thread scheduling\n"
+              << "  --handler-sched <sched>          Control handler thread scheduling\n"
+              << "  --zmq-io-sched <sched>           ZMQ I/O thread scheduling\n"
+              << "  --worker-sched <sched>           Journal, Opus, features and --dsp worker thread scheduling\n"
               << "  --pub-address <address:port>     ZMQ PUB socket address (e.g., tcp://*:5555)\n"
+              << "  --publish-latency <min>:<max>    Batch audio adaptively, between min and max ms per message\n"
+              << "                                   (default: one message per captured block)\n"
+              << "  --publish-format <fmt>[:planar]  Publish audio as int8, int16, int24, int32 or float32,\n"
+              << "                                   optionally planar (default: as captured)\n"
+              << "  --simd <level>                   Conversion kernels: scalar, sse2 or avx2 (default: best supported)\n"
+              << "  --codec <name>                   Compress audio payloads losslessly: none or delta-rice\n"
+              << "                                   (default: none)\n"
+              << "  --silence-gate <db>[:<hang>[:<pre>]]\n"
+              << "                                   Replace silence below <db> dBFS with silence markers, keeping\n"
+              << "                                   <hang> ms after speech and <pre> ms before it (default: off;\n"
+              << "                                   e.g. -50:300:200)\n"
+              << "  --levels <ms>                    Add per-channel RMS, peak and clip counts to each message and\n"
+              << "                                   publish them every <ms> on <stream topic>/levels (default: off)\n"
               << "  --pub-topic <topic>              ZMQ PUB topic (default: audio)\n"
               << "  --dealer-address <address:port>  ZMQ DEALER socket address (e.g., tcp://*:5556)\n"
               << "  --dealer-topic <topic>           ZMQ DEALER topic (default: control)\n"
               << "  --service-name <name>            Service name for messages (default: tessa_audio)\n"
               << "  --stream-id <id>                 Stream ID for messages (optional)\n"
+              << "  --add-stream <id>=<source>       Capture another source in this process, published on\n"
+              << "                                   topic <pub-topic>/<id> (repeatable, e.g. mic2=device:USB Mic)\n"
+              << "  --derive <id>=[<stream>:]<map>[@<rate>]\n"
+              << "                                   Also publish a channel selection or mix of a stream (default:\n"
+              << "                                   the first) on <pub-topic>/<id>; outputs are separated by ';',\n"
+              << "                                   e.g. mono=mix, left=0, mono=0.5*0+0.5*1, wide=all@48000, and\n"
+              << "                                   @<rate> resamples it (repeatable)\n"
               << "  --sample-rate <rate>             Audio sample rate (default: 44100)\n"
               << "  --channels <number>              Number of audio channels (default: 2)\n"
               << "  --bit-depth <depth>              Audio bit depth (default: 16)\n"
               << "  --buffer-size <size>             Audio buffer size in ms (default: 100)\n"
-              << "  --buffer-min-send <size>         Audio buffer min send size in bytes (default: 2048)\n"
+              << "  --history-ms <ms>                Audio kept per stream for GET_HISTORY (default: 5000)\n"
+              << "  --journal <path>                 Record a rolling capture journal to this file (extra streams\n"
+              << "                                   use <path>.<id>), queried with GET_JOURNAL\n"
+              << "  --journal-mb <size>              Journal file size in MiB per stream (default: 1024)\n"
+              << "  --opus <bitrate>                 Also publish every captured stream as 20 ms Opus packets at this\n"
+              << "                                   bitrate (bit/s) on <stream topic>/opus (default: off)\n"
+              << "  --features <win>:<hop>[:<mels>[:<window>]]\n"
+              << "                                   Also publish log-power spectra of every captured stream, <win> ms\n"
+              << "                                   windows every <hop> ms, as <mels> mel bands (0: FFT bins) on\n"
+              << "                                   <stream topic>/features (default: off; e.g. 25:10:64:hann)\n"
+              << "  --feature-format <fmt>           Feature values as float16 or float32 (default: float16)\n"
+              << "  --dsp <stage>[,<stage>...]       Process captured audio on a worker thread before publishing:\n"
+              << "                                   gain:<db>, dc[:<hz>], highpass:<hz>, lowpass:<hz>, in order\n"
+              << "                                   (default: off; e.g. dc,highpass:80,gain:6). Only the published\n"
+              << "                                   stream is processed: GET_HISTORY, the journal, Opus and features\n"
+              << "                                   keep the raw capture\n"
+              << "  --dsp-threads <n>                Threads sharing the processing of wide streams in groups of\n"
+              << "                                   4 channels (default: 0, one per core)\n"
+              << "  --realtime-memory                Lock process memory (mlockall) and pre-fault buffers; journal\n"
+              << "                                   files are not locked\n"
+              << "  --huge-pages                     Back large capture buffers with huge pages\n"
               << "  --verbose                        Echo status messages to stdout\n"
               << "  --list-devices                   List available audio devices and exit\n"
               << "  --env <file>                     Load environment variables from file\n"
@@ -145,9 +231,28 @@ void printUsage(const char* programName) {
               << "  All options can also be set via environment variables using the\n"
               << "  uppercase version of the option name with dashes replaced by underscores.\n"
               << "  For example, --pub-address can be set with PUB_ADDRESS environment variable.\n"
+              << "  Extra streams are set with STREAMS as a comma-separated list of <id>=<source>,\n"
+              << "  derived streams with DERIVED as a comma-separated list of --derive values.\n"
               << "  Command line options take precedence over environment variables.\n";
 }
 
+// Split a comma-separated list, skipping empty entries
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> entries;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        if (comma > start) {
+            entries.push_back(list.substr(start, comma - start));
+        }
+        start = comma + 1;
+    }
+    return entries;
+}
+
 Arguments parseArguments(int argc, char* argv[]) {
     Arguments args;
     
@@ -162,6 +267,22 @@ Arguments parseArguments(int argc, char* argv[]) {
     
     // Get default values from environment variables
     args.inputDevice = getEnvVar("INPUT_DEVICE", "");
+    args.inputSource = getEnvVar("INPUT_SOURCE", "device");
+    args.sourcePacing = getEnvVar("SOURCE_PACING", "realtime");
+    args.captureMode = getEnvVar("CAPTURE_MODE", "callback");
+    args.captureSched = getEnvVar("CAPTURE_SCHED", "");
+    args.publisherSched = getEnvVar("PUBLISHER_SCHED", "");
+    args.handlerSched = getEnvVar("HANDLER_SCHED", "");
+    args.zmqIoSched = getEnvVar("ZMQ_IO_SCHED", "");
+    args.workerSched = getEnvVar("WORKER_SCHED", "");
+    args.publishLatency = getEnvVar("PUBLISH_LATENCY", "");
+    args.publishFormat = getEnvVar("PUBLISH_FORMAT", "");
+    args.simdLevel = getEnvVar("SIMD", "");
+    args.payloadCodec = getEnvVar("CODEC", "none");
+    args.silenceGate = getEnvVar("SILENCE_GATE", "");
+    args.features = getEnvVar("FEATURES", "");
+    args.featureFormat = getEnvVar("FEATURE_FORMAT", "float16");
+    args.dsp = getEnvVar("DSP", "");
     args.pubAddress = getEnvVar("PUB_ADDRESS", "");
     args.pubTopic = getEnvVar("PUB_TOPIC", "audio");
     args.dealerAddress = getEnvVar("DEALER_ADDRESS", "");
@@ -169,12 +290,21 @@ Arguments parseArguments(int argc, char* argv[]) {
     args.serviceName = getEnvVar("SERVICE_NAME", "tessa_audio");
     args.streamId = getEnvVar("STREAM_ID", "");
     
+    // Comma-separated lists of extra and derived streams
+    args.extraStreams = splitList(getEnvVar("STREAMS", ""));
+    args.derivedStreams = splitList(getEnvVar("DERIVED", ""));
+    
     // Convert numeric environment variables with fallbacks
     std::string sampleRateStr = getEnvVar("SAMPLE_RATE", "44100");
     std::string channelsStr = getEnvVar("CHANNELS", "2");
     std::string bitDepthStr = getEnvVar("BIT_DEPTH", "16");
     std::string bufferSizeStr = getEnvVar("BUFFER_SIZE", "100");
-    std::string bufferMinSendStr = getEnvVar("BUFFER_MIN_SEND", "2048");
+    std::string historyMsStr = getEnvVar("HISTORY_MS", std::to_string(AudioSource::kDefaultHistoryMs));
+    std::string journalMbStr = getEnvVar("JOURNAL_MB", "1024");
+    std::string opusBitrateStr = getEnvVar("OPUS", "0");
+    std::string levelIntervalStr = getEnvVar("LEVELS", "0");
+    std::string dspThreadsStr = getEnvVar("DSP_THREADS", "0");
+    args.journalPath = getEnvVar("JOURNAL", "");
     
     try {
         args.sampleRate = std::stoi(sampleRateStr);
@@ -199,21 +329,83 @@ Arguments parseArguments(int argc, char* argv[]) {
     } catch (...) {
         args.bufferSize = 100;
     }
-
+    
+    try {
+        args.historyMs = std::stoi(historyMsStr);
+    } catch (...) {
+        args.historyMs = AudioSource::kDefaultHistoryMs;
+    }
+    
+    try {
+        args.journalMb = std::stoull(journalMbStr);
+    } catch (...) {
+        args.journalMb = 1024;
+    }
+    
+    try {
+        args.opusBitrate = std::stoi(opusBitrateStr);
+    } catch (...) {
+        args.opusBitrate = 0;
+    }
+    
     try {
-        args.bufferMinSend = std::stoi(bufferMinSendStr);
+        args.levelIntervalMs = std::stoi(levelIntervalStr);
     } catch (...) {
-        args.bufferMinSend = 2048;
+        args.levelIntervalMs = 0;
+    }
+    
+    try {
+        args.dspThreads = std::stoi(dspThreadsStr);
+    } catch (...) {
+        args.dspThreads = 0;
     }
     
     // Boolean flags
     args.listDevices = getEnvVar("LIST_DEVICES", "false") == "true";
     args.verbose = getEnvVar("VERBOSE", "false") == "true";
+    args.realtimeMemory = getEnvVar("REALTIME_MEMORY", "false") == "true";
+    args.hugePages = getEnvVar("HUGE_PAGES", "false") == "true";
     
     // Override with command line arguments
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--input-device") == 0 && i + 1 < argc) {
             args.inputDevice = argv[++i];
+        } else if (strcmp(argv[i], "--input-source") == 0 && i + 1 < argc) {
+            args.inputSource = argv[++i];
+        } else if (strcmp(argv[i], "--source-pacing") == 0 && i + 1 < argc) {
+            args.sourcePacing = argv[++i];
+        } else if (strcmp(argv[i], "--capture-mode") == 0 && i + 1 < argc) {
+            args.captureMode = argv[++i];
+        } else if (strcmp(argv[i], "--capture-sched") == 0 && i + 1 < argc) {
+            args.captureSched = argv[++i];
+        } else if (strcmp(argv[i], "--publisher-sched") == 0 && i + 1 < argc) {
+            args.publisherSched = argv[++i];
+        } else if (strcmp(argv[i], "--handler-sched") == 0 && i + 1 < argc) {
+            args.handlerSched = argv[++i];
+        } else if (strcmp(argv[i], "--zmq-io-sched") == 0 && i + 1 < argc) {
+            args.zmqIoSched = argv[++i];
+        } else if (strcmp(argv[i], "--worker-sched") == 0 && i + 1 < argc) {
+            args.workerSched = argv[++i];
+        } else if (strcmp(argv[i], "--publish-latency") == 0 && i + 1 < argc) {
+            args.publishLatency = argv[++i];
+        } else if (strcmp(argv[i], "--publish-format") == 0 && i + 1 < argc) {
+            args.publishFormat = argv[++i];
+        } else if (strcmp(argv[i], "--simd") == 0 && i + 1 < argc) {
+            args.simdLevel = argv[++i];
+        } else if (strcmp(argv[i], "--codec") == 0 && i + 1 < argc) {
+            args.payloadCodec = argv[++i];
+        } else if (strcmp(argv[i], "--silence-gate") == 0 && i + 1 < argc) {
+            args.silenceGate = argv[++i];
+        } else if (strcmp(argv[i], "--features") == 0 && i + 1 < argc) {
+            args.features = argv[++i];
+        } else if (strcmp(argv[i], "--feature-format") == 0 && i + 1 < argc) {
+            args.featureFormat = argv[++i];
+        } else if (strcmp(argv[i], "--dsp") == 0 && i + 1 < argc) {
+            args.dsp = argv[++i];
+        } else if (strcmp(argv[i], "--dsp-threads") == 0 && i + 1 < argc) {
+            args.dspThreads = std::stoi(argv[++i]);
+        } else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc) {
+            args.levelIntervalMs = std::stoi(argv[++i]);
         } else if (strcmp(argv[i], "--pub-address") == 0 && i + 1 < argc) {
             args.pubAddress = argv[++i];
         } else if (strcmp(argv[i], "--pub-topic") == 0 && i + 1 < argc) {
@@ -226,6 +418,10 @@ Arguments parseArguments(int argc, char* argv[]) {
             args.serviceName = argv[++i];
         } else if (strcmp(argv[i], "--stream-id") == 0 && i + 1 < argc) {
             args.streamId = argv[++i];
+        } else if (strcmp(argv[i], "--add-stream") == 0 && i + 1 < argc) {
+            args.extraStreams.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--derive") == 0 && i + 1 < argc) {
+            args.derivedStreams.push_back(argv[++i]);
         } else if (strcmp(argv[i], "--sample-rate") == 0 && i + 1 < argc) {
             args.sampleRate = std::stoi(argv[++i]);
         } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
@@ -234,10 +430,20 @@ Arguments parseArguments(int argc, char* argv[]) {
             args.bitDepth = std::stoi(argv[++i]);
         } else if (strcmp(argv[i], "--buffer-size") == 0 && i + 1 < argc) {
             args.bufferSize = std::stoi(argv[++i]);
-        } else if (strcmp(argv[i], "--buffer-min-send") == 0 && i + 1 < argc) {
-            args.bufferMinSend = std::stoi(argv[++i]);
+        } else if (strcmp(argv[i], "--history-ms") == 0 && i + 1 < argc) {
+            args.historyMs = std::stoi(argv[++i]);
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            args.journalPath = argv[++i];
+        } else if (strcmp(argv[i], "--journal-mb") == 0 && i + 1 < argc) {
+            args.journalMb = std::stoull(argv[++i]);
+        } else if (strcmp(argv[i], "--opus") == 0 && i + 1 < argc) {
+            args.opusBitrate = std::atoi(argv[++i]);
         } else if (strcmp(argv[i], "--verbose") == 0) {
             args.verbose = true;
+        } else if (strcmp(argv[i], "--realtime-memory") == 0) {
+            args.realtimeMemory = true;
+        } else if (strcmp(argv[i], "--huge-pages") == 0) {
+            args.hugePages = true;
         } else if (strcmp(argv[i], "--list-devices") == 0) {
             args.listDevices = true;
         } else if (strcmp(argv[i], "--env") == 0) {
@@ -279,6 +485,74 @@ void listAudioDevices() {
     }
 }
 
+// Apply --capture-mode/--capture-sched to a device source; other sources are left alone
+bool configureCapture(const std::shared_ptr<AudioSource>& source, const Arguments& args) {
+    auto capture = std::dynamic_pointer_cast<AudioCapture>(source);
+    if (!capture) {
+        return true;
+    }
+    
+    AudioCapture::CaptureMode mode;
+    if (args.captureMode.empty() || args.captureMode == "callback") {
+        mode = AudioCapture::CaptureMode::Callback;
+    } else if (args.captureMode == "blocking") {
+        mode = AudioCapture::CaptureMode::BlockingRead;
+    } else {
+        std::cerr << "Unknown capture mode: " << args.captureMode << std::endl;
+        return false;
+    }
+    
+    ThreadSchedule schedule;
+    if (!args.captureSched.empty() && !ThreadSchedule::parse(args.captureSched, schedule)) {
+        return false;
+    }
+    if (!schedule.isDefault() && mode != AudioCapture::CaptureMode::BlockingRead) {
+        std::cerr << "Warning: --capture-sched only applies to --capture-mode blocking" << std::endl;
+    }
+    
+    capture->setCaptureMode(mode, schedule);
+    return true;
+}
+
+// ZMQ starts its I/O threads with the first socket, so this must run before any socket exists
+bool configureZmqIoThreads(zmq::context_t& context, const ThreadSchedule& schedule) {
+    if (schedule.isDefault()) {
+        return true;
+    }
+    
+    bool ok = true;
+    
+#if defined(ZMQ_THREAD_SCHED_POLICY) && defined(ZMQ_THREAD_PRIORITY)
+    if (schedule.policy != ThreadSchedule::Policy::Inherit) {
+        ok &= zmq_ctx_set(context.handle(), ZMQ_THREAD_SCHED_POLICY, schedule.nativePolicy()) == 0;
+        ok &= zmq_ctx_set(context.handle(), ZMQ_THREAD_PRIORITY, schedule.priority) == 0;
+    }
+#else
+    if (schedule.policy != ThreadSchedule::Policy::Inherit) {
+        ok = false;
+    }
+#endif
+    
+#if defined(ZMQ_THREAD_AFFINITY_CPU_ADD)
+    for (int cpu : schedule.cpus) {
+        ok &= zmq_ctx_set(context.handle(), ZMQ_THREAD_AFFINITY_CPU_ADD, cpu) == 0;
+    }
+#else
+    if (!schedule.cpus.empty()) {
+        ok = false;
+    }
+#endif
+    
+    if (!ok) {
+        std::cerr << "Failed to apply ZMQ I/O thread scheduling " << schedule.toString() << std::endl;
+        return false;
+    }
+    
+    // The I/O threads cannot be inspected from here, so report what libzmq accepted
+    recordThreadSchedule("zmq_io", schedule.toString());
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     // Initialize PortAudio
     Pa_Initialize();
@@ -313,26 +587,290 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Lock memory before the buffers are allocated so they are locked as they are created
+    RealtimeMemory::setHugePages(args.hugePages);
+    if (args.realtimeMemory && RealtimeMemory::lockAll()) {
+        RealtimeMemory::prefaultStack();
+    }
+    
     // Initialize components
-    std::shared_ptr<AudioBuffer> audioBuffer = 
-        std::make_shared<AudioBuffer>(args.sampleRate, args.channels, args.bitDepth, args.bufferSize, args.bufferMinSend);
+    std::shared_ptr<AudioSource> audioSource = 
+        createAudioSource(args.inputSource, args.inputDevice, args.sampleRate, args.channels, args.bitDepth,
+                          args.bufferSize, args.sourcePacing);
+    if (!audioSource || !configureCapture(audioSource, args)) {
+        printUsage(argv[0]);
+        return 1;
+    }
     
-    std::shared_ptr<AudioCapture> audioCapture = 
-        std::make_shared<AudioCapture>(args.inputDevice, args.sampleRate, args.channels, args.bitDepth, args.bufferSize);
+    // Thread scheduling; capture threads are configured per source
+    ThreadSchedule publisherSchedule;
+    ThreadSchedule handlerSchedule;
+    ThreadSchedule zmqIoSchedule;
+    ThreadSchedule workerSchedule;
+    if (!ThreadSchedule::parse(args.publisherSched, publisherSchedule) ||
+        !ThreadSchedule::parse(args.handlerSched, handlerSchedule) ||
+        !ThreadSchedule::parse(args.zmqIoSched, zmqIoSchedule) ||
+        !ThreadSchedule::parse(args.workerSched, workerSchedule)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    BatchingSettings batching;
+    if (!args.publishLatency.empty() && !BatchingSettings::parse(args.publishLatency, batching)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    SampleSpec publishFormat;
+    if (!args.publishFormat.empty() && !SampleSpec::parse(args.publishFormat, publishFormat)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    std::unique_ptr<PayloadCodec> payloadCodec;
+    if (!PayloadCodec::create(args.payloadCodec, payloadCodec)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    FeatureSettings featureSettings;
+    if ((!args.features.empty() && !FeatureSettings::parse(args.features, featureSettings)) ||
+        !FeatureSettings::parseFormat(args.featureFormat, featureSettings)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    GateSettings silenceGate;
+    if (!args.silenceGate.empty() && !GateSettings::parse(args.silenceGate, silenceGate)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    DspSettings dspSettings;
+    if (!args.dsp.empty() && !DspSettings::parse(args.dsp, dspSettings)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    if (!args.simdLevel.empty()) {
+        SimdLevel level;
+        if (!parseSimdLevel(args.simdLevel, level) || !setSimdLevel(level)) {
+            return 1;
+        }
+    }
+    
+    // One context (and I/O thread) for the publisher and handler of every stream
+    std::shared_ptr<zmq::context_t> zmqContext = std::make_shared<zmq::context_t>(1);
+    configureZmqIoThreads(*zmqContext, zmqIoSchedule);
     
     std::shared_ptr<ZmqPublisher> zmqPublisher = 
-        std::make_shared<ZmqPublisher>(args.pubAddress, args.pubTopic, audioBuffer, audioCapture, args.serviceName, args.streamId);
+        std::make_shared<ZmqPublisher>(args.pubAddress, args.pubTopic, audioSource, args.serviceName,
+                                       args.streamId, zmqContext);
     
     std::shared_ptr<ZmqHandler> zmqHandler = 
-        std::make_shared<ZmqHandler>(args.dealerAddress, args.dealerTopic, audioCapture, zmqPublisher);
+        std::make_shared<ZmqHandler>(args.dealerAddress, args.dealerTopic, audioSource, zmqPublisher, zmqContext);
+    
+    // Extra streams share the PUB socket, each on its own stream_id and topic
+    std::vector<std::shared_ptr<AudioSource>> audioSources = { audioSource };
+    for (const auto& streamSpec : args.extraStreams) {
+        size_t eqPos = streamSpec.find('=');
+        std::string streamId = streamSpec.substr(0, eqPos);
+        if (eqPos == std::string::npos || streamId.empty() || streamId == args.streamId) {
+            std::cerr << "Invalid stream (expected unique <id>=<source>): " << streamSpec << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        
+        std::shared_ptr<AudioSource> source = 
+            createAudioSource(streamSpec.substr(eqPos + 1), args.inputDevice, args.sampleRate, args.channels,
+                              args.bitDepth, args.bufferSize, args.sourcePacing);
+        if (!source || !configureCapture(source, args)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        
+        size_t publisherStream = zmqPublisher->addStream(streamId, args.pubTopic + "/" + streamId, source);
+        zmqHandler->addStream(streamId, source, publisherStream);
+        audioSources.push_back(source);
+    }
+    
+    // Derived layouts, registered after every captured stream so those keep their indices
+    for (const auto& derivedSpec : args.derivedStreams) {
+        size_t eqPos = derivedSpec.find('=');
+        std::string streamId = derivedSpec.substr(0, eqPos);
+        if (eqPos == std::string::npos || streamId.empty()) {
+            std::cerr << "Invalid derived stream (expected <id>=[<stream>:]<map>[@<rate>]): " << derivedSpec
+                      << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        
+        std::string mapSpec = derivedSpec.substr(eqPos + 1);
+        int outputRate = 0;
+        size_t at = mapSpec.rfind('@');
+        if (at != std::string::npos) {
+            outputRate = std::atoi(mapSpec.c_str() + at + 1);
+            mapSpec = mapSpec.substr(0, at);
+            if (outputRate < 1000 || outputRate > 384000) {
+                std::cerr << "Invalid sample rate in derived stream " << streamId << std::endl;
+                return 1;
+            }
+        }
+        size_t parent = 0;
+        size_t colon = mapSpec.find(':');
+        if (colon != std::string::npos) {
+            std::string parentId = mapSpec.substr(0, colon);
+            mapSpec = mapSpec.substr(colon + 1);
+            parent = audioSources.size();
+            for (size_t i = 0; i < audioSources.size(); i++) {
+                if (zmqPublisher->getStream(i).streamId == parentId) {
+                    parent = i;
+                }
+            }
+            if (parent == audioSources.size()) {
+                std::cerr << "Unknown stream '" << parentId << "' in derived stream " << streamId << std::endl;
+                return 1;
+            }
+        }
+        
+        ChannelMatrix matrix;
+        if (!ChannelMatrix::parse(mapSpec.empty() ? "all" : mapSpec, matrix)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        ChannelMixer check(matrix);
+        if (!check.setInputChannels(audioSources[parent]->getChannels())) {
+            return 1;
+        }
+        
+        if (zmqPublisher->addDerivedStream(streamId, args.pubTopic + "/" + streamId, parent, matrix,
+                                           outputRate) == 0) {
+            return 1;
+        }
+    }
+    
+    // Opus topics next to each captured stream, encoded on their own threads
+    std::vector<std::shared_ptr<OpusStreamEncoder>> opusEncoders;
+    if (args.opusBitrate > 0) {
+        if (!OpusStreamEncoder::isAvailable()) {
+            std::cerr << "--opus needs a build with libopus" << std::endl;
+            return 1;
+        }
+        for (size_t i = 0; i < audioSources.size(); i++) {
+            const PublishedStream& parent = zmqPublisher->getStream(i);
+            std::string streamId = parent.streamId.empty() ? "opus" : parent.streamId + "-opus";
+            size_t index = zmqPublisher->addEncodedStream(streamId, parent.topic + "/opus", i, "opus");
+            if (index == 0) {
+                return 1;
+            }
+            auto encoder = std::make_shared<OpusStreamEncoder>(zmqPublisher, index, args.opusBitrate);
+            encoder->setThreadSchedule(workerSchedule);
+            zmqHandler->setOpusEncoder(i, encoder);
+            opusEncoders.push_back(encoder);
+        }
+    }
+    
+    // Feature topics next to each captured stream, computed on their own threads
+    std::vector<std::shared_ptr<FeatureStream>> featureStreams;
+    if (featureSettings.enabled) {
+        for (size_t i = 0; i < audioSources.size(); i++) {
+            const PublishedStream& parent = zmqPublisher->getStream(i);
+            std::string streamId = parent.streamId.empty() ? "features" : parent.streamId + "-features";
+            size_t index = zmqPublisher->addEncodedStream(streamId, parent.topic + "/features", i, "features");
+            if (index == 0) {
+                return 1;
+            }
+            auto features = std::make_shared<FeatureStream>(zmqPublisher, index, featureSettings);
+            features->setThreadSchedule(workerSchedule);
+            zmqHandler->setFeatureStream(i, features);
+            featureStreams.push_back(features);
+        }
+    }
     
     // Set echo status flag
     zmqHandler->setVerboseMode(args.verbose);
     
+    zmqPublisher->setThreadSchedule(publisherSchedule);
+    zmqPublisher->setBatching(batching);
+    if (!args.publishFormat.empty()) {
+        zmqPublisher->setPublishFormat(publishFormat);
+    }
+    zmqPublisher->setPayloadCodec(std::move(payloadCodec));
+    zmqPublisher->setSilenceGate(silenceGate);
+    zmqPublisher->setLevelMetering(args.levelIntervalMs);
+    zmqHandler->setThreadSchedule(handlerSchedule);
+    
     // Initialize components
-    if (!audioCapture->initialize()) {
-        std::cerr << "Failed to initialize audio capture" << std::endl;
-        return 1;
+    for (const auto& source : audioSources) {
+        source->setHistoryMs(args.historyMs);
+        if (!source->initialize()) {
+            std::cerr << "Failed to initialize audio source" << std::endl;
+            return 1;
+        }
+    }
+    
+    // Processing chains between capture and publishing, each on its own thread. Wide streams
+    // share one pool that splits their channel groups across cores; streams run in it at the
+    // same time, so it is sized for the groups of all of them.
+    std::vector<std::shared_ptr<DspWorker>> dspWorkers;
+    if (dspSettings.enabled()) {
+        size_t totalGroups = 0;
+        for (const auto& source : audioSources) {
+            const int groups =
+                (source->getChannels() + DspPipeline::kChannelsPerGroup - 1) / DspPipeline::kChannelsPerGroup;
+            if (groups > 1) {
+                totalGroups += static_cast<size_t>(groups);
+            }
+        }
+        size_t poolThreads = std::max(1u, std::thread::hardware_concurrency());
+        if (args.dspThreads > 0) {
+            poolThreads = static_cast<size_t>(args.dspThreads);
+        }
+        poolThreads = std::min(poolThreads, totalGroups);
+        std::shared_ptr<WorkStealingPool> dspPool;
+        if (poolThreads > 1) {
+            dspPool = std::make_shared<WorkStealingPool>(poolThreads, workerSchedule);
+        }
+        
+        for (size_t i = 0; i < audioSources.size(); i++) {
+            auto publish = [zmqPublisher, i](const AudioBlockHandle& block) {
+                zmqPublisher->publishAudioData(i, block);
+            };
+            auto worker = std::make_shared<DspWorker>(i, dspSettings, publish, dspPool);
+            worker->setThreadSchedule(workerSchedule);
+            zmqHandler->setDspWorker(i, worker);
+            dspWorkers.push_back(worker);
+        }
+    }
+    
+    // Capture journals, one file per stream; the format is known once the sources are initialized
+    std::vector<std::shared_ptr<CaptureJournal>> journals;
+    if (!args.journalPath.empty()) {
+        for (size_t i = 0; i < audioSources.size(); i++) {
+            std::string path = args.journalPath;
+            if (i > 0) {
+                path += "." + zmqPublisher->getStream(i).streamId;
+            }
+            
+            auto journal = std::make_shared<CaptureJournal>(path);
+            journal->setThreadSchedule(workerSchedule);
+            const auto& source = audioSources[i];
+            if (!journal->create(source->getSampleRate(), source->getChannels(), source->getBitDepth(),
+                                 args.journalMb * 1024 * 1024)) {
+                std::cerr << "Failed to create capture journal " << path << std::endl;
+                return 1;
+            }
+            zmqHandler->setJournal(i, journal);
+            journals.push_back(journal);
+        }
+    }
+    
+    // Sources allocate their rings and block pools above
+    if (args.realtimeMemory || args.hugePages) {
+        std::cout << "Realtime memory: " << (RealtimeMemory::isLocked() ? "locked" : "not locked")
+                  << ", VmLck " << RealtimeMemory::getLockedBytes() / 1024 << " KiB"
+                  << ", capture buffers " << RealtimeMemory::getBufferBytes() / 1024 << " KiB"
+                  << (args.hugePages ? " (huge pages requested)" : "") << std::endl;
     }
     
     if (!zmqPublisher->initialize()) {
@@ -345,10 +883,19 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    // Set up the callback from AudioCapture to ZmqPublisher
-    audioCapture->setAudioDataCallback([zmqPublisher](const std::vector<uint8_t>& data, uint64_t timestamp) {
-        zmqPublisher->publishAudioData(data, timestamp);
-    });
+    // Set up the callbacks from the sources to ZmqPublisher, through the processing chain if there is one
+    for (size_t i = 0; i < audioSources.size(); i++) {
+        if (i < dspWorkers.size()) {
+            std::shared_ptr<DspWorker> worker = dspWorkers[i];
+            audioSources[i]->setAudioDataCallback([worker](const AudioBlockHandle& block) {
+                worker->submit(block);
+            });
+        } else {
+            audioSources[i]->setAudioDataCallback([zmqPublisher, i](const AudioBlockHandle& block) {
+                zmqPublisher->publishAudioData(i, block);
+            });
+        }
+    }
     
     // Start components
     if (!zmqPublisher->start()) {
@@ -362,25 +909,58 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    if (!audioCapture->start()) {
-        std::cerr << "Failed to start audio capture" << std::endl;
-        zmqHandler->stop();
-        zmqPublisher->stop();
-        return 1;
+    for (size_t i = 0; i < dspWorkers.size(); i++) {
+        if (!dspWorkers[i]->start(audioSources[i])) {
+            std::cerr << "Failed to start processing for stream " << i << std::endl;
+        }
     }
     
-    // Send initial status message
-    nlohmann::json statusJson;
-    std::map<std::string, nlohmann::json> statusData;
-    statusData["running"] = true;
-    statusData["sample_rate"] = audioCapture->getSampleRate();
-    statusData["channels"] = audioCapture->getChannels();
-    statusData["bit_depth"] = audioCapture->getBitDepth();
-    statusData["device"] = audioCapture->getDeviceName();
-    zmqPublisher->publishStatusMessage(statusData, args.verbose);
+    for (const auto& source : audioSources) {
+        if (!source->start()) {
+            std::cerr << "Failed to start audio source" << std::endl;
+            for (const auto& started : audioSources) {
+                started->stop();
+            }
+            zmqHandler->stop();
+            zmqPublisher->stop();
+            return 1;
+        }
+    }
+    
+    for (size_t i = 0; i < journals.size(); i++) {
+        journals[i]->start(audioSources[i]);
+        std::cout << "Journaling to " << journals[i]->getPath() << std::endl;
+    }
+    
+    for (size_t i = 0; i < opusEncoders.size(); i++) {
+        if (!opusEncoders[i]->start(audioSources[i])) {
+            std::cerr << "Failed to start Opus encoder for stream " << i << std::endl;
+        }
+    }
+    
+    for (size_t i = 0; i < featureStreams.size(); i++) {
+        if (!featureStreams[i]->start(audioSources[i])) {
+            std::cerr << "Failed to start features for stream " << i << std::endl;
+        }
+    }
+    
+    // Send initial status message for each stream
+    std::vector<std::map<std::string, nlohmann::json>> statusData(audioSources.size());
+    for (size_t i = 0; i < audioSources.size(); i++) {
+        statusData[i]["running"] = true;
+        statusData[i]["sample_rate"] = audioSources[i]->getSampleRate();
+        statusData[i]["channels"] = audioSources[i]->getChannels();
+        statusData[i]["bit_depth"] = audioSources[i]->getBitDepth();
+        statusData[i]["device"] = audioSources[i]->getDeviceName();
+        zmqPublisher->publishStatusMessage(i, statusData[i], args.verbose);
+    }
     
     std::cout << "AudioZMQ started successfully" << std::endl;
     std::cout << "Publishing on " << args.pubAddress << " with topic '" << args.pubTopic << "'" << std::endl;
+    for (size_t i = 1; i < zmqPublisher->getStreamCount(); i++) {
+        std::cout << "Publishing stream '" << zmqPublisher->getStream(i).streamId << "' with topic '"
+                  << zmqPublisher->getStream(i).topic << "'" << std::endl;
+    }
     std::cout << "Handling requests on " << args.dealerAddress << " with topic '" << args.dealerTopic << "'" << std::endl;
     std::cout << "Press Ctrl+C to stop" << std::endl;
     
@@ -392,13 +972,30 @@ int main(int argc, char* argv[]) {
     // Clean shutdown
     std::cout << "\nShutting down..." << std::endl;
     
-    audioCapture->stop();
+    for (const auto& source : audioSources) {
+        source->stop();
+    }
+    // Blocks still queued for processing go out before the publisher stops
+    for (const auto& worker : dspWorkers) {
+        worker->stop();
+    }
+    for (const auto& journal : journals) {
+        journal->stop();
+    }
+    for (const auto& encoder : opusEncoders) {
+        encoder->stop();
+    }
+    for (const auto& features : featureStreams) {
+        features->stop();
+    }
     zmqHandler->stop();
     zmqPublisher->stop();
     
     // Send final status message indicating shutdown
-    statusData["running"] = false;
-    zmqPublisher->publishStatusMessage(statusData, args.verbose);
+    for (size_t i = 0; i < statusData.size(); i++) {
+        statusData[i]["running"] = false;
+        zmqPublisher->publishStatusMessage(i, statusData[i], args.verbose);
+    }
     
     std::cout << "Shutdown complete" << std::endl;
     
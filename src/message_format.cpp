@@ -105,4 +105,12 @@ std::string getCurrentTimestamp() {
     return ss.str();
 }
 
+json gapToJson(const CaptureGap& gap) {
+    return {
+        {"input_overflows", gap.inputOverflows},
+        {"input_underflows", gap.inputUnderflows},
+        {"dropped_frames", gap.droppedFrames}
+    };
+}
+
 } // namespace message_format 
\ No newline at end of file
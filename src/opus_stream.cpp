@@ -0,0 +1,240 @@
+#include "opus_stream.hpp"
+#include "audio_source.hpp"
+#include "channel_mix.hpp"
+#include "message_format.hpp"
+#include "resampler.hpp"
+#include "sample_format.hpp"
+#include "zmq_publisher.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#if defined(TESSA_HAVE_OPUS)
+#include <opus.h>
+#endif
+
+namespace {
+
+// Read the ring in chunks of up to this many bytes
+constexpr size_t kEncodeChunkBytes = 64 * 1024;
+const auto kEncodeInterval = std::chrono::milliseconds(10);
+
+// Largest packet Opus produces for one frame is 1275 bytes per stream
+constexpr size_t kMaxPacketBytes = 1500;
+
+bool isOpusRate(int sampleRate) {
+    return sampleRate == 8000 || sampleRate == 12000 || sampleRate == 16000 || sampleRate == 24000 ||
+           sampleRate == 48000;
+}
+
+} // namespace
+
+OpusStreamEncoder::OpusStreamEncoder(std::shared_ptr<ZmqPublisher> publisher, size_t publisherStream, int bitrate)
+    : RingReader("opus " + std::to_string(publisherStream), kEncodeChunkBytes, kEncodeInterval),
+      publisher_(publisher),
+      publisherStream_(publisherStream),
+      bitrate_(std::max(kMinBitrate, std::min(kMaxBitrate, bitrate))),
+      encoder_(nullptr),
+      inputRate_(0),
+      inputChannels_(0),
+      encodeRate_(0),
+      encodeChannels_(0),
+      pendingTimestampMs_(0.0),
+      pendingGapFrames_(0),
+      packetIndex_(0),
+      packetsEncoded_(0) {
+}
+
+OpusStreamEncoder::~OpusStreamEncoder() {
+    stop();
+#if defined(TESSA_HAVE_OPUS)
+    if (encoder_) {
+        opus_encoder_destroy(encoder_);
+    }
+#endif
+}
+
+bool OpusStreamEncoder::isAvailable() {
+#if defined(TESSA_HAVE_OPUS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool OpusStreamEncoder::start(std::shared_ptr<AudioSource> source) {
+    if (!isAvailable()) {
+        std::cerr << "Opus encoding is not available: built without libopus" << std::endl;
+        return false;
+    }
+    if (!publisher_) {
+        return false;
+    }
+    return RingReader::start(source);
+}
+
+double OpusStreamEncoder::getEncodeUsPerPacket() const {
+    uint64_t packets = getPacketsEncoded();
+    return packets > 0 ? getEncodeNs() / 1000.0 / packets : 0.0;
+}
+
+double OpusStreamEncoder::getEncodeLoadPercent() const {
+    uint64_t audioNs = getPacketsEncoded() * kFrameMs * 1000000ull;
+    return audioNs > 0 ? 100.0 * getEncodeNs() / audioNs : 0.0;
+}
+
+bool OpusStreamEncoder::onRing(AudioSource& source) {
+    inputRate_ = source.getSampleRate();
+    inputChannels_ = source.getChannels();
+    encodeRate_ = isOpusRate(inputRate_) ? inputRate_ : 48000;
+    encodeChannels_ = inputChannels_ <= 2 ? inputChannels_ : 1;
+
+    SampleSpec captured;
+    if (inputChannels_ <= 0 || !SampleSpec::fromBitDepth(source.getBitDepth(), captured)) {
+        std::cerr << "Cannot encode Opus from " << source.getBitDepth() << "-bit audio" << std::endl;
+        return false;
+    }
+    toFloat_ = std::make_unique<SampleConverter>(captured, SampleSpec{SampleFormat::Float32, SampleLayout::Planar},
+                                                 inputChannels_);
+
+    mixer_.reset();
+    if (inputChannels_ > 2) {
+        ChannelMatrix mono;
+        ChannelMatrix::parse("mix", mono);
+        mixer_ = std::make_unique<ChannelMixer>(mono);
+        mixer_->setInputChannels(inputChannels_);
+    }
+
+    resampler_.reset();
+    if (encodeRate_ != inputRate_) {
+        resampler_ = std::make_unique<Resampler>(inputRate_, encodeRate_, encodeChannels_);
+    }
+
+#if defined(TESSA_HAVE_OPUS)
+    if (encoder_) {
+        opus_encoder_destroy(encoder_);
+        encoder_ = nullptr;
+    }
+    // VOIP favours intelligibility at the low bitrates remote monitoring runs at
+    int error = OPUS_OK;
+    encoder_ = opus_encoder_create(encodeRate_, encodeChannels_, OPUS_APPLICATION_VOIP, &error);
+    if (error != OPUS_OK || !encoder_) {
+        std::cerr << "Failed to create Opus encoder: " << opus_strerror(error) << std::endl;
+        encoder_ = nullptr;
+        return false;
+    }
+    opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate_));
+#endif
+
+    pending_.clear();
+    pendingGapFrames_ = 0;
+    return true;
+}
+
+void OpusStreamEncoder::resetState() {
+    pending_.clear();
+    if (resampler_) {
+        resampler_->reset();
+    }
+#if defined(TESSA_HAVE_OPUS)
+    if (encoder_) {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+    }
+#endif
+}
+
+void OpusStreamEncoder::onChunk(const ReadResult& chunk) {
+    // Audio we never saw: start the next packet afresh and flag the gap in it
+    if (chunk.overrun()) {
+        resetState();
+        pendingGapFrames_ += chunk.lostFrames;
+    }
+    process(chunk);
+}
+
+void OpusStreamEncoder::process(const ReadResult& chunk) {
+    const size_t frameBytes = inputChannels_ * toFloat_->getFrom().bytesPerSample();
+    const size_t frames = chunk.data.size() / frameBytes;
+    if (frames == 0) {
+        return;
+    }
+
+    planar_.resize(frames * inputChannels_);
+    toFloat_->convert(chunk.data.data(), frames * frameBytes, planar_.data());
+    const float* audio = planar_.data();
+
+    if (mixer_) {
+        mixed_.resize(frames);
+        mixer_->mix(audio, frames, mixed_.data());
+        audio = mixed_.data();
+    }
+
+    // Where the first frame to encode falls, in input frames from the chunk's first frame
+    size_t encodeFrames = frames;
+    double offset = 0.0;
+    if (resampler_) {
+        encodeFrames = resampler_->process(audio, frames, resampled_, offset);
+        audio = resampled_.data();
+        if (encodeFrames == 0) {
+            return;  // Still filling the filter
+        }
+    }
+
+    // Packets start at the first resampled frame, as on the raw stream's resampled output
+    if (pending_.empty()) {
+        pendingTimestampMs_ = static_cast<double>(chunk.timestamp) + 1000.0 * offset / inputRate_;
+    }
+
+    // Opus takes interleaved frames
+    const size_t start = pending_.size();
+    pending_.resize(start + encodeFrames * encodeChannels_);
+    for (size_t i = 0; i < encodeFrames; ++i) {
+        for (int channel = 0; channel < encodeChannels_; ++channel) {
+            pending_[start + i * encodeChannels_ + channel] = audio[channel * encodeFrames + i];
+        }
+    }
+
+    encodePending();
+}
+
+void OpusStreamEncoder::publishPacket(std::vector<uint8_t> packet, size_t frames,
+                                      std::map<std::string, nlohmann::json> metadata) {
+    metadata["derived_from"] = publisher_->getStream(publisher_->getStream(publisherStream_).parent).streamId;
+    publisher_->publishEncodedAudio(publisherStream_, std::move(packet), frames, std::move(metadata));
+}
+
+void OpusStreamEncoder::encodePending() {
+#if defined(TESSA_HAVE_OPUS)
+    const size_t packetFrames = static_cast<size_t>(encodeRate_) * kFrameMs / 1000;
+    const size_t packetSamples = packetFrames * encodeChannels_;
+
+    size_t offset = 0;
+    packet_.resize(kMaxPacketBytes);
+    while (pending_.size() - offset >= packetSamples) {
+        int bytes = opus_encode_float(encoder_, pending_.data() + offset, static_cast<int>(packetFrames),
+                                      packet_.data(), static_cast<opus_int32>(packet_.size()));
+        offset += packetSamples;
+        if (bytes < 0) {
+            std::cerr << "Opus encode error: " << opus_strerror(bytes) << std::endl;
+            continue;
+        }
+
+        std::map<std::string, nlohmann::json> metadata;
+        metadata["unix_timestamp_ms"] = static_cast<uint64_t>(pendingTimestampMs_);
+        metadata["packet_index"] = packetIndex_++;
+        metadata["sample_rate"] = encodeRate_;
+        metadata["channels"] = encodeChannels_;
+        metadata["frame_ms"] = kFrameMs;
+        metadata["bitrate"] = bitrate_;
+        if (pendingGapFrames_ > 0) {
+            metadata["gap"] = message_format::gapToJson(CaptureGap{0, 0, pendingGapFrames_});
+            pendingGapFrames_ = 0;
+        }
+        publishPacket(std::vector<uint8_t>(packet_.begin(), packet_.begin() + bytes), packetFrames, std::move(metadata));
+
+        packetsEncoded_.fetch_add(1, std::memory_order_relaxed);
+        pendingTimestampMs_ += 1000.0 * packetFrames / encodeRate_;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + offset);
+#endif
+}
@@ -0,0 +1,378 @@
+#include "payload_codec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Rice codes with a longer quotient write the value in full instead
+constexpr uint64_t kEscapeQuotient = 24;
+constexpr int kRiceParameterBits = 6;
+constexpr int kWideLengthBits = 7;
+
+// Header of each coded channel: predictor order, and whether the channel is coded as its
+// difference to the previous one
+constexpr uint8_t kOrderMask = 0x07;
+constexpr uint8_t kDifferenceFlag = 0x08;
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+int bitLength(uint64_t value) {
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+// MSB-first bit packing
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& output) : output_(output), bits_(0), count_(0) {}
+
+    // Up to 32 bits
+    void write(uint64_t value, int bits) {
+        bits_ = (bits_ << bits) | (value & ((uint64_t(1) << bits) - 1));
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            output_.push_back(static_cast<uint8_t>(bits_ >> count_));
+        }
+    }
+
+    void writeWide(uint64_t value) {
+        int length = bitLength(value);
+        write(length, kWideLengthBits);
+        if (length > 32) {
+            write(value >> 32, length - 32);
+            length = 32;
+        }
+        write(value, length);
+    }
+
+    void writeRice(uint64_t value, int parameter) {
+        uint64_t quotient = value >> parameter;
+        if (quotient >= kEscapeQuotient) {
+            write((uint64_t(1) << kEscapeQuotient) - 1, static_cast<int>(kEscapeQuotient));
+            writeWide(value);
+            return;
+        }
+        // quotient ones, then a zero, then the low bits; usually one write
+        const uint64_t unary = ((uint64_t(1) << quotient) - 1) << 1;
+        if (quotient + 1 + parameter <= 32) {
+            write((unary << parameter) | (value & ((uint64_t(1) << parameter) - 1)),
+                  static_cast<int>(quotient) + 1 + parameter);
+            return;
+        }
+        write(unary, static_cast<int>(quotient) + 1);
+        if (parameter > 32) {
+            write(value >> 32, parameter - 32);
+            parameter = 32;
+        }
+        write(value, parameter);
+    }
+
+    void flush() {
+        if (count_ > 0) {
+            write(0, 8 - count_);
+        }
+    }
+
+private:
+    std::vector<uint8_t>& output_;
+    uint64_t bits_;
+    int count_;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size), offset_(0), bits_(0), count_(0), failed_(false) {}
+
+    // Up to 32 bits
+    uint64_t read(int bits) {
+        while (count_ < bits) {
+            if (offset_ >= size_) {
+                failed_ = true;
+                return 0;
+            }
+            bits_ = (bits_ << 8) | data_[offset_++];
+            count_ += 8;
+        }
+        count_ -= bits;
+        return (bits_ >> count_) & ((uint64_t(1) << bits) - 1);
+    }
+
+    uint64_t readWide() {
+        int length = static_cast<int>(read(kWideLengthBits));
+        if (length > 64) {
+            failed_ = true;
+            return 0;
+        }
+        uint64_t value = 0;
+        if (length > 32) {
+            value = read(length - 32) << 32;
+            length = 32;
+        }
+        return value | read(length);
+    }
+
+    uint64_t readRice(int parameter) {
+        uint64_t quotient = 0;
+        while (read(1) == 1 && !failed_) {
+            if (++quotient == kEscapeQuotient) {
+                return readWide();
+            }
+        }
+        uint64_t low = 0;
+        int remaining = parameter;
+        if (remaining > 32) {
+            low = read(remaining - 32) << 32;
+            remaining = 32;
+        }
+        low |= read(remaining);
+        return (quotient << parameter) | low;
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_;
+    uint64_t bits_;
+    int count_;
+    bool failed_;
+};
+
+// Fixed polynomial prediction of s[i] from the order samples before it
+int64_t predict(const int64_t* s, size_t i, int order) {
+    switch (order) {
+        case 1:
+            return s[i - 1];
+        case 2:
+            return 2 * s[i - 1] - s[i - 2];
+        case 3:
+            return 3 * s[i - 1] - 3 * s[i - 2] + s[i - 3];
+        case 4:
+            return 4 * s[i - 1] - 6 * s[i - 2] + 4 * s[i - 3] - s[i - 4];
+        default:
+            return 0;
+    }
+}
+
+// Predictor order with the smallest absolute residuals, and that total
+int bestOrder(const int64_t* s, size_t frames, uint64_t& cost) {
+    cost = 0;
+    if (frames <= static_cast<size_t>(DeltaRiceCodec::kMaxOrder)) {
+        return 0;  // Too short to be worth predicting
+    }
+
+    uint64_t totals[DeltaRiceCodec::kMaxOrder + 1] = {};
+    for (size_t i = DeltaRiceCodec::kMaxOrder; i < frames; ++i) {
+        int64_t e0 = s[i];
+        int64_t e1 = e0 - s[i - 1];
+        int64_t e2 = e1 - (s[i - 1] - s[i - 2]);
+        int64_t e3 = e2 - (s[i - 1] - 2 * s[i - 2] + s[i - 3]);
+        int64_t e4 = e3 - (s[i - 1] - 3 * s[i - 2] + 3 * s[i - 3] - s[i - 4]);
+        totals[0] += static_cast<uint64_t>(e0 < 0 ? -e0 : e0);
+        totals[1] += static_cast<uint64_t>(e1 < 0 ? -e1 : e1);
+        totals[2] += static_cast<uint64_t>(e2 < 0 ? -e2 : e2);
+        totals[3] += static_cast<uint64_t>(e3 < 0 ? -e3 : e3);
+        totals[4] += static_cast<uint64_t>(e4 < 0 ? -e4 : e4);
+    }
+    int order = 0;
+    for (int candidate = 1; candidate <= DeltaRiceCodec::kMaxOrder; ++candidate) {
+        if (totals[candidate] < totals[order]) {
+            order = candidate;
+        }
+    }
+    cost = totals[order];
+    return order;
+}
+
+// Rice parameter close to log2 of the mean value
+int riceParameter(const uint64_t* values, size_t count) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += values[i];
+    }
+    int parameter = 0;
+    while (parameter < 62 && (static_cast<uint64_t>(count) << (parameter + 1)) <= sum) {
+        ++parameter;
+    }
+    return parameter;
+}
+
+// Sign-extended integer sample of the given width (little-endian)
+int64_t readSample(const uint8_t* p, size_t bytes) {
+    uint32_t value = 0;
+    for (size_t b = 0; b < bytes; ++b) {
+        value |= static_cast<uint32_t>(p[b]) << (8 * b);
+    }
+    const int shift = static_cast<int>(32 - 8 * bytes);
+    return static_cast<int32_t>(value << shift) >> shift;
+}
+
+// Unpack a payload into planar samples, one row of frames per channel
+void loadSamples(const uint8_t* data, size_t frames, int channels, const SampleSpec& spec, std::vector<int64_t>& samples) {
+    const size_t bytes = spec.bytesPerSample();
+    const bool planar = spec.layout == SampleLayout::Planar;
+    samples.resize(frames * channels);
+
+    for (int channel = 0; channel < channels; ++channel) {
+        int64_t* row = &samples[channel * frames];
+        const uint8_t* p = data + (planar ? channel * frames : channel) * bytes;
+        const size_t stride = (planar ? 1 : channels) * bytes;
+        for (size_t i = 0; i < frames; ++i, p += stride) {
+            row[i] = readSample(p, bytes);
+        }
+    }
+}
+
+void storeSamples(const std::vector<int64_t>& samples, size_t frames, int channels, const SampleSpec& spec,
+                  std::vector<uint8_t>& output) {
+    const size_t bytes = spec.bytesPerSample();
+    const bool planar = spec.layout == SampleLayout::Planar;
+    output.resize(frames * channels * bytes);
+
+    for (int channel = 0; channel < channels; ++channel) {
+        const int64_t* row = &samples[channel * frames];
+        uint8_t* p = output.data() + (planar ? channel * frames : channel) * bytes;
+        const size_t stride = (planar ? 1 : channels) * bytes;
+        for (size_t i = 0; i < frames; ++i, p += stride) {
+            const uint32_t value = static_cast<uint32_t>(row[i]);
+            for (size_t b = 0; b < bytes; ++b) {
+                p[b] = static_cast<uint8_t>(value >> (8 * b));
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool PayloadCodec::create(const std::string& name, std::unique_ptr<PayloadCodec>& codec) {
+    if (name == "none") {
+        codec.reset();
+        return true;
+    }
+    if (name == "delta-rice") {
+        codec = std::make_unique<DeltaRiceCodec>();
+        return true;
+    }
+
+    std::cerr << "Unknown payload codec '" << name << "' (expected none or delta-rice)" << std::endl;
+    return false;
+}
+
+bool DeltaRiceCodec::encode(const uint8_t* data, size_t frames, int channels, const SampleSpec& spec,
+                            std::vector<uint8_t>& output) {
+    if (spec.format == SampleFormat::Float32 || channels <= 0) {
+        return false;
+    }
+
+    loadSamples(data, frames, channels, spec, samples_);
+    output.clear();
+    output.reserve(frames * channels * spec.bytesPerSample() / 2);
+    BitWriter writer(output);
+
+    candidate_.resize(frames);
+    coded_.resize(frames);
+
+    for (int channel = 0; channel < channels; ++channel) {
+        const int64_t* samples = &samples_[channel * frames];
+
+        uint64_t cost = 0;
+        int order = bestOrder(samples, frames, cost);
+        const int64_t* source = samples;
+        bool difference = false;
+
+        // Correlated channels often predict better as the difference to their neighbour
+        if (channel > 0) {
+            const int64_t* previous = samples - frames;
+            for (size_t i = 0; i < frames; ++i) {
+                candidate_[i] = samples[i] - previous[i];
+            }
+            uint64_t differenceCost = 0;
+            int differenceOrder = bestOrder(candidate_.data(), frames, differenceCost);
+            if (differenceCost < cost) {
+                order = differenceOrder;
+                source = candidate_.data();
+                difference = true;
+            }
+        }
+
+        writer.write(static_cast<uint8_t>(order) | (difference ? kDifferenceFlag : 0), 8);
+        for (int i = 0; i < order; ++i) {
+            writer.writeWide(zigzag(source[i]));
+        }
+
+        const size_t count = frames - order;
+        for (size_t i = 0; i < count; ++i) {
+            coded_[i] = zigzag(source[order + i] - predict(source, order + i, order));
+        }
+        for (size_t start = 0; start < count; start += kPartitionSamples) {
+            const size_t length = std::min(kPartitionSamples, count - start);
+            const int parameter = riceParameter(&coded_[start], length);
+            writer.write(parameter, kRiceParameterBits);
+            for (size_t i = start; i < start + length; ++i) {
+                writer.writeRice(coded_[i], parameter);
+            }
+        }
+    }
+
+    writer.flush();
+    return true;
+}
+
+bool DeltaRiceCodec::decode(const uint8_t* data, size_t size, size_t frames, int channels, const SampleSpec& spec,
+                            std::vector<uint8_t>& output) {
+    if (spec.format == SampleFormat::Float32 || channels <= 0) {
+        return false;
+    }
+
+    samples_.assign(frames * channels, 0);
+    BitReader reader(data, size);
+
+    for (int channel = 0; channel < channels; ++channel) {
+        int64_t* samples = &samples_[channel * frames];
+
+        const uint8_t header = static_cast<uint8_t>(reader.read(8));
+        const int order = header & kOrderMask;
+        const bool difference = (header & kDifferenceFlag) != 0;
+        if (order > kMaxOrder || static_cast<size_t>(order) > frames || (difference && channel == 0)) {
+            return false;
+        }
+
+        for (int i = 0; i < order; ++i) {
+            samples[i] = unzigzag(reader.readWide());
+        }
+
+        const size_t count = frames - order;
+        for (size_t start = 0; start < count; start += kPartitionSamples) {
+            const size_t length = std::min(kPartitionSamples, count - start);
+            const int parameter = static_cast<int>(reader.read(kRiceParameterBits));
+            for (size_t i = order + start; i < order + start + length; ++i) {
+                samples[i] = unzigzag(reader.readRice(parameter)) + predict(samples, i, order);
+            }
+            if (reader.failed()) {
+                return false;
+            }
+        }
+
+        if (difference) {
+            const int64_t* previous = samples - frames;
+            for (size_t i = 0; i < frames; ++i) {
+                samples[i] += previous[i];
+            }
+        }
+    }
+
+    if (reader.failed()) {
+        return false;
+    }
+
+    storeSamples(samples_, frames, channels, spec, output);
+    return true;
+}
@@ -0,0 +1,99 @@
+#include "publish_batching.hpp"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+bool BatchingSettings::parse(const std::string& spec, BatchingSettings& settings) {
+    size_t colon = spec.find(':');
+    if (colon == std::string::npos) {
+        std::cerr << "Invalid latency bounds '" << spec << "' (expected <min_ms>:<max_ms>)" << std::endl;
+        return false;
+    }
+
+    int minMs = 0;
+    int maxMs = 0;
+    try {
+        size_t parsed = 0;
+        minMs = std::stoi(spec.substr(0, colon), &parsed);
+        if (parsed != colon) {
+            throw std::invalid_argument(spec);
+        }
+        std::string maxPart = spec.substr(colon + 1);
+        maxMs = std::stoi(maxPart, &parsed);
+        if (parsed != maxPart.size()) {
+            throw std::invalid_argument(spec);
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid latency bounds '" << spec << "' (expected <min_ms>:<max_ms>)" << std::endl;
+        return false;
+    }
+
+    if (minMs < 1 || maxMs < minMs || maxMs > 10000) {
+        std::cerr << "Latency bounds must satisfy 1 <= min <= max <= 10000 ms, got '" << spec << "'" << std::endl;
+        return false;
+    }
+
+    settings.adaptive = true;
+    settings.minLatencyMs = minMs;
+    settings.maxLatencyMs = maxMs;
+    return true;
+}
+
+std::string BatchingSettings::toString() const {
+    if (!adaptive) {
+        return "per_block";
+    }
+    std::ostringstream ss;
+    ss << "adaptive " << minLatencyMs << ":" << maxLatencyMs << "ms";
+    return ss.str();
+}
+
+BatchController::BatchController(const BatchingSettings& settings)
+    : settings_(settings),
+      idleWindows_(0),
+      chunkMs_(0),
+      flushIntervalMs_(1),
+      loadPercent_(0) {
+
+    if (settings_.adaptive) {
+        setChunkMs(settings_.minLatencyMs);
+    }
+}
+
+void BatchController::update(double senderLoad, size_t backlog, size_t backlogCapacity) {
+    loadPercent_.store(static_cast<uint32_t>(std::clamp(senderLoad, 0.0, 1.0) * 100.0 + 0.5),
+                       std::memory_order_relaxed);
+
+    if (!settings_.adaptive) {
+        return;
+    }
+
+    int chunkMs = getChunkMs();
+    bool behind = senderLoad > kGrowLoad || backlog * 4 > backlogCapacity;
+    bool idle = senderLoad < kShrinkLoad && backlog <= 1;
+
+    if (behind) {
+        idleWindows_ = 0;
+        setChunkMs(std::min(settings_.maxLatencyMs, chunkMs * 2));
+    } else if (idle) {
+        // Shrink slowly so a bursty load does not make us oscillate
+        if (++idleWindows_ >= kShrinkAfterWindows) {
+            idleWindows_ = 0;
+            setChunkMs(std::max(settings_.minLatencyMs, chunkMs / 2));
+        }
+    } else {
+        idleWindows_ = 0;
+    }
+}
+
+size_t BatchController::chunkFrames(int sampleRate) const {
+    long long frames = static_cast<long long>(sampleRate) * getChunkMs() / 1000;
+    return static_cast<size_t>(std::max(1LL, frames));
+}
+
+void BatchController::setChunkMs(int chunkMs) {
+    chunkMs_.store(chunkMs, std::memory_order_relaxed);
+    // Wake often enough that a partly filled message is not held much past its deadline
+    flushIntervalMs_.store(std::max(1, chunkMs / 4), std::memory_order_relaxed);
+}
@@ -0,0 +1,187 @@
+#include "realtime_memory.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+std::atomic<bool> gHugePages(false);
+std::atomic<bool> gLocked(false);
+std::atomic<size_t> gBufferBytes(0);
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Lock pages the capture path touches once lockAll() is in effect; warns once on failure
+void lockRange(void* start, size_t bytes) {
+    static std::atomic<bool> warned(false);
+    if (!gLocked || mlock(start, bytes) == 0) {
+        return;
+    }
+    if (!warned.exchange(true)) {
+        std::cerr << "Failed to lock capture memory: " << std::strerror(errno)
+                  << " (raise RLIMIT_MEMLOCK, e.g. 'ulimit -l unlimited', or grant CAP_IPC_LOCK)" << std::endl;
+    }
+}
+
+} // namespace
+
+RealtimeBuffer::RealtimeBuffer(size_t bytes)
+    : data_(nullptr),
+      size_(bytes),
+      mappedSize_(0),
+      hugePages_(false) {
+
+    if (bytes == 0) {
+        return;
+    }
+
+    void* memory = MAP_FAILED;
+    bool wantHugePages = gHugePages.load() && bytes >= kHugePageSize;
+
+#if defined(MAP_HUGETLB)
+    // Explicit huge pages only work when the admin has reserved some (vm.nr_hugepages)
+    if (wantHugePages) {
+        mappedSize_ = roundUp(bytes, kHugePageSize);
+        memory = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        hugePages_ = (memory != MAP_FAILED);
+    }
+#endif
+
+    if (memory == MAP_FAILED) {
+        mappedSize_ = roundUp(bytes, wantHugePages ? kHugePageSize : pageSize());
+        memory = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+#if defined(MADV_HUGEPAGE)
+        // Fall back to transparent huge pages
+        if (wantHugePages) {
+            madvise(memory, mappedSize_, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    data_ = static_cast<uint8_t*>(memory);
+
+    // Fault every page in now rather than on the capture thread
+    size_t step = hugePages_ ? kHugePageSize : pageSize();
+    for (size_t offset = 0; offset < mappedSize_; offset += step) {
+        static_cast<volatile uint8_t*>(data_)[offset] = 0;
+    }
+    lockRange(data_, mappedSize_);
+
+    gBufferBytes.fetch_add(mappedSize_);
+}
+
+RealtimeBuffer::~RealtimeBuffer() {
+    release();
+}
+
+RealtimeBuffer::RealtimeBuffer(RealtimeBuffer&& other) noexcept
+    : data_(other.data_),
+      size_(other.size_),
+      mappedSize_(other.mappedSize_),
+      hugePages_(other.hugePages_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.mappedSize_ = 0;
+    other.hugePages_ = false;
+}
+
+RealtimeBuffer& RealtimeBuffer::operator=(RealtimeBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = other.data_;
+        size_ = other.size_;
+        mappedSize_ = other.mappedSize_;
+        hugePages_ = other.hugePages_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mappedSize_ = 0;
+        other.hugePages_ = false;
+    }
+    return *this;
+}
+
+void RealtimeBuffer::release() {
+    if (data_) {
+        munmap(data_, mappedSize_);
+        gBufferBytes.fetch_sub(mappedSize_);
+        data_ = nullptr;
+    }
+}
+
+void RealtimeMemory::setHugePages(bool enabled) {
+    gHugePages = enabled;
+}
+
+bool RealtimeMemory::getHugePages() {
+    return gHugePages;
+}
+
+bool RealtimeMemory::lockAll() {
+    if (mlockall(MCL_CURRENT) != 0) {
+        std::cerr << "Failed to lock process memory: " << std::strerror(errno)
+                  << " (raise RLIMIT_MEMLOCK, e.g. 'ulimit -l unlimited', or grant CAP_IPC_LOCK)" << std::endl;
+        return false;
+    }
+
+    gLocked = true;
+    return true;
+}
+
+bool RealtimeMemory::isLocked() {
+    return gLocked;
+}
+
+void RealtimeMemory::prefaultStack() {
+    uint8_t stack[kStackPrefaultBytes];
+    volatile uint8_t* touch = stack;  // Writes through volatile are not optimized away
+    for (size_t offset = 0; offset < kStackPrefaultBytes; offset += pageSize()) {
+        touch[offset] = 0;
+    }
+
+    // Whole pages inside the array
+    uintptr_t first = roundUp(reinterpret_cast<uintptr_t>(stack), pageSize());
+    uintptr_t last = (reinterpret_cast<uintptr_t>(stack) + kStackPrefaultBytes) / pageSize() * pageSize();
+    if (last > first) {
+        lockRange(reinterpret_cast<void*>(first), last - first);
+    }
+}
+
+size_t RealtimeMemory::getBufferBytes() {
+    return gBufferBytes;
+}
+
+size_t RealtimeMemory::getLockedBytes() {
+    // "VmLck:     1234 kB"
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmLck:") == 0) {
+            try {
+                return std::stoull(line.substr(6)) * 1024;
+            } catch (...) {
+                return 0;
+            }
+        }
+    }
+    return 0;
+}
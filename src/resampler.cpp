@@ -0,0 +1,205 @@
+#include "resampler.hpp"
+#include "cpu_features.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TESSA_X86_KERNELS 1
+#define TESSA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kStopbandDb = 80.0;
+
+// Dot product of count floats, count a multiple of 8
+using DotFn = float (*)(const float* a, const float* b, size_t count);
+
+float dotScalar(const float* a, const float* b, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if defined(TESSA_X86_KERNELS)
+
+float dotSse2(const float* a, const float* b, size_t count) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (size_t i = 0; i < count; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+TESSA_TARGET_AVX2 float dotAvx2(const float* a, const float* b, size_t count) {
+    __m256 sum = _mm256_setzero_ps();
+    for (size_t i = 0; i < count; i += 8) {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    return _mm_cvtss_f32(half);
+}
+
+#endif // TESSA_X86_KERNELS
+
+DotFn selectDot() {
+#if defined(TESSA_X86_KERNELS)
+    switch (getSimdLevel()) {
+        case SimdLevel::Avx2:
+            return dotAvx2;
+        case SimdLevel::Sse2:
+            return dotSse2;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return dotScalar;
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+} // namespace
+
+Resampler::Resampler(int inputRate, int outputRate, int channels, int zeroCrossings)
+    : inputRate_(inputRate),
+      outputRate_(outputRate),
+      channels_(std::max(1, channels)),
+      taps_(8),
+      phases_(1),
+      interpolate_(false),
+      position_(0),
+      phase_(0),
+      outputFrames_(0) {
+
+    uint64_t divisor = std::gcd(static_cast<uint64_t>(inputRate), static_cast<uint64_t>(outputRate));
+    up_ = static_cast<uint64_t>(outputRate) / divisor;
+    down_ = static_cast<uint64_t>(inputRate) / divisor;
+
+    buildFilters(zeroCrossings);
+    reset();
+}
+
+void Resampler::buildFilters(int zeroCrossings) {
+    // Filter length in input samples: the sinc stretches when the output rate is lower
+    const double ratio = std::min(1.0, static_cast<double>(outputRate_) / inputRate_);
+    int halfTaps = static_cast<int>(std::ceil(zeroCrossings / ratio));
+    taps_ = (2 * halfTaps + 7) / 8 * 8;
+    const int half = taps_ / 2;
+
+    // Put the transition band just below the lower Nyquist rate (Kaiser design formulas)
+    const double transition = (kStopbandDb - 7.95) / (14.36 * taps_);
+    const double cutoff = std::max(0.05 * ratio, 0.5 * ratio - transition / 2.0);
+    const double beta = 0.1102 * (kStopbandDb - 8.7);
+    const double window = besselI0(beta);
+
+    interpolate_ = up_ > static_cast<uint64_t>(kMaxPhases);
+    phases_ = interpolate_ ? kMaxPhases : static_cast<int>(up_);
+
+    // Row p delays by p / phases_ of an input sample; sample k of the window sits at
+    // t = frac + half - 1 - k from the output
+    filters_.assign(static_cast<size_t>(phases_ + 1) * taps_, 0.0f);
+    for (int p = 0; p <= phases_; ++p) {
+        const double frac = static_cast<double>(p) / phases_;
+        float* row = &filters_[static_cast<size_t>(p) * taps_];
+        double sum = 0.0;
+        std::vector<double> coefficients(taps_);
+        for (int k = 0; k < taps_; ++k) {
+            double t = frac + half - 1 - k;
+            double x = t / half;
+            if (std::fabs(x) >= 1.0) {
+                continue;
+            }
+            double argument = 2.0 * cutoff * t;
+            double sinc = std::fabs(argument) < 1e-12 ? 1.0 : std::sin(kPi * argument) / (kPi * argument);
+            coefficients[k] = 2.0 * cutoff * sinc * besselI0(beta * std::sqrt(1.0 - x * x)) / window;
+            sum += coefficients[k];
+        }
+        // Unity gain at DC for every phase
+        for (int k = 0; k < taps_; ++k) {
+            row[k] = static_cast<float>(coefficients[k] / sum);
+        }
+    }
+}
+
+void Resampler::reset() {
+    history_.assign(channels_, std::vector<float>(taps_ - 1, 0.0f));
+    position_ = taps_ - 1;  // The first input sample
+    phase_ = 0;
+}
+
+size_t Resampler::process(const float* input, size_t frames, std::vector<float>& output, double& firstOutputOffset) {
+    const size_t historyLength = taps_ - 1;
+    const size_t half = taps_ / 2;
+
+    // Plan the outputs this input completes; each needs input up to position + half
+    schedule_.clear();
+    uint64_t position = position_;
+    uint64_t phase = phase_;
+    while (position + half <= historyLength + frames - 1) {
+        schedule_.push_back({static_cast<size_t>(position - half + 1), phase});
+        phase += down_;
+        position += phase / up_;
+        phase %= up_;
+    }
+
+    firstOutputOffset = static_cast<double>(position_) - static_cast<double>(historyLength) +
+                        static_cast<double>(phase_) / static_cast<double>(up_);
+
+    const size_t count = schedule_.size();
+    output.resize(count * channels_);
+    const DotFn dot = selectDot();
+
+    for (int channel = 0; channel < channels_; ++channel) {
+        std::vector<float>& buffer = history_[channel];
+        buffer.resize(historyLength);
+        buffer.insert(buffer.end(), input + channel * frames, input + (channel + 1) * frames);
+
+        float* out = output.data() + channel * count;
+        for (size_t n = 0; n < count; ++n) {
+            const float* samples = buffer.data() + schedule_[n].first;
+            const uint64_t outputPhase = schedule_[n].second;
+            if (!interpolate_) {
+                out[n] = dot(samples, &filters_[outputPhase * taps_], taps_);
+            } else {
+                double f = static_cast<double>(outputPhase) * phases_ / static_cast<double>(up_);
+                size_t row = static_cast<size_t>(f);
+                float weight = static_cast<float>(f - row);
+                float lower = dot(samples, &filters_[row * taps_], taps_);
+                float upper = dot(samples, &filters_[(row + 1) * taps_], taps_);
+                out[n] = lower + weight * (upper - lower);
+            }
+        }
+
+        // Keep the newest taps - 1 samples for the next call
+        buffer.erase(buffer.begin(), buffer.end() - historyLength);
+    }
+
+    position_ = position - frames;
+    phase_ = phase;
+    outputFrames_ += count;
+    return count;
+}
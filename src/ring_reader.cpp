@@ -0,0 +1,83 @@
+#include "ring_reader.hpp"
+#include "audio_source.hpp"
+
+RingReader::RingReader(const std::string& threadName, size_t chunkBytes, std::chrono::milliseconds interval,
+                       bool fromOldest)
+    : threadName_(threadName),
+      chunkBytes_(chunkBytes),
+      interval_(interval),
+      fromOldest_(fromOldest),
+      running_(false),
+      processNs_(0) {
+}
+
+RingReader::~RingReader() {
+    stop();
+}
+
+bool RingReader::start(std::shared_ptr<AudioSource> source) {
+    if (running_) {
+        return true;
+    }
+    if (!source) {
+        return false;
+    }
+
+    source_ = source;
+    running_ = true;
+    readThread_ = std::thread(&RingReader::readLoop, this);
+    return true;
+}
+
+void RingReader::stop() {
+    if (!running_) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        running_ = false;
+    }
+    wakeCondition_.notify_all();
+
+    if (readThread_.joinable()) {
+        readThread_.join();
+    }
+}
+
+void RingReader::readLoop() {
+    if (!threadSchedule_.isDefault()) {
+        threadSchedule_.applyToCurrentThread(threadName_);
+    }
+    recordThreadSchedule(threadName_);
+
+    std::shared_ptr<AudioBuffer> buffer;
+    ReadCursor cursor;
+    bool configured = false;
+
+    while (running_) {
+        // The source replaces its ring when its format changes
+        std::shared_ptr<AudioBuffer> current = source_->getAudioBuffer();
+        if (current != buffer) {
+            buffer = current;
+            cursor = buffer->createCursor(fromOldest_);
+            configured = onRing(*source_);
+        }
+
+        ReadResult chunk = buffer->read(cursor, chunkBytes_);
+        while (configured && !chunk.data.empty()) {
+            auto start = std::chrono::steady_clock::now();
+            onChunk(chunk);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            processNs_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                 std::memory_order_relaxed);
+            chunk = buffer->read(cursor, chunkBytes_);
+        }
+        onCaughtUp(false);
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wakeCondition_.wait_for(lock, interval_, [this] { return !running_; });
+    }
+
+    onCaughtUp(true);
+}
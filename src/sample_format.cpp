@@ -0,0 +1,585 @@
+#include "sample_format.hpp"
+#include "cpu_features.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define TESSA_X86_KERNELS 1
+#define TESSA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+// Every conversion goes through left-justified int32 (integers) or float, so each format
+// needs one kernel in each direction instead of one per pair
+using WidenFn = void (*)(const uint8_t* src, int32_t* dst, size_t count);
+using NarrowFn = void (*)(const int32_t* src, uint8_t* dst, size_t count);
+using ToFloatFn = void (*)(const int32_t* src, float* dst, size_t count);
+using FromFloatFn = void (*)(const float* src, int32_t* dst, size_t count);
+
+struct Kernels {
+    WidenFn widen8;
+    WidenFn widen16;
+    WidenFn widen24;
+    NarrowFn narrow8;
+    NarrowFn narrow16;
+    NarrowFn narrow24;
+    ToFloatFn toFloat;
+    FromFloatFn fromFloat;
+};
+
+constexpr float kToFloatScale = 1.0f / 2147483648.0f;
+constexpr float kFromFloatScale = 2147483648.0f;
+constexpr float kFloatMax = 2147483520.0f;  // Largest float below 2^31
+constexpr float kFloatMin = -2147483648.0f;
+
+// Samples converted per pass through the intermediate buffer
+constexpr size_t kChunkSamples = 1024;
+
+// Scalar kernels, also used for the tails the vector kernels leave
+
+void widen8Scalar(const uint8_t* src, int32_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<int32_t>(static_cast<uint32_t>(src[i]) << 24);
+    }
+}
+
+void widen16Scalar(const uint8_t* src, int32_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t sample = static_cast<uint32_t>(src[2 * i]) | (static_cast<uint32_t>(src[2 * i + 1]) << 8);
+        dst[i] = static_cast<int32_t>(sample << 16);
+    }
+}
+
+void widen24Scalar(const uint8_t* src, int32_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* s = src + 3 * i;
+        uint32_t sample = (static_cast<uint32_t>(s[0]) << 8) |
+                          (static_cast<uint32_t>(s[1]) << 16) |
+                          (static_cast<uint32_t>(s[2]) << 24);
+        dst[i] = static_cast<int32_t>(sample);
+    }
+}
+
+// x >> shift rounded to nearest, saturated to the narrow range
+inline int32_t roundShift(int32_t x, int shift) {
+    int32_t rounded = ((x >> (shift - 1)) + 1) >> 1;
+    int32_t maxValue = static_cast<int32_t>((1u << (31 - shift)) - 1);
+    return std::min(rounded, maxValue);
+}
+
+void narrow8Scalar(const int32_t* src, uint8_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<uint8_t>(roundShift(src[i], 24));
+    }
+}
+
+void narrow16Scalar(const int32_t* src, uint8_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t sample = static_cast<uint32_t>(roundShift(src[i], 16));
+        dst[2 * i] = static_cast<uint8_t>(sample);
+        dst[2 * i + 1] = static_cast<uint8_t>(sample >> 8);
+    }
+}
+
+void narrow24Scalar(const int32_t* src, uint8_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t sample = static_cast<uint32_t>(roundShift(src[i], 8));
+        dst[3 * i] = static_cast<uint8_t>(sample);
+        dst[3 * i + 1] = static_cast<uint8_t>(sample >> 8);
+        dst[3 * i + 2] = static_cast<uint8_t>(sample >> 16);
+    }
+}
+
+void toFloatScalar(const int32_t* src, float* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<float>(src[i]) * kToFloatScale;
+    }
+}
+
+void fromFloatScalar(const float* src, int32_t* dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        float value = src[i] * kFromFloatScale;
+        // Written so NaN ends up at the maximum, as with the vector min/max
+        if (!(value < kFloatMax)) {
+            value = kFloatMax;
+        }
+        if (value < kFloatMin) {
+            value = kFloatMin;
+        }
+        dst[i] = static_cast<int32_t>(std::lrintf(value));
+    }
+}
+
+const Kernels kScalarKernels = {
+    widen8Scalar, widen16Scalar, widen24Scalar,
+    narrow8Scalar, narrow16Scalar, narrow24Scalar,
+    toFloatScalar, fromFloatScalar
+};
+
+#if defined(TESSA_X86_KERNELS)
+
+// SSE2 (x86-64 baseline). No byte shuffle before SSSE3, so 24-bit stays scalar.
+
+void widen8Sse2(const uint8_t* src, int32_t* dst, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_unpacklo_epi8(zero, bytes);  // Sample << 8 in 16-bit lanes
+        __m128i hi = _mm_unpackhi_epi8(zero, bytes);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(zero, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(zero, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpacklo_epi16(zero, hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 12), _mm_unpackhi_epi16(zero, hi));
+    }
+    widen8Scalar(src + i, dst + i, count - i);
+}
+
+void widen16Sse2(const uint8_t* src, int32_t* dst, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(zero, samples));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(zero, samples));
+    }
+    widen16Scalar(src + 2 * i, dst + i, count - i);
+}
+
+// Rounded x >> shift (shift >= 2), as roundShift before saturation
+inline __m128i roundShiftSse2(__m128i x, int shift) {
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i partial = _mm_sra_epi32(x, _mm_cvtsi32_si128(shift - 1));
+    return _mm_srai_epi32(_mm_add_epi32(partial, one), 1);
+}
+
+void narrow8Sse2(const int32_t* src, uint8_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = roundShiftSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), 24);
+        __m128i b = roundShiftSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4)), 24);
+        __m128i c = roundShiftSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8)), 24);
+        __m128i d = roundShiftSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 12)), 24);
+        // The packs saturate 128 (rounded up from the top) to 127
+        __m128i packed = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+    }
+    narrow8Scalar(src + i, dst + i, count - i);
+}
+
+void narrow16Sse2(const int32_t* src, uint8_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = roundShiftSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), 16);
+        __m128i b = roundShiftSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4)), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_packs_epi32(a, b));
+    }
+    narrow16Scalar(src + i, dst + 2 * i, count - i);
+}
+
+void toFloatSse2(const int32_t* src, float* dst, size_t count) {
+    const __m128 scale = _mm_set1_ps(kToFloatScale);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+    toFloatScalar(src + i, dst + i, count - i);
+}
+
+void fromFloatSse2(const float* src, int32_t* dst, size_t count) {
+    const __m128 scale = _mm_set1_ps(kFromFloatScale);
+    const __m128 maxValue = _mm_set1_ps(kFloatMax);
+    const __m128 minValue = _mm_set1_ps(kFloatMin);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 value = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        value = _mm_max_ps(_mm_min_ps(value, maxValue), minValue);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_cvtps_epi32(value));
+    }
+    fromFloatScalar(src + i, dst + i, count - i);
+}
+
+const Kernels kSse2Kernels = {
+    widen8Sse2, widen16Sse2, widen24Scalar,
+    narrow8Sse2, narrow16Sse2, narrow24Scalar,
+    toFloatSse2, fromFloatSse2
+};
+
+// AVX2
+
+TESSA_TARGET_AVX2 void widen8Avx2(const uint8_t* src, int32_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        __m256i samples = _mm256_slli_epi32(_mm256_cvtepi8_epi32(bytes), 24);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), samples);
+    }
+    widen8Scalar(src + i, dst + i, count - i);
+}
+
+TESSA_TARGET_AVX2 void widen16Avx2(const uint8_t* src, int32_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+        __m256i samples = _mm256_slli_epi32(_mm256_cvtepi16_epi32(halves), 16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), samples);
+    }
+    widen16Scalar(src + 2 * i, dst + i, count - i);
+}
+
+TESSA_TARGET_AVX2 void widen24Avx2(const uint8_t* src, int32_t* dst, size_t count) {
+    // Each 128-bit lane takes four packed samples (12 bytes) and spreads them into the top
+    // three bytes of four int32s; -1 zeroes the low byte
+    const __m256i spread = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    size_t i = 0;
+    // The second load reads 4 bytes past the 8 samples, so stop early enough to stay in bounds
+    for (; i + 10 <= count; i += 8) {
+        const uint8_t* s = src + 3 * i;
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12));
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(bytes, spread));
+    }
+    widen24Scalar(src + 3 * i, dst + i, count - i);
+}
+
+TESSA_TARGET_AVX2 inline __m256i roundShiftAvx2(__m256i x, int shift) {
+    const __m256i one = _mm256_set1_epi32(1);
+    __m256i partial = _mm256_sra_epi32(x, _mm_cvtsi32_si128(shift - 1));
+    return _mm256_srai_epi32(_mm256_add_epi32(partial, one), 1);
+}
+
+TESSA_TARGET_AVX2 void narrow8Avx2(const int32_t* src, uint8_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = roundShiftAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), 24);
+        __m256i b = roundShiftAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 8)), 24);
+        __m256i c = roundShiftAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16)), 24);
+        __m256i d = roundShiftAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 24)), 24);
+        // Packs work within 128-bit lanes; the permutes put the 64-bit groups back in order
+        __m256i ab = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i cd = _mm256_permute4x64_epi64(_mm256_packs_epi32(c, d), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(ab, cd), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    narrow8Scalar(src + i, dst + i, count - i);
+}
+
+TESSA_TARGET_AVX2 void narrow16Avx2(const int32_t* src, uint8_t* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = roundShiftAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), 16);
+        __m256i b = roundShiftAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 8)), 16);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), packed);
+    }
+    narrow16Scalar(src + i, dst + 2 * i, count - i);
+}
+
+TESSA_TARGET_AVX2 void narrow24Avx2(const int32_t* src, uint8_t* dst, size_t count) {
+    // Inverse of widen24Avx2: keep bytes 0-2 of each rounded int32, packed into 12 bytes per lane
+    const __m256i gather = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i maxValue = _mm256_set1_epi32(0x7FFFFF);
+    size_t i = 0;
+    // Each lane stores 16 bytes of which 12 are ours, so leave room for the 4 extra
+    for (; i + 10 <= count; i += 8) {
+        __m256i samples = roundShiftAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), 8);
+        samples = _mm256_min_epi32(samples, maxValue);
+        __m256i packed = _mm256_shuffle_epi8(samples, gather);
+        uint8_t* d = dst + 3 * i;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d), _mm256_castsi256_si128(packed));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(d + 12), _mm256_extracti128_si256(packed, 1));
+    }
+    narrow24Scalar(src + i, dst + 3 * i, count - i);
+}
+
+TESSA_TARGET_AVX2 void toFloatAvx2(const int32_t* src, float* dst, size_t count) {
+    const __m256 scale = _mm256_set1_ps(kToFloatScale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i samples = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale));
+    }
+    toFloatScalar(src + i, dst + i, count - i);
+}
+
+TESSA_TARGET_AVX2 void fromFloatAvx2(const float* src, int32_t* dst, size_t count) {
+    const __m256 scale = _mm256_set1_ps(kFromFloatScale);
+    const __m256 maxValue = _mm256_set1_ps(kFloatMax);
+    const __m256 minValue = _mm256_set1_ps(kFloatMin);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 value = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        value = _mm256_max_ps(_mm256_min_ps(value, maxValue), minValue);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtps_epi32(value));
+    }
+    fromFloatScalar(src + i, dst + i, count - i);
+}
+
+const Kernels kAvx2Kernels = {
+    widen8Avx2, widen16Avx2, widen24Avx2,
+    narrow8Avx2, narrow16Avx2, narrow24Avx2,
+    toFloatAvx2, fromFloatAvx2
+};
+
+#endif // TESSA_X86_KERNELS
+
+const Kernels& activeKernels() {
+#if defined(TESSA_X86_KERNELS)
+    switch (getSimdLevel()) {
+        case SimdLevel::Avx2:
+            return kAvx2Kernels;
+        case SimdLevel::Sse2:
+            return kSse2Kernels;
+        case SimdLevel::Scalar:
+            break;
+    }
+#endif
+    return kScalarKernels;
+}
+
+WidenFn widenFor(const Kernels& kernels, SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Int8:
+            return kernels.widen8;
+        case SampleFormat::Int16:
+            return kernels.widen16;
+        case SampleFormat::Int24:
+            return kernels.widen24;
+        default:
+            return nullptr;
+    }
+}
+
+NarrowFn narrowFor(const Kernels& kernels, SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Int8:
+            return kernels.narrow8;
+        case SampleFormat::Int16:
+            return kernels.narrow16;
+        case SampleFormat::Int24:
+            return kernels.narrow24;
+        default:
+            return nullptr;
+    }
+}
+
+// Move samples of `bytes` each between interleaved and planar order
+template <size_t bytes>
+void reorderSamples(const uint8_t* src, uint8_t* dst, size_t frames, int channels, bool toPlanar) {
+    for (int channel = 0; channel < channels; ++channel) {
+        for (size_t frame = 0; frame < frames; ++frame) {
+            size_t interleaved = (frame * channels + channel) * bytes;
+            size_t planar = (channel * frames + frame) * bytes;
+            if (toPlanar) {
+                std::memcpy(dst + planar, src + interleaved, bytes);
+            } else {
+                std::memcpy(dst + interleaved, src + planar, bytes);
+            }
+        }
+    }
+}
+
+void reorder(const uint8_t* src, uint8_t* dst, size_t sampleBytes, size_t frames, int channels, bool toPlanar) {
+    switch (sampleBytes) {
+        case 1:
+            reorderSamples<1>(src, dst, frames, channels, toPlanar);
+            break;
+        case 2:
+            reorderSamples<2>(src, dst, frames, channels, toPlanar);
+            break;
+        case 3:
+            reorderSamples<3>(src, dst, frames, channels, toPlanar);
+            break;
+        default:
+            reorderSamples<4>(src, dst, frames, channels, toPlanar);
+            break;
+    }
+}
+
+} // namespace
+
+void convertSamples(const void* src, SampleFormat from, void* dst, SampleFormat to, size_t count) {
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    uint8_t* out = static_cast<uint8_t*>(dst);
+
+    if (from == to) {
+        std::memcpy(out, in, count * SampleSpec::sampleBytes(from));
+        return;
+    }
+
+    const Kernels& kernels = activeKernels();
+    const size_t inBytes = SampleSpec::sampleBytes(from);
+    const size_t outBytes = SampleSpec::sampleBytes(to);
+
+    // Left-justified int32 (or float, from float input) between the two kernels
+    alignas(32) int32_t intermediate[kChunkSamples];
+
+    for (size_t done = 0; done < count; done += kChunkSamples) {
+        size_t n = std::min(kChunkSamples, count - done);
+        const uint8_t* s = in + done * inBytes;
+        uint8_t* d = out + done * outBytes;
+
+        if (from == SampleFormat::Float32) {
+            const float* samples = reinterpret_cast<const float*>(s);
+            if (to == SampleFormat::Int32) {
+                kernels.fromFloat(samples, reinterpret_cast<int32_t*>(d), n);
+            } else {
+                kernels.fromFloat(samples, intermediate, n);
+                narrowFor(kernels, to)(intermediate, d, n);
+            }
+            continue;
+        }
+
+        // Integer input: widen unless it already is int32
+        const int32_t* ints = reinterpret_cast<const int32_t*>(s);
+        if (from != SampleFormat::Int32) {
+            int32_t* target = (to == SampleFormat::Int32) ? reinterpret_cast<int32_t*>(d) : intermediate;
+            widenFor(kernels, from)(s, target, n);
+            if (to == SampleFormat::Int32) {
+                continue;
+            }
+            ints = intermediate;
+        }
+
+        if (to == SampleFormat::Float32) {
+            kernels.toFloat(ints, reinterpret_cast<float*>(d), n);
+        } else {
+            narrowFor(kernels, to)(ints, d, n);
+        }
+    }
+}
+
+bool SampleSpec::parse(const std::string& spec, SampleSpec& sampleSpec) {
+    std::string name = spec;
+    SampleLayout layout = SampleLayout::Interleaved;
+
+    size_t colon = spec.find(':');
+    if (colon != std::string::npos) {
+        name = spec.substr(0, colon);
+        std::string layoutName = spec.substr(colon + 1);
+        if (layoutName == "planar") {
+            layout = SampleLayout::Planar;
+        } else if (layoutName != "interleaved") {
+            std::cerr << "Unknown sample layout '" << layoutName << "' (expected interleaved or planar)" << std::endl;
+            return false;
+        }
+    }
+
+    SampleFormat format;
+    if (name == "int8") {
+        format = SampleFormat::Int8;
+    } else if (name == "int16") {
+        format = SampleFormat::Int16;
+    } else if (name == "int24") {
+        format = SampleFormat::Int24;
+    } else if (name == "int32") {
+        format = SampleFormat::Int32;
+    } else if (name == "float32") {
+        format = SampleFormat::Float32;
+    } else {
+        std::cerr << "Unknown sample format '" << name << "' (expected int8, int16, int24, int32 or float32)" << std::endl;
+        return false;
+    }
+
+    sampleSpec.format = format;
+    sampleSpec.layout = layout;
+    return true;
+}
+
+std::string SampleSpec::toString() const {
+    std::string name = formatName(format);
+    if (layout == SampleLayout::Planar) {
+        name += ":planar";
+    }
+    return name;
+}
+
+bool SampleSpec::fromBitDepth(int bitDepth, SampleSpec& sampleSpec) {
+    switch (bitDepth) {
+        case 8:
+            sampleSpec.format = SampleFormat::Int8;
+            break;
+        case 16:
+            sampleSpec.format = SampleFormat::Int16;
+            break;
+        case 24:
+            sampleSpec.format = SampleFormat::Int24;
+            break;
+        case 32:
+            sampleSpec.format = SampleFormat::Int32;
+            break;
+        default:
+            std::cerr << "Unsupported bit depth: " << bitDepth << std::endl;
+            return false;
+    }
+    sampleSpec.layout = SampleLayout::Interleaved;
+    return true;
+}
+
+size_t SampleSpec::sampleBytes(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Int8:
+            return 1;
+        case SampleFormat::Int16:
+            return 2;
+        case SampleFormat::Int24:
+            return 3;
+        case SampleFormat::Int32:
+        case SampleFormat::Float32:
+            return 4;
+    }
+    return 0;
+}
+
+std::string SampleSpec::formatName(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Int8:
+            return "int8";
+        case SampleFormat::Int16:
+            return "int16";
+        case SampleFormat::Int24:
+            return "int24";
+        case SampleFormat::Int32:
+            return "int32";
+        case SampleFormat::Float32:
+            return "float32";
+    }
+    return "unknown";
+}
+
+SampleConverter::SampleConverter(const SampleSpec& from, const SampleSpec& to, int channels)
+    : from_(from),
+      to_(to),
+      channels_(std::max(1, channels)) {
+}
+
+size_t SampleConverter::outputBytes(size_t inputBytes) const {
+    return inputBytes / from_.bytesPerSample() * to_.bytesPerSample();
+}
+
+void SampleConverter::convert(const void* src, size_t inputBytes, void* dst) {
+    const size_t samples = inputBytes / from_.bytesPerSample();
+    const size_t frames = samples / channels_;
+
+    if (from_.layout == to_.layout || channels_ == 1) {
+        convertSamples(src, from_.format, dst, to_.format, samples);
+        return;
+    }
+
+    // Change the format in the source layout, then move the samples into place
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    scratch_.resize(samples * to_.bytesPerSample());
+    convertSamples(in, from_.format, scratch_.data(), to_.format, samples);
+    reorder(scratch_.data(), static_cast<uint8_t*>(dst), to_.bytesPerSample(), frames, channels_,
+            to_.layout == SampleLayout::Planar);
+}
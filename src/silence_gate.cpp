@@ -0,0 +1,207 @@
+#include "silence_gate.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+size_t framesIn(int sampleRate, int ms) {
+    return static_cast<size_t>(sampleRate) * static_cast<size_t>(ms) / 1000;
+}
+
+} // namespace
+
+bool GateSettings::parse(const std::string& spec, GateSettings& settings) {
+    const char* usage = "(expected <threshold_db>[:<hangover_ms>[:<preroll_ms>]])";
+    GateSettings parsed;
+    try {
+        std::istringstream fields(spec);
+        std::string field;
+        for (int i = 0; std::getline(fields, field, ':'); ++i) {
+            size_t used = 0;
+            if (i == 0) {
+                parsed.thresholdDb = std::stod(field, &used);
+            } else if (i == 1) {
+                parsed.hangoverMs = std::stoi(field, &used);
+            } else if (i == 2) {
+                parsed.preRollMs = std::stoi(field, &used);
+            }
+            if (i > 2 || used != field.size()) {
+                throw std::invalid_argument(spec);
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid silence gate '" << spec << "' " << usage << std::endl;
+        return false;
+    }
+
+    if (spec.empty() || parsed.thresholdDb < SilenceGate::kMinLevelDb || parsed.thresholdDb > 0.0 ||
+        parsed.hangoverMs < 0 || parsed.hangoverMs > 10000 || parsed.preRollMs < 0 || parsed.preRollMs > 10000) {
+        std::cerr << "Silence gate needs a threshold of -120..0 dBFS and hangover and pre-roll of 0..10000 ms, got '"
+                  << spec << "'" << std::endl;
+        return false;
+    }
+
+    parsed.enabled = true;
+    settings = parsed;
+    return true;
+}
+
+std::string GateSettings::toString() const {
+    if (!enabled) {
+        return "off";
+    }
+    std::ostringstream ss;
+    ss << thresholdDb << " dBFS, " << hangoverMs << "ms hangover, " << preRollMs << "ms pre-roll";
+    return ss.str();
+}
+
+SilenceGate::SilenceGate(const GateSettings& settings)
+    : settings_(settings),
+      open_(false),
+      hangoverLeft_(0),
+      heldFrames_(0),
+      markerFrames_(0),
+      floorDb_(settings.thresholdDb - kNoiseMarginDb),
+      levelDb_(kMinLevelDb),
+      noiseFloorDb_(settings.thresholdDb - kNoiseMarginDb),
+      framesPassed_(0),
+      framesSuppressed_(0) {
+}
+
+void SilenceGate::process(const uint8_t* data, size_t bytes, size_t frames, const SampleSpec& spec, int sampleRate,
+                          const std::map<std::string, nlohmann::json>& metadata, std::vector<Output>& outputs) {
+    outputs.clear();
+    for (Held& held : released_) {
+        spare_.push_back(std::move(held));
+    }
+    released_.clear();
+
+    if (!isActive(data, frames, spec, bytes / spec.bytesPerSample(), sampleRate)) {
+        if (open_.load(std::memory_order_relaxed)) {
+            if (hangoverLeft_ > 0) {
+                hangoverLeft_ -= std::min(hangoverLeft_, frames);
+                emitAudio(data, bytes, frames, metadata, outputs);
+                return;
+            }
+            open_.store(false, std::memory_order_relaxed);
+        }
+
+        // Closed: keep a copy as pre-roll; what falls out of it is silence
+        Held held;
+        if (!spare_.empty()) {
+            held = std::move(spare_.back());
+            spare_.pop_back();
+        }
+        held.data.assign(data, data + bytes);
+        held.frames = frames;
+        held.metadata = metadata;
+        held_.push_back(std::move(held));
+        heldFrames_ += frames;
+
+        const size_t preRollFrames = framesIn(sampleRate, settings_.preRollMs);
+        while (heldFrames_ > preRollFrames) {
+            heldFrames_ -= held_.front().frames;
+            foldIntoMarker(held_.front(), sampleRate, outputs);
+            spare_.push_back(std::move(held_.front()));
+            held_.pop_front();
+        }
+        return;
+    }
+
+    // Onset: close the silent span, then send the pre-roll ahead of this message
+    if (!open_.load(std::memory_order_relaxed)) {
+        emitMarker(outputs);
+        for (Held& held : held_) {
+            emitAudio(held.data.data(), held.data.size(), held.frames, held.metadata, outputs);
+            released_.push_back(std::move(held));
+        }
+        held_.clear();
+        heldFrames_ = 0;
+        open_.store(true, std::memory_order_relaxed);
+    }
+    hangoverLeft_ = framesIn(sampleRate, settings_.hangoverMs);
+    emitAudio(data, bytes, frames, metadata, outputs);
+}
+
+void SilenceGate::flush(std::vector<Output>& outputs) {
+    outputs.clear();
+    for (Held& held : held_) {
+        // No onset is coming to send it as pre-roll
+        foldIntoMarker(held, 0, outputs);
+        spare_.push_back(std::move(held));
+    }
+    held_.clear();
+    heldFrames_ = 0;
+    emitMarker(outputs);
+}
+
+bool SilenceGate::isActive(const uint8_t* data, size_t frames, const SampleSpec& spec, size_t samples,
+                           int sampleRate) {
+    // Every sample counts alike, so the message is measured as one channel
+    levels_.clear();
+    meter_.measure(data, samples, spec, 1, levels_);
+    const double meanSquare = samples > 0 ? levels_[0].sumSquares / samples : 0.0;
+    const double level = meanSquare > 0.0 ? std::max(kMinLevelDb, 10.0 * std::log10(meanSquare)) : kMinLevelDb;
+    const bool active = level > settings_.thresholdDb && level > floorDb_ + kNoiseMarginDb;
+
+    // The floor follows quieter audio at once and louder audio slowly, so pauses between
+    // words pull it back down while steady noise eventually becomes the floor
+    if (level < floorDb_) {
+        floorDb_ = level;
+    } else if (sampleRate > 0) {
+        floorDb_ = std::min(level, floorDb_ + kFloorRiseDbPerSec * frames / sampleRate);
+    }
+
+    levelDb_.store(level, std::memory_order_relaxed);
+    noiseFloorDb_.store(floorDb_, std::memory_order_relaxed);
+    return active;
+}
+
+void SilenceGate::emitAudio(const uint8_t* data, size_t bytes, size_t frames,
+                            const std::map<std::string, nlohmann::json>& metadata, std::vector<Output>& outputs) {
+    Output output;
+    output.data = data;
+    output.bytes = bytes;
+    output.frames = frames;
+    output.metadata = metadata;
+    outputs.push_back(std::move(output));
+    framesPassed_.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void SilenceGate::foldIntoMarker(Held& held, int sampleRate, std::vector<Output>& outputs) {
+    // A marker covers one contiguous span: lost audio starts a new one that carries the gap
+    if (markerFrames_ > 0 && held.metadata.find("gap") != held.metadata.end()) {
+        emitMarker(outputs);
+    }
+    if (markerFrames_ == 0) {
+        markerMetadata_ = std::move(held.metadata);
+    }
+    markerFrames_ += held.frames;
+    framesSuppressed_.fetch_add(held.frames, std::memory_order_relaxed);
+
+    // Long silences go out as a marker a second, so subscribers can tell quiet from stalled
+    if (sampleRate > 0 && markerFrames_ >= framesIn(sampleRate, kMaxMarkerMs)) {
+        emitMarker(outputs);
+    }
+}
+
+void SilenceGate::emitMarker(std::vector<Output>& outputs) {
+    if (markerFrames_ == 0) {
+        return;
+    }
+
+    Output marker;
+    marker.silence = true;
+    marker.frames = markerFrames_;
+    marker.metadata = std::move(markerMetadata_);
+    marker.metadata.erase("blocks");
+    marker.metadata["frames"] = markerFrames_;
+    marker.metadata["silence"] = true;
+    outputs.push_back(std::move(marker));
+
+    markerMetadata_.clear();
+    markerFrames_ = 0;
+}
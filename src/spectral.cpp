@@ -0,0 +1,319 @@
+#include "spectral.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+size_t nextPowerOfTwo(size_t value) {
+    size_t size = 4;
+    while (size < value) {
+        size <<= 1;
+    }
+    return size;
+}
+
+} // namespace
+
+bool FeatureSettings::parse(const std::string& spec, FeatureSettings& settings) {
+    const char* usage = "(expected <window_ms>:<hop_ms>[:<mel_bands>[:<hann|hamming>]])";
+    FeatureSettings parsed = settings;
+    int fields = 0;
+    try {
+        std::istringstream stream(spec);
+        std::string field;
+        for (; std::getline(stream, field, ':'); ++fields) {
+            size_t used = field.size();
+            if (fields == 0) {
+                parsed.windowMs = std::stoi(field, &used);
+            } else if (fields == 1) {
+                parsed.hopMs = std::stoi(field, &used);
+            } else if (fields == 2) {
+                parsed.melBands = std::stoi(field, &used);
+            } else if (fields == 3 && (field == "hann" || field == "hamming")) {
+                parsed.window = field;
+            } else {
+                throw std::invalid_argument(spec);
+            }
+            if (used != field.size()) {
+                throw std::invalid_argument(spec);
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Invalid feature spec '" << spec << "' " << usage << std::endl;
+        return false;
+    }
+
+    if (fields < 2 || parsed.windowMs < 1 || parsed.windowMs > 1000 || parsed.hopMs < 1 || parsed.hopMs > 1000 ||
+        parsed.melBands < 0 || parsed.melBands > 512) {
+        std::cerr << "Features need window and hop of 1..1000 ms and 0..512 mel bands, got '" << spec << "'"
+                  << std::endl;
+        return false;
+    }
+
+    parsed.enabled = true;
+    settings = parsed;
+    return true;
+}
+
+bool FeatureSettings::parseFormat(const std::string& name, FeatureSettings& settings) {
+    if (name == "float16") {
+        settings.half = true;
+    } else if (name == "float32") {
+        settings.half = false;
+    } else {
+        std::cerr << "Invalid feature format '" << name << "' (expected float16 or float32)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string FeatureSettings::toString() const {
+    if (!enabled) {
+        return "off";
+    }
+    std::ostringstream ss;
+    ss << windowMs << "ms " << window << " every " << hopMs << "ms, ";
+    if (melBands > 0) {
+        ss << melBands << " mel bands";
+    } else {
+        ss << "power spectrum";
+    }
+    ss << ", " << (half ? "float16" : "float32");
+    return ss.str();
+}
+
+RealFft::RealFft(size_t size)
+    : size_(nextPowerOfTwo(size)) {
+
+    const size_t half = size_ / 2;
+    bitReverse_.resize(half);
+    size_t bits = 0;
+    while ((static_cast<size_t>(1) << bits) < half) {
+        ++bits;
+    }
+    for (size_t i = 0; i < half; ++i) {
+        size_t reversed = 0;
+        for (size_t bit = 0; bit < bits; ++bit) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        bitReverse_[i] = reversed;
+    }
+
+    twiddles_.resize(half / 2);
+    for (size_t k = 0; k < twiddles_.size(); ++k) {
+        twiddles_[k] = std::polar(1.0f, static_cast<float>(-2.0 * kPi * k / half));
+    }
+    splitTwiddles_.resize(half + 1);
+    for (size_t k = 0; k <= half; ++k) {
+        splitTwiddles_[k] = std::polar(1.0f, static_cast<float>(-2.0 * kPi * k / size_));
+    }
+    work_.resize(half);
+}
+
+void RealFft::forward(const float* input, std::vector<std::complex<float>>& spectrum) {
+    const size_t half = size_ / 2;
+
+    // Even samples as the real part, odd ones as the imaginary part, in bit-reversed order
+    for (size_t i = 0; i < half; ++i) {
+        work_[bitReverse_[i]] = std::complex<float>(input[2 * i], input[2 * i + 1]);
+    }
+
+    // Iterative radix-2 butterflies
+    for (size_t length = 2; length <= half; length <<= 1) {
+        const size_t stride = half / length;
+        for (size_t start = 0; start < half; start += length) {
+            for (size_t k = 0; k < length / 2; ++k) {
+                const std::complex<float> odd = work_[start + k + length / 2] * twiddles_[k * stride];
+                const std::complex<float> even = work_[start + k];
+                work_[start + k] = even + odd;
+                work_[start + k + length / 2] = even - odd;
+            }
+        }
+    }
+
+    // Separate the spectra of the even and odd samples and combine them
+    spectrum.resize(half + 1);
+    for (size_t k = 0; k <= half; ++k) {
+        const std::complex<float> z = work_[k % half];
+        const std::complex<float> mirror = std::conj(work_[(half - k) % half]);
+        const std::complex<float> even = 0.5f * (z + mirror);
+        const std::complex<float> odd = std::complex<float>(0.0f, -0.5f) * (z - mirror);
+        spectrum[k] = even + splitTwiddles_[k] * odd;
+    }
+}
+
+MelFilterBank::MelFilterBank(int bands, size_t fftSize, int sampleRate) {
+    const size_t bins = fftSize / 2 + 1;
+    const double binHz = static_cast<double>(sampleRate) / fftSize;
+    const double maxMel = hzToMel(sampleRate / 2.0);
+
+    // bands + 2 edges: each filter rises from one edge to the next and falls to the one after
+    std::vector<double> edges(bands + 2);
+    for (int i = 0; i < bands + 2; ++i) {
+        edges[i] = melToHz(maxMel * i / (bands + 1));
+    }
+
+    filters_.resize(bands);
+    for (int band = 0; band < bands; ++band) {
+        const double low = edges[band];
+        const double center = edges[band + 1];
+        const double high = edges[band + 2];
+        Filter& filter = filters_[band];
+        filter.firstBin = static_cast<size_t>(std::ceil(low / binHz));
+        for (size_t bin = filter.firstBin; bin < bins && bin * binHz < high; ++bin) {
+            const double hz = bin * binHz;
+            const double weight = hz <= center ? (hz - low) / (center - low) : (high - hz) / (high - center);
+            filter.weights.push_back(static_cast<float>(std::max(0.0, weight)));
+        }
+    }
+}
+
+void MelFilterBank::apply(const float* power, float* bands) const {
+    for (size_t band = 0; band < filters_.size(); ++band) {
+        const Filter& filter = filters_[band];
+        float sum = 0.0f;
+        for (size_t i = 0; i < filter.weights.size(); ++i) {
+            sum += filter.weights[i] * power[filter.firstBin + i];
+        }
+        bands[band] = sum;
+    }
+}
+
+double MelFilterBank::hzToMel(double hz) {
+    return 2595.0 * std::log10(1.0 + hz / 700.0);
+}
+
+double MelFilterBank::melToHz(double mel) {
+    return 700.0 * (std::pow(10.0, mel / 2595.0) - 1.0);
+}
+
+SpectralAnalyzer::SpectralAnalyzer(const FeatureSettings& settings, int sampleRate)
+    : windowFrames_(std::max<size_t>(1, static_cast<size_t>(sampleRate) * settings.windowMs / 1000)),
+      hopFrames_(std::max<size_t>(1, static_cast<size_t>(sampleRate) * settings.hopMs / 1000)),
+      fft_(windowFrames_),
+      historyStart_(0),
+      nextWindow_(0) {
+
+    const size_t fftSize = fft_.getSize();
+    if (settings.melBands > 0) {
+        melBank_ = std::make_unique<MelFilterBank>(settings.melBands, fftSize, sampleRate);
+        bins_ = static_cast<size_t>(settings.melBands);
+    } else {
+        bins_ = fftSize / 2 + 1;
+    }
+
+    // Periodic window, so overlapping hops of a Hann window sum to a constant
+    const double alpha = settings.window == "hamming" ? 0.54 : 0.5;
+    window_.assign(fftSize, 0.0f);
+    double windowSum = 0.0;
+    for (size_t i = 0; i < windowFrames_; ++i) {
+        window_[i] = static_cast<float>(alpha - (1.0 - alpha) * std::cos(2.0 * kPi * i / windowFrames_));
+        windowSum += window_[i];
+    }
+
+    // A full-scale sine puts amplitude windowSum / 2 into its bin: scale that to power 1
+    powerScale_ = static_cast<float>(4.0 / (windowSum * windowSum));
+
+    frame_.resize(fftSize);
+    power_.resize(fftSize / 2 + 1);
+}
+
+size_t SpectralAnalyzer::process(const float* input, size_t frames, std::vector<float>& features,
+                                 uint64_t& firstWindowStart) {
+    history_.insert(history_.end(), input, input + frames);
+    firstWindowStart = nextWindow_;
+
+    size_t windows = 0;
+    size_t offset = 0;
+    while (true) {
+        // Skip audio before the next window (hops longer than the window leave some unused)
+        if (historyStart_ + offset < nextWindow_) {
+            offset = std::min<size_t>(history_.size(), nextWindow_ - historyStart_);
+        }
+        if (history_.size() - offset < windowFrames_) {
+            break;
+        }
+
+        const size_t start = features.size();
+        features.resize(start + bins_);
+        computeWindow(history_.data() + offset, features.data() + start);
+        nextWindow_ += hopFrames_;
+        ++windows;
+    }
+
+    history_.erase(history_.begin(), history_.begin() + offset);
+    historyStart_ += offset;
+    return windows;
+}
+
+void SpectralAnalyzer::reset() {
+    historyStart_ += history_.size();
+    nextWindow_ = historyStart_;
+    history_.clear();
+}
+
+void SpectralAnalyzer::computeWindow(const float* samples, float* output) {
+    for (size_t i = 0; i < windowFrames_; ++i) {
+        frame_[i] = samples[i] * window_[i];
+    }
+    fft_.forward(frame_.data(), spectrum_);
+    for (size_t bin = 0; bin < power_.size(); ++bin) {
+        power_[bin] = std::norm(spectrum_[bin]) * powerScale_;
+    }
+
+    if (melBank_) {
+        melBank_->apply(power_.data(), output);
+    } else {
+        std::copy(power_.begin(), power_.end(), output);
+    }
+    const float minPower = static_cast<float>(std::pow(10.0, kMinDb / 10.0));
+    for (size_t i = 0; i < bins_; ++i) {
+        output[i] = 10.0f * std::log10(std::max(output[i], minPower));
+    }
+}
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) {
+        return sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00);  // NaN or infinity
+    }
+    if (magnitude >= 0x477ff000) {
+        return sign | 0x7c00;  // Rounds past 65504
+    }
+    if (magnitude < 0x38800000) {
+        // Below the smallest normal half: count in steps of 2^-24 (rounds to nearest even)
+        float absolute;
+        std::memcpy(&absolute, &magnitude, sizeof(absolute));
+        return sign | static_cast<uint16_t>(std::nearbyint(absolute * 16777216.0f));
+    }
+    // Rebias the exponent (127 -> 15) and round the 13 dropped mantissa bits to nearest even
+    const uint32_t rounded = magnitude - 0x38000000 + 0xfff + ((magnitude >> 13) & 1);
+    return sign | static_cast<uint16_t>(rounded >> 13);
+}
+
+float halfToFloat(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1f;
+    const uint32_t mantissa = value & 0x3ff;
+
+    float result;
+    if (exponent == 0) {
+        result = std::ldexp(static_cast<float>(mantissa), -24);
+    } else if (exponent == 31) {
+        result = mantissa ? std::nanf("") : INFINITY;
+    } else {
+        const uint32_t bits = ((exponent + 112) << 23) | (mantissa << 13);
+        std::memcpy(&result, &bits, sizeof(result));
+    }
+    return sign ? -result : result;
+}
@@ -0,0 +1,85 @@
+#include "synthetic_audio_source.hpp"
+#include <iostream>
+#include <cmath>
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+
+// Write one sample as a little-endian signed integer of the given width
+void writeSample(uint8_t* dest, double value, int bitDepth) {
+    double maxValue = std::ldexp(1.0, bitDepth - 1) - 1.0;
+    int64_t sample = static_cast<int64_t>(std::lround(value * maxValue));
+    
+    for (int byte = 0; byte < bitDepth / 8; byte++) {
+        dest[byte] = static_cast<uint8_t>((sample >> (8 * byte)) & 0xff);
+    }
+}
+
+} // namespace
+
+SyntheticAudioSource::SyntheticAudioSource(Waveform waveform,
+                                           double frequency,
+                                           int sampleRate,
+                                           int channels,
+                                           int bitDepth,
+                                           int bufferSize,
+                                           Pacing pacing)
+    : ThreadedAudioSource(sampleRate, channels, bitDepth, bufferSize, pacing),
+      waveform_(waveform),
+      frequency_(frequency),
+      amplitude_(0.5),
+      phase_(0.0),
+      noiseState_(0x9E3779B97F4A7C15ull) {
+}
+
+SyntheticAudioSource::~SyntheticAudioSource() {
+    // Stop the generator before this object's fillBlock goes away
+    stop();
+}
+
+std::string SyntheticAudioSource::getDeviceName() const {
+    if (waveform_ == Waveform::Sine) {
+        return "sine:" + std::to_string(static_cast<int>(frequency_)) + "Hz";
+    }
+    return "noise";
+}
+
+bool SyntheticAudioSource::openSource() {
+    if (bitDepth_ != 8 && bitDepth_ != 16 && bitDepth_ != 24 && bitDepth_ != 32) {
+        std::cerr << "Unsupported bit depth: " << bitDepth_ << std::endl;
+        return false;
+    }
+    
+    phase_ = 0.0;
+    return true;
+}
+
+double SyntheticAudioSource::nextValue() {
+    if (waveform_ == Waveform::Sine) {
+        double value = std::sin(phase_);
+        phase_ += kTwoPi * frequency_ / sampleRate_;
+        if (phase_ >= kTwoPi) {
+            phase_ -= kTwoPi;
+        }
+        return value;
+    }
+    
+    // xorshift64* white noise, top 53 bits mapped to [-1, 1)
+    noiseState_ ^= noiseState_ >> 12;
+    noiseState_ ^= noiseState_ << 25;
+    noiseState_ ^= noiseState_ >> 27;
+    uint64_t bits = (noiseState_ * 0x2545F4914F6CDD1Dull) >> 11;
+    return std::ldexp(static_cast<double>(bits), -52) - 1.0;
+}
+
+bool SyntheticAudioSource::fillBlock(uint8_t* dest, unsigned long frames) {
+    for (unsigned long frame = 0; frame < frames; frame++) {
+        double value = amplitude_ * nextValue();
+        for (int channel = 0; channel < channels_; channel++) {
+            writeSample(dest, value, bitDepth_);
+            dest += bytesPerSample_;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,221 @@
+#include "thread_schedule.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+// CPU ids past what a cpu_set_t holds cannot be pinned to
+#if defined(__linux__)
+const int kMaxCpus = CPU_SETSIZE;
+#else
+const int kMaxCpus = 1024;
+#endif
+
+bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    cpus.clear();
+    std::stringstream ss(text);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        try {
+            size_t dashPos = item.find('-');
+            int first = std::stoi(item.substr(0, dashPos));
+            int last = (dashPos == std::string::npos) ? first : std::stoi(item.substr(dashPos + 1));
+            if (first < 0 || last < first || last >= kMaxCpus) {
+                return false;
+            }
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        } catch (...) {
+            return false;
+        }
+    }
+
+    return !cpus.empty();
+}
+
+std::mutex gRecordMutex;
+std::map<std::string, std::string> gRecordedSchedules;
+
+} // namespace
+
+bool ThreadSchedule::parse(const std::string& spec, ThreadSchedule& schedule) {
+    ThreadSchedule result;
+
+    std::string policyPart = spec;
+    size_t atPos = spec.find('@');
+    if (atPos != std::string::npos) {
+        policyPart = spec.substr(0, atPos);
+        if (!parseCpuList(spec.substr(atPos + 1), result.cpus)) {
+            std::cerr << "Invalid CPU list in thread schedule: " << spec << std::endl;
+            return false;
+        }
+    }
+
+    std::string policyName = policyPart;
+    size_t colonPos = policyPart.find(':');
+    if (colonPos != std::string::npos) {
+        policyName = policyPart.substr(0, colonPos);
+        try {
+            result.priority = std::stoi(policyPart.substr(colonPos + 1));
+        } catch (...) {
+            std::cerr << "Invalid priority in thread schedule: " << spec << std::endl;
+            return false;
+        }
+    }
+
+    if (policyName.empty()) {
+        result.policy = Policy::Inherit;
+    } else if (policyName == "other") {
+        result.policy = Policy::Other;
+    } else if (policyName == "fifo") {
+        result.policy = Policy::Fifo;
+    } else if (policyName == "rr") {
+        result.policy = Policy::RoundRobin;
+    } else {
+        std::cerr << "Unknown scheduling policy: " << policyName << std::endl;
+        return false;
+    }
+
+    // Realtime policies need a priority, SCHED_OTHER only accepts 0
+    if (result.policy == Policy::Fifo || result.policy == Policy::RoundRobin) {
+        if (result.priority < 1 || result.priority > 99) {
+            std::cerr << "Realtime priority must be 1-99: " << spec << std::endl;
+            return false;
+        }
+    } else if (result.priority != 0) {
+        std::cerr << "Priority is only used with fifo or rr: " << spec << std::endl;
+        return false;
+    }
+
+    schedule = result;
+    return true;
+}
+
+bool ThreadSchedule::applyToCurrentThread(const std::string& threadName) const {
+    bool ok = true;
+
+    if (policy != Policy::Inherit) {
+        sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+
+        int err = pthread_setschedparam(pthread_self(), nativePolicy(), &param);
+        if (err != 0) {
+            std::cerr << "Failed to set scheduling " << toString() << " for " << threadName
+                      << " thread: " << std::strerror(err) << std::endl;
+            ok = false;
+        }
+    }
+
+    if (!cpus.empty()) {
+#if defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &cpuSet);
+        }
+
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (err != 0) {
+            std::cerr << "Failed to set CPU affinity " << toString() << " for " << threadName
+                      << " thread: " << std::strerror(err) << std::endl;
+            ok = false;
+        }
+#else
+        std::cerr << "CPU affinity is not supported on this platform (" << threadName << " thread)" << std::endl;
+        ok = false;
+#endif
+    }
+
+    return ok;
+}
+
+ThreadSchedule ThreadSchedule::ofCurrentThread() {
+    ThreadSchedule schedule;
+
+    int policy = SCHED_OTHER;
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+        if (policy == SCHED_FIFO) {
+            schedule.policy = Policy::Fifo;
+            schedule.priority = param.sched_priority;
+        } else if (policy == SCHED_RR) {
+            schedule.policy = Policy::RoundRobin;
+            schedule.priority = param.sched_priority;
+        } else {
+            schedule.policy = Policy::Other;
+        }
+    }
+
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &cpuSet)) {
+                schedule.cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+
+    return schedule;
+}
+
+int ThreadSchedule::nativePolicy() const {
+    switch (policy) {
+        case Policy::Fifo: return SCHED_FIFO;
+        case Policy::RoundRobin: return SCHED_RR;
+        default: return SCHED_OTHER;
+    }
+}
+
+std::string ThreadSchedule::toString() const {
+    std::stringstream ss;
+
+    switch (policy) {
+        case Policy::Inherit: break;
+        case Policy::Other: ss << "other"; break;
+        case Policy::Fifo: ss << "fifo:" << priority; break;
+        case Policy::RoundRobin: ss << "rr:" << priority; break;
+    }
+
+    // Consecutive CPUs are written as ranges
+    if (!cpus.empty()) {
+        ss << "@";
+        for (size_t i = 0; i < cpus.size(); i++) {
+            size_t last = i;
+            while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) {
+                last++;
+            }
+            ss << (i ? "," : "") << cpus[i];
+            if (last > i) {
+                ss << "-" << cpus[last];
+            }
+            i = last;
+        }
+    }
+
+    return ss.str();
+}
+
+void recordThreadSchedule(const std::string& threadName) {
+    recordThreadSchedule(threadName, ThreadSchedule::ofCurrentThread().toString());
+}
+
+void recordThreadSchedule(const std::string& threadName, const std::string& description) {
+    std::lock_guard<std::mutex> lock(gRecordMutex);
+    gRecordedSchedules[threadName] = description;
+}
+
+std::map<std::string, std::string> recordedThreadSchedules() {
+    std::lock_guard<std::mutex> lock(gRecordMutex);
+    return gRecordedSchedules;
+}
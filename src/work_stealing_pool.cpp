@@ -0,0 +1,196 @@
+#include "work_stealing_pool.hpp"
+#include <algorithm>
+#include <string>
+#include "thread_schedule.hpp"
+
+namespace {
+
+uint64_t packRange(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+}
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads, const ThreadSchedule& schedule)
+    : threadCount_(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      schedule_(schedule),
+      stopping_(false),
+      tasksStolen_(0) {
+    // The caller of run() is thread 0
+    for (size_t i = 1; i < threadCount_; ++i) {
+        workers_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    if (threadCount_ == 1 || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    Run* run = nullptr;
+    {
+        // Workers only find a run under mutex_, so they see it fully dealt
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& slot : runs_) {
+            if (!slot->inUse) {
+                run = slot.get();
+                break;
+            }
+        }
+        if (!run) {
+            runs_.push_back(std::make_unique<Run>());
+            run = runs_.back().get();
+            run->ranges.reset(new TaskRange[threadCount_]);
+        }
+
+        run->task = &task;
+        run->pending.store(count, std::memory_order_relaxed);
+        for (size_t i = 0; i < threadCount_; ++i) {
+            const uint32_t begin = static_cast<uint32_t>(count * i / threadCount_);
+            const uint32_t end = static_cast<uint32_t>(count * (i + 1) / threadCount_);
+            run->ranges[i].bounds.store(packRange(begin, end), std::memory_order_relaxed);
+        }
+        run->inUse = true;
+    }
+    wakeCondition_.notify_all();
+
+    work(*run, 0);
+
+    // Join: the last tasks may still be running on other threads. A realtime caller must
+    // not yield to them (that does not let lower-priority threads run), so spin briefly and
+    // then sleep until the workers have left the run.
+    for (int spin = 0; spin < kJoinSpins && run->pending.load(std::memory_order_acquire) > 0; ++spin) {
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    doneCondition_.wait(lock, [run] {
+        return run->pending.load(std::memory_order_acquire) == 0 && run->active == 0;
+    });
+    run->inUse = false;
+    run->task = nullptr;
+}
+
+bool WorkStealingPool::popFront(TaskRange& range, uint32_t& task) {
+    std::atomic<uint64_t>& bounds = range.bounds;
+    uint64_t current = bounds.load(std::memory_order_relaxed);
+    while (true) {
+        const uint32_t begin = static_cast<uint32_t>(current >> 32);
+        const uint32_t end = static_cast<uint32_t>(current);
+        if (begin >= end) {
+            return false;
+        }
+        if (bounds.compare_exchange_weak(current, packRange(begin + 1, end), std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            task = begin;
+            return true;
+        }
+    }
+}
+
+bool WorkStealingPool::stealBack(TaskRange& range, uint32_t& task) {
+    std::atomic<uint64_t>& bounds = range.bounds;
+    uint64_t current = bounds.load(std::memory_order_relaxed);
+    while (true) {
+        const uint32_t begin = static_cast<uint32_t>(current >> 32);
+        const uint32_t end = static_cast<uint32_t>(current);
+        if (begin >= end) {
+            return false;
+        }
+        if (bounds.compare_exchange_weak(current, packRange(begin, end - 1), std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            task = end - 1;
+            return true;
+        }
+    }
+}
+
+void WorkStealingPool::work(Run& run, size_t self) {
+    const std::function<void(size_t)>& task = *run.task;
+    size_t done = 0;
+    uint32_t index;
+
+    while (popFront(run.ranges[self], index)) {
+        task(index);
+        ++done;
+    }
+
+    // Steal from the next threads round, so thieves spread over different victims
+    uint64_t stolen = 0;
+    for (size_t offset = 1; offset < threadCount_; ++offset) {
+        const size_t victim = (self + offset) % threadCount_;
+        while (stealBack(run.ranges[victim], index)) {
+            task(index);
+            ++done;
+            ++stolen;
+        }
+    }
+
+    if (stolen > 0) {
+        tasksStolen_.fetch_add(stolen, std::memory_order_relaxed);
+    }
+    if (done > 0) {
+        run.pending.fetch_sub(done, std::memory_order_acq_rel);
+    }
+}
+
+bool WorkStealingPool::hasUnclaimed(const Run& run) const {
+    for (size_t i = 0; i < threadCount_; ++i) {
+        const uint64_t bounds = run.ranges[i].bounds.load(std::memory_order_relaxed);
+        if ((bounds >> 32) < (bounds & 0xffffffffu)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+WorkStealingPool::Run* WorkStealingPool::findRun() const {
+    for (const auto& run : runs_) {
+        if (run->inUse && hasUnclaimed(*run)) {
+            return run.get();
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    const std::string threadName = "dsp pool " + std::to_string(index);
+    if (!schedule_.isDefault()) {
+        schedule_.applyToCurrentThread(threadName);
+    }
+    recordThreadSchedule(threadName);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        Run* run = nullptr;
+        wakeCondition_.wait(lock, [&] { return stopping_ || (run = findRun()) != nullptr; });
+        if (stopping_) {
+            return;
+        }
+
+        // The caller keeps the run listed until every worker inside has left
+        run->active++;
+        lock.unlock();
+        work(*run, index);
+        lock.lock();
+        run->active--;
+        if (run->pending.load(std::memory_order_acquire) == 0) {
+            doneCondition_.notify_all();
+        }
+    }
+}
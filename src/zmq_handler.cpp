@@ -1,27 +1,64 @@
 #include "zmq_handler.hpp"
 #include "device_manager.hpp"
+#include "cpu_features.hpp"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <chrono>
 #include <cstring>
 
+namespace {
+
+// zmq frees history frames through this; each frame holds a reference to the shared copy
+void releaseHistorySlice(void*, void* hint) {
+    delete static_cast<std::shared_ptr<std::vector<uint8_t>>*>(hint);
+}
+
+} // namespace
+
 ZmqHandler::ZmqHandler(const std::string& address, 
                       const std::string& topic,
-                      std::shared_ptr<AudioCapture> audioCapture,
-                      std::shared_ptr<ZmqPublisher> zmqPublisher)
+                      std::shared_ptr<AudioSource> audioSource,
+                      std::shared_ptr<ZmqPublisher> zmqPublisher,
+                      std::shared_ptr<zmq::context_t> context)
     : address_(address),
       topic_(topic),
-      audioCapture_(audioCapture),
+      context_(context),
       zmqPublisher_(zmqPublisher),
       running_(false),
       initialized_(false),
       verboseMode_(false) {
     
-    // Set up command handlers
-    commandHandlers_["STATUS"] = [this](const std::string&) { return handleStatus(); };
-    commandHandlers_["SET_SAMPLE_RATE"] = [this](const std::string& args) { return handleSetSampleRate(args); };
-    commandHandlers_["STOP"] = [this](const std::string&) { return handleStop(); };
-    commandHandlers_["START"] = [this](const std::string&) { return handleStart(); };
+    streams_.push_back({zmqPublisher ? zmqPublisher->getStream(0).streamId : "", audioSource, 0, nullptr, nullptr, nullptr, nullptr});
+    
+    // Set up command handlers; per-source commands accept a trailing stream id
+    commandHandlers_["STATUS"] = [this](const std::string& args) {
+        return forEachStream(args, false, [this](const ControlledStream& stream, const std::string&) {
+            return handleStatus(stream);
+        });
+    };
+    commandHandlers_["SET_SAMPLE_RATE"] = [this](const std::string& args) {
+        return forEachStream(args, true, [this](const ControlledStream& stream, const std::string& rest) {
+            return handleSetSampleRate(stream, rest);
+        });
+    };
+    commandHandlers_["SET_BUFFER_MS"] = [this](const std::string& args) {
+        return forEachStream(args, true, [this](const ControlledStream& stream, const std::string& rest) {
+            return handleSetBufferMs(stream, rest);
+        });
+    };
+    commandHandlers_["STOP"] = [this](const std::string& args) {
+        return forEachStream(args, false, [this](const ControlledStream& stream, const std::string&) {
+            return handleStop(stream);
+        });
+    };
+    commandHandlers_["START"] = [this](const std::string& args) {
+        return forEachStream(args, false, [this](const ControlledStream& stream, const std::string&) {
+            return handleStart(stream);
+        });
+    };
+    commandHandlers_["GET_HISTORY"] = [this](const std::string& args) { return handleGetHistory(args); };
+    commandHandlers_["GET_JOURNAL"] = [this](const std::string& args) { return handleGetJournal(args); };
     commandHandlers_["GET_DEVICES"] = [this](const std::string&) { return handleGetDevices(); };
     commandHandlers_["SET_VERBOSE"] = [this](const std::string& args) { return handleSetVerbose(args); };
 }
@@ -30,14 +67,61 @@ ZmqHandler::~ZmqHandler() {
     stop();
 }
 
+void ZmqHandler::addStream(const std::string& streamId, std::shared_ptr<AudioSource> source, size_t publisherStream) {
+    if (running_) {
+        std::cerr << "Cannot add stream " << streamId << " while handling commands" << std::endl;
+        return;
+    }
+    
+    streams_.push_back({streamId, source, publisherStream, nullptr, nullptr, nullptr, nullptr});
+}
+
+void ZmqHandler::setJournal(size_t stream, std::shared_ptr<CaptureJournal> journal) {
+    if (running_ || stream >= streams_.size()) {
+        std::cerr << "Cannot attach journal to stream " << stream << std::endl;
+        return;
+    }
+    
+    streams_[stream].journal = journal;
+}
+
+void ZmqHandler::setOpusEncoder(size_t stream, std::shared_ptr<OpusStreamEncoder> encoder) {
+    if (running_ || stream >= streams_.size()) {
+        std::cerr << "Cannot attach Opus encoder to stream " << stream << std::endl;
+        return;
+    }
+    
+    streams_[stream].opus = encoder;
+}
+
+void ZmqHandler::setFeatureStream(size_t stream, std::shared_ptr<FeatureStream> features) {
+    if (running_ || stream >= streams_.size()) {
+        std::cerr << "Cannot attach features to stream " << stream << std::endl;
+        return;
+    }
+    
+    streams_[stream].features = features;
+}
+
+void ZmqHandler::setDspWorker(size_t stream, std::shared_ptr<DspWorker> dsp) {
+    if (running_ || stream >= streams_.size()) {
+        std::cerr << "Cannot attach processing chain to stream " << stream << std::endl;
+        return;
+    }
+    
+    streams_[stream].dsp = dsp;
+}
+
 bool ZmqHandler::initialize() {
     if (initialized_) {
         return true;
     }
     
     try {
-        // Create ZMQ context and socket
-        context_ = std::make_unique<zmq::context_t>(1);
+        // Create ZMQ context (unless one is shared with us) and socket
+        if (!context_) {
+            context_ = std::make_shared<zmq::context_t>(1);
+        }
         dealerSocket_ = std::make_unique<zmq::socket_t>(*context_, ZMQ_ROUTER);
         
 // see discussion in message_format.hpp
@@ -96,7 +180,32 @@ bool ZmqHandler::isRunning() const {
     return running_;
 }
 
+std::string ZmqHandler::handleCommand(const std::string& command) {
+    // Parse command and arguments
+    std::string commandName;
+    std::string arguments;
+    
+    size_t spacePos = command.find(' ');
+    if (spacePos != std::string::npos) {
+        commandName = command.substr(0, spacePos);
+        arguments = command.substr(spacePos + 1);
+    } else {
+        commandName = command;
+    }
+    
+    auto it = commandHandlers_.find(commandName);
+    if (it == commandHandlers_.end()) {
+        return "ERROR: Unknown command";
+    }
+    return it->second(arguments);
+}
+
 void ZmqHandler::handleLoop() {
+    if (!threadSchedule_.isDefault()) {
+        threadSchedule_.applyToCurrentThread("handler");
+    }
+    recordThreadSchedule("handler");
+    
     std::vector<zmq::pollitem_t> pollItems = {
         { static_cast<void*>(*dealerSocket_), 0, ZMQ_POLLIN, 0 }
     };
@@ -139,26 +248,9 @@ void ZmqHandler::handleLoop() {
                     }
                     std::string command(static_cast<char*>(commandMsg.data()), commandMsg.size());
                     
-                    // Parse command and arguments
-                    std::string commandName;
-                    std::string arguments;
-                    
-                    size_t spacePos = command.find(' ');
-                    if (spacePos != std::string::npos) {
-                        commandName = command.substr(0, spacePos);
-                        arguments = command.substr(spacePos + 1);
-                    } else {
-                        commandName = command;
-                    }
-                    
                     // Handle command
-                    std::string response;
-                    auto it = commandHandlers_.find(commandName);
-                    if (it != commandHandlers_.end()) {
-                        response = it->second(arguments);
-                    } else {
-                        response = "ERROR: Unknown command";
-                    }
+                    replyFrames_.clear();
+                    std::string response = handleCommand(command);
                     
                     // Send DEALER response back to client
                     dealerSocket_->send(identityMsg, zmq::send_flags::sndmore);  // Client identity
@@ -172,7 +264,15 @@ void ZmqHandler::handleLoop() {
                     // Send response frame
                     zmq::message_t responseMsg(response.size());
                     memcpy(responseMsg.data(), response.data(), response.size());
-                    dealerSocket_->send(responseMsg, zmq::send_flags::none);
+                    dealerSocket_->send(responseMsg, replyFrames_.empty() ? zmq::send_flags::none
+                                                                          : zmq::send_flags::sndmore);
+                    
+                    // Binary frames follow the text response
+                    for (size_t i = 0; i < replyFrames_.size(); i++) {
+                        bool last = (i + 1 == replyFrames_.size());
+                        dealerSocket_->send(replyFrames_[i], last ? zmq::send_flags::none : zmq::send_flags::sndmore);
+                    }
+                    replyFrames_.clear();
                 }
             }
         } catch (const zmq::error_t& e) {
@@ -181,53 +281,272 @@ void ZmqHandler::handleLoop() {
     }
 }
 
-std::string ZmqHandler::handleStatus() {
+void ZmqHandler::selectStreams(const std::string& args, std::string& rest,
+                               std::vector<const ControlledStream*>& selected) const {
+    selected.clear();
+    rest = args;
+    
+    // The last word names a stream if it matches one
+    size_t end = args.find_last_not_of(' ');
+    if (end != std::string::npos) {
+        size_t start = args.find_last_of(' ', end);
+        start = (start == std::string::npos) ? 0 : start + 1;
+        std::string lastWord = args.substr(start, end - start + 1);
+        
+        for (const auto& stream : streams_) {
+            if (!stream.streamId.empty() && stream.streamId == lastWord) {
+                selected.push_back(&stream);
+                rest = args.substr(0, start);
+                rest.erase(rest.find_last_not_of(' ') + 1);
+                return;
+            }
+        }
+    }
+    
+    for (const auto& stream : streams_) {
+        selected.push_back(&stream);
+    }
+}
+
+std::string ZmqHandler::streamLabel(const ControlledStream& stream) const {
+    if (!stream.streamId.empty()) {
+        return stream.streamId;
+    }
+    return "stream " + std::to_string(&stream - streams_.data());
+}
+
+std::string ZmqHandler::forEachStream(const std::string& args, bool takesArguments,
+                                      const std::function<std::string(const ControlledStream&, const std::string&)>& handler) {
+    std::string rest;
+    std::vector<const ControlledStream*> selected;
+    selectStreams(args, rest, selected);
+    
+    if (!takesArguments && !rest.empty()) {
+        return "ERROR: Unknown stream: " + rest;
+    }
+    
+    // A single stream keeps the original one-line response
+    if (selected.size() == 1) {
+        return handler(*selected.front(), rest);
+    }
+    
+    std::stringstream ss;
+    for (const ControlledStream* stream : selected) {
+        ss << "[" << streamLabel(*stream) << "] " << handler(*stream, rest) << "\n";
+    }
+    return ss.str();
+}
+
+void ZmqHandler::publishSourceStatus(const ControlledStream& stream, bool running, const char* event) {
     std::map<std::string, nlohmann::json> statusData;
+    statusData["running"] = running;
+    statusData["sample_rate"] = zmqPublisher_->getOutputRate(stream.publisherStream);
+    statusData["capture_sample_rate"] = stream.source->getSampleRate();
+    statusData["channels"] = stream.source->getChannels();
+    statusData["bit_depth"] = stream.source->getBitDepth();
+    statusData["device"] = stream.source->getDeviceName();
+    statusData["buffer_ms"] = stream.source->getHistoryMs();
+    if (event) {
+        statusData["event"] = event;
+    }
+    zmqPublisher_->publishStatusMessage(stream.publisherStream, statusData, verboseMode_.load());
+}
+
+std::string ZmqHandler::handleStatus(const ControlledStream& stream) {
+    const auto& audioSource = stream.source;
+    
+    // Capture and publishing counters, so gaps can be traced to the device or the network
+    CaptureCounters capture = audioSource->getCaptureCounters();
+    const PublishCounters& publish = *zmqPublisher_->getStream(stream.publisherStream).counters;
+    uint64_t framesPublished = publish.framesPublished.load(std::memory_order_relaxed);
+    uint64_t framesDropped = capture.framesDropped + publish.framesDropped.load(std::memory_order_relaxed);
+    
+    std::map<std::string, nlohmann::json> statusData;
+    statusData["running"] = audioSource->isRunning();
+    statusData["sample_rate"] = zmqPublisher_->getOutputRate(stream.publisherStream);
+    statusData["capture_sample_rate"] = audioSource->getSampleRate();
+    statusData["channels"] = audioSource->getChannels();
+    statusData["bit_depth"] = audioSource->getBitDepth();
+    statusData["device"] = audioSource->getDeviceName();
+    statusData["buffer_ms"] = audioSource->getHistoryMs();
+    statusData["input_overflows"] = capture.inputOverflows;
+    statusData["input_underflows"] = capture.inputUnderflows;
+    statusData["frames_captured"] = capture.framesCaptured;
+    statusData["frames_published"] = framesPublished;
+    statusData["frames_dropped"] = framesDropped;
+    
+    // Current message size and flush interval of the sender (adaptive batching moves both)
+    const BatchController& batching = zmqPublisher_->getBatchController();
+    statusData["publish_mode"] = batching.isAdaptive() ? "adaptive" : "per_block";
+    statusData["publish_chunk_ms"] = batching.getChunkMs();
+    statusData["publish_flush_ms"] = batching.getFlushIntervalMs();
+    statusData["publisher_load_pct"] = batching.getLoadPercent();
+    statusData["publish_queue"] = zmqPublisher_->getQueuedMessages();
+    statusData["publish_format"] = zmqPublisher_->getPublishFormat();
+    statusData["simd"] = simdLevelName(getSimdLevel());
+    
+    // Payload compression across all streams: raw bytes per coded byte
+    uint64_t codecOutputBytes = zmqPublisher_->getCodecOutputBytes();
+    double codecRatio = codecOutputBytes > 0
+        ? static_cast<double>(zmqPublisher_->getCodecInputBytes()) / codecOutputBytes : 1.0;
+    statusData["codec"] = zmqPublisher_->getPayloadCodec();
+    statusData["codec_ratio"] = codecRatio;
+    
+    // Layouts derived from this stream, each published on its own topic
+    nlohmann::json derived = nlohmann::json::object();
+    std::vector<size_t> derivedStreams = zmqPublisher_->getDerivedStreams(stream.publisherStream);
+    for (size_t index : derivedStreams) {
+        const PublishedStream& published = zmqPublisher_->getStream(index);
+        derived[published.streamId] = {
+            {"topic", published.topic},
+            {"channel_map", published.mixer->getMatrix().spec},
+            {"sample_rate", zmqPublisher_->getOutputRate(index)},
+            {"frames_published", published.counters->framesPublished.load(std::memory_order_relaxed)}
+        };
+    }
+    if (!derivedStreams.empty()) {
+        statusData["derived"] = derived;
+    }
+    
+    // Encode cost of the Opus topic: per 20 ms packet, and as a share of real time
+    if (stream.opus) {
+        const PublishedStream& encoded = zmqPublisher_->getStream(stream.opus->getPublisherStream());
+        statusData["opus"] = {
+            {"topic", encoded.topic},
+            {"bitrate", stream.opus->getBitrate()},
+            {"running", stream.opus->isRunning()},
+            {"packets_encoded", stream.opus->getPacketsEncoded()},
+            {"frames_published", encoded.counters->framesPublished.load(std::memory_order_relaxed)},
+            {"frames_dropped", encoded.counters->framesDropped.load(std::memory_order_relaxed)},
+            {"encode_us_per_packet", stream.opus->getEncodeUsPerPacket()},
+            {"encode_load_pct", stream.opus->getEncodeLoadPercent()}
+        };
+    }
+    
+    // Cost of the feature topic: per feature frame, and as a share of real time
+    if (stream.features) {
+        const PublishedStream& published = zmqPublisher_->getStream(stream.features->getPublisherStream());
+        statusData["features"] = {
+            {"topic", published.topic},
+            {"settings", stream.features->getSettings().toString()},
+            {"bins", stream.features->getBins()},
+            {"running", stream.features->isRunning()},
+            {"frames_computed", stream.features->getFramesComputed()},
+            {"frames_dropped", published.counters->framesDropped.load(std::memory_order_relaxed)},
+            {"compute_us_per_frame", stream.features->getComputeUsPerFrame()},
+            {"compute_load_pct", stream.features->getComputeLoadPercent()}
+        };
+    }
     
-    // Fill status data
-    statusData["running"] = audioCapture_->isRunning();
-    statusData["sample_rate"] = audioCapture_->getSampleRate();
-    statusData["channels"] = audioCapture_->getChannels();
-    statusData["bit_depth"] = audioCapture_->getBitDepth();
-    statusData["device"] = audioCapture_->getDeviceName();
+    // Processing chain: time spent per step, and the whole chain as a share of real time
+    if (stream.dsp) {
+        nlohmann::json steps = nlohmann::json::array();
+        for (const DspStageStats& step : stream.dsp->getStageStats()) {
+            steps.push_back({
+                {"name", step.name},
+                {"blocks", step.blocks},
+                {"ns", step.ns},
+                {"us_per_block", step.blocks > 0 ? step.ns / 1000.0 / step.blocks : 0.0}
+            });
+        }
+        statusData["dsp"] = {
+            {"settings", stream.dsp->getSettings().toString()},
+            {"running", stream.dsp->isRunning()},
+            {"threads", stream.dsp->getThreadCount()},
+            {"blocks_processed", stream.dsp->getBlocksProcessed()},
+            {"frames_dropped", stream.dsp->getFramesDropped()},
+            {"process_us_per_block", stream.dsp->getProcessUsPerBlock()},
+            {"process_load_pct", stream.dsp->getProcessLoadPercent()},
+            {"stages", steps}
+        };
+    }
+    
+    // Silence gate: how much of the stream it held back, and what it hears now
+    const SilenceGate* gate = zmqPublisher_->getSilenceGate(stream.publisherStream);
+    if (gate) {
+        statusData["gate"] = {
+            {"settings", gate->getSettings().toString()},
+            {"open", gate->isOpen()},
+            {"level_db", gate->getLevelDb()},
+            {"noise_floor_db", gate->getNoiseFloorDb()},
+            {"frames_passed", gate->getFramesPassed()},
+            {"frames_suppressed", gate->getFramesSuppressed()}
+        };
+    }
+    
+    // Effective scheduling of our threads (requested settings for the ZMQ I/O threads)
+    std::map<std::string, std::string> threads = recordedThreadSchedules();
+    statusData["threads"] = threads;
     
     // Publish status message
-    zmqPublisher_->publishStatusMessage(statusData, verboseMode_.load());
+    zmqPublisher_->publishStatusMessage(stream.publisherStream, statusData, verboseMode_.load());
     
     // Return simple status string for DEALER response
     std::stringstream ss;
     ss << "STATUS: ";
-    ss << (audioCapture_->isRunning() ? "RUNNING" : "STOPPED");
-    ss << ", SAMPLE_RATE: " << audioCapture_->getSampleRate();
-    ss << ", CHANNELS: " << audioCapture_->getChannels();
-    ss << ", BIT_DEPTH: " << audioCapture_->getBitDepth();
-    ss << ", DEVICE: " << audioCapture_->getDeviceName();
+    ss << (audioSource->isRunning() ? "RUNNING" : "STOPPED");
+    ss << ", SAMPLE_RATE: " << zmqPublisher_->getOutputRate(stream.publisherStream);
+    ss << ", CAPTURE_SAMPLE_RATE: " << audioSource->getSampleRate();
+    ss << ", CHANNELS: " << audioSource->getChannels();
+    ss << ", BIT_DEPTH: " << audioSource->getBitDepth();
+    ss << ", DEVICE: " << audioSource->getDeviceName();
+    ss << ", BUFFER_MS: " << audioSource->getHistoryMs();
+    ss << ", OVERFLOWS: " << capture.inputOverflows;
+    ss << ", UNDERFLOWS: " << capture.inputUnderflows;
+    ss << ", FRAMES_CAPTURED: " << capture.framesCaptured;
+    ss << ", FRAMES_PUBLISHED: " << framesPublished;
+    ss << ", FRAMES_DROPPED: " << framesDropped;
+    ss << ", PUBLISH_CHUNK_MS: " << batching.getChunkMs();
+    ss << ", PUBLISH_FLUSH_MS: " << batching.getFlushIntervalMs();
+    ss << ", PUBLISH_FORMAT: " << zmqPublisher_->getPublishFormat();
+    ss << ", CODEC: " << zmqPublisher_->getPayloadCodec();
+    if (!derivedStreams.empty()) {
+        ss << ", DERIVED:";
+        for (size_t index : derivedStreams) {
+            ss << " " << zmqPublisher_->getStream(index).streamId;
+        }
+    }
+    if (stream.opus) {
+        ss << ", OPUS_ENCODE_US: " << stream.opus->getEncodeUsPerPacket();
+    }
+    if (stream.features) {
+        ss << ", FEATURE_US: " << stream.features->getComputeUsPerFrame();
+    }
+    if (stream.dsp) {
+        ss << ", DSP_US: " << stream.dsp->getProcessUsPerBlock();
+    }
+    if (gate) {
+        ss << ", GATE: " << (gate->isOpen() ? "OPEN" : "CLOSED");
+        ss << ", FRAMES_SUPPRESSED: " << gate->getFramesSuppressed();
+    }
+    ss << ", THREADS:";
+    for (const auto& thread : threads) {
+        ss << " " << thread.first << "=" << thread.second;
+    }
     
     return ss.str();
 }
 
-std::string ZmqHandler::handleSetSampleRate(const std::string& args) {
+std::string ZmqHandler::handleSetSampleRate(const ControlledStream& stream, const std::string& args) {
+    const auto& audioSource = stream.source;
+    const int minSampleRate = 1000;
+    const int maxSampleRate = 384000;
+    
     try {
-        int sampleRate = std::stoi(args);
+        size_t parsed = 0;
+        int sampleRate = std::stoi(args, &parsed);
         
-        if (sampleRate <= 0) {
+        if (sampleRate < minSampleRate || sampleRate > maxSampleRate ||
+            args.find_first_not_of(' ', parsed) != std::string::npos) {
             return "ERROR: Invalid sample rate";
         }
         
-        if (audioCapture_->setSampleRate(sampleRate)) {
-            if (audioCapture_->isRunning()) {
-                audioCapture_->start();
-            }
-            
+        // The device keeps capturing at its own rate; the publisher resamples, so there is
+        // no reopen and no gap. History and journals stay at the captured rate.
+        int outputRate = sampleRate == audioSource->getSampleRate() ? 0 : sampleRate;
+        if (zmqPublisher_->setOutputRate(stream.publisherStream, outputRate)) {
             // Publish status update
-            std::map<std::string, nlohmann::json> statusData;
-            statusData["running"] = audioCapture_->isRunning();
-            statusData["sample_rate"] = audioCapture_->getSampleRate();
-            statusData["channels"] = audioCapture_->getChannels();
-            statusData["bit_depth"] = audioCapture_->getBitDepth();
-            statusData["device"] = audioCapture_->getDeviceName();
-            statusData["event"] = "sample_rate_changed";
-            zmqPublisher_->publishStatusMessage(statusData, verboseMode_.load());
+            publishSourceStatus(stream, audioSource->isRunning(), "sample_rate_changed");
             
             return "OK: Sample rate set to " + std::to_string(sampleRate);
         } else {
@@ -238,17 +557,34 @@ std::string ZmqHandler::handleSetSampleRate(const std::string& args) {
     }
 }
 
-std::string ZmqHandler::handleStop() {
-    if (audioCapture_->stop()) {
+std::string ZmqHandler::handleSetBufferMs(const ControlledStream& stream, const std::string& args) {
+    // Keep a runaway request from exhausting memory: 10 minutes is plenty for history
+    const int maxBufferMs = 10 * 60 * 1000;
+    
+    try {
+        size_t parsed = 0;
+        int bufferMs = std::stoi(args, &parsed);
+        
+        if (bufferMs <= 0 || bufferMs > maxBufferMs || args.find_first_not_of(' ', parsed) != std::string::npos) {
+            return "ERROR: Invalid buffer size";
+        }
+        
+        if (!stream.source->setHistoryMs(bufferMs)) {
+            return "ERROR: Failed to resize buffer";
+        }
+        
+        publishSourceStatus(stream, stream.source->isRunning(), "buffer_resized");
+        
+        return "OK: Buffer set to " + std::to_string(bufferMs) + " ms";
+    } catch (const std::exception& e) {
+        return "ERROR: Invalid buffer size format";
+    }
+}
+
+std::string ZmqHandler::handleStop(const ControlledStream& stream) {
+    if (stream.source->stop()) {
         // Publish status update
-        std::map<std::string, nlohmann::json> statusData;
-        statusData["running"] = false;
-        statusData["sample_rate"] = audioCapture_->getSampleRate();
-        statusData["channels"] = audioCapture_->getChannels();
-        statusData["bit_depth"] = audioCapture_->getBitDepth();
-        statusData["device"] = audioCapture_->getDeviceName();
-        statusData["event"] = "stopped";
-        zmqPublisher_->publishStatusMessage(statusData, verboseMode_.load());
+        publishSourceStatus(stream, false, "stopped");
         
         return "OK: Audio capture stopped";
     } else {
@@ -256,17 +592,10 @@ std::string ZmqHandler::handleStop() {
     }
 }
 
-std::string ZmqHandler::handleStart() {
-    if (audioCapture_->start()) {
+std::string ZmqHandler::handleStart(const ControlledStream& stream) {
+    if (stream.source->start()) {
         // Publish status update
-        std::map<std::string, nlohmann::json> statusData;
-        statusData["running"] = true;
-        statusData["sample_rate"] = audioCapture_->getSampleRate();
-        statusData["channels"] = audioCapture_->getChannels();
-        statusData["bit_depth"] = audioCapture_->getBitDepth();
-        statusData["device"] = audioCapture_->getDeviceName();
-        statusData["event"] = "started";
-        zmqPublisher_->publishStatusMessage(statusData, verboseMode_.load());
+        publishSourceStatus(stream, true, "started");
         
         return "OK: Audio capture started";
     } else {
@@ -274,6 +603,87 @@ std::string ZmqHandler::handleStart() {
     }
 }
 
+const ControlledStream* ZmqHandler::parseHistoryRequest(const std::string& command, const std::string& args,
+                                                        uint64_t& fromTimestamp, uint64_t& toTimestamp,
+                                                        std::string& error) const {
+    std::string rest;
+    std::vector<const ControlledStream*> selected;
+    selectStreams(args, rest, selected);
+    
+    // Audio from several streams in one reply would be ambiguous
+    if (selected.size() != 1) {
+        error = "ERROR: " + command + " needs a stream id";
+        return nullptr;
+    }
+    
+    std::stringstream ss(rest);
+    std::string extra;
+    if (!(ss >> fromTimestamp >> toTimestamp) || (ss >> extra) || fromTimestamp > toTimestamp) {
+        error = "ERROR: Usage: " + command + " <from_ms> <to_ms> [stream]";
+        return nullptr;
+    }
+    
+    return selected.front();
+}
+
+std::string ZmqHandler::replyWithAudio(ReadResult& audio, uint64_t fromTimestamp,
+                                       int sampleRate, int channels, int bitDepth) {
+    // One copy out of the ring; the frames are slices of it and keep it alive until sent
+    auto snapshot = std::make_shared<std::vector<uint8_t>>(std::move(audio.data));
+    const size_t frameBytes = channels * (bitDepth / 8);
+    const size_t sliceBytes = std::max<size_t>(1, sampleRate) * frameBytes;
+    
+    for (size_t offset = 0; offset < snapshot->size(); offset += sliceBytes) {
+        size_t size = std::min(sliceBytes, snapshot->size() - offset);
+        auto* hint = new std::shared_ptr<std::vector<uint8_t>>(snapshot);
+        replyFrames_.emplace_back(snapshot->data() + offset, size, releaseHistorySlice, hint);
+    }
+    
+    size_t frames = snapshot->size() / frameBytes;
+    std::stringstream response;
+    response << "HISTORY: FROM: " << (frames > 0 ? audio.timestamp : fromTimestamp);
+    response << ", FRAMES: " << frames;
+    response << ", LOST_FRAMES: " << audio.lostFrames;
+    response << ", SAMPLE_RATE: " << sampleRate;
+    response << ", CHANNELS: " << channels;
+    response << ", BIT_DEPTH: " << bitDepth;
+    response << ", PARTS: " << replyFrames_.size();
+    
+    return response.str();
+}
+
+std::string ZmqHandler::handleGetHistory(const std::string& args) {
+    uint64_t fromTimestamp = 0;
+    uint64_t toTimestamp = 0;
+    std::string error;
+    const ControlledStream* stream = parseHistoryRequest("GET_HISTORY", args, fromTimestamp, toTimestamp, error);
+    if (!stream) {
+        return error;
+    }
+    
+    std::shared_ptr<AudioBuffer> audioBuffer = stream->source->getAudioBuffer();
+    ReadResult history = audioBuffer->readRange(fromTimestamp, toTimestamp);
+    return replyWithAudio(history, fromTimestamp, stream->source->getSampleRate(),
+                          stream->source->getChannels(), stream->source->getBitDepth());
+}
+
+std::string ZmqHandler::handleGetJournal(const std::string& args) {
+    uint64_t fromTimestamp = 0;
+    uint64_t toTimestamp = 0;
+    std::string error;
+    const ControlledStream* stream = parseHistoryRequest("GET_JOURNAL", args, fromTimestamp, toTimestamp, error);
+    if (!stream) {
+        return error;
+    }
+    if (!stream->journal) {
+        return "ERROR: No journal for this stream";
+    }
+    
+    ReadResult history = stream->journal->readRange(fromTimestamp, toTimestamp);
+    return replyWithAudio(history, fromTimestamp, stream->journal->getSampleRate(),
+                          stream->journal->getChannels(), stream->journal->getBitDepth());
+}
+
 std::string ZmqHandler::handleGetDevices() {
     DeviceManager deviceManager;
     if (!deviceManager.initialize()) {
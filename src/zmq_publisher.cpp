@@ -1,22 +1,216 @@
 #include "zmq_publisher.hpp"
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstring>
+#include <mutex>
+
+namespace {
+
+// Converter held in slot, rebuilt when the formats or channel count change
+SampleConverter& cachedConverter(std::unique_ptr<SampleConverter>& slot, const SampleSpec& from,
+                                 const SampleSpec& to, int channels) {
+    if (!slot || slot->getFrom() != from || slot->getTo() != to || slot->getChannels() != channels) {
+        slot = std::make_unique<SampleConverter>(from, to, channels);
+    }
+    return *slot;
+}
+
+} // namespace
 
 ZmqPublisher::ZmqPublisher(const std::string& address, 
                          const std::string& topic,
-                         std::shared_ptr<AudioBuffer> audioBuffer,
-                         std::shared_ptr<AudioCapture> audioCapture,
+                         std::shared_ptr<AudioSource> audioSource,
                          const std::string& serviceName,
-                         const std::string& streamId)
+                         const std::string& streamId,
+                         std::shared_ptr<zmq::context_t> context)
     : address_(address),
       topic_(topic),
       serviceName_(serviceName),
-      streamId_(streamId),
-      audioBuffer_(audioBuffer),
-      audioCapture_(audioCapture),
+      context_(context),
       running_(false),
-      initialized_(false) {
+      initialized_(false),
+      outboundQueue_(kOutboundQueueSize),
+      droppedBlocks_(0),
+      batchController_(std::make_unique<BatchController>()),
+      convertFormat_(false),
+      codecInputBytes_(0),
+      codecOutputBytes_(0),
+      levelIntervalMs_(0) {
+    
+    streams_.push_back({streamId, topic, audioSource, std::make_shared<PublishCounters>(),
+                        std::make_shared<std::atomic<int>>(0), 0, nullptr, ""});
+}
+
+size_t ZmqPublisher::addDerivedStream(const std::string& streamId, const std::string& topic, size_t parent,
+                                      const ChannelMatrix& matrix, int outputRate) {
+    if (running_) {
+        std::cerr << "Cannot add stream " << streamId << " while publishing" << std::endl;
+        return 0;
+    }
+    
+    if (parent >= streams_.size() || streams_[parent].isDerived() || streams_[parent].isEncoded()) {
+        std::cerr << "Derived stream " << streamId << " needs a captured stream to derive from" << std::endl;
+        return 0;
+    }
+    
+    streams_.push_back({streamId, topic, streams_[parent].source, std::make_shared<PublishCounters>(),
+                        std::make_shared<std::atomic<int>>(outputRate), parent,
+                        std::make_shared<ChannelMixer>(matrix), ""});
+    return streams_.size() - 1;
+}
+
+size_t ZmqPublisher::addEncodedStream(const std::string& streamId, const std::string& topic, size_t parent,
+                                      const std::string& encoding) {
+    if (running_) {
+        std::cerr << "Cannot add stream " << streamId << " while publishing" << std::endl;
+        return 0;
+    }
+    
+    if (parent >= streams_.size() || streams_[parent].isDerived() || streams_[parent].isEncoded() ||
+        encoding.empty()) {
+        std::cerr << "Encoded stream " << streamId << " needs a captured stream to encode" << std::endl;
+        return 0;
+    }
+    
+    streams_.push_back({streamId, topic, streams_[parent].source, std::make_shared<PublishCounters>(),
+                        std::make_shared<std::atomic<int>>(0), parent, nullptr, encoding});
+    return streams_.size() - 1;
+}
+
+bool ZmqPublisher::publishEncodedAudio(size_t stream, std::vector<uint8_t> packet, size_t frames,
+                                       std::map<std::string, nlohmann::json> metadata) {
+    if (!running_ || stream >= streams_.size() || !streams_[stream].isEncoded()) {
+        return false;
+    }
+    
+    try {
+        message_format::DataMessage msg;
+        msg.message_type = message_format::MessageType::DATA;
+        msg.timestamp = message_format::getCurrentTimestamp();
+        msg.service = serviceName_;
+        if (!streams_[stream].streamId.empty()) {
+            msg.stream_id = streams_[stream].streamId;
+        }
+        metadata["codec"] = streams_[stream].encoding;
+        metadata["frames"] = frames;
+        msg.metadata = metadata;
+        
+        OutboundMessage message;
+        message.kind = OutboundMessage::Kind::Encoded;
+        message.stream = stream;
+        message.json = std::make_shared<const std::string>(msg.toJson().dump());
+        message.payload = std::make_shared<const std::vector<uint8_t>>(std::move(packet));
+        message.frames = frames;
+        if (!outboundQueue_.tryPush(std::move(message))) {
+            streams_[stream].counters->framesDropped.fetch_add(frames, std::memory_order_relaxed);
+            return false;
+        }
+        wakeCondition_.notify_one();
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error queueing encoded audio: " << e.what() << std::endl;
+    }
+    return false;
+}
+
+std::vector<size_t> ZmqPublisher::getDerivedStreams(size_t parent) const {
+    std::vector<size_t> derived;
+    for (size_t i = 0; i < streams_.size(); i++) {
+        if (streams_[i].isDerived() && streams_[i].parent == parent) {
+            derived.push_back(i);
+        }
+    }
+    return derived;
+}
+
+size_t ZmqPublisher::addStream(const std::string& streamId, const std::string& topic, std::shared_ptr<AudioSource> source) {
+    if (running_) {
+        std::cerr << "Cannot add stream " << streamId << " while publishing" << std::endl;
+        return 0;
+    }
+    
+    streams_.push_back({streamId, topic, source, std::make_shared<PublishCounters>(),
+                        std::make_shared<std::atomic<int>>(0), 0, nullptr, ""});
+    return streams_.size() - 1;
+}
+
+bool ZmqPublisher::setOutputRate(size_t stream, int sampleRate) {
+    if (stream >= streams_.size() || sampleRate < 0) {
+        return false;
+    }
+    
+    // The sender thread picks the new rate up with the stream's next block
+    streams_[stream].outputRate->store(sampleRate, std::memory_order_relaxed);
+    return true;
+}
+
+int ZmqPublisher::getOutputRate(size_t stream) const {
+    if (stream >= streams_.size()) {
+        return 0;
+    }
+    
+    int rate = streams_[stream].outputRate->load(std::memory_order_relaxed);
+    return rate > 0 ? rate : streams_[stream].source->getSampleRate();
+}
+
+void ZmqPublisher::setBatching(const BatchingSettings& settings) {
+    if (running_) {
+        std::cerr << "Cannot change batching while publishing" << std::endl;
+        return;
+    }
+    
+    batchController_ = std::make_unique<BatchController>(settings);
+}
+
+void ZmqPublisher::setPublishFormat(const SampleSpec& spec) {
+    if (running_) {
+        std::cerr << "Cannot change the publish format while publishing" << std::endl;
+        return;
+    }
+    
+    convertFormat_ = true;
+    publishFormat_ = spec;
+}
+
+std::string ZmqPublisher::getPublishFormat() const {
+    return convertFormat_ ? publishFormat_.toString() : "native";
+}
+
+void ZmqPublisher::setPayloadCodec(std::unique_ptr<PayloadCodec> codec) {
+    if (running_) {
+        std::cerr << "Cannot change the payload codec while publishing" << std::endl;
+        return;
+    }
+    
+    codec_ = std::move(codec);
+}
+
+std::string ZmqPublisher::getPayloadCodec() const {
+    return codec_ ? codec_->getName() : "none";
+}
+
+void ZmqPublisher::setLevelMetering(int intervalMs) {
+    if (running_) {
+        std::cerr << "Cannot change level metering while publishing" << std::endl;
+        return;
+    }
+    
+    levelIntervalMs_ = std::max(0, intervalMs);
+}
+
+void ZmqPublisher::setSilenceGate(const GateSettings& settings) {
+    if (running_) {
+        std::cerr << "Cannot change the silence gate while publishing" << std::endl;
+        return;
+    }
+    
+    gateSettings_ = settings;
+}
+
+const SilenceGate* ZmqPublisher::getSilenceGate(size_t stream) const {
+    return stream < gates_.size() ? gates_[stream].get() : nullptr;
 }
 
 ZmqPublisher::~ZmqPublisher() {
@@ -29,8 +223,10 @@ bool ZmqPublisher::initialize() {
     }
     
     try {
-        // Create ZMQ context and socket
-        context_ = std::make_unique<zmq::context_t>(1);
+        // Create ZMQ context (unless one is shared with us) and socket
+        if (!context_) {
+            context_ = std::make_shared<zmq::context_t>(1);
+        }
         pubSocket_ = std::make_unique<zmq::socket_t>(*context_, ZMQ_PUB);
 
 // see discussion in message_format.hpp
@@ -64,6 +260,34 @@ bool ZmqPublisher::start() {
     
     running_ = true;
     
+    batches_.assign(streams_.size(), PendingBatch());
+    converters_.clear();
+    converters_.resize(streams_.size());
+    mixInputConverters_.clear();
+    mixInputConverters_.resize(streams_.size());
+    resamplers_.clear();
+    resamplers_.resize(streams_.size());
+    resampleInputConverters_.clear();
+    resampleInputConverters_.resize(streams_.size());
+    derived_.assign(streams_.size(), std::vector<size_t>());
+    for (size_t i = 0; i < streams_.size(); i++) {
+        derived_[i] = getDerivedStreams(i);
+    }
+    
+    levelWindows_.assign(streams_.size(), LevelWindow());
+    
+    // Derived streams follow their parent's gate; encoders read the ring, not the sender
+    gates_.clear();
+    gates_.resize(streams_.size());
+    for (size_t i = 0; i < streams_.size() && gateSettings_.enabled; i++) {
+        if (!streams_[i].isDerived() && !streams_[i].isEncoded()) {
+            gates_[i] = std::make_unique<SilenceGate>(gateSettings_);
+        }
+    }
+    for (auto& batch : batches_) {
+        batch.blocks.reserve(kMaxBatchBlocks);
+    }
+    
     // Start publisher thread
     publishThread_ = std::thread(&ZmqPublisher::publishLoop, this);
     
@@ -76,6 +300,7 @@ bool ZmqPublisher::stop() {
     }
     
     running_ = false;
+    wakeCondition_.notify_one();
     
     // Wait for thread to finish
     if (publishThread_.joinable()) {
@@ -89,28 +314,90 @@ bool ZmqPublisher::isRunning() const {
     return running_;
 }
 
-void ZmqPublisher::publishAudioData(const std::vector<uint8_t>& data, uint64_t timestamp) {
-    if (!running_ || !initialized_) {
+void ZmqPublisher::publishAudioData(size_t stream, const AudioBlockHandle& block) {
+    if (!running_ || !initialized_ || stream >= streams_.size()) {
         return;
     }
     
+    // Hand the block to the sender thread; never wait on the network here
+    OutboundMessage message;
+    message.kind = OutboundMessage::Kind::Audio;
+    message.stream = stream;
+    message.block = block;
+    if (!outboundQueue_.tryPush(std::move(message))) {
+        // Flagged as a gap on the next block of this stream that goes out
+        PublishCounters& counters = *streams_[stream].counters;
+        counters.framesDropped.fetch_add(block->frames, std::memory_order_relaxed);
+        counters.pendingGapFrames.fetch_add(block->frames, std::memory_order_relaxed);
+        droppedBlocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool ZmqPublisher::sendAudioFrames(size_t streamIndex, const uint8_t* data, size_t size, const SampleSpec& dataSpec,
+                                   int channels, std::map<std::string, nlohmann::json> metadata) {
+    if (!initialized_) {
+        return false;
+    }
+    
+    const PublishedStream& stream = streams_[streamIndex];
+    
     try {
+        // Derived streams come out in the captured format too, unless a publish format is set
+        SampleSpec captured;
+        bool knownFormat = SampleSpec::fromBitDepth(stream.source->getBitDepth(), captured);
+        SampleSpec published = dataSpec;
+        if (convertFormat_) {
+            published = publishFormat_;
+        } else if (knownFormat) {
+            published = captured;
+        }
+        
+        SampleConverter* converter = nullptr;
+        if (published != dataSpec && size > 0 && streamIndex < converters_.size()) {
+            converter = &cachedConverter(converters_[streamIndex], dataSpec, published, channels);
+        }
+        
         // Create a DataMessage
         message_format::DataMessage msg;
         msg.message_type = message_format::MessageType::DATA;
         msg.timestamp = message_format::getCurrentTimestamp();
         msg.service = serviceName_;
-        if (!streamId_.empty()) {
-            msg.stream_id = streamId_;
+        if (!stream.streamId.empty()) {
+            msg.stream_id = stream.streamId;
         }
-        msg.payload = data;
+        // The payload goes out as its own frame below, so it is not copied into msg
         
-        // Add audio metadata
-        std::map<std::string, nlohmann::json> metadata;
-        metadata["unix_timestamp_ms"] = timestamp;
-        metadata["sample_rate"] = audioCapture_->getSampleRate();
-        metadata["channels"] = audioCapture_->getChannels();
-        metadata["bit_depth"] = audioCapture_->getBitDepth();
+        // Add audio metadata next to the caller's timing fields
+        if (metadata.find("sample_rate") == metadata.end()) {
+            metadata["sample_rate"] = stream.source->getSampleRate();
+        }
+        metadata["channels"] = channels;
+        metadata["bit_depth"] = knownFormat || convertFormat_ ? published.bitDepth() : stream.source->getBitDepth();
+        metadata["sample_format"] = SampleSpec::formatName(published.format);
+        metadata["layout"] = published.layout == SampleLayout::Planar ? "planar" : "interleaved";
+        
+        // The payload in the published format, compressed when that makes it smaller
+        const uint8_t* payload = data;
+        size_t payloadSize = size;
+        if (converter && !converter->isIdentity() && codec_) {
+            codecInput_.resize(converter->outputBytes(size));
+            converter->convert(data, size, codecInput_.data());
+            payload = codecInput_.data();
+            payloadSize = codecInput_.size();
+            converter = nullptr;
+        }
+        bool encoded = false;
+        if (codec_ && channels > 0 && payloadSize > 0) {
+            size_t frames = payloadSize / (channels * published.bytesPerSample());
+            encoded = codec_->encode(payload, frames, channels, published, codecOutput_) &&
+                      codecOutput_.size() < payloadSize;
+        }
+        if (encoded) {
+            metadata["codec"] = codec_->getName();
+            metadata["payload_bytes"] = payloadSize;
+            codecInputBytes_.fetch_add(payloadSize, std::memory_order_relaxed);
+            codecOutputBytes_.fetch_add(codecOutput_.size(), std::memory_order_relaxed);
+        }
         msg.metadata = metadata;
         
         // Convert to JSON
@@ -118,8 +405,8 @@ void ZmqPublisher::publishAudioData(const std::vector<uint8_t>& data, uint64_t t
         std::string jsonString = jsonMsg.dump();
         
         // Send topic frame
-        zmq::message_t topicMsg(topic_.size());
-        memcpy(topicMsg.data(), topic_.data(), topic_.size());
+        zmq::message_t topicMsg(stream.topic.size());
+        memcpy(topicMsg.data(), stream.topic.data(), stream.topic.size());
         pubSocket_->send(topicMsg, zmq::send_flags::sndmore);
         
         // Send JSON message
@@ -127,19 +414,38 @@ void ZmqPublisher::publishAudioData(const std::vector<uint8_t>& data, uint64_t t
         memcpy(jsonMessage.data(), jsonString.data(), jsonString.size());
         pubSocket_->send(jsonMessage, zmq::send_flags::sndmore);
         
-        // Send binary payload
-        zmq::message_t dataMsg(data.size());
-        memcpy(dataMsg.data(), data.data(), data.size());
-        pubSocket_->send(dataMsg, zmq::send_flags::none);
+        // Send binary payload, converted straight into the message when not compressed
+        if (encoded) {
+            zmq::message_t dataMsg(codecOutput_.size());
+            memcpy(dataMsg.data(), codecOutput_.data(), codecOutput_.size());
+            pubSocket_->send(dataMsg, zmq::send_flags::none);
+        } else if (converter && !converter->isIdentity()) {
+            zmq::message_t dataMsg(converter->outputBytes(size));
+            converter->convert(data, size, dataMsg.data());
+            pubSocket_->send(dataMsg, zmq::send_flags::none);
+        } else {
+            // Silence markers carry an empty payload frame
+            zmq::message_t dataMsg(payloadSize);
+            if (payloadSize > 0) {
+                memcpy(dataMsg.data(), payload, payloadSize);
+            }
+            pubSocket_->send(dataMsg, zmq::send_flags::none);
+        }
         
+        return true;
     } catch (const zmq::error_t& e) {
         std::cerr << "ZMQ send error: " << e.what() << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Error sending audio data: " << e.what() << std::endl;
     }
+    return false;
 }
 
-void ZmqPublisher::publishStatusMessage(const std::map<std::string, nlohmann::json>& status, bool echo) {
+void ZmqPublisher::publishStatusMessage(size_t stream, const std::map<std::string, nlohmann::json>& status, bool echo) {
+    if (stream >= streams_.size()) {
+        return;
+    }
+    
     if (!initialized_) {
         if (!initialize()) {
             return;
@@ -152,23 +458,46 @@ void ZmqPublisher::publishStatusMessage(const std::map<std::string, nlohmann::js
         msg.message_type = message_format::MessageType::STATUS;
         msg.timestamp = message_format::getCurrentTimestamp();
         msg.service = serviceName_;
-        if (!streamId_.empty()) {
-            msg.stream_id = streamId_;
+        if (!streams_[stream].streamId.empty()) {
+            msg.stream_id = streams_[stream].streamId;
         }
         msg.status = status;
         
         // Convert to JSON
         nlohmann::json jsonMsg = msg.toJson();
-        std::string jsonString = jsonMsg.dump();
+        auto jsonString = std::make_shared<const std::string>(jsonMsg.dump());
         
         // Echo to stdout if requested
         if (echo) {
-            std::cout << "Status: " << jsonString << std::endl;
+            std::cout << "Status: " << *jsonString << std::endl;
         }
         
+        // Without a sender thread the caller is the only socket user, so send directly
+        if (!running_) {
+            sendJsonFrames(streams_[stream].topic, *jsonString);
+            return;
+        }
+        
+        OutboundMessage message;
+        message.kind = OutboundMessage::Kind::Status;
+        message.stream = stream;
+        message.json = jsonString;
+        if (!outboundQueue_.tryPush(std::move(message))) {
+            std::cerr << "Outbound queue full, dropping status message" << std::endl;
+            return;
+        }
+        wakeCondition_.notify_one();
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error sending status message: " << e.what() << std::endl;
+    }
+}
+
+void ZmqPublisher::sendJsonFrames(const std::string& topic, const std::string& jsonString) {
+    try {
         // Send topic frame
-        zmq::message_t topicMsg(topic_.size());
-        memcpy(topicMsg.data(), topic_.data(), topic_.size());
+        zmq::message_t topicMsg(topic.size());
+        memcpy(topicMsg.data(), topic.data(), topic.size());
         pubSocket_->send(topicMsg, zmq::send_flags::sndmore);
         
         // Send JSON message
@@ -178,32 +507,509 @@ void ZmqPublisher::publishStatusMessage(const std::map<std::string, nlohmann::js
         
     } catch (const zmq::error_t& e) {
         std::cerr << "ZMQ send error: " << e.what() << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Error sending status message: " << e.what() << std::endl;
+    }
+}
+
+void ZmqPublisher::sendEncodedFrames(const OutboundMessage& message) {
+    const PublishedStream& stream = streams_[message.stream];
+    
+    try {
+        // Send topic frame
+        zmq::message_t topicMsg(stream.topic.size());
+        memcpy(topicMsg.data(), stream.topic.data(), stream.topic.size());
+        pubSocket_->send(topicMsg, zmq::send_flags::sndmore);
+        
+        // Send JSON message
+        zmq::message_t jsonMessage(message.json->size());
+        memcpy(jsonMessage.data(), message.json->data(), message.json->size());
+        pubSocket_->send(jsonMessage, zmq::send_flags::sndmore);
+        
+        // Send the encoded packet
+        zmq::message_t dataMsg(message.payload->size());
+        memcpy(dataMsg.data(), message.payload->data(), message.payload->size());
+        pubSocket_->send(dataMsg, zmq::send_flags::none);
+        
+        stream.counters->framesPublished.fetch_add(message.frames, std::memory_order_relaxed);
+    } catch (const zmq::error_t& e) {
+        std::cerr << "ZMQ send error: " << e.what() << std::endl;
+        stream.counters->framesDropped.fetch_add(message.frames, std::memory_order_relaxed);
+    }
+}
+
+void ZmqPublisher::sendMessage(const OutboundMessage& message) {
+    const PublishedStream& stream = streams_[message.stream];
+    
+    switch (message.kind) {
+        case OutboundMessage::Kind::Audio:
+            if (batchController_->isAdaptive()) {
+                queueBatch(message.stream, message.block);
+            } else {
+                sendAudioBlocks(message.stream, &message.block, 1);
+            }
+            break;
+        case OutboundMessage::Kind::Status:
+            sendJsonFrames(stream.topic, *message.json);
+            break;
+        case OutboundMessage::Kind::Encoded:
+            sendEncodedFrames(message);
+            break;
+    }
+}
+
+void ZmqPublisher::sendAudioBlocks(size_t streamIndex, const AudioBlockHandle* blocks, size_t count) {
+    const PublishedStream& stream = streams_[streamIndex];
+    const AudioBlockHandle& first = blocks[0];
+    
+    size_t frames = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        frames += blocks[i]->frames;
+        bytes += blocks[i].size();
+    }
+    
+    // Timing fields describe the first frame of the message
+    const CaptureTime& time = first->time;
+    std::map<std::string, nlohmann::json> metadata;
+    metadata["unix_timestamp_ms"] = first->timestamp;
+    metadata["frame_index"] = time.frameIndex;
+    metadata["frames"] = frames;
+    metadata["adc_time"] = time.adcTime;
+    metadata["monotonic_ns"] = time.monotonicNs;
+    metadata["unix_timestamp_ns"] = time.epochNs;
+    if (batchController_->isAdaptive()) {
+        metadata["blocks"] = count;
+    }
+    
+    // Mark anything lost between the previous block and this one, at capture or in the queue.
+    // Batches end before any block with a gap, so only the first block can carry one.
+    CaptureGap gap = first->gap;
+    gap.droppedFrames += stream.counters->pendingGapFrames.exchange(0, std::memory_order_relaxed);
+    if (!gap.empty()) {
+        metadata["gap"] = message_format::gapToJson(gap);
+    }
+    
+    const uint8_t* data = first.data();
+    if (count > 1) {
+        batchScratch_.resize(bytes);
+        size_t offset = 0;
+        for (size_t i = 0; i < count; ++i) {
+            memcpy(batchScratch_.data() + offset, blocks[i].data(), blocks[i].size());
+            offset += blocks[i].size();
+        }
+        data = batchScratch_.data();
+    }
+    
+    SampleSpec captured;
+    SampleSpec::fromBitDepth(stream.source->getBitDepth(), captured);
+    
+    // Levels cover every captured message, including silence the gate holds back
+    if (levelIntervalMs_ > 0) {
+        meterLevels(streamIndex, data, frames, captured, metadata);
+    }
+    
+    SilenceGate* gate = gates_.empty() ? nullptr : gates_[streamIndex].get();
+    if (!gate) {
+        publishCaptured(streamIndex, data, frames, captured, std::move(metadata));
+        return;
+    }
+    
+    // The gate may hold this message back, or release earlier ones ahead of it
+    gate->process(data, bytes, frames, captured, stream.source->getSampleRate(), metadata, gateOutputs_);
+    for (SilenceGate::Output& output : gateOutputs_) {
+        if (output.silence) {
+            publishSilence(streamIndex, output.frames, captured, output.metadata);
+        } else {
+            publishCaptured(streamIndex, output.data, output.frames, captured, std::move(output.metadata));
+        }
+    }
+}
+
+void ZmqPublisher::publishCaptured(size_t streamIndex, const uint8_t* data, size_t frames, const SampleSpec& captured,
+                                   std::map<std::string, nlohmann::json> metadata) {
+    const PublishedStream& stream = streams_[streamIndex];
+    
+    // Derived layouts are computed once here, however many subscribers they have
+    if (!derived_[streamIndex].empty()) {
+        publishDerived(streamIndex, data, frames, captured, metadata);
+    }
+    
+    if (sendAtStreamRate(streamIndex, data, frames, captured, stream.source->getChannels(), std::move(metadata))) {
+        stream.counters->framesPublished.fetch_add(frames, std::memory_order_relaxed);
+    } else {
+        stream.counters->framesDropped.fetch_add(frames, std::memory_order_relaxed);
+        stream.counters->pendingGapFrames.fetch_add(frames, std::memory_order_relaxed);
+    }
+}
+
+void ZmqPublisher::publishSilence(size_t streamIndex, size_t frames, const SampleSpec& captured,
+                                  const std::map<std::string, nlohmann::json>& metadata) {
+    const PublishedStream& source = streams_[streamIndex];
+    const int channels = source.source->getChannels();
+    
+    for (size_t index : derived_[streamIndex]) {
+        ChannelMixer& mixer = *streams_[index].mixer;
+        if (mixer.getInputChannels() != channels) {
+            mixer.setInputChannels(channels);
+        }
+        if (mixer.getOutputChannels() == 0) {
+            continue;
+        }
+        
+        std::map<std::string, nlohmann::json> derivedMetadata = metadata;
+        derivedMetadata["derived_from"] = source.streamId;
+        derivedMetadata["channel_map"] = mixer.getMatrix().spec;
+        sendSilenceMarker(index, frames, captured, mixer.getOutputChannels(), std::move(derivedMetadata));
+    }
+    
+    sendSilenceMarker(streamIndex, frames, captured, channels, metadata);
+}
+
+bool ZmqPublisher::sendSilenceMarker(size_t streamIndex, size_t frames, const SampleSpec& dataSpec, int channels,
+                                     std::map<std::string, nlohmann::json> metadata) {
+    const PublishedStream& stream = streams_[streamIndex];
+    const int inputRate = stream.source->getSampleRate();
+    const int outputRate = stream.outputRate->load(std::memory_order_relaxed);
+    metadata.erase("levels");  // Of the first silent message only
+    
+    // Resampled streams count the span at their own rate and start afresh after it
+    if (outputRate > 0 && outputRate != inputRate) {
+        std::unique_ptr<Resampler>& resampler = resamplers_[streamIndex];
+        if (!resampler || resampler->getInputRate() != inputRate || resampler->getOutputRate() != outputRate ||
+            resampler->getChannels() != channels) {
+            resampler = std::make_unique<Resampler>(inputRate, outputRate, channels);
+        }
+        const uint64_t outputFrames = static_cast<uint64_t>(frames) * outputRate / inputRate;
+        metadata["frame_index"] = resampler->getOutputFrames();
+        metadata["frames"] = outputFrames;
+        metadata["sample_rate"] = outputRate;
+        metadata["capture_sample_rate"] = inputRate;
+        auto gap = metadata.find("gap");
+        if (gap != metadata.end() && gap->second.contains("dropped_frames")) {
+            uint64_t dropped = gap->second["dropped_frames"].get<uint64_t>();
+            gap->second["dropped_frames"] = dropped * static_cast<uint64_t>(outputRate) / static_cast<uint64_t>(inputRate);
+        }
+        resampler->reset();
+        resampler->skip(outputFrames);
+    }
+    
+    return sendAudioFrames(streamIndex, nullptr, 0, dataSpec, channels, std::move(metadata));
+}
+
+void ZmqPublisher::meterLevels(size_t streamIndex, const uint8_t* data, size_t frames, const SampleSpec& captured,
+                               std::map<std::string, nlohmann::json>& metadata) {
+    const PublishedStream& stream = streams_[streamIndex];
+    const int channels = stream.source->getChannels();
+    
+    messageLevels_.clear();
+    levelMeter_.measure(data, frames, captured, channels, messageLevels_);
+    metadata["levels"] = LevelMeter::toJson(messageLevels_, frames);
+    
+    LevelWindow& window = levelWindows_[streamIndex];
+    if (window.frames == 0 || window.levels.size() != messageLevels_.size()) {
+        window.levels.assign(messageLevels_.size(), ChannelLevels());
+        window.frames = 0;
+        window.timing.clear();
+        for (const char* key : {"unix_timestamp_ms", "frame_index", "adc_time", "monotonic_ns", "unix_timestamp_ns"}) {
+            auto field = metadata.find(key);
+            if (field != metadata.end()) {
+                window.timing[key] = field->second;
+            }
+        }
+    }
+    for (size_t channel = 0; channel < messageLevels_.size(); ++channel) {
+        window.levels[channel].sumSquares += messageLevels_[channel].sumSquares;
+        window.levels[channel].peak = std::max(window.levels[channel].peak, messageLevels_[channel].peak);
+        window.levels[channel].clipped += messageLevels_[channel].clipped;
+    }
+    window.frames += frames;
+    
+    const size_t windowFrames = static_cast<size_t>(stream.source->getSampleRate()) * levelIntervalMs_ / 1000;
+    if (window.frames >= windowFrames) {
+        sendLevels(streamIndex, window);
+    }
+}
+
+void ZmqPublisher::sendLevels(size_t streamIndex, LevelWindow& window) {
+    const PublishedStream& stream = streams_[streamIndex];
+    
+    message_format::DataMessage msg;
+    msg.message_type = message_format::MessageType::DATA;
+    msg.timestamp = message_format::getCurrentTimestamp();
+    msg.service = serviceName_;
+    if (!stream.streamId.empty()) {
+        msg.stream_id = stream.streamId;
+    }
+    
+    // Timing of the window's first frame, then its levels; no audio payload follows
+    std::map<std::string, nlohmann::json> metadata = window.timing;
+    metadata["frames"] = window.frames;
+    metadata["sample_rate"] = stream.source->getSampleRate();
+    metadata["channels"] = window.levels.size();
+    nlohmann::json levels = LevelMeter::toJson(window.levels, window.frames);
+    for (auto& field : levels.items()) {
+        metadata[field.key()] = field.value();
+    }
+    msg.metadata = metadata;
+    
+    sendJsonFrames(stream.topic + "/levels", msg.toJson().dump());
+    window.frames = 0;
+}
+
+void ZmqPublisher::flushSilenceGates() {
+    for (size_t stream = 0; stream < gates_.size(); ++stream) {
+        if (!gates_[stream]) {
+            continue;
+        }
+        
+        SampleSpec captured;
+        SampleSpec::fromBitDepth(streams_[stream].source->getBitDepth(), captured);
+        gates_[stream]->flush(gateOutputs_);
+        for (const SilenceGate::Output& output : gateOutputs_) {
+            publishSilence(stream, output.frames, captured, output.metadata);
+        }
+    }
+}
+
+void ZmqPublisher::publishDerived(size_t parent, const uint8_t* data, size_t frames, const SampleSpec& captured,
+                                  const std::map<std::string, nlohmann::json>& metadata) {
+    const PublishedStream& source = streams_[parent];
+    const int channels = source.source->getChannels();
+    const SampleSpec floatPlanar{SampleFormat::Float32, SampleLayout::Planar};
+    bool planarReady = false;
+    
+    for (size_t index : derived_[parent]) {
+        const PublishedStream& stream = streams_[index];
+        ChannelMixer& mixer = *stream.mixer;
+        if (mixer.getInputChannels() != channels) {
+            mixer.setInputChannels(channels);
+        }
+        const int outputChannels = mixer.getOutputChannels();
+        if (outputChannels == 0) {
+            continue;  // The map does not fit this source (logged when resolved)
+        }
+        
+        std::map<std::string, nlohmann::json> derivedMetadata = metadata;
+        derivedMetadata.erase("levels");  // Of the captured channels
+        derivedMetadata["derived_from"] = source.streamId;
+        derivedMetadata["channel_map"] = mixer.getMatrix().spec;
+        
+        bool sent;
+        if (mixer.isSelection()) {
+            // Picking channels copies samples as captured, so it stays exact
+            const size_t bytes = frames * outputChannels * captured.bytesPerSample();
+            derivedScratch_.resize(bytes);
+            mixer.select(data, frames, captured.bytesPerSample(), derivedScratch_.data());
+            sent = sendAtStreamRate(index, derivedScratch_.data(), frames, captured, outputChannels,
+                                    std::move(derivedMetadata));
+        } else {
+            // Every mixing stream of this parent shares one float planar copy of the block
+            if (!planarReady) {
+                mixInput_.resize(frames * channels);
+                cachedConverter(mixInputConverters_[parent], captured, floatPlanar, channels)
+                    .convert(data, frames * channels * captured.bytesPerSample(), mixInput_.data());
+                planarReady = true;
+            }
+            mixOutput_.resize(frames * outputChannels);
+            mixer.mix(mixInput_.data(), frames, mixOutput_.data());
+            sent = sendAtStreamRate(index, reinterpret_cast<const uint8_t*>(mixOutput_.data()), frames,
+                                    floatPlanar, outputChannels, std::move(derivedMetadata));
+        }
+        
+        if (sent) {
+            stream.counters->framesPublished.fetch_add(frames, std::memory_order_relaxed);
+        } else {
+            stream.counters->framesDropped.fetch_add(frames, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool ZmqPublisher::sendAtStreamRate(size_t streamIndex, const uint8_t* data, size_t frames, const SampleSpec& dataSpec,
+                                    int channels, std::map<std::string, nlohmann::json> metadata) {
+    const PublishedStream& stream = streams_[streamIndex];
+    const int inputRate = stream.source->getSampleRate();
+    const int outputRate = stream.outputRate->load(std::memory_order_relaxed);
+    std::unique_ptr<Resampler>& resampler = resamplers_[streamIndex];
+    
+    if (outputRate <= 0 || outputRate == inputRate) {
+        resampler.reset();
+        return sendAudioFrames(streamIndex, data, frames * channels * dataSpec.bytesPerSample(), dataSpec,
+                               channels, std::move(metadata));
+    }
+    
+    if (!resampler || resampler->getInputRate() != inputRate || resampler->getOutputRate() != outputRate ||
+        resampler->getChannels() != channels) {
+        resampler = std::make_unique<Resampler>(inputRate, outputRate, channels);
+    } else if (metadata.find("gap") != metadata.end()) {
+        // Do not filter across missing audio
+        resampler->reset();
+    }
+    
+    // The resampler works on float planar; the sender converts to the published format after
+    const SampleSpec floatPlanar{SampleFormat::Float32, SampleLayout::Planar};
+    const float* input = reinterpret_cast<const float*>(data);
+    if (dataSpec != floatPlanar) {
+        resampleInput_.resize(frames * channels);
+        cachedConverter(resampleInputConverters_[streamIndex], dataSpec, floatPlanar, channels)
+            .convert(data, frames * channels * dataSpec.bytesPerSample(), resampleInput_.data());
+        input = resampleInput_.data();
+    }
+    
+    const uint64_t firstOutput = resampler->getOutputFrames();
+    double offset = 0.0;
+    const size_t outputFrames = resampler->process(input, frames, resampleOutput_, offset);
+    if (outputFrames == 0) {
+        return true;  // Still filling the filter
+    }
+    
+    // Timing fields move to the first resampled frame and count frames at the output rate
+    const double shiftSeconds = offset / inputRate;
+    const auto shiftNs = static_cast<int64_t>(std::llround(shiftSeconds * 1e9));
+    auto retime = [&](const char* key, int64_t shift) {
+        auto field = metadata.find(key);
+        if (field != metadata.end() && field->second.is_number_integer() && field->second.get<int64_t>() != 0) {
+            field->second = field->second.get<int64_t>() + shift;
+        }
+    };
+    retime("monotonic_ns", shiftNs);
+    retime("unix_timestamp_ns", shiftNs);
+    retime("unix_timestamp_ms", shiftNs / 1000000);
+    auto adcTime = metadata.find("adc_time");
+    if (adcTime != metadata.end() && adcTime->second.get<double>() != 0.0) {
+        adcTime->second = adcTime->second.get<double>() + shiftSeconds;
+    }
+    auto gap = metadata.find("gap");
+    if (gap != metadata.end() && gap->second.contains("dropped_frames")) {
+        uint64_t dropped = gap->second["dropped_frames"].get<uint64_t>();
+        gap->second["dropped_frames"] = dropped * static_cast<uint64_t>(outputRate) / static_cast<uint64_t>(inputRate);
+    }
+    metadata["frame_index"] = firstOutput;
+    metadata["frames"] = outputFrames;
+    metadata["sample_rate"] = outputRate;
+    metadata["capture_sample_rate"] = inputRate;
+    
+    return sendAudioFrames(streamIndex, reinterpret_cast<const uint8_t*>(resampleOutput_.data()),
+                           resampleOutput_.size() * sizeof(float), floatPlanar, channels, std::move(metadata));
+}
+
+void ZmqPublisher::queueBatch(size_t stream, const AudioBlockHandle& block) {
+    PendingBatch& batch = batches_[stream];
+    
+    // A message holds one contiguous run: a gap or a jump in frame index starts a new one
+    if (!batch.blocks.empty()) {
+        const AudioBlockHandle& last = batch.blocks.back();
+        bool contiguous = block->gap.empty() &&
+                          block->time.frameIndex == last->time.frameIndex + last->frames;
+        if (!contiguous) {
+            flushBatch(stream);
+        }
+    }
+    
+    if (batch.blocks.empty()) {
+        batch.firstQueued = std::chrono::steady_clock::now();
+    }
+    batch.blocks.push_back(block);
+    batch.frames += block->frames;
+    
+    if (batch.frames >= batchController_->chunkFrames(streams_[stream].source->getSampleRate()) ||
+        batch.blocks.size() >= kMaxBatchBlocks) {
+        flushBatch(stream);
+    }
+}
+
+void ZmqPublisher::flushBatch(size_t stream) {
+    PendingBatch& batch = batches_[stream];
+    if (batch.blocks.empty()) {
+        return;
+    }
+    
+    sendAudioBlocks(stream, batch.blocks.data(), batch.blocks.size());
+    
+    // Return the blocks to the capture pool
+    batch.blocks.clear();
+    batch.frames = 0;
+}
+
+void ZmqPublisher::flushDueBatches(std::chrono::steady_clock::time_point now) {
+    const auto maxWait = std::chrono::milliseconds(batchController_->getChunkMs());
+    for (size_t stream = 0; stream < batches_.size(); ++stream) {
+        if (!batches_[stream].blocks.empty() && now - batches_[stream].firstQueued >= maxWait) {
+            flushBatch(stream);
+        }
+    }
+}
+
+void ZmqPublisher::drainOutboundQueue() {
+    OutboundMessage message;
+    while (outboundQueue_.tryPop(message)) {
+        sendMessage(message);
+        
+        // Return the block to the capture pool as soon as it is on the wire
+        message.block.reset();
+        message.json.reset();
+        message.payload.reset();
     }
 }
 
 void ZmqPublisher::publishLoop() {
-    // Buffer size to read at once (10ms of audio data)
-    const size_t bufferSize = audioBuffer_->getMaxSize() / 10;
+    if (!threadSchedule_.isDefault()) {
+        threadSchedule_.applyToCurrentThread("publisher");
+    }
+    recordThreadSchedule("publisher");
+    
+    // The capture thread does not signal, so wake up often enough to keep latency low
+    const auto idleWait = std::chrono::milliseconds(1);
+    
+    // Measurement window for the batch controller: time spent working and deepest backlog.
+    // A PUB socket never pushes back (it drops at the high-water mark), so falling behind
+    // shows up as messages piling up in our queue and as time spent in send.
+    auto windowStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration busy{0};
+    size_t maxBacklog = 0;
     
     while (running_) {
+        auto workStart = std::chrono::steady_clock::now();
+        maxBacklog = std::max(maxBacklog, outboundQueue_.size());
+        
         try {
-            // Get data from audio buffer
-            uint64_t timestamp;
-            std::vector<uint8_t> data = audioBuffer_->getData(bufferSize, timestamp);
+            drainOutboundQueue();
             
-            if (!data.empty()) {
-                publishAudioData(data, timestamp);
+            if (batchController_->isAdaptive()) {
+                flushDueBatches(std::chrono::steady_clock::now());
             }
-            
         } catch (const zmq::error_t& e) {
             std::cerr << "ZMQ error in publish loop: " << e.what() << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Error in publish loop: " << e.what() << std::endl;
         }
         
-        // Sleep for a short time to avoid busy-wait
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        auto now = std::chrono::steady_clock::now();
+        busy += now - workStart;
+        if (now - windowStart >= std::chrono::milliseconds(BatchController::kWindowMs)) {
+            double load = std::chrono::duration<double>(busy).count() /
+                          std::chrono::duration<double>(now - windowStart).count();
+            batchController_->update(load, maxBacklog, kOutboundQueueSize);
+            windowStart = now;
+            busy = std::chrono::steady_clock::duration::zero();
+            maxBacklog = 0;
+        }
+        
+        // Sleep until woken or the idle wait expires to avoid busy-wait
+        auto wait = batchController_->isAdaptive()
+            ? std::chrono::milliseconds(batchController_->getFlushIntervalMs())
+            : idleWait;
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wakeCondition_.wait_for(lock, wait);
+    }
+    
+    // Flush whatever was queued before stop()
+    try {
+        drainOutboundQueue();
+        for (size_t stream = 0; stream < batches_.size(); ++stream) {
+            flushBatch(stream);
+        }
+        // Silence still held back goes out as markers, so the stream accounts for every frame
+        flushSilenceGates();
+    } catch (const std::exception& e) {
+        std::cerr << "Error flushing publish queue: " << e.what() << std::endl;
     }
-} 
\ No newline at end of file
+}
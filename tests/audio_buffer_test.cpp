@@ -0,0 +1,323 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <chrono>
+#include "audio_buffer.hpp"
+#include "ring_util.hpp"
+
+// Test that lock-free mode consumes data in order and only returns whole frames
+TEST(AudioBufferTest, LockFreeModeConsumesWholeFrames) {
+    // 16-bit stereo: 4 bytes per frame
+    AudioBuffer buffer(48000, 2, 16, 100, 0, AudioBuffer::Mode::LockFree);
+
+    uint8_t block[40];
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = static_cast<uint8_t>(i);
+    }
+    buffer.addData(block, sizeof(block), 1000);
+
+    uint64_t timestamp = 0;
+    std::vector<uint8_t> first = buffer.getData(10, timestamp);
+    ASSERT_EQ(first.size(), 8u);
+    EXPECT_EQ(0, std::memcmp(first.data(), block, first.size()));
+
+    std::vector<uint8_t> rest = buffer.getData(sizeof(block), timestamp);
+    ASSERT_EQ(rest.size(), 32u);
+    EXPECT_EQ(0, std::memcmp(rest.data(), block + 8, rest.size()));
+
+    // Nothing left to consume
+    EXPECT_TRUE(buffer.getData(sizeof(block), timestamp).empty());
+    EXPECT_EQ(buffer.getDroppedBytes(), 0u);
+}
+
+// Stress test: a producer and a consumer hammer the lock-free buffer concurrently.
+// Every sample in a frame carries the frame's index, so a torn or reordered frame is detectable.
+TEST(AudioBufferTest, LockFreeModeHasNoTornFramesUnderContention) {
+    const int channels = 4;
+    const int bitDepth = 32;
+    const size_t frameBytes = channels * sizeof(uint32_t);
+    const uint32_t totalFrames = 2000000;
+
+    // Small ring (a few ms) so the producer laps the consumer constantly
+    AudioBuffer buffer(48000, channels, bitDepth, 5, 0, AudioBuffer::Mode::LockFree);
+
+    std::atomic<bool> producerDone(false);
+
+    std::thread producer([&]() {
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<uint32_t> blockFrames(1, 64);
+        std::vector<uint32_t> block;
+
+        uint32_t frame = 0;
+        while (frame < totalFrames) {
+            uint32_t count = std::min(blockFrames(gen), totalFrames - frame);
+            block.resize(count * channels);
+            for (uint32_t f = 0; f < count; f++) {
+                for (int c = 0; c < channels; c++) {
+                    block[f * channels + c] = frame + f;
+                }
+            }
+            buffer.addData(block.data(), block.size() * sizeof(uint32_t), frame);
+            frame += count;
+        }
+        producerDone = true;
+    });
+
+    uint64_t framesConsumed = 0;
+    int64_t lastFrame = -1;
+    uint64_t tornFrames = 0;
+    uint64_t reorderedFrames = 0;
+
+    auto consume = [&](const std::vector<uint8_t>& data) {
+        ASSERT_EQ(data.size() % frameBytes, 0u);
+        const uint32_t* samples = reinterpret_cast<const uint32_t*>(data.data());
+        size_t frames = data.size() / frameBytes;
+        for (size_t f = 0; f < frames; f++) {
+            uint32_t index = samples[f * channels];
+            for (int c = 1; c < channels; c++) {
+                if (samples[f * channels + c] != index) {
+                    tornFrames++;
+                }
+            }
+            if (static_cast<int64_t>(index) <= lastFrame) {
+                reorderedFrames++;
+            }
+            lastFrame = index;
+            framesConsumed++;
+        }
+    };
+
+    uint64_t timestamp;
+    while (!producerDone) {
+        consume(buffer.getData(777 * frameBytes, timestamp));
+    }
+
+    // Drain whatever is left
+    std::vector<uint8_t> tail;
+    do {
+        tail = buffer.getData(buffer.getMaxSize(), timestamp);
+        consume(tail);
+    } while (!tail.empty());
+
+    producer.join();
+
+    EXPECT_EQ(tornFrames, 0u);
+    EXPECT_EQ(reorderedFrames, 0u);
+
+    // Every frame is either delivered or accounted for as dropped
+    EXPECT_EQ(framesConsumed + buffer.getDroppedBytes() / frameBytes, totalFrames);
+    EXPECT_EQ(buffer.getDroppedBytes() % frameBytes, 0u);
+}
+
+// Test that independent cursors each consume the stream once, with their own sequence numbers
+TEST(AudioBufferTest, CursorsConsumeIndependently) {
+    // 16-bit mono: 2 bytes per frame, 1 kHz so one frame is one ms
+    AudioBuffer buffer(1000, 1, 16, 1000, 0, AudioBuffer::Mode::LockFree);
+
+    ReadCursor early = buffer.createCursor();
+    std::vector<uint8_t> block(20, 0x11);
+    buffer.addData(block.data(), block.size(), 5010);
+    ReadCursor late = buffer.createCursor();
+    ReadCursor oldest = buffer.createCursor(true);
+
+    ReadResult first = buffer.read(early, 8);
+    EXPECT_EQ(first.data.size(), 8u);
+    EXPECT_EQ(first.sequence, 0u);
+    EXPECT_EQ(first.timestamp, 5000u);
+
+    ReadResult second = buffer.read(early, 100);
+    EXPECT_EQ(second.data.size(), 12u);
+    EXPECT_EQ(second.sequence, 1u);
+    EXPECT_EQ(second.timestamp, 5004u);
+    EXPECT_FALSE(second.overrun());
+
+    // Nothing new for a cursor created after the data, and no sequence number is used up
+    ReadResult none = buffer.read(late, 100);
+    EXPECT_TRUE(none.data.empty());
+    EXPECT_EQ(late.sequence, 0u);
+
+    // A cursor from the oldest data sees the whole block
+    EXPECT_EQ(buffer.read(oldest, 100).data.size(), 20u);
+
+    // The buffer's own cursor is unaffected by the others
+    uint64_t timestamp = 0;
+    EXPECT_EQ(buffer.getData(100, timestamp).size(), 20u);
+}
+
+// Test that a lapped cursor skips to the oldest audio still held and reports what it lost
+TEST(AudioBufferTest, LappedCursorReportsLostFrames) {
+    // 8-bit mono at 1 kHz, 64 ms requested -> 64 byte ring
+    AudioBuffer buffer(1000, 1, 8, 64, 0, AudioBuffer::Mode::Locked);
+    ASSERT_EQ(buffer.getMaxSize(), 64u);
+
+    ReadCursor cursor = buffer.createCursor();
+    std::vector<uint8_t> block(16);
+    for (int i = 0; i < 6; i++) {
+        std::fill(block.begin(), block.end(), static_cast<uint8_t>(i));
+        buffer.addData(block.data(), block.size(), 16 * (i + 1));
+    }
+
+    // 96 bytes written into a 64 byte ring: the first two blocks are gone
+    ReadResult result = buffer.read(cursor, 1000);
+    EXPECT_TRUE(result.overrun());
+    EXPECT_EQ(result.lostFrames, 32u);
+    ASSERT_EQ(result.data.size(), 64u);
+    EXPECT_EQ(result.data.front(), 2);
+    EXPECT_EQ(result.data.back(), 5);
+    EXPECT_EQ(result.timestamp, 32u);
+    EXPECT_EQ(result.sequence, 0u);
+    EXPECT_EQ(buffer.getCurrentSize(), 64u);
+
+    uint64_t timestamp = 0;
+    buffer.getData(1000, timestamp);
+    EXPECT_EQ(buffer.getDroppedBytes(), 32u);
+}
+
+// Test that a timestamp range maps to the right bytes and reports what was already overwritten
+TEST(AudioBufferTest, ReadsRangeByTimestamp) {
+    // 8-bit mono at 1 kHz: one byte per ms, 64 byte ring
+    AudioBuffer buffer(1000, 1, 8, 64, 0, AudioBuffer::Mode::LockFree);
+
+    // Ten 10 ms blocks; byte value is the capture time of the frame
+    std::vector<uint8_t> block(10);
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < 10; j++) {
+            block[j] = static_cast<uint8_t>(i * 10 + j);
+        }
+        buffer.addData(block.data(), block.size(), 10 * (i + 1));
+    }
+
+    ReadResult range = buffer.readRange(50, 70);
+    ASSERT_EQ(range.data.size(), 20u);
+    EXPECT_EQ(range.data.front(), 50);
+    EXPECT_EQ(range.data.back(), 69);
+    EXPECT_EQ(range.timestamp, 50u);
+    EXPECT_FALSE(range.overrun());
+
+    // Only the last 64 ms are held
+    ReadResult clipped = buffer.readRange(20, 50);
+    EXPECT_EQ(clipped.lostFrames, 16u);
+    ASSERT_EQ(clipped.data.size(), 14u);
+    EXPECT_EQ(clipped.data.front(), 36);
+
+    // Reading a range does not consume anything
+    uint64_t timestamp = 0;
+    EXPECT_EQ(buffer.getData(1000, timestamp).size(), 64u);
+    EXPECT_TRUE(buffer.readRange(200, 100).data.empty());
+}
+
+// Test that resizing keeps the buffered audio, cursors and timestamps
+TEST(AudioBufferTest, ResizeKeepsBufferedAudio) {
+    // 8-bit mono at 1 kHz, 64 byte ring
+    AudioBuffer buffer(1000, 1, 8, 64, 0, AudioBuffer::Mode::LockFree);
+    ReadCursor cursor = buffer.createCursor();
+
+    std::vector<uint8_t> block(48);
+    for (size_t i = 0; i < block.size(); i++) {
+        block[i] = static_cast<uint8_t>(i);
+    }
+    buffer.addData(block.data(), block.size(), 48);
+
+    ASSERT_TRUE(buffer.resize(256));
+    EXPECT_EQ(buffer.getMaxSize(), 256u);
+    EXPECT_EQ(buffer.getCurrentSize(), 48u);
+
+    buffer.addData(block.data(), block.size(), 96);
+    ReadResult grown = buffer.read(cursor, 1000);
+    EXPECT_FALSE(grown.overrun());
+    ASSERT_EQ(grown.data.size(), 96u);
+    EXPECT_EQ(0, std::memcmp(grown.data.data(), block.data(), block.size()));
+    EXPECT_EQ(0, std::memcmp(grown.data.data() + 48, block.data(), block.size()));
+    EXPECT_EQ(grown.timestamp, 0u);
+
+    // Shrinking keeps the newest audio that fits
+    ASSERT_TRUE(buffer.resize(32));
+    ReadResult range = buffer.readRange(0, 96);
+    EXPECT_EQ(range.data.size(), 32u);
+    EXPECT_EQ(range.data.front(), 16);
+    EXPECT_EQ(range.lostFrames, 64u);
+}
+
+// Test that rings too large for kMaxBufferBytes, or for 32-bit arithmetic, are refused
+// without touching the current ring
+TEST(AudioBufferTest, ResizeRefusesOversizedRings) {
+    EXPECT_EQ(roundUpPowerOfTwo(5), 8u);
+    EXPECT_EQ(roundUpPowerOfTwo(~size_t(0)), 0u);
+
+    // 32 channels of int32 at 48 kHz: 10 minutes is ~3.7 GB, past INT_MAX
+    AudioBuffer buffer(48000, 32, 32, 100, 0, AudioBuffer::Mode::LockFree);
+    size_t size = buffer.getMaxSize();
+    EXPECT_FALSE(buffer.resize(600000));
+    EXPECT_EQ(buffer.getMaxSize(), size);
+    EXPECT_TRUE(buffer.resize(1000));
+    EXPECT_GT(buffer.getMaxSize(), size);
+}
+
+// Test that a running lock-free writer picks up resized rings without losing or tearing frames
+TEST(AudioBufferTest, ResizeWhileWriting) {
+    const int channels = 2;
+    const size_t frameBytes = channels * sizeof(uint32_t);
+    const uint32_t totalFrames = 200000;
+
+    AudioBuffer buffer(48000, channels, 32, 20, 0, AudioBuffer::Mode::LockFree);
+    ReadCursor cursor = buffer.createCursor();
+    std::atomic<bool> producerDone(false);
+
+    std::thread producer([&]() {
+        std::vector<uint32_t> block(32 * channels);
+        for (uint32_t frame = 0; frame < totalFrames; frame += 32) {
+            for (uint32_t f = 0; f < 32; f++) {
+                block[f * channels] = frame + f;
+                block[f * channels + 1] = frame + f;
+            }
+            buffer.addData(block.data(), block.size() * sizeof(uint32_t), frame);
+            // Roughly real-time pacing, so the writer is running during every resize
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+        producerDone = true;
+    });
+
+    uint64_t framesConsumed = 0;
+    uint64_t framesLost = 0;
+    int64_t lastFrame = -1;
+    bool ordered = true;
+    auto consume = [&](const ReadResult& chunk) {
+        framesLost += chunk.lostFrames;
+        const uint32_t* samples = reinterpret_cast<const uint32_t*>(chunk.data.data());
+        for (size_t f = 0; f < chunk.data.size() / frameBytes; f++) {
+            if (samples[f * channels] != samples[f * channels + 1] ||
+                static_cast<int64_t>(samples[f * channels]) <= lastFrame) {
+                ordered = false;
+            }
+            lastFrame = samples[f * channels];
+            framesConsumed++;
+        }
+    };
+
+    int resizes = 0;
+    int failedResizes = 0;
+    while (!producerDone) {
+        if (!buffer.resize(resizes % 2 ? 20 : 200, true)) {
+            failedResizes += producerDone ? 0 : 1;
+        }
+        resizes++;
+        for (int i = 0; i < 20; i++) {
+            consume(buffer.read(cursor, 4096));
+        }
+    }
+    producer.join();
+
+    ReadResult tail;
+    do {
+        tail = buffer.read(cursor, buffer.getMaxSize());
+        consume(tail);
+    } while (!tail.data.empty());
+
+    EXPECT_GT(resizes, 1);
+    EXPECT_EQ(failedResizes, 0);
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(framesConsumed + framesLost, totalFrames);
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "audio_capture.hpp"
+
+// This file is its own test binary (see tests/CMakeLists.txt): replacing the global
+// allocation functions would otherwise change every other test's heap as well.
+
+namespace {
+
+// Count heap allocations made while gCountAllocations is set
+std::atomic<bool> gCountAllocations(false);
+std::atomic<size_t> gAllocationCount(0);
+
+// Kept out of line so the compiler never pairs a visible malloc with a free elsewhere
+__attribute__((noinline)) void* countedAlloc(size_t size, size_t alignment) {
+    if (gCountAllocations.load(std::memory_order_relaxed)) {
+        gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    // aligned_alloc needs a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+__attribute__((noinline)) void countedFree(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void* countedAllocOrThrow(size_t size, size_t alignment) {
+    void* ptr = countedAlloc(size, alignment);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    return countedAllocOrThrow(size, 0);
+}
+void* operator new[](size_t size) {
+    return countedAllocOrThrow(size, 0);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAllocOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return countedAllocOrThrow(size, static_cast<size_t>(alignment));
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, 0);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, 0);
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    countedFree(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    countedFree(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    countedFree(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    countedFree(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    countedFree(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    countedFree(ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    countedFree(ptr);
+}
+
+// Test that the callback path does not touch the heap
+TEST(AudioCaptureAllocationTest, CallbackPathDoesNotAllocate) {
+    const int channels = 2;
+    const unsigned long framesPerBuffer = 480;
+    AudioCapture capture("", 48000, channels, 16, 10);
+    capture.prepareBlockPool(framesPerBuffer);
+
+    std::vector<int16_t> input(framesPerBuffer * channels);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<int16_t>(i);
+    }
+
+    // Keep a window of handles alive like a consumer queue would, without allocating
+    std::array<AudioBlockHandle, 8> held;
+    size_t received = 0;
+    bool contentsMatch = true;
+
+    capture.setAudioDataCallback([&](const AudioBlockHandle& block) {
+        if (block.size() != input.size() * sizeof(int16_t) ||
+            std::memcmp(block.data(), input.data(), block.size()) != 0) {
+            contentsMatch = false;
+        }
+        held[received % held.size()] = block;
+        received++;
+    });
+
+    gAllocationCount = 0;
+    gCountAllocations = true;
+    for (int i = 0; i < 1000; i++) {
+        capture.processInput(input.data(), framesPerBuffer);
+    }
+    gCountAllocations = false;
+
+    EXPECT_EQ(gAllocationCount.load(), 0u);
+    EXPECT_EQ(received, 1000u);
+    EXPECT_TRUE(contentsMatch);
+
+    // Only the held window is still checked out of the pool
+    auto pool = capture.getBlockPool();
+    EXPECT_EQ(pool->available(), pool->blockCount() - held.size());
+    EXPECT_EQ(pool->getExhaustedCount(), 0u);
+}
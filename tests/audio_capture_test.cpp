@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include "audio_capture.hpp"
+
+// Test fixture that drives the capture hot path without an audio device
+class AudioCaptureTest : public ::testing::Test {
+protected:
+    static constexpr int kSampleRate = 48000;
+    static constexpr int kChannels = 2;
+    static constexpr int kBitDepth = 16;
+    static constexpr unsigned long kFramesPerBuffer = 480;
+
+    void SetUp() override {
+        capture = std::make_unique<AudioCapture>("", kSampleRate, kChannels, kBitDepth, 10);
+        capture->prepareBlockPool(kFramesPerBuffer);
+
+        input.resize(kFramesPerBuffer * kChannels);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = static_cast<int16_t>(i);
+        }
+    }
+
+    std::unique_ptr<AudioCapture> capture;
+    std::vector<int16_t> input;
+};
+
+// Test that blocks return to the pool once the last handle is released
+TEST_F(AudioCaptureTest, BlocksReturnToPoolWhenReleased) {
+    std::vector<AudioBlockHandle> held;
+    held.reserve(AudioCapture::kBlockPoolSize + 1);
+
+    capture->setAudioDataCallback([&](const AudioBlockHandle& block) {
+        held.push_back(block);
+    });
+
+    // Exhaust the pool; the extra block is dropped instead of blocking
+    for (size_t i = 0; i < AudioCapture::kBlockPoolSize + 1; i++) {
+        capture->processInput(input.data(), kFramesPerBuffer);
+    }
+
+    auto pool = capture->getBlockPool();
+    EXPECT_EQ(held.size(), AudioCapture::kBlockPoolSize);
+    EXPECT_EQ(pool->available(), 0u);
+    EXPECT_EQ(pool->getExhaustedCount(), 1u);
+
+    // A copied handle keeps the block checked out
+    AudioBlockHandle extra = held.front();
+    held.clear();
+    EXPECT_EQ(pool->available(), pool->blockCount() - 1);
+
+    extra.reset();
+    EXPECT_EQ(pool->available(), pool->blockCount());
+}
+
+// Test that device flags and pool drops are counted and reported on the next delivered block
+TEST_F(AudioCaptureTest, CountsGapsAndMarksNextBlock) {
+    std::vector<AudioBlockHandle> held;
+    held.reserve(AudioCapture::kBlockPoolSize);
+
+    capture->setAudioDataCallback([&](const AudioBlockHandle& block) {
+        held.push_back(block);
+    });
+
+    capture->processInput(input.data(), kFramesPerBuffer, 0.0, 0.0, AudioSource::kInputOverflow);
+    ASSERT_EQ(held.size(), 1u);
+    EXPECT_EQ(held[0]->gap.inputOverflows, 1u);
+    EXPECT_EQ(held[0]->gap.droppedFrames, 0u);
+
+    // A clean block carries no gap
+    capture->processInput(input.data(), kFramesPerBuffer);
+    EXPECT_TRUE(held[1]->gap.empty());
+
+    // Exhaust the pool, then drop two blocks, one of them flagged
+    while (held.size() < AudioCapture::kBlockPoolSize) {
+        capture->processInput(input.data(), kFramesPerBuffer);
+    }
+    capture->processInput(input.data(), kFramesPerBuffer, 0.0, 0.0, AudioSource::kInputUnderflow);
+    capture->processInput(input.data(), kFramesPerBuffer);
+
+    // The next block that gets through reports both drops and the underflow
+    held.pop_back();
+    capture->processInput(input.data(), kFramesPerBuffer);
+    ASSERT_EQ(held.size(), AudioCapture::kBlockPoolSize);
+    EXPECT_EQ(held.back()->gap.droppedFrames, 2 * kFramesPerBuffer);
+    EXPECT_EQ(held.back()->gap.inputUnderflows, 1u);
+    EXPECT_EQ(held.back()->gap.inputOverflows, 0u);
+
+    CaptureCounters counters = capture->getCaptureCounters();
+    EXPECT_EQ(counters.inputOverflows, 1u);
+    EXPECT_EQ(counters.inputUnderflows, 1u);
+    EXPECT_EQ(counters.framesCaptured, (AudioCapture::kBlockPoolSize + 3) * kFramesPerBuffer);
+    EXPECT_EQ(counters.framesDropped, 2 * kFramesPerBuffer);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "file_audio_source.hpp"
+#include "synthetic_audio_source.hpp"
+
+// Write a minimal 16-bit PCM WAV file; bitDepth only changes what the header claims
+static void writeWavFile(const std::string& path, int sampleRate, int channels, const std::vector<int16_t>& samples,
+                         int bitDepth = 16) {
+    auto le16 = [](std::ofstream& out, uint16_t value) { out.put(value & 0xff); out.put(value >> 8); };
+    auto le32 = [&](std::ofstream& out, uint32_t value) { le16(out, value & 0xffff); le16(out, value >> 16); };
+
+    uint32_t dataBytes = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+    std::ofstream out(path, std::ios::binary);
+    out.write("RIFF", 4);
+    le32(out, 36 + dataBytes);
+    out.write("WAVE", 4);
+    out.write("fmt ", 4);
+    le32(out, 16);
+    le16(out, 1);
+    le16(out, channels);
+    le32(out, sampleRate);
+    le32(out, sampleRate * channels * 2);
+    le16(out, channels * 2);
+    le16(out, bitDepth);
+    out.write("data", 4);
+    le32(out, dataBytes);
+    out.write(reinterpret_cast<const char*>(samples.data()), dataBytes);
+}
+
+// Collect published bytes until at least minBytes have arrived or the timeout expires
+static std::vector<uint8_t> collect(AudioSource& source, size_t minBytes) {
+    std::mutex mutex;
+    std::vector<uint8_t> received;
+
+    source.setAudioDataCallback([&](const AudioBlockHandle& block) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.insert(received.end(), block.data(), block.data() + block.size());
+    });
+
+    EXPECT_TRUE(source.start());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (received.size() >= minBytes) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    source.stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return received;
+}
+
+// Test that a WAV file is replayed with its own format and loops at the end
+TEST(AudioSourceTest, FileSourceReplaysAndLoopsWav) {
+    std::string path = testing::TempDir() + "tessa_audio_source_test.wav";
+    std::vector<int16_t> samples(1000 * 2);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = static_cast<int16_t>(i * 7);
+    }
+    writeWavFile(path, 8000, 2, samples);
+
+    // Configured format differs from the file on purpose
+    FileAudioSource source(path, 48000, 1, 32, 10, ThreadedAudioSource::Pacing::AsFastAsPossible);
+    ASSERT_TRUE(source.initialize());
+    EXPECT_EQ(source.getSampleRate(), 8000);
+    EXPECT_EQ(source.getChannels(), 2);
+    EXPECT_EQ(source.getBitDepth(), 16);
+
+    size_t fileBytes = samples.size() * sizeof(int16_t);
+    std::vector<uint8_t> received = collect(source, 3 * fileBytes);
+    ASSERT_GE(received.size(), 3 * fileBytes);
+
+    // Every pass over the file must match the original samples
+    for (size_t offset = 0; offset + fileBytes <= received.size(); offset += fileBytes) {
+        EXPECT_EQ(0, std::memcmp(received.data() + offset, samples.data(), fileBytes)) << "Mismatch at offset " << offset;
+    }
+
+    std::remove(path.c_str());
+}
+
+// Test that WAV headers with a format nothing downstream can handle are rejected
+TEST(AudioSourceTest, FileSourceRejectsMalformedWav) {
+    std::string path = testing::TempDir() + "tessa_audio_source_malformed.wav";
+    std::vector<int16_t> samples(200, 100);
+
+    struct Header {
+        int sampleRate;
+        int channels;
+        int bitDepth;
+    };
+    for (const Header& header : {Header{48000, 0, 16}, Header{0, 2, 16}, Header{999, 2, 16},
+                                 Header{-44100, 2, 16}, Header{48000, 2, 12}, Header{48000, 2, 0}}) {
+        writeWavFile(path, header.sampleRate, header.channels, samples, header.bitDepth);
+        FileAudioSource source(path, 48000, 2, 16, 10, ThreadedAudioSource::Pacing::AsFastAsPossible);
+        EXPECT_FALSE(source.initialize()) << header.sampleRate << " Hz, " << header.channels << " channels, "
+                                          << header.bitDepth << " bit";
+    }
+
+    // The lowest accepted rate still works
+    writeWavFile(path, FileAudioSource::kMinSampleRate, 2, samples);
+    FileAudioSource source(path, 48000, 2, 16, 10, ThreadedAudioSource::Pacing::AsFastAsPossible);
+    EXPECT_TRUE(source.initialize());
+
+    std::remove(path.c_str());
+}
+
+// Test that the synthetic sine source produces full-format frames at the requested level
+TEST(AudioSourceTest, SyntheticSineHasExpectedPeak) {
+    SyntheticAudioSource source(SyntheticAudioSource::Waveform::Sine, 1000.0, 48000, 2, 16, 10,
+                                ThreadedAudioSource::Pacing::AsFastAsPossible);
+    ASSERT_TRUE(source.initialize());
+
+    std::vector<uint8_t> received = collect(source, 48000 * 2 * sizeof(int16_t));
+    ASSERT_EQ(received.size() % (2 * sizeof(int16_t)), 0u);
+
+    const int16_t* frames = reinterpret_cast<const int16_t*>(received.data());
+    size_t frameCount = received.size() / (2 * sizeof(int16_t));
+    int peak = 0;
+    for (size_t i = 0; i < frameCount; i++) {
+        EXPECT_EQ(frames[2 * i], frames[2 * i + 1]);
+        peak = std::max(peak, std::abs(static_cast<int>(frames[2 * i])));
+    }
+
+    // Half of full scale
+    EXPECT_NEAR(peak, 16383, 2);
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "capture_clock.hpp"
+
+namespace {
+
+// 10 ms blocks at 48 kHz, each reaching the callback 5 ms after its first frame hit the ADC
+const int kSampleRate = 48000;
+const unsigned long kFrames = 480;
+const int64_t kBlockNs = 10000000;
+const int64_t kLatencyNs = 5000000;
+const int64_t kStartNs = 1000000000000;  // Steady clock at frame 0
+const int64_t kEpochOffsetNs = 1700000000000000000;  // system_clock - steady_clock
+
+// Stamp block index with the callback running jitterNs late; systemStepNs moves the
+// system clock on its own (an NTP step)
+CaptureTime stampBlock(CaptureClock& clock, int64_t index, int64_t jitterNs, int64_t systemStepNs = 0) {
+    double adcTime = 100.0 + index * 0.01;
+    int64_t steadyNow = kStartNs + index * kBlockNs + kLatencyNs + jitterNs;
+    return clock.stamp(kFrames, adcTime, adcTime + kLatencyNs / 1e9, steadyNow,
+                       steadyNow + kEpochOffsetNs + systemStepNs);
+}
+
+int64_t idealNs(int64_t index) {
+    return kStartNs + index * kBlockNs;
+}
+
+} // namespace
+
+// Test that each block moves the frame 0 estimate by 1/64 of its error, so callback
+// jitter barely shows in the timestamps, which stay sample-accurate and increasing
+TEST(CaptureClockTest, SmoothsCallbackJitter) {
+    CaptureClock clock(kSampleRate);
+
+    CaptureTime first = stampBlock(clock, 0, 0);
+    EXPECT_EQ(first.frameIndex, 0u);
+    EXPECT_NEAR(static_cast<double>(first.monotonicNs), static_cast<double>(idealNs(0)), 2.0);
+    EXPECT_NEAR(static_cast<double>(first.epochNs), static_cast<double>(idealNs(0) + kEpochOffsetNs), 1024.0);
+
+    // 6.4 ms late: the estimate moves 0.1 ms
+    CaptureTime late = stampBlock(clock, 1, 6400000);
+    EXPECT_EQ(late.frameIndex, kFrames);
+    EXPECT_NEAR(static_cast<double>(late.monotonicNs), static_cast<double>(idealNs(1) + 100000), 2.0);
+
+    // Up to 2 ms of jitter either way settles to a small fraction of it
+    uint32_t state = 12345;
+    uint64_t previous = late.monotonicNs;
+    int64_t worstNs = 0;
+    for (int64_t index = 2; index < 2000; index++) {
+        state = state * 1664525u + 1013904223u;
+        int64_t jitterNs = static_cast<int64_t>(state >> 8) % 4000001 - 2000000;
+        CaptureTime time = stampBlock(clock, index, jitterNs);
+
+        ASSERT_EQ(time.frameIndex, static_cast<uint64_t>(index) * kFrames);
+        ASSERT_GT(time.monotonicNs, previous) << "block " << index;
+        previous = time.monotonicNs;
+        if (index >= 500) {
+            worstNs = std::max<int64_t>(worstNs, std::llabs(static_cast<int64_t>(time.monotonicNs) - idealNs(index)));
+        }
+    }
+    EXPECT_LT(worstNs, 500000);
+    EXPECT_EQ(clock.getFramesCaptured(), 2000u * kFrames);
+}
+
+// Test that an error of 50 ms or more re-anchors at once, while a smaller one is smoothed
+TEST(CaptureClockTest, ResyncsOnDiscontinuity) {
+    CaptureClock clock(kSampleRate);
+    for (int64_t index = 0; index < 10; index++) {
+        stampBlock(clock, index, 0);
+    }
+
+    // 40 ms off is still jitter
+    CaptureTime smoothed = stampBlock(clock, 10, 40000000);
+    EXPECT_NEAR(static_cast<double>(smoothed.monotonicNs), static_cast<double>(idealNs(10) + 40000000 / 64), 2.0);
+
+    // The stream stalled for 60 ms: timestamps follow the measurement from this block on
+    CaptureTime jumped = stampBlock(clock, 11, 60000000);
+    EXPECT_NEAR(static_cast<double>(jumped.monotonicNs), static_cast<double>(idealNs(11) + 60000000), 2.0);
+    CaptureTime next = stampBlock(clock, 12, 60000000);
+    EXPECT_NEAR(static_cast<double>(next.monotonicNs), static_cast<double>(idealNs(12) + 60000000), 2.0);
+
+    // Without PortAudio times the block is taken to have just completed
+    CaptureClock noAdc(kSampleRate);
+    CaptureTime estimated = noAdc.stamp(kFrames, 0.0, 0.0, kStartNs + kBlockNs, kStartNs + kBlockNs + kEpochOffsetNs);
+    EXPECT_NEAR(static_cast<double>(estimated.monotonicNs), static_cast<double>(kStartNs), 2.0);
+
+    // reset() starts over from frame 0
+    clock.reset(kSampleRate);
+    EXPECT_EQ(clock.getFramesCaptured(), 0u);
+    EXPECT_EQ(stampBlock(clock, 0, 0).frameIndex, 0u);
+}
+
+// Test that a step of the system clock is slewed into the epoch timestamps
+TEST(CaptureClockTest, SlewsSystemClockSteps) {
+    CaptureClock clock(kSampleRate);
+    for (int64_t index = 0; index < 10; index++) {
+        stampBlock(clock, index, 0);
+    }
+
+    // The system clock jumps 1 s ahead: the first block shows 1/64 of it
+    const int64_t stepNs = 1000000000;
+    CaptureTime stepped = stampBlock(clock, 10, 0, stepNs);
+    int64_t shown = static_cast<int64_t>(stepped.epochNs - stepped.monotonicNs) - kEpochOffsetNs;
+    EXPECT_NEAR(static_cast<double>(shown), stepNs / 64.0, 1024.0);
+
+    uint64_t previous = stepped.epochNs;
+    for (int64_t index = 11; index < 1000; index++) {
+        CaptureTime time = stampBlock(clock, index, 0, stepNs);
+        ASSERT_GT(time.epochNs, previous);
+        previous = time.epochNs;
+        shown = static_cast<int64_t>(time.epochNs - time.monotonicNs) - kEpochOffsetNs;
+    }
+    EXPECT_NEAR(static_cast<double>(shown), static_cast<double>(stepNs), 1e6);
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "capture_journal.hpp"
+
+namespace {
+
+// 8-bit mono at 1 kHz: one byte per ms, so byte values can carry their capture time
+const int kSampleRate = 1000;
+const int kSegmentMs = 100;
+
+// Header page, one page of segment table and the given number of 100 byte segments
+uint64_t journalSize(int segments) {
+    return 2 * 4096 + segments * 100;
+}
+
+void appendMs(CaptureJournal& journal, uint64_t fromMs, uint64_t toMs) {
+    std::vector<uint8_t> block;
+    for (uint64_t ms = fromMs; ms < toMs; ms++) {
+        block.push_back(static_cast<uint8_t>(ms));
+    }
+    journal.append(block.data(), block.size(), fromMs);
+}
+
+std::string journalPath(const char* name) {
+    std::string path = testing::TempDir() + name;
+    std::remove(path.c_str());
+    return path;
+}
+
+} // namespace
+
+// Test that appended audio is found by timestamp across segment boundaries
+TEST(CaptureJournalTest, ReadsRangeAcrossSegments) {
+    std::string path = journalPath("journal_range.jrnl");
+    CaptureJournal journal(path);
+    ASSERT_TRUE(journal.create(kSampleRate, 1, 8, journalSize(8), kSegmentMs));
+
+    for (uint64_t ms = 1000; ms < 1500; ms += 50) {
+        appendMs(journal, ms, ms + 50);
+    }
+
+    ReadResult range = journal.readRange(1120, 1260);
+    ASSERT_EQ(range.data.size(), 140u);
+    EXPECT_EQ(range.timestamp, 1120u);
+    EXPECT_EQ(range.data.front(), static_cast<uint8_t>(1120));
+    EXPECT_EQ(range.data.back(), static_cast<uint8_t>(1259));
+    EXPECT_FALSE(range.overrun());
+
+    uint64_t oldest = 0;
+    uint64_t newest = 0;
+    journal.getSpan(oldest, newest);
+    EXPECT_EQ(oldest, 1000u);
+    EXPECT_EQ(newest, 1500u);
+
+    journal.close();
+    std::remove(path.c_str());
+}
+
+// Test that old segments are recycled and reads stop at a gap in the recording
+TEST(CaptureJournalTest, RecyclesSegmentsAndStopsAtGaps) {
+    std::string path = journalPath("journal_recycle.jrnl");
+    CaptureJournal journal(path);
+    ASSERT_TRUE(journal.create(kSampleRate, 1, 8, journalSize(4), kSegmentMs));
+
+    // 1 s of audio into 400 ms of journal
+    for (uint64_t ms = 0; ms < 1000; ms += 25) {
+        appendMs(journal, ms, ms + 25);
+    }
+
+    ReadResult recycled = journal.readRange(500, 700);
+    EXPECT_EQ(recycled.lostFrames, 100u);
+    ASSERT_EQ(recycled.data.size(), 100u);
+    EXPECT_EQ(recycled.data.front(), static_cast<uint8_t>(600));
+
+    // A jump in time starts a new segment; a read stops where the audio stops
+    appendMs(journal, 5000, 5050);
+    ReadResult beforeGap = journal.readRange(950, 5050);
+    ASSERT_EQ(beforeGap.data.size(), 50u);
+    EXPECT_EQ(beforeGap.timestamp, 950u);
+
+    ReadResult afterGap = journal.readRange(5000, 5050);
+    ASSERT_EQ(afterGap.data.size(), 50u);
+    EXPECT_EQ(afterGap.data.front(), static_cast<uint8_t>(5000));
+
+    journal.close();
+    std::remove(path.c_str());
+}
+
+// Test that a journal can be read by another mapping and continued after reopening
+TEST(CaptureJournalTest, SurvivesReopen) {
+    std::string path = journalPath("journal_reopen.jrnl");
+    {
+        CaptureJournal writer(path);
+        ASSERT_TRUE(writer.create(kSampleRate, 1, 8, journalSize(8), kSegmentMs));
+        appendMs(writer, 2000, 2150);
+    }
+
+    CaptureJournal reader(path);
+    ASSERT_TRUE(reader.openForReading());
+    EXPECT_EQ(reader.getSampleRate(), kSampleRate);
+    EXPECT_EQ(reader.readRange(2000, 2150).data.size(), 150u);
+
+    // Continuing the journal keeps what is there
+    CaptureJournal writer(path);
+    ASSERT_TRUE(writer.create(kSampleRate, 1, 8, journalSize(8), kSegmentMs));
+    appendMs(writer, 2150, 2200);
+    EXPECT_EQ(reader.readRange(2000, 2200).data.size(), 200u);
+
+    // A different format starts over
+    ASSERT_TRUE(writer.create(kSampleRate, 2, 8, journalSize(8), kSegmentMs));
+    EXPECT_TRUE(writer.readRange(2000, 2200).data.empty());
+
+    reader.close();
+    writer.close();
+    std::remove(path.c_str());
+}
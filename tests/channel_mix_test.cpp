@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "channel_mix.hpp"
+#include "cpu_features.hpp"
+
+// Test that channel maps parse into per-output terms and malformed ones are rejected
+TEST(ChannelMixTest, ParsesMatrices) {
+    ChannelMatrix matrix;
+
+    ASSERT_TRUE(ChannelMatrix::parse("0.5*0+0.5*1;2", matrix));
+    ASSERT_EQ(matrix.outputs.size(), 2u);
+    ASSERT_EQ(matrix.outputs[0].size(), 2u);
+    EXPECT_EQ(matrix.outputs[0][1].first, 1);
+    EXPECT_FLOAT_EQ(matrix.outputs[0][1].second, 0.5f);
+    EXPECT_EQ(matrix.outputs[1][0].first, 2);
+
+    ASSERT_TRUE(ChannelMatrix::parse("mix", matrix));
+    EXPECT_TRUE(matrix.mixAll);
+
+    // "all" passes every channel through, exactly
+    ASSERT_TRUE(ChannelMatrix::parse("all", matrix));
+    ChannelMixer passthrough(matrix);
+    ASSERT_TRUE(passthrough.setInputChannels(3));
+    EXPECT_EQ(passthrough.getOutputChannels(), 3);
+    EXPECT_TRUE(passthrough.isSelection());
+
+    EXPECT_FALSE(ChannelMatrix::parse("", matrix));
+    EXPECT_FALSE(ChannelMatrix::parse("0;;1", matrix));
+    EXPECT_FALSE(ChannelMatrix::parse("left", matrix));
+    EXPECT_FALSE(ChannelMatrix::parse("x*0", matrix));
+
+    // Channels are checked against the source
+    ASSERT_TRUE(ChannelMatrix::parse("0;3", matrix));
+    ChannelMixer mixer(matrix);
+    EXPECT_FALSE(mixer.setInputChannels(2));
+    EXPECT_EQ(mixer.getOutputChannels(), 0);
+    EXPECT_TRUE(mixer.setInputChannels(4));
+    EXPECT_EQ(mixer.getOutputChannels(), 2);
+}
+
+// Test that picking channels copies samples of any width unchanged
+TEST(ChannelMixTest, SelectsChannelsExactly) {
+    ChannelMatrix matrix;
+    ASSERT_TRUE(ChannelMatrix::parse("2;0", matrix));
+    ChannelMixer mixer(matrix);
+    ASSERT_TRUE(mixer.setInputChannels(3));
+    EXPECT_TRUE(mixer.isSelection());
+
+    // Two frames of three 24-bit channels; sample n is bytes {n, n, n}
+    std::vector<uint8_t> input;
+    for (uint8_t sample = 0; sample < 6; sample++) {
+        input.insert(input.end(), 3, sample);
+    }
+    std::vector<uint8_t> output(2 * 2 * 3);
+    mixer.select(input.data(), 2, 3, output.data());
+    EXPECT_EQ(output, std::vector<uint8_t>({2, 2, 2, 0, 0, 0, 5, 5, 5, 3, 3, 3}));
+
+    ASSERT_TRUE(ChannelMatrix::parse("1", matrix));
+    ChannelMixer single(matrix);
+    ASSERT_TRUE(single.setInputChannels(3));
+    std::vector<uint8_t> mono(2 * 3);
+    single.select(input.data(), 2, 3, mono.data());
+    EXPECT_EQ(mono, std::vector<uint8_t>({1, 1, 1, 4, 4, 4}));
+}
+
+// Test mixing planar float, with every SIMD level matching the scalar result
+TEST(ChannelMixTest, MixesPlanarFloat) {
+    const size_t frames = 1003;  // Leaves a tail for the vector kernels
+    std::vector<float> input(8 * frames);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<float>(i % 97) / 97.0f - 0.5f;
+    }
+
+    ChannelMatrix matrix;
+    ASSERT_TRUE(ChannelMatrix::parse("mix", matrix));
+    ChannelMixer mono(matrix);
+    ASSERT_TRUE(mono.setInputChannels(8));
+    EXPECT_FALSE(mono.isSelection());
+    ASSERT_EQ(mono.getOutputChannels(), 1);
+
+    const SimdLevel detected = detectSimdLevel();
+    ASSERT_TRUE(setSimdLevel(SimdLevel::Scalar));
+    std::vector<float> expected(frames);
+    mono.mix(input.data(), frames, expected.data());
+
+    float mean = 0.0f;
+    for (int channel = 0; channel < 8; channel++) {
+        mean += input[channel * frames + 10] / 8.0f;
+    }
+    EXPECT_NEAR(expected[10], mean, 1e-6f);
+
+    for (SimdLevel level : {SimdLevel::Sse2, SimdLevel::Avx2}) {
+        if (static_cast<int>(level) > static_cast<int>(detected)) {
+            continue;
+        }
+        ASSERT_TRUE(setSimdLevel(level));
+        std::vector<float> actual(frames);
+        mono.mix(input.data(), frames, actual.data());
+        EXPECT_EQ(actual, expected) << simdLevelName(level);
+    }
+    setSimdLevel(detected);
+
+    // Weighted stereo out of the first two channels
+    ASSERT_TRUE(ChannelMatrix::parse("0.25*0+0.75*1;-1*1", matrix));
+    ChannelMixer stereo(matrix);
+    ASSERT_TRUE(stereo.setInputChannels(8));
+    std::vector<float> output(2 * frames);
+    stereo.mix(input.data(), frames, output.data());
+    EXPECT_FLOAT_EQ(output[5], 0.25f * input[5] + 0.75f * input[frames + 5]);
+    EXPECT_FLOAT_EQ(output[frames + 5], -input[frames + 5]);
+}
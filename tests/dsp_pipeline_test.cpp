@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "dsp_pipeline.hpp"
+#include "synthetic_audio_source.hpp"
+
+namespace {
+
+// Planar float channels, each a sine of its own frequency
+std::vector<float> sines(const std::vector<double>& hz, int sampleRate, size_t frames) {
+    std::vector<float> planar(hz.size() * frames);
+    for (size_t channel = 0; channel < hz.size(); channel++) {
+        for (size_t i = 0; i < frames; i++) {
+            planar[channel * frames + i] = static_cast<float>(0.5 * std::sin(2.0 * M_PI * hz[channel] * i / sampleRate));
+        }
+    }
+    return planar;
+}
+
+// Amplitude of a sine from its RMS over the second half of a channel, after filters have settled
+double settledAmplitude(const std::vector<float>& planar, size_t channel, size_t frames) {
+    double sum = 0.0;
+    for (size_t i = frames / 2; i < frames; i++) {
+        sum += planar[channel * frames + i] * planar[channel * frames + i];
+    }
+    return std::sqrt(2.0 * sum / (frames - frames / 2));
+}
+
+} // namespace
+
+// Test that chains parse in order with defaults, and malformed stages are rejected
+TEST(DspPipelineTest, ParsesChains) {
+    DspSettings settings;
+    ASSERT_TRUE(DspSettings::parse("dc,highpass:80,gain:-6", settings));
+    ASSERT_EQ(settings.stages.size(), 3u);
+    EXPECT_EQ(settings.stages[0].type, "dc");
+    EXPECT_EQ(settings.stages[0].value, 5.0);
+    EXPECT_EQ(settings.stages[1].type, "highpass");
+    EXPECT_EQ(settings.stages[1].value, 80.0);
+    EXPECT_EQ(settings.stages[2].value, -6.0);
+    EXPECT_EQ(settings.toString(), "dc:5,highpass:80,gain:-6");
+
+    DspSettings unchanged = settings;
+    EXPECT_FALSE(DspSettings::parse("gain", unchanged));
+    EXPECT_FALSE(DspSettings::parse("gain:90", unchanged));
+    EXPECT_FALSE(DspSettings::parse("bandpass:100", unchanged));
+    EXPECT_FALSE(DspSettings::parse("highpass:abc", unchanged));
+    EXPECT_FALSE(DspSettings::parse("lowpass:0", unchanged));
+    EXPECT_EQ(unchanged.stages.size(), 3u);
+
+    DspSettings empty;
+    ASSERT_TRUE(DspSettings::parse("", empty));
+    EXPECT_FALSE(empty.enabled());
+}
+
+// Test that the pipeline converts in place around its stages, saturating on the way back,
+// and times every step
+TEST(DspPipelineTest, AppliesGainInCapturedFormat) {
+    DspSettings settings;
+    ASSERT_TRUE(DspSettings::parse("gain:6.0206", settings));
+    DspPipeline pipeline(settings);
+    const SampleSpec int16{SampleFormat::Int16, SampleLayout::Interleaved};
+    ASSERT_TRUE(pipeline.configure(int16, 2, 48000));
+
+    std::vector<int16_t> samples = {100, -200, 1000, -16000, 20000, -20000};
+    pipeline.process(reinterpret_cast<uint8_t*>(samples.data()), 3);
+    EXPECT_EQ(samples, (std::vector<int16_t>{200, -400, 2000, -32000, 32767, -32768}));
+
+    std::vector<DspStageStats> stats = pipeline.getStats();
+    ASSERT_EQ(stats.size(), 3u);
+    EXPECT_EQ(stats[0].name, "to_float");
+    EXPECT_EQ(stats[1].name, "gain");
+    EXPECT_EQ(stats[2].name, "from_float");
+    for (const DspStageStats& step : stats) {
+        EXPECT_EQ(step.blocks, 1u);
+        EXPECT_EQ(step.frames, 3u);
+    }
+
+    // An empty chain gives the samples back unchanged
+    DspPipeline identity{DspSettings()};
+    ASSERT_TRUE(identity.configure(int16, 2, 48000));
+    std::vector<int16_t> copy = samples;
+    identity.process(reinterpret_cast<uint8_t*>(copy.data()), 3);
+    EXPECT_EQ(copy, samples);
+
+    // Cutoffs at or above Nyquist cannot run
+    ASSERT_TRUE(DspSettings::parse("lowpass:30000", settings));
+    DspPipeline tooHigh(settings);
+    EXPECT_FALSE(tooHigh.configure(int16, 2, 48000));
+}
+
+// Test the filters' responses, and that state carries across blocks per channel
+TEST(DspPipelineTest, FiltersPassAndStop) {
+    const int sampleRate = 48000;
+    const size_t frames = 48000;
+
+    // DC offset decays away
+    DcBlockStage dc(5.0);
+    ASSERT_TRUE(dc.configure(sampleRate, 1));
+    std::vector<float> offset(frames, 0.5f);
+    dc.process(offset.data(), frames, 0, 1);
+    EXPECT_LT(std::fabs(offset.back()), 1e-3);
+
+    // 1 kHz high-pass: 50 Hz down by more than 40 dB, 8 kHz passes
+    BiquadStage highpass(BiquadStage::Type::HighPass, 1000.0);
+    ASSERT_TRUE(highpass.configure(sampleRate, 2));
+    std::vector<float> tones = sines({50.0, 8000.0}, sampleRate, frames);
+    highpass.process(tones.data(), frames, 0, 2);
+    EXPECT_LT(settledAmplitude(tones, 0, frames), 0.5 * 0.01);
+    EXPECT_NEAR(settledAmplitude(tones, 1, frames), 0.5, 0.01);
+
+    // 1 kHz low-pass: the other way around, and -3 dB at the cutoff
+    BiquadStage lowpass(BiquadStage::Type::LowPass, 1000.0);
+    ASSERT_TRUE(lowpass.configure(sampleRate, 3));
+    tones = sines({50.0, 8000.0, 1000.0}, sampleRate, frames);
+    lowpass.process(tones.data(), frames, 0, 3);
+    EXPECT_NEAR(settledAmplitude(tones, 0, frames), 0.5, 0.01);
+    EXPECT_LT(settledAmplitude(tones, 1, frames), 0.5 * 0.02);
+    EXPECT_NEAR(settledAmplitude(tones, 2, frames), 0.5 / std::sqrt(2.0), 0.01);
+
+    // Block by block and channel by channel gives the same result as all at once
+    std::vector<float> whole = sines({300.0, 5000.0}, sampleRate, 960);
+    std::vector<float> pieces = whole;
+    BiquadStage once(BiquadStage::Type::HighPass, 1000.0);
+    ASSERT_TRUE(once.configure(sampleRate, 2));
+    once.process(whole.data(), 960, 0, 2);
+    BiquadStage split(BiquadStage::Type::HighPass, 1000.0);
+    ASSERT_TRUE(split.configure(sampleRate, 2));
+    for (size_t block = 0; block < 960; block += 480) {
+        std::vector<float> part(2 * 480);
+        for (size_t channel = 0; channel < 2; channel++) {
+            std::memcpy(&part[channel * 480], &pieces[channel * 960 + block], 480 * sizeof(float));
+        }
+        split.process(part.data(), 480, 1, 1);
+        split.process(part.data(), 480, 0, 1);
+        for (size_t channel = 0; channel < 2; channel++) {
+            std::memcpy(&pieces[channel * 960 + block], &part[channel * 480], 480 * sizeof(float));
+        }
+    }
+    EXPECT_EQ(pieces, whole);
+}
+
+// Test that the worker processes submitted blocks in order on its own thread, and drains
+// its queue on stop
+TEST(DspPipelineTest, WorkerProcessesOffCaptureThread) {
+    auto source = std::make_shared<SyntheticAudioSource>(SyntheticAudioSource::Waveform::Sine, 1000.0, 48000, 1, 16,
+                                                         10);
+    DspSettings settings;
+    ASSERT_TRUE(DspSettings::parse("gain:-6.0206", settings));
+
+    std::mutex mutex;
+    std::vector<int16_t> firstSamples;
+    std::vector<std::thread::id> threads;
+    DspWorker worker(0, settings, [&](const AudioBlockHandle& block) {
+        std::lock_guard<std::mutex> lock(mutex);
+        firstSamples.push_back(reinterpret_cast<const int16_t*>(block.data())[0]);
+        threads.push_back(std::this_thread::get_id());
+    });
+    ASSERT_TRUE(worker.start(source));
+
+    AudioBlockPool pool(8, 480 * sizeof(int16_t));
+    for (int i = 0; i < 4; i++) {
+        AudioBlockHandle block = pool.acquire();
+        ASSERT_TRUE(block);
+        int16_t* samples = reinterpret_cast<int16_t*>(block->data);
+        for (size_t j = 0; j < 480; j++) {
+            samples[j] = static_cast<int16_t>(1000 * (i + 1));
+        }
+        block->size = 480 * sizeof(int16_t);
+        block->frames = 480;
+        worker.submit(block);
+    }
+    worker.stop();
+
+    ASSERT_EQ(firstSamples, (std::vector<int16_t>{500, 1000, 1500, 2000}));
+    for (std::thread::id id : threads) {
+        EXPECT_NE(id, std::this_thread::get_id());
+    }
+    EXPECT_EQ(worker.getBlocksProcessed(), 4u);
+    EXPECT_EQ(worker.getFramesDropped(), 0u);
+    EXPECT_EQ(worker.getStageStats()[1].frames, 4u * 480);
+
+    // Nothing is taken once stopped
+    AudioBlockHandle late = pool.acquire();
+    late->size = 480 * sizeof(int16_t);
+    late->frames = 480;
+    worker.submit(late);
+    EXPECT_EQ(worker.getBlocksProcessed(), 4u);
+}
+
+// Test that splitting channel groups across a pool gives bit-identical output to running
+// on one thread, block after block, including a last group narrower than the others
+TEST(DspPipelineTest, PoolOutputMatchesSingleThread) {
+    const int channels = 30;
+    const size_t frames = 480;
+    const SampleSpec int24{SampleFormat::Int24, SampleLayout::Interleaved};
+    DspSettings settings;
+    ASSERT_TRUE(DspSettings::parse("dc,highpass:100,lowpass:9000,gain:3", settings));
+
+    DspPipeline single(settings);
+    ASSERT_TRUE(single.configure(int24, channels, 48000));
+    DspPipeline pooled(settings);
+    auto pool = std::make_shared<WorkStealingPool>(4);
+    pooled.setThreadPool(pool);
+    ASSERT_TRUE(pooled.configure(int24, channels, 48000));
+    EXPECT_EQ(pooled.getThreadCount(), 4u);
+
+    uint32_t state = 1;
+    for (int block = 0; block < 10; block++) {
+        std::vector<uint8_t> audio(frames * channels * 3);
+        for (uint8_t& byte : audio) {
+            state = state * 1664525u + 1013904223u;
+            byte = static_cast<uint8_t>(state >> 24);
+        }
+        std::vector<uint8_t> copy = audio;
+        single.process(audio.data(), frames);
+        pooled.process(copy.data(), frames);
+        ASSERT_EQ(audio, copy) << "block " << block;
+    }
+
+    std::vector<DspStageStats> stats = pooled.getStats();
+    ASSERT_EQ(stats.size(), 6u);
+    EXPECT_EQ(stats[2].name, "highpass");
+    EXPECT_EQ(stats[2].blocks, 10u);
+    EXPECT_EQ(stats[2].frames, 10u * frames);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "cpu_features.hpp"
+#include "level_meter.hpp"
+
+namespace {
+
+// Interleaved int16 stereo: a full-scale square wave on the left, a quiet sine on the right
+std::vector<uint8_t> testSignal(size_t frames) {
+    std::vector<uint8_t> data(frames * 2 * 2);
+    int16_t* samples = reinterpret_cast<int16_t*>(data.data());
+    for (size_t i = 0; i < frames; i++) {
+        samples[2 * i] = (i / 24) % 2 == 0 ? 32767 : -32768;
+        samples[2 * i + 1] = static_cast<int16_t>(std::lround(3276.7 * std::sin(2.0 * M_PI * i / 48.0)));
+    }
+    return data;
+}
+
+} // namespace
+
+// Test per-channel RMS, peak and clipping against known signals
+TEST(LevelMeterTest, MeasuresChannels) {
+    LevelMeter meter;
+    std::vector<ChannelLevels> levels;
+    const SampleSpec int16{SampleFormat::Int16, SampleLayout::Interleaved};
+    std::vector<uint8_t> audio = testSignal(960);
+    meter.measure(audio.data(), 960, int16, 2, levels);
+
+    ASSERT_EQ(levels.size(), 2u);
+    EXPECT_EQ(levels[0].clipped, 960u);
+    EXPECT_NEAR(levels[0].peak, 1.0f, 1e-6);
+    EXPECT_NEAR(LevelMeter::toDbfs(std::sqrt(levels[0].sumSquares / 960)), 0.0, 0.01);
+    EXPECT_EQ(levels[1].clipped, 0u);
+    EXPECT_NEAR(LevelMeter::toDbfs(levels[1].peak), -20.0, 0.01);
+    EXPECT_NEAR(LevelMeter::toDbfs(std::sqrt(levels[1].sumSquares / 960)), -23.0, 0.05);
+
+    nlohmann::json json = LevelMeter::toJson(levels, 960);
+    EXPECT_EQ(json["clipped"], nlohmann::json({960, 0}));
+    EXPECT_DOUBLE_EQ(json["peak_dbfs"][1].get<double>(), -20.0);
+
+    // Measuring again adds to the sums; silence reads as the floor
+    meter.measure(audio.data(), 960, int16, 2, levels);
+    EXPECT_EQ(levels[0].clipped, 1920u);
+    std::vector<ChannelLevels> silent;
+    std::vector<uint8_t> zeros(100 * 4);
+    meter.measure(zeros.data(), 100, int16, 2, silent);
+    EXPECT_EQ(LevelMeter::toDbfs(silent[0].peak), LevelMeter::kMinDbfs);
+}
+
+// Test that every kernel level gives the same results on odd lengths
+TEST(LevelMeterTest, KernelsAgree) {
+    const SimdLevel detected = detectSimdLevel();
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    const SampleSpec float32{SampleFormat::Float32, SampleLayout::Interleaved};
+
+    for (size_t frames : {1, 7, 33, 1001}) {
+        std::vector<float> samples(frames * 3);
+        for (float& sample : samples) {
+            sample = uniform(rng);
+        }
+        samples[0] = 1.0f;
+        samples[samples.size() - 1] = -1.0f;
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(samples.data());
+
+        std::vector<std::vector<ChannelLevels>> results;
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2}) {
+            if (!setSimdLevel(level)) {
+                continue;
+            }
+            LevelMeter meter;
+            std::vector<ChannelLevels> levels;
+            meter.measure(data, frames, float32, 3, levels);
+            results.push_back(levels);
+        }
+        for (const auto& levels : results) {
+            for (size_t channel = 0; channel < 3; channel++) {
+                EXPECT_NEAR(levels[channel].sumSquares, results[0][channel].sumSquares, 1e-3 * frames);
+                EXPECT_EQ(levels[channel].peak, results[0][channel].peak);
+                EXPECT_EQ(levels[channel].clipped, results[0][channel].clipped);
+            }
+        }
+        EXPECT_EQ(results[0][0].clipped + results[0][2].clipped, 2u);
+    }
+    setSimdLevel(detected);
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "mpsc_queue.hpp"
+
+// Test that capacity rounds up to a power of two, and that a full queue refuses pushes and
+// an empty one pops nothing, lap after lap
+TEST(MpscQueueTest, FullAndEmpty) {
+    EXPECT_EQ(MpscQueue<int>(0).capacity(), 2u);
+    EXPECT_EQ(MpscQueue<int>(5).capacity(), 8u);
+
+    MpscQueue<int> queue(4);
+    int item = -1;
+    EXPECT_FALSE(queue.tryPop(item));
+    EXPECT_EQ(item, -1);
+
+    for (int lap = 0; lap < 3; lap++) {
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(queue.tryPush(lap * 10 + i));
+        }
+        EXPECT_EQ(queue.size(), 4u);
+        EXPECT_FALSE(queue.tryPush(99));
+
+        // One pop frees exactly one slot
+        ASSERT_TRUE(queue.tryPop(item));
+        EXPECT_EQ(item, lap * 10);
+        EXPECT_TRUE(queue.tryPush(lap * 10 + 4));
+        EXPECT_FALSE(queue.tryPush(99));
+
+        for (int i = 1; i <= 4; i++) {
+            ASSERT_TRUE(queue.tryPop(item));
+            EXPECT_EQ(item, lap * 10 + i);
+        }
+        EXPECT_FALSE(queue.tryPop(item));
+        EXPECT_EQ(queue.size(), 0u);
+    }
+}
+
+// Test that a popped slot lets go of its item instead of keeping it alive
+TEST(MpscQueueTest, PopReleasesSlot) {
+    MpscQueue<std::shared_ptr<int>> queue(2);
+    std::shared_ptr<int> value = std::make_shared<int>(7);
+    ASSERT_TRUE(queue.tryPush(std::shared_ptr<int>(value)));
+    EXPECT_EQ(value.use_count(), 2);
+
+    std::shared_ptr<int> popped;
+    ASSERT_TRUE(queue.tryPop(popped));
+    EXPECT_EQ(*popped, 7);
+    popped.reset();
+    EXPECT_EQ(value.use_count(), 1);
+}
+
+// Test that with several producers racing through a small queue, every item arrives
+// exactly once and each producer's items arrive in the order it pushed them
+TEST(MpscQueueTest, ManyProducersDeliverEachItemOnceInOrder) {
+    const int producers = 4;
+    const uint32_t perProducer = 100000;
+    MpscQueue<uint64_t> queue(64);
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> threads;
+    for (int producer = 0; producer < producers; producer++) {
+        threads.emplace_back([&, producer] {
+            while (!go) {
+                std::this_thread::yield();
+            }
+            for (uint32_t i = 0; i < perProducer; i++) {
+                uint64_t item = (static_cast<uint64_t>(producer) << 32) | i;
+                while (!queue.tryPush(std::move(item))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Keep draining on a mismatch so the producers can finish and be joined
+    std::vector<uint32_t> next(producers, 0);
+    uint64_t received = 0;
+    uint64_t outOfOrder = 0;
+    go = true;
+    while (received < producers * static_cast<uint64_t>(perProducer)) {
+        uint64_t item = 0;
+        if (!queue.tryPop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        size_t producer = static_cast<size_t>(item >> 32);
+        received++;
+        if (producer >= next.size() || static_cast<uint32_t>(item) != next[producer]) {
+            outOfOrder++;
+            continue;
+        }
+        next[producer]++;
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(outOfOrder, 0u);
+    uint64_t extra = 0;
+    EXPECT_FALSE(queue.tryPop(extra));
+    for (uint32_t count : next) {
+        EXPECT_EQ(count, perProducer);
+    }
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "opus_stream.hpp"
+#include "resampler.hpp"
+#include "synthetic_audio_source.hpp"
+
+#if defined(TESSA_HAVE_OPUS)
+
+namespace {
+
+struct Packet {
+    std::vector<uint8_t> data;
+    size_t frames;
+    std::map<std::string, nlohmann::json> metadata;
+};
+
+// Drives the encoder directly, without a reader thread or a publisher
+class RecordingEncoder : public OpusStreamEncoder {
+public:
+    explicit RecordingEncoder(int bitrate = kDefaultBitrate) : OpusStreamEncoder(nullptr, 1, bitrate) {}
+    ~RecordingEncoder() override { stop(); }
+
+    using OpusStreamEncoder::onRing;
+    using OpusStreamEncoder::onChunk;
+
+    std::vector<Packet> packets;
+
+protected:
+    void publishPacket(std::vector<uint8_t> packet, size_t frames,
+                       std::map<std::string, nlohmann::json> metadata) override {
+        packets.push_back({std::move(packet), frames, std::move(metadata)});
+    }
+};
+
+std::shared_ptr<SyntheticAudioSource> sourceOf(int sampleRate, int channels, int bitDepth = 16) {
+    return std::make_shared<SyntheticAudioSource>(SyntheticAudioSource::Waveform::Sine, 440.0, sampleRate, channels,
+                                                  bitDepth, 480);
+}
+
+// A ring chunk of 16-bit audio, a 440 Hz sine on every channel, starting at frame first
+ReadResult chunkOf(uint64_t first, size_t frames, int channels, int sampleRate, uint64_t timestamp,
+                   uint64_t lostFrames = 0) {
+    ReadResult chunk;
+    chunk.timestamp = timestamp;
+    chunk.lostFrames = lostFrames;
+    chunk.data.resize(frames * channels * sizeof(int16_t));
+    int16_t* samples = reinterpret_cast<int16_t*>(chunk.data.data());
+    for (size_t i = 0; i < frames; i++) {
+        double value = 0.5 * std::sin(2.0 * M_PI * 440.0 * (first + i) / sampleRate);
+        for (int channel = 0; channel < channels; channel++) {
+            samples[i * channels + channel] = static_cast<int16_t>(std::lround(value * 32767.0));
+        }
+    }
+    return chunk;
+}
+
+// Feed a second of audio in 10 ms chunks
+void feedSecond(RecordingEncoder& encoder, int sampleRate, int channels) {
+    const size_t frames = sampleRate / 100;
+    for (uint64_t block = 0; block < 100; block++) {
+        encoder.onChunk(chunkOf(block * frames, frames, channels, sampleRate, 1000000 + block * 10));
+    }
+}
+
+} // namespace
+
+// Test that formats Opus cannot take are refused, and that wide sources are mixed to mono
+// and odd rates resampled to 48 kHz, while mono and stereo at Opus rates pass as they are
+TEST(OpusStreamTest, EncodesInOpusFormat) {
+    RecordingEncoder tooLow(1000);
+    EXPECT_EQ(tooLow.getBitrate(), OpusStreamEncoder::kMinBitrate);
+    EXPECT_FALSE(tooLow.onRing(*sourceOf(48000, 2, 12)));
+
+    RecordingEncoder wide;
+    ASSERT_TRUE(wide.onRing(*sourceOf(44100, 6)));
+    feedSecond(wide, 44100, 6);
+    // The resampler holds a little back, so a packet may still be pending
+    ASSERT_GE(wide.packets.size(), 49u);
+    ASSERT_LE(wide.packets.size(), 50u);
+    for (const Packet& packet : wide.packets) {
+        EXPECT_EQ(packet.metadata.at("sample_rate"), 48000);
+        EXPECT_EQ(packet.metadata.at("channels"), 1);
+        EXPECT_EQ(packet.metadata.at("frame_ms"), OpusStreamEncoder::kFrameMs);
+        EXPECT_EQ(packet.frames, 960u);
+        EXPECT_FALSE(packet.data.empty());
+    }
+
+    RecordingEncoder stereo;
+    ASSERT_TRUE(stereo.onRing(*sourceOf(16000, 2)));
+    feedSecond(stereo, 16000, 2);
+    ASSERT_EQ(stereo.packets.size(), 50u);
+    EXPECT_EQ(stereo.packets[0].metadata.at("sample_rate"), 16000);
+    EXPECT_EQ(stereo.packets[0].metadata.at("channels"), 2);
+    EXPECT_EQ(stereo.packets[0].frames, 320u);
+    EXPECT_EQ(stereo.getPacketsEncoded(), 50u);
+}
+
+// Test that packets are 20 ms apart with consecutive indexes across chunks that do not
+// line up with them, and that after lost audio the next packet starts at the new audio,
+// carries the gap and keeps counting
+TEST(OpusStreamTest, PacketsStayContinuousAcrossReadsAndGaps) {
+    const int sampleRate = 48000;
+    RecordingEncoder encoder;
+    ASSERT_TRUE(encoder.onRing(*sourceOf(sampleRate, 1)));
+
+    // 20 chunks of 700 frames: 14 packets and 560 frames left over
+    const uint64_t start = 1000000;
+    for (uint64_t i = 0; i < 20; i++) {
+        encoder.onChunk(chunkOf(i * 700, 700, 1, sampleRate, start + i * 700 * 1000 / sampleRate));
+    }
+    ASSERT_EQ(encoder.packets.size(), 14u);
+    for (size_t i = 0; i < encoder.packets.size(); i++) {
+        const auto& metadata = encoder.packets[i].metadata;
+        EXPECT_EQ(metadata.at("packet_index").get<uint64_t>(), i);
+        EXPECT_EQ(metadata.at("unix_timestamp_ms").get<uint64_t>(), start + 20 * i);
+        EXPECT_EQ(metadata.count("gap"), 0u);
+    }
+
+    // 100 ms lost: the 560 pending frames are dropped with it
+    const uint64_t resumed = start + 14000 * 1000 / sampleRate + 100;
+    encoder.onChunk(chunkOf(0, 960, 1, sampleRate, resumed, 4800));
+    encoder.onChunk(chunkOf(960, 960, 1, sampleRate, resumed + 20));
+    ASSERT_EQ(encoder.packets.size(), 16u);
+
+    const auto& afterGap = encoder.packets[14].metadata;
+    EXPECT_EQ(afterGap.at("packet_index").get<uint64_t>(), 14u);
+    EXPECT_EQ(afterGap.at("unix_timestamp_ms").get<uint64_t>(), resumed);
+    ASSERT_EQ(afterGap.count("gap"), 1u);
+    EXPECT_EQ(afterGap.at("gap").at("dropped_frames").get<uint64_t>(), 4800u);
+
+    const auto& next = encoder.packets[15].metadata;
+    EXPECT_EQ(next.at("packet_index").get<uint64_t>(), 15u);
+    EXPECT_EQ(next.at("unix_timestamp_ms").get<uint64_t>(), resumed + 20);
+    EXPECT_EQ(next.count("gap"), 0u);
+}
+
+// Test that a packet starting in a later chunk of a resampled source is stamped at its
+// first resampled frame, which the resampler's delay puts before that chunk, as on the raw
+// stream's resampled messages
+TEST(OpusStreamTest, ResampledPacketsFollowResamplerTiming) {
+    const int sampleRate = 44100;
+    RecordingEncoder encoder;
+    ASSERT_TRUE(encoder.onRing(*sourceOf(sampleRate, 1)));
+
+    // 914 frames make exactly one packet at 48 kHz, so the next packet starts with the
+    // next chunk; the same resampler on its own says where that chunk's output starts
+    Resampler reference(sampleRate, 48000, 1);
+    std::vector<float> silence(914, 0.0f);
+    std::vector<float> output;
+    double offset = 0.0;
+    ASSERT_EQ(reference.process(silence.data(), 914, output, offset), 960u);
+    ASSERT_EQ(reference.process(silence.data(), 882, output, offset), 960u);
+    ASSERT_LT(offset, 0.0);
+
+    const uint64_t start = 1000000;
+    encoder.onChunk(chunkOf(0, 914, 1, sampleRate, start));
+    for (uint64_t i = 0; i < 10; i++) {
+        encoder.onChunk(chunkOf(914 + i * 882, 882, 1, sampleRate, start + 21 + i * 20));
+    }
+
+    ASSERT_EQ(encoder.packets.size(), 11u);
+    EXPECT_EQ(encoder.packets[0].metadata.at("unix_timestamp_ms").get<uint64_t>(), start);
+    const double resumedMs = start + 21 + 1000.0 * offset / sampleRate;
+    for (size_t i = 1; i < encoder.packets.size(); i++) {
+        EXPECT_EQ(encoder.packets[i].metadata.at("unix_timestamp_ms").get<uint64_t>(),
+                  static_cast<uint64_t>(resumedMs + 20.0 * (i - 1)));
+    }
+}
+
+#else
+
+// Test that without libopus the encoder says so and never starts
+TEST(OpusStreamTest, UnavailableWithoutLibopus) {
+    EXPECT_FALSE(OpusStreamEncoder::isAvailable());
+    OpusStreamEncoder encoder(nullptr, 1, OpusStreamEncoder::kDefaultBitrate);
+    EXPECT_FALSE(encoder.start(std::make_shared<SyntheticAudioSource>(SyntheticAudioSource::Waveform::Sine, 440.0,
+                                                                      48000, 1, 16, 480)));
+    EXPECT_FALSE(encoder.isRunning());
+}
+
+#endif
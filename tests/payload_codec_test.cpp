@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "payload_codec.hpp"
+
+namespace {
+
+// Interleaved int16 stereo: correlated tones with a little noise, like a room mic pair
+std::vector<uint8_t> stereoTone(size_t frames, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, 20.0);
+    std::vector<uint8_t> data(frames * 2 * 2);
+    int16_t* samples = reinterpret_cast<int16_t*>(data.data());
+    for (size_t i = 0; i < frames; i++) {
+        double t = static_cast<double>(i) / 48000.0;
+        double tone = 8000.0 * std::sin(2.0 * M_PI * 440.0 * t) + 3000.0 * std::sin(2.0 * M_PI * 1250.0 * t);
+        samples[2 * i] = static_cast<int16_t>(std::lround(tone + noise(rng)));
+        samples[2 * i + 1] = static_cast<int16_t>(std::lround(0.9 * tone + noise(rng)));
+    }
+    return data;
+}
+
+} // namespace
+
+// Test that codecs are created by name and that "none" means no codec
+TEST(PayloadCodecTest, CreatesCodecsByName) {
+    std::unique_ptr<PayloadCodec> codec;
+    ASSERT_TRUE(PayloadCodec::create("delta-rice", codec));
+    ASSERT_NE(codec, nullptr);
+    EXPECT_EQ(codec->getName(), "delta-rice");
+
+    EXPECT_TRUE(PayloadCodec::create("none", codec));
+    EXPECT_EQ(codec, nullptr);
+    EXPECT_FALSE(PayloadCodec::create("zip", codec));
+}
+
+// Test that audio round-trips bit-exactly and that tonal audio actually compresses
+TEST(PayloadCodecTest, CompressesAudioLosslessly) {
+    DeltaRiceCodec codec;
+    const SampleSpec int16{SampleFormat::Int16, SampleLayout::Interleaved};
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> decoded;
+
+    std::vector<uint8_t> audio = stereoTone(4800, 1);
+    ASSERT_TRUE(codec.encode(audio.data(), 4800, 2, int16, encoded));
+    EXPECT_LT(encoded.size(), audio.size() * 6 / 10);
+    ASSERT_TRUE(codec.decode(encoded.data(), encoded.size(), 4800, 2, int16, decoded));
+    EXPECT_EQ(decoded, audio);
+
+    // Every integer format and layout, with full-scale random data and odd lengths
+    std::mt19937 rng(7);
+    for (SampleFormat format : {SampleFormat::Int8, SampleFormat::Int16, SampleFormat::Int24, SampleFormat::Int32}) {
+        for (SampleLayout layout : {SampleLayout::Interleaved, SampleLayout::Planar}) {
+            for (size_t frames : {1, 3, 257, 1000}) {
+                const SampleSpec spec{format, layout};
+                std::vector<uint8_t> random(frames * 3 * spec.bytesPerSample());
+                for (auto& byte : random) {
+                    byte = static_cast<uint8_t>(rng());
+                }
+                ASSERT_TRUE(codec.encode(random.data(), frames, 3, spec, encoded));
+                ASSERT_TRUE(codec.decode(encoded.data(), encoded.size(), frames, 3, spec, decoded))
+                    << spec.toString() << " " << frames;
+                EXPECT_EQ(decoded, random) << spec.toString() << " " << frames;
+            }
+        }
+    }
+
+    // Float is left to the caller to send as it is
+    const SampleSpec float32{SampleFormat::Float32, SampleLayout::Interleaved};
+    EXPECT_FALSE(codec.encode(audio.data(), 2400, 1, float32, encoded));
+}
+
+// Test that truncated payloads are rejected instead of read past their end
+TEST(PayloadCodecTest, RejectsTruncatedPayloads) {
+    DeltaRiceCodec codec;
+    const SampleSpec int16{SampleFormat::Int16, SampleLayout::Interleaved};
+    std::vector<uint8_t> audio = stereoTone(1024, 2);
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> decoded;
+    ASSERT_TRUE(codec.encode(audio.data(), 1024, 2, int16, encoded));
+
+    EXPECT_FALSE(codec.decode(encoded.data(), encoded.size() / 2, 1024, 2, int16, decoded));
+    EXPECT_FALSE(codec.decode(encoded.data(), 0, 1024, 2, int16, decoded));
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "publish_batching.hpp"
+
+// Test that latency bounds parse and malformed ones are rejected
+TEST(PublishBatchingTest, ParsesLatencyBounds) {
+    BatchingSettings settings;
+    EXPECT_FALSE(settings.adaptive);
+    EXPECT_EQ(settings.toString(), "per_block");
+
+    ASSERT_TRUE(BatchingSettings::parse("2:80", settings));
+    EXPECT_TRUE(settings.adaptive);
+    EXPECT_EQ(settings.minLatencyMs, 2);
+    EXPECT_EQ(settings.maxLatencyMs, 80);
+
+    EXPECT_FALSE(BatchingSettings::parse("20", settings));
+    EXPECT_FALSE(BatchingSettings::parse("20:10", settings));
+    EXPECT_FALSE(BatchingSettings::parse("0:10", settings));
+    EXPECT_FALSE(BatchingSettings::parse("5:10ms", settings));
+}
+
+// Test that the chunk grows under load up to the upper bound and shrinks back when idle
+TEST(PublishBatchingTest, AdaptsChunkWithinBounds) {
+    BatchingSettings settings;
+    ASSERT_TRUE(BatchingSettings::parse("5:40", settings));
+    BatchController controller(settings);
+
+    EXPECT_EQ(controller.getChunkMs(), 5);
+    EXPECT_EQ(controller.getFlushIntervalMs(), 1);
+    EXPECT_EQ(controller.chunkFrames(48000), 240u);
+
+    // Busy sender
+    controller.update(0.8, 0, 256);
+    EXPECT_EQ(controller.getChunkMs(), 10);
+    EXPECT_EQ(controller.getLoadPercent(), 80u);
+
+    // Backlog alone is enough
+    controller.update(0.05, 100, 256);
+    EXPECT_EQ(controller.getChunkMs(), 20);
+
+    for (int i = 0; i < 5; ++i) {
+        controller.update(1.0, 256, 256);
+    }
+    EXPECT_EQ(controller.getChunkMs(), 40);
+    EXPECT_EQ(controller.getFlushIntervalMs(), 10);
+
+    // Moderate load holds the size
+    for (int i = 0; i < 50; ++i) {
+        controller.update(0.3, 10, 256);
+    }
+    EXPECT_EQ(controller.getChunkMs(), 40);
+
+    // Idle windows shrink it one step at a time
+    for (int i = 0; i < BatchController::kShrinkAfterWindows; ++i) {
+        controller.update(0.0, 0, 256);
+    }
+    EXPECT_EQ(controller.getChunkMs(), 20);
+
+    for (int i = 0; i < 10 * BatchController::kShrinkAfterWindows; ++i) {
+        controller.update(0.0, 0, 256);
+    }
+    EXPECT_EQ(controller.getChunkMs(), 5);
+}
+
+// Test that the controller leaves per-block publishing alone
+TEST(PublishBatchingTest, PerBlockModeDoesNotAdapt) {
+    BatchController controller;
+
+    controller.update(1.0, 256, 256);
+    EXPECT_FALSE(controller.isAdaptive());
+    EXPECT_EQ(controller.getChunkMs(), 0);
+    EXPECT_EQ(controller.getLoadPercent(), 100u);
+}
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <utility>
+#include "realtime_memory.hpp"
+
+// Test that buffers are page-aligned, zeroed, accounted for and movable
+TEST(RealtimeMemoryTest, BufferLifecycle) {
+    size_t before = RealtimeMemory::getBufferBytes();
+
+    RealtimeBuffer buffer(10000);
+    ASSERT_NE(buffer.data(), nullptr);
+    EXPECT_EQ(buffer.size(), 10000u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % 4096, 0u);
+    EXPECT_GE(RealtimeMemory::getBufferBytes(), before + 10000);
+
+    for (size_t i = 0; i < buffer.size(); i++) {
+        ASSERT_EQ(buffer.data()[i], 0) << "Byte " << i << " not zeroed";
+    }
+    std::memset(buffer.data(), 0xab, buffer.size());
+
+    RealtimeBuffer moved(std::move(buffer));
+    EXPECT_EQ(buffer.data(), nullptr);
+    EXPECT_EQ(moved.data()[9999], 0xab);
+
+    moved = RealtimeBuffer();
+    EXPECT_EQ(RealtimeMemory::getBufferBytes(), before);
+}
+
+// Test that huge page requests fall back to regular pages when none are reserved
+TEST(RealtimeMemoryTest, HugePagesFallBack) {
+    RealtimeMemory::setHugePages(true);
+    RealtimeBuffer buffer(4 * 1024 * 1024);
+    RealtimeMemory::setHugePages(false);
+
+    ASSERT_NE(buffer.data(), nullptr);
+    buffer.data()[buffer.size() - 1] = 1;
+    EXPECT_EQ(buffer.data()[buffer.size() - 1], 1);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include "cpu_features.hpp"
+#include "resampler.hpp"
+
+namespace {
+
+std::vector<float> sine(double frequency, int sampleRate, size_t frames, double amplitude = 0.5) {
+    std::vector<float> samples(frames);
+    for (size_t i = 0; i < frames; i++) {
+        samples[i] = static_cast<float>(amplitude * std::sin(2.0 * M_PI * frequency * i / sampleRate));
+    }
+    return samples;
+}
+
+// Amplitude of one frequency in a signal (single-bin DFT)
+double amplitudeAt(const std::vector<float>& samples, size_t from, double frequency, int sampleRate) {
+    double re = 0.0;
+    double im = 0.0;
+    for (size_t i = from; i < samples.size(); i++) {
+        double angle = 2.0 * M_PI * frequency * i / sampleRate;
+        re += samples[i] * std::cos(angle);
+        im += samples[i] * std::sin(angle);
+    }
+    return 2.0 * std::sqrt(re * re + im * im) / (samples.size() - from);
+}
+
+// Feed input in uneven blocks, collecting mono output
+std::vector<float> resampleInBlocks(Resampler& resampler, const std::vector<float>& input) {
+    std::vector<float> output;
+    std::vector<float> block;
+    double offset = 0.0;
+    size_t done = 0;
+    for (size_t size = 1; done < input.size(); size = size * 3 % 1021 + 7) {
+        size_t frames = std::min(size, input.size() - done);
+        resampler.process(input.data() + done, frames, block, offset);
+        output.insert(output.end(), block.begin(), block.end());
+        done += frames;
+    }
+    return output;
+}
+
+} // namespace
+
+// Test that a tone keeps its frequency and level across common rate changes
+TEST(ResamplerTest, PreservesTones) {
+    const int rates[][2] = {{48000, 16000}, {44100, 48000}, {48000, 44100}, {16000, 48000}, {48000, 44101}};
+    for (const auto& rate : rates) {
+        Resampler resampler(rate[0], rate[1], 1);
+        std::vector<float> output = resampleInBlocks(resampler, sine(1000.0, rate[0], rate[0]));
+
+        // One second in, one second out, less the filter delay still waiting for input
+        double delay = resampler.getTaps() / 2.0 * rate[1] / rate[0];
+        EXPECT_LE(static_cast<double>(output.size()), rate[1]);
+        EXPECT_GE(static_cast<double>(output.size()), rate[1] - delay - 1);
+        EXPECT_EQ(resampler.getOutputFrames(), output.size());
+
+        // Skip the filter's start-up, then compare against the expected tone
+        size_t settle = resampler.getTaps();
+        EXPECT_NEAR(amplitudeAt(output, settle, 1000.0, rate[1]), 0.5, 0.005) << rate[0] << " -> " << rate[1];
+        EXPECT_LT(amplitudeAt(output, settle, 1100.0, rate[1]), 0.005);
+    }
+}
+
+// Test that content above the new Nyquist rate is filtered out rather than aliased
+TEST(ResamplerTest, RejectsAliases) {
+    Resampler resampler(48000, 16000, 1);
+    // 12 kHz would alias to 4 kHz at 16 kHz
+    std::vector<float> output = resampleInBlocks(resampler, sine(12000.0, 48000, 48000));
+    EXPECT_LT(amplitudeAt(output, resampler.getTaps(), 4000.0, 16000), 0.5 * 1e-3);
+}
+
+// Test that block boundaries do not change the result and channels stay separate
+TEST(ResamplerTest, StreamsPlanarChannelsIndependentlyOfBlocking) {
+    const size_t frames = 9000;
+    std::vector<float> left = sine(440.0, 44100, frames);
+    std::vector<float> right = sine(3000.0, 44100, frames, 0.25);
+    std::vector<float> planar(left);
+    planar.insert(planar.end(), right.begin(), right.end());
+
+    Resampler stereo(44100, 16000, 2);
+    std::vector<float> whole;
+    double offset = 0.0;
+    size_t count = stereo.process(planar.data(), frames, whole, offset);
+    EXPECT_DOUBLE_EQ(offset, 0.0);
+
+    Resampler mono(44100, 16000, 1);
+    std::vector<float> leftOnly = resampleInBlocks(mono, left);
+    ASSERT_EQ(leftOnly.size(), count);
+    for (size_t i = 0; i < count; i++) {
+        ASSERT_EQ(whole[i], leftOnly[i]) << i;
+    }
+
+    // The second block starts mid-way between input frames
+    std::vector<float> next;
+    stereo.process(planar.data(), 100, next, offset);
+    EXPECT_LT(offset, 0.0);
+    EXPECT_GT(offset, -stereo.getTaps());
+}
+
+// Test that the vector dot products agree with the scalar one
+TEST(ResamplerTest, VectorKernelsMatchScalar) {
+    std::vector<float> input = sine(1234.0, 48000, 4800);
+    const SimdLevel detected = detectSimdLevel();
+
+    ASSERT_TRUE(setSimdLevel(SimdLevel::Scalar));
+    Resampler scalar(48000, 22050, 1);
+    std::vector<float> expected;
+    double offset = 0.0;
+    scalar.process(input.data(), input.size(), expected, offset);
+
+    for (SimdLevel level : {SimdLevel::Sse2, SimdLevel::Avx2}) {
+        if (static_cast<int>(level) > static_cast<int>(detected)) {
+            continue;
+        }
+        ASSERT_TRUE(setSimdLevel(level));
+        Resampler vector(48000, 22050, 1);
+        std::vector<float> actual;
+        vector.process(input.data(), input.size(), actual, offset);
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); i++) {
+            ASSERT_NEAR(actual[i], expected[i], 1e-5f) << simdLevelName(level) << " at " << i;
+        }
+    }
+    setSimdLevel(detected);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ring_reader.hpp"
+#include "synthetic_audio_source.hpp"
+
+namespace {
+
+// Records what the reader thread hands it
+class RecordingReader : public RingReader {
+public:
+    RecordingReader() : RingReader("test reader", 4096, std::chrono::milliseconds(1)) {}
+    ~RecordingReader() override { stop(); }
+
+    std::vector<int> rates() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rates_;
+    }
+    uint64_t bytesAt(int rate) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rate == currentRate_ ? currentBytes_ : 0;
+    }
+
+    std::atomic<int> caughtUp{0};
+    std::atomic<int> stopped{0};
+    std::thread::id thread;
+
+protected:
+    bool onRing(AudioSource& source) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        thread = std::this_thread::get_id();
+        currentRate_ = source.getSampleRate();
+        currentBytes_ = 0;
+        rates_.push_back(currentRate_);
+        return true;
+    }
+
+    void onChunk(const ReadResult& chunk) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        currentBytes_ += chunk.data.size();
+    }
+
+    void onCaughtUp(bool stopping) override {
+        (stopping ? stopped : caughtUp).fetch_add(1);
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<int> rates_;
+    int currentRate_ = 0;
+    uint64_t currentBytes_ = 0;
+};
+
+// Wait until the reader has read at least bytes of audio at rate
+bool waitForBytes(RecordingReader& reader, int rate, uint64_t bytes) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (reader.bytesAt(rate) < bytes) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+// Test that the reader tails the ring on its own thread, follows the source to a new ring
+// when its format changes, and reports catching up and stopping
+TEST(RingReaderTest, TailsRingAndFollowsFormatChanges) {
+    auto source = std::make_shared<SyntheticAudioSource>(SyntheticAudioSource::Waveform::Sine, 1000.0, 48000, 1, 16,
+                                                         480);
+    ASSERT_TRUE(source->initialize());
+    ASSERT_TRUE(source->start());
+
+    RecordingReader reader;
+    EXPECT_FALSE(reader.start(nullptr));
+    ASSERT_TRUE(reader.start(source));
+    EXPECT_TRUE(reader.isRunning());
+    ASSERT_TRUE(waitForBytes(reader, 48000, 4800 * 2));
+    EXPECT_NE(reader.thread, std::this_thread::get_id());
+
+    ASSERT_TRUE(source->setSampleRate(16000));
+    ASSERT_TRUE(source->start());
+    ASSERT_TRUE(waitForBytes(reader, 16000, 1600 * 2));
+
+    reader.stop();
+    source->stop();
+    EXPECT_FALSE(reader.isRunning());
+    EXPECT_EQ(reader.rates(), (std::vector<int>{48000, 16000}));
+    EXPECT_GT(reader.caughtUp.load(), 0);
+    EXPECT_EQ(reader.stopped.load(), 1);
+    EXPECT_GT(reader.getProcessNs(), 0u);
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "cpu_features.hpp"
+#include "sample_format.hpp"
+
+namespace {
+
+const SampleFormat kFormats[] = {
+    SampleFormat::Int8, SampleFormat::Int16, SampleFormat::Int24, SampleFormat::Int32, SampleFormat::Float32
+};
+
+// Random samples in any format; float stays slightly beyond [-1, 1] to exercise clamping
+std::vector<uint8_t> randomSamples(SampleFormat format, size_t count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(count * SampleSpec::sampleBytes(format));
+    if (format == SampleFormat::Float32) {
+        std::uniform_real_distribution<float> dist(-1.1f, 1.1f);
+        for (size_t i = 0; i < count; i++) {
+            float value = dist(rng);
+            std::memcpy(data.data() + i * 4, &value, 4);
+        }
+    } else {
+        for (auto& byte : data) {
+            byte = static_cast<uint8_t>(rng());
+        }
+    }
+    return data;
+}
+
+} // namespace
+
+// Test that known values convert with full-scale scaling, rounding and saturation
+TEST(SampleFormatTest, ConvertsKnownValues) {
+    const int16_t int16Samples[] = {0, 16384, -32768, 32767};
+    float floats[4];
+    convertSamples(int16Samples, SampleFormat::Int16, floats, SampleFormat::Float32, 4);
+    EXPECT_FLOAT_EQ(floats[0], 0.0f);
+    EXPECT_FLOAT_EQ(floats[1], 0.5f);
+    EXPECT_FLOAT_EQ(floats[2], -1.0f);
+    EXPECT_FLOAT_EQ(floats[3], 32767.0f / 32768.0f);
+
+    // Out of range float saturates
+    const float loud[] = {2.0f, -2.0f, 1.0f, -1.0f};
+    int16_t int16Out[4];
+    convertSamples(loud, SampleFormat::Float32, int16Out, SampleFormat::Int16, 4);
+    EXPECT_EQ(int16Out[0], 32767);
+    EXPECT_EQ(int16Out[1], -32768);
+    EXPECT_EQ(int16Out[2], 32767);
+    EXPECT_EQ(int16Out[3], -32768);
+
+    // Packed little-endian 24-bit
+    const uint8_t int24Samples[] = {0x56, 0x34, 0x12, 0x00, 0x00, 0x80};
+    int32_t int32Out[2];
+    convertSamples(int24Samples, SampleFormat::Int24, int32Out, SampleFormat::Int32, 2);
+    EXPECT_EQ(int32Out[0], 0x12345600);
+    EXPECT_EQ(int32Out[1], INT32_MIN);
+
+    // Narrowing rounds to nearest
+    const int32_t wide[] = {0x00018000, 0x00017FFF, INT32_MAX};
+    int16_t narrow[3];
+    convertSamples(wide, SampleFormat::Int32, narrow, SampleFormat::Int16, 3);
+    EXPECT_EQ(narrow[0], 2);
+    EXPECT_EQ(narrow[1], 1);
+    EXPECT_EQ(narrow[2], 32767);
+}
+
+// Test that widening and converting back is lossless
+TEST(SampleFormatTest, RoundTripsLosslessly) {
+    for (SampleFormat format : {SampleFormat::Int8, SampleFormat::Int16, SampleFormat::Int24}) {
+        std::vector<uint8_t> original = randomSamples(format, 1001, 7);
+        for (SampleFormat wide : {SampleFormat::Int32, SampleFormat::Float32}) {
+            std::vector<uint8_t> widened(1001 * 4);
+            std::vector<uint8_t> back(original.size());
+            convertSamples(original.data(), format, widened.data(), wide, 1001);
+            convertSamples(widened.data(), wide, back.data(), format, 1001);
+            EXPECT_EQ(back, original) << SampleSpec::formatName(format) << " via " << SampleSpec::formatName(wide);
+        }
+    }
+}
+
+// Test that every SIMD level produces exactly the scalar output, for lengths that leave tails
+TEST(SampleFormatTest, VectorKernelsMatchScalar) {
+    const SimdLevel detected = detectSimdLevel();
+
+    for (SampleFormat from : kFormats) {
+        for (SampleFormat to : kFormats) {
+            for (size_t count : {1u, 7u, 33u, 1000u, 4099u}) {
+                std::vector<uint8_t> input = randomSamples(from, count, static_cast<unsigned>(count));
+                std::vector<uint8_t> expected(count * SampleSpec::sampleBytes(to));
+                ASSERT_TRUE(setSimdLevel(SimdLevel::Scalar));
+                convertSamples(input.data(), from, expected.data(), to, count);
+
+                for (SimdLevel level : {SimdLevel::Sse2, SimdLevel::Avx2}) {
+                    if (static_cast<int>(level) > static_cast<int>(detected)) {
+                        continue;
+                    }
+                    ASSERT_TRUE(setSimdLevel(level));
+                    std::vector<uint8_t> actual(expected.size());
+                    convertSamples(input.data(), from, actual.data(), to, count);
+                    EXPECT_EQ(actual, expected) << SampleSpec::formatName(from) << " -> "
+                                                << SampleSpec::formatName(to) << " x" << count
+                                                << " with " << simdLevelName(level);
+                }
+            }
+        }
+    }
+    setSimdLevel(detected);
+}
+
+// Test conversion between interleaved and planar layouts
+TEST(SampleFormatTest, ConvertsBetweenLayouts) {
+    SampleSpec from;
+    SampleSpec to;
+    ASSERT_TRUE(SampleSpec::parse("int16", from));
+    ASSERT_TRUE(SampleSpec::parse("float32:planar", to));
+    EXPECT_EQ(to.toString(), "float32:planar");
+    EXPECT_FALSE(SampleSpec::parse("float64", to));
+    EXPECT_FALSE(SampleSpec::parse("int16:stacked", to));
+
+    // Three frames of stereo: left 1, 2, 3 and right -1, -2, -3 (in 1/32768)
+    const int16_t interleaved[] = {1, -1, 2, -2, 3, -3};
+    SampleConverter toPlanar(from, to, 2);
+    ASSERT_EQ(toPlanar.outputBytes(sizeof(interleaved)), 6 * sizeof(float));
+    float planar[6];
+    toPlanar.convert(interleaved, sizeof(interleaved), planar);
+    const float scale = 1.0f / 32768.0f;
+    EXPECT_FLOAT_EQ(planar[0], 1 * scale);
+    EXPECT_FLOAT_EQ(planar[2], 3 * scale);
+    EXPECT_FLOAT_EQ(planar[3], -1 * scale);
+    EXPECT_FLOAT_EQ(planar[5], -3 * scale);
+
+    SampleConverter back(to, from, 2);
+    int16_t roundTrip[6];
+    back.convert(planar, sizeof(planar), roundTrip);
+    EXPECT_EQ(std::memcmp(roundTrip, interleaved, sizeof(interleaved)), 0);
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "silence_gate.hpp"
+
+namespace {
+
+const int kSampleRate = 48000;
+const size_t kMessageFrames = 480;
+const SampleSpec kInt16{SampleFormat::Int16, SampleLayout::Interleaved};
+
+// One 10 ms mono int16 message: a tone at amplitude (full-scale fraction), or silence
+std::vector<uint8_t> message(double amplitude, uint64_t firstFrame) {
+    std::vector<uint8_t> data(kMessageFrames * 2);
+    int16_t* samples = reinterpret_cast<int16_t*>(data.data());
+    for (size_t i = 0; i < kMessageFrames; i++) {
+        double t = static_cast<double>(firstFrame + i) / kSampleRate;
+        samples[i] = static_cast<int16_t>(std::lround(32767.0 * amplitude * std::sin(2.0 * M_PI * 440.0 * t)));
+    }
+    return data;
+}
+
+std::map<std::string, nlohmann::json> timing(uint64_t frameIndex) {
+    return {{"frame_index", frameIndex}, {"frames", kMessageFrames}};
+}
+
+} // namespace
+
+// Test that gate specs parse with defaults for what is left out, and bad ones are rejected
+TEST(SilenceGateTest, ParsesSettings) {
+    GateSettings settings;
+    ASSERT_TRUE(GateSettings::parse("-45.5:150:50", settings));
+    EXPECT_TRUE(settings.enabled);
+    EXPECT_DOUBLE_EQ(settings.thresholdDb, -45.5);
+    EXPECT_EQ(settings.hangoverMs, 150);
+    EXPECT_EQ(settings.preRollMs, 50);
+
+    ASSERT_TRUE(GateSettings::parse("-60", settings));
+    EXPECT_DOUBLE_EQ(settings.thresholdDb, -60.0);
+    EXPECT_EQ(settings.hangoverMs, 300);
+    EXPECT_EQ(settings.preRollMs, 200);
+
+    EXPECT_FALSE(GateSettings::parse("", settings));
+    EXPECT_FALSE(GateSettings::parse("loud", settings));
+    EXPECT_FALSE(GateSettings::parse("-50:x", settings));
+    EXPECT_FALSE(GateSettings::parse("6", settings));
+    EXPECT_FALSE(GateSettings::parse("-50:300:200:1", settings));
+}
+
+// Test that silence becomes markers, the pre-roll goes out ahead of an onset, the hangover
+// after it, and audio plus markers cover every frame in order
+TEST(SilenceGateTest, ReplacesSilenceWithMarkers) {
+    GateSettings settings;
+    ASSERT_TRUE(GateSettings::parse("-50:100:50", settings));
+    SilenceGate gate(settings);
+
+    // 3 s of silence, 0.5 s of tone, 3 s of silence
+    std::vector<double> amplitudes(300, 0.0);
+    amplitudes.insert(amplitudes.end(), 50, 0.3);
+    amplitudes.insert(amplitudes.end(), 300, 0.0);
+
+    std::vector<SilenceGate::Output> outputs;
+    uint64_t nextFrame = 0;
+    size_t audioMessages = 0;
+    size_t markers = 0;
+    size_t audioBeforeOnset = 0;
+    auto check = [&](const std::vector<SilenceGate::Output>& sent) {
+        for (const auto& output : sent) {
+            // Consecutive outputs pick up where the previous one ended
+            EXPECT_EQ(output.metadata.at("frame_index").get<uint64_t>(), nextFrame);
+            EXPECT_EQ(output.metadata.at("frames").get<uint64_t>(), output.frames);
+            nextFrame += output.frames;
+            if (output.silence) {
+                EXPECT_TRUE(output.metadata.at("silence").get<bool>());
+                EXPECT_EQ(output.data, nullptr);
+                EXPECT_LE(output.frames, static_cast<size_t>(kSampleRate));
+                markers++;
+            } else {
+                EXPECT_EQ(output.bytes, output.frames * 2);
+                audioMessages++;
+            }
+        }
+    };
+
+    for (size_t i = 0; i < amplitudes.size(); i++) {
+        std::vector<uint8_t> data = message(amplitudes[i], i * kMessageFrames);
+        gate.process(data.data(), data.size(), kMessageFrames, kInt16, kSampleRate, timing(i * kMessageFrames),
+                     outputs);
+        if (i == 300) {
+            // Marker for the silence before the pre-roll, 5 pre-roll messages, then the onset
+            ASSERT_EQ(outputs.size(), 7u);
+            EXPECT_TRUE(outputs[0].silence);
+            EXPECT_EQ(outputs[1].metadata.at("frame_index").get<uint64_t>(), 295 * kMessageFrames);
+            EXPECT_EQ(outputs[6].metadata.at("frame_index").get<uint64_t>(), 300 * kMessageFrames);
+            EXPECT_TRUE(gate.isOpen());
+            audioBeforeOnset = audioMessages;
+        }
+        check(outputs);
+    }
+    gate.flush(outputs);
+    check(outputs);
+
+    EXPECT_EQ(nextFrame, amplitudes.size() * kMessageFrames);
+    EXPECT_FALSE(gate.isOpen());
+    EXPECT_EQ(audioBeforeOnset, 0u);
+    // Pre-roll (5), tone (50) and hangover (10) messages
+    EXPECT_EQ(audioMessages, 65u);
+    EXPECT_EQ(gate.getFramesPassed(), 65 * kMessageFrames);
+    EXPECT_EQ(gate.getFramesSuppressed(), (amplitudes.size() - 65) * kMessageFrames);
+    EXPECT_GE(markers, 6u);
+}
+
+// Test that a gap ends the current marker, so the next one carries it and starts afresh
+TEST(SilenceGateTest, MarkersDoNotSpanGaps) {
+    GateSettings settings;
+    ASSERT_TRUE(GateSettings::parse("-50:0:0", settings));
+    SilenceGate gate(settings);
+    std::vector<uint8_t> silence = message(0.0, 0);
+    std::vector<SilenceGate::Output> outputs;
+
+    gate.process(silence.data(), silence.size(), kMessageFrames, kInt16, kSampleRate, timing(0), outputs);
+    EXPECT_TRUE(outputs.empty());
+
+    std::map<std::string, nlohmann::json> afterGap = timing(10 * kMessageFrames);
+    afterGap["gap"] = {{"dropped_frames", 9 * kMessageFrames}};
+    gate.process(silence.data(), silence.size(), kMessageFrames, kInt16, kSampleRate, afterGap, outputs);
+    ASSERT_EQ(outputs.size(), 1u);
+    EXPECT_EQ(outputs[0].frames, kMessageFrames);
+    EXPECT_EQ(outputs[0].metadata.count("gap"), 0u);
+
+    gate.flush(outputs);
+    ASSERT_EQ(outputs.size(), 1u);
+    EXPECT_EQ(outputs[0].metadata.at("frame_index").get<uint64_t>(), 10 * kMessageFrames);
+    EXPECT_EQ(outputs[0].metadata.count("gap"), 1u);
+}
+
+// Test that steady noise above the threshold is learned as the floor and gated
+TEST(SilenceGateTest, GatesSteadyNoise) {
+    GateSettings settings;
+    ASSERT_TRUE(GateSettings::parse("-50:300:200", settings));
+    SilenceGate gate(settings);
+
+    // White noise around -40 dBFS
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0.0, 0.01 * 32767.0);
+    std::vector<uint8_t> data(kMessageFrames * 2);
+    int16_t* samples = reinterpret_cast<int16_t*>(data.data());
+    std::vector<SilenceGate::Output> outputs;
+    for (size_t i = 0; i < 1000; i++) {
+        for (size_t j = 0; j < kMessageFrames; j++) {
+            samples[j] = static_cast<int16_t>(std::lround(noise(rng)));
+        }
+        gate.process(data.data(), data.size(), kMessageFrames, kInt16, kSampleRate, timing(i * kMessageFrames),
+                     outputs);
+    }
+
+    EXPECT_NEAR(gate.getLevelDb(), -40.0, 1.0);
+    EXPECT_GT(gate.getNoiseFloorDb(), -46.0);
+    EXPECT_FALSE(gate.isOpen());
+    EXPECT_GT(gate.getFramesSuppressed(), 500 * kMessageFrames);
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "spectral.hpp"
+
+namespace {
+
+std::vector<float> sine(double hz, int sampleRate, size_t frames) {
+    std::vector<float> samples(frames);
+    for (size_t i = 0; i < frames; i++) {
+        samples[i] = static_cast<float>(std::sin(2.0 * M_PI * hz * i / sampleRate));
+    }
+    return samples;
+}
+
+} // namespace
+
+// Test that feature specs parse with defaults for what is left out, and bad ones are rejected
+TEST(SpectralTest, ParsesSettings) {
+    FeatureSettings settings;
+    ASSERT_TRUE(FeatureSettings::parse("32:16:40:hamming", settings));
+    EXPECT_TRUE(settings.enabled);
+    EXPECT_EQ(settings.windowMs, 32);
+    EXPECT_EQ(settings.hopMs, 16);
+    EXPECT_EQ(settings.melBands, 40);
+    EXPECT_EQ(settings.window, "hamming");
+
+    FeatureSettings spectrum;
+    ASSERT_TRUE(FeatureSettings::parse("20:10:0", spectrum));
+    EXPECT_EQ(spectrum.melBands, 0);
+    EXPECT_EQ(spectrum.window, "hann");
+    ASSERT_TRUE(FeatureSettings::parseFormat("float32", spectrum));
+    EXPECT_FALSE(spectrum.half);
+
+    EXPECT_FALSE(FeatureSettings::parse("25", settings));
+    EXPECT_FALSE(FeatureSettings::parse("25:0", settings));
+    EXPECT_FALSE(FeatureSettings::parse("25:10:64:kaiser", settings));
+    EXPECT_FALSE(FeatureSettings::parseFormat("float64", settings));
+}
+
+// Test the real FFT against a direct DFT
+TEST(SpectralTest, RealFftMatchesDft) {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    for (size_t size : {4, 8, 64, 512}) {
+        std::vector<float> input(size);
+        for (float& sample : input) {
+            sample = uniform(rng);
+        }
+        RealFft fft(size);
+        ASSERT_EQ(fft.getSize(), size);
+        std::vector<std::complex<float>> spectrum;
+        fft.forward(input.data(), spectrum);
+        ASSERT_EQ(spectrum.size(), size / 2 + 1);
+
+        for (size_t k = 0; k <= size / 2; k++) {
+            std::complex<double> expected = 0.0;
+            for (size_t n = 0; n < size; n++) {
+                expected += static_cast<double>(input[n]) * std::polar(1.0, -2.0 * M_PI * k * n / size);
+            }
+            EXPECT_NEAR(spectrum[k].real(), expected.real(), 1e-3 * size) << size << " bin " << k;
+            EXPECT_NEAR(spectrum[k].imag(), expected.imag(), 1e-3 * size) << size << " bin " << k;
+        }
+    }
+}
+
+// Test that a full-scale tone reads 0 dB in its bin and lands in the right mel band, and
+// that windows come every hop however the input is chunked
+TEST(SpectralTest, AnalyzesTonesInAnyChunking) {
+    const int sampleRate = 16000;
+    FeatureSettings settings;
+    ASSERT_TRUE(FeatureSettings::parse("25:10:0", settings));
+    SpectralAnalyzer analyzer(settings, sampleRate);
+    EXPECT_EQ(analyzer.getWindowFrames(), 400u);
+    EXPECT_EQ(analyzer.getHopFrames(), 160u);
+    EXPECT_EQ(analyzer.getFftSize(), 512u);
+    EXPECT_EQ(analyzer.getBins(), 257u);
+
+    // 1 kHz sits exactly on bin 32 of a 512-point FFT at 16 kHz
+    std::vector<float> tone = sine(1000.0, sampleRate, 16000);
+    std::vector<float> whole;
+    uint64_t firstWindow = 99;
+    size_t windows = analyzer.process(tone.data(), tone.size(), whole, firstWindow);
+    EXPECT_EQ(firstWindow, 0u);
+    EXPECT_EQ(windows, (16000u - 400) / 160 + 1);
+    ASSERT_EQ(whole.size(), windows * 257);
+    auto peak = std::max_element(whole.begin(), whole.begin() + 257);
+    EXPECT_EQ(peak - whole.begin(), 32);
+    EXPECT_NEAR(*peak, 0.0, 0.1);
+
+    // The same audio in odd chunks gives the same frames
+    SpectralAnalyzer chunked(settings, sampleRate);
+    std::vector<float> pieces;
+    size_t total = 0;
+    for (size_t offset = 0; offset < tone.size(); offset += 137) {
+        size_t frames = std::min<size_t>(137, tone.size() - offset);
+        uint64_t start = 0;
+        size_t count = chunked.process(tone.data() + offset, frames, pieces, start);
+        if (count > 0) {
+            EXPECT_EQ(start, total * 160);
+        }
+        total += count;
+    }
+    ASSERT_EQ(pieces.size(), whole.size());
+    for (size_t i = 0; i < whole.size(); i++) {
+        ASSERT_NEAR(pieces[i], whole[i], 1e-3) << i;
+    }
+
+    // After a reset windows start at the next input frame
+    chunked.reset();
+    uint64_t afterReset = 0;
+    std::vector<float> more;
+    chunked.process(tone.data(), 400, more, afterReset);
+    EXPECT_EQ(afterReset, 16000u);
+    EXPECT_EQ(more.size(), 257u);
+
+    // Mel bands: the loudest one is the one centred nearest 1 kHz
+    ASSERT_TRUE(FeatureSettings::parse("25:10:40", settings));
+    SpectralAnalyzer mel(settings, sampleRate);
+    std::vector<float> bands;
+    ASSERT_EQ(mel.process(tone.data(), 400, bands, firstWindow), 1u);
+    ASSERT_EQ(bands.size(), 40u);
+    size_t loudest = std::max_element(bands.begin(), bands.end()) - bands.begin();
+    const double step = MelFilterBank::hzToMel(8000.0) / 41;
+    EXPECT_NEAR(MelFilterBank::melToHz(step * (loudest + 1)), 1000.0, 100.0);
+}
+
+// Test float16 conversion on exact values, rounding and the range ends
+TEST(SpectralTest, ConvertsToHalf) {
+    EXPECT_EQ(floatToHalf(0.0f), 0x0000);
+    EXPECT_EQ(floatToHalf(1.0f), 0x3c00);
+    EXPECT_EQ(floatToHalf(-2.0f), 0xc000);
+    EXPECT_EQ(floatToHalf(65504.0f), 0x7bff);
+    EXPECT_EQ(floatToHalf(1e6f), 0x7c00);
+    EXPECT_EQ(floatToHalf(std::ldexp(1.0f, -24)), 0x0001);
+    EXPECT_EQ(floatToHalf(std::ldexp(1.0f, -14)), 0x0400);
+    EXPECT_EQ(floatToHalf(1.0f + std::ldexp(1.0f, -11)), 0x3c00);  // Tie rounds to even
+    EXPECT_EQ(floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)), 0x3c02);
+
+    for (float value : {-120.0f, -63.25f, -0.5f, 3.140625f, 1000.0f}) {
+        EXPECT_NEAR(halfToFloat(floatToHalf(value)), value, std::fabs(value) * 1e-3);
+    }
+}
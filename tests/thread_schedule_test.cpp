@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "thread_schedule.hpp"
+
+// Test that schedule specs parse into policy, priority and CPU set
+TEST(ThreadScheduleTest, ParsesSpecs) {
+    ThreadSchedule schedule;
+
+    ASSERT_TRUE(ThreadSchedule::parse("fifo:80@3", schedule));
+    EXPECT_EQ(schedule.policy, ThreadSchedule::Policy::Fifo);
+    EXPECT_EQ(schedule.priority, 80);
+    EXPECT_EQ(schedule.cpus, std::vector<int>({3}));
+    EXPECT_EQ(schedule.toString(), "fifo:80@3");
+
+    ASSERT_TRUE(ThreadSchedule::parse("rr:10@0,2-4", schedule));
+    EXPECT_EQ(schedule.policy, ThreadSchedule::Policy::RoundRobin);
+    EXPECT_EQ(schedule.cpus, std::vector<int>({0, 2, 3, 4}));
+    EXPECT_EQ(schedule.toString(), "rr:10@0,2-4");
+
+    ASSERT_TRUE(ThreadSchedule::parse("@1", schedule));
+    EXPECT_EQ(schedule.policy, ThreadSchedule::Policy::Inherit);
+    EXPECT_EQ(schedule.cpus, std::vector<int>({1}));
+    EXPECT_FALSE(schedule.isDefault());
+
+    ASSERT_TRUE(ThreadSchedule::parse("", schedule));
+    EXPECT_TRUE(schedule.isDefault());
+}
+
+// Test that malformed specs are rejected
+TEST(ThreadScheduleTest, RejectsInvalidSpecs) {
+    ThreadSchedule schedule;
+
+    EXPECT_FALSE(ThreadSchedule::parse("fifo", schedule));       // Realtime needs a priority
+    EXPECT_FALSE(ThreadSchedule::parse("fifo:100", schedule));
+    EXPECT_FALSE(ThreadSchedule::parse("other:5", schedule));
+    EXPECT_FALSE(ThreadSchedule::parse("batch", schedule));
+    EXPECT_FALSE(ThreadSchedule::parse("fifo:10@", schedule));
+    EXPECT_FALSE(ThreadSchedule::parse("@3-1", schedule));
+    EXPECT_FALSE(ThreadSchedule::parse("@0-2147483647", schedule));  // Past what a CPU set holds
+    EXPECT_FALSE(ThreadSchedule::parse("@2000000000", schedule));
+    EXPECT_FALSE(ThreadSchedule::parse("@0,1024", schedule));  // CPU_SETSIZE
+    EXPECT_TRUE(ThreadSchedule::parse("@1023", schedule));     // The last one it holds is fine
+}
+
+#if defined(__linux__)
+// Test that an affinity-only schedule can be applied without privileges
+TEST(ThreadScheduleTest, AppliesAffinity) {
+    ThreadSchedule schedule;
+    ASSERT_TRUE(ThreadSchedule::parse("@0", schedule));
+
+    bool applied = false;
+    ThreadSchedule effective;
+    std::thread thread([&]() {
+        applied = schedule.applyToCurrentThread("test");
+        effective = ThreadSchedule::ofCurrentThread();
+        recordThreadSchedule("test");
+    });
+    thread.join();
+
+    EXPECT_TRUE(applied);
+    EXPECT_EQ(effective.policy, ThreadSchedule::Policy::Other);
+    EXPECT_EQ(effective.cpus, std::vector<int>({0}));
+    EXPECT_EQ(recordedThreadSchedules()["test"], "other@0");
+}
+#endif
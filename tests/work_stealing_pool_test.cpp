@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "work_stealing_pool.hpp"
+
+// Test that every task runs exactly once per run, however many threads and tasks there are
+TEST(WorkStealingPoolTest, RunsEveryTaskOnce) {
+    for (size_t threads : {1, 2, 4, 7}) {
+        WorkStealingPool pool(threads);
+        EXPECT_EQ(pool.getThreadCount(), threads);
+        for (size_t count : {0, 1, 3, 16, 100}) {
+            std::vector<std::atomic<int>> runs(count);
+            for (int repeat = 0; repeat < 20; repeat++) {
+                pool.run(count, [&](size_t task) {
+                    runs[task].fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            for (size_t task = 0; task < count; task++) {
+                ASSERT_EQ(runs[task].load(), 20) << threads << " threads, task " << task << " of " << count;
+            }
+        }
+    }
+
+    WorkStealingPool automatic;
+    EXPECT_GE(automatic.getThreadCount(), 1u);
+}
+
+// Test that run() returns only after every task's writes are done, and that idle threads
+// steal from a thread whose tasks are slow
+TEST(WorkStealingPoolTest, JoinsAndStealsUnevenWork) {
+    WorkStealingPool pool(4);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::vector<int> results(32, 0);
+
+    // Thread 0 (the caller) is dealt tasks 0-7, which are slow
+    pool.run(results.size(), [&](size_t task) {
+        if (task < 8) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        results[task] = static_cast<int>(task) * 2;
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+
+    for (size_t task = 0; task < results.size(); task++) {
+        EXPECT_EQ(results[task], static_cast<int>(task) * 2);
+    }
+    EXPECT_GT(threads.size(), 1u);
+    EXPECT_GT(pool.getTasksStolen(), 0u);
+}
+
+// Test that runs from several threads share the workers instead of waiting for each
+// other: every task waits until all four tasks of both runs have started
+TEST(WorkStealingPoolTest, OverlapsConcurrentRuns) {
+    WorkStealingPool pool(5);
+    std::atomic<int> started(0);
+    std::atomic<int> overlapped(0);
+    std::atomic<int> total(0);
+
+    auto caller = [&](int id) {
+        pool.run(2, [&, id](size_t) {
+            started.fetch_add(1);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (started.load() < 4 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            if (started.load() == 4) {
+                overlapped.fetch_add(1);
+            }
+            total.fetch_add(id, std::memory_order_relaxed);
+        });
+    };
+    std::thread first(caller, 1);
+    std::thread second(caller, 10);
+    first.join();
+    second.join();
+
+    EXPECT_EQ(overlapped.load(), 4);
+    EXPECT_EQ(total.load(), 2 * 1 + 2 * 10);
+
+    // Many back-to-back runs from both callers still run every task once
+    total = 0;
+    auto repeatCaller = [&](int id) {
+        for (int repeat = 0; repeat < 200; repeat++) {
+            pool.run(6, [&, id](size_t) { total.fetch_add(id, std::memory_order_relaxed); });
+        }
+    };
+    std::thread third(repeatCaller, 1);
+    std::thread fourth(repeatCaller, 10);
+    third.join();
+    fourth.join();
+    EXPECT_EQ(total.load(), 200 * 6 * 1 + 200 * 6 * 10);
+}
+
+#ifdef __linux__
+// Test that the pool's worker threads take the schedule it was given
+TEST(WorkStealingPoolTest, AppliesScheduleToWorkers) {
+    ThreadSchedule schedule;
+    ASSERT_TRUE(ThreadSchedule::parse("@0", schedule));
+    {
+        // Workers record their schedule as they start, and the destructor joins them
+        WorkStealingPool pool(3, schedule);
+    }
+    auto schedules = recordedThreadSchedules();
+    EXPECT_EQ(schedules["dsp pool 1"], "other@0");
+    EXPECT_EQ(schedules["dsp pool 2"], "other@0");
+}
+#endif
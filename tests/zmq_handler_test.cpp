@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <zmq.hpp>
+#include <memory>
+#include <string>
+#include "zmq_handler.hpp"
+#include "zmq_publisher.hpp"
+#include "synthetic_audio_source.hpp"
+
+namespace {
+
+std::shared_ptr<SyntheticAudioSource> makeSource() {
+    auto source = std::make_shared<SyntheticAudioSource>(SyntheticAudioSource::Waveform::Sine, 440.0, 48000, 1, 16,
+                                                         480);
+    source->initialize();
+    return source;
+}
+
+// Two named streams, "mic" and "room", and one without an id; commands are run directly
+// instead of through the handler thread
+class ZmqHandlerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        context = std::make_shared<zmq::context_t>(1);
+        mic = makeSource();
+        room = makeSource();
+        unnamed = makeSource();
+
+        publisher = std::make_shared<ZmqPublisher>("inproc://handler-test-pub", "audio", mic, "test", "mic", context);
+        size_t roomStream = publisher->addStream("room", "audio.room", room);
+        size_t unnamedStream = publisher->addStream("", "audio.unnamed", unnamed);
+        ASSERT_TRUE(publisher->initialize());
+
+        handler = std::make_unique<ZmqHandler>("inproc://handler-test", "control", mic, publisher, context);
+        handler->addStream("room", room, roomStream);
+        handler->addStream("", unnamed, unnamedStream);
+    }
+
+    void TearDown() override {
+        handler.reset();
+        publisher.reset();
+    }
+
+    std::shared_ptr<zmq::context_t> context;
+    std::shared_ptr<SyntheticAudioSource> mic;
+    std::shared_ptr<SyntheticAudioSource> room;
+    std::shared_ptr<SyntheticAudioSource> unnamed;
+    std::shared_ptr<ZmqPublisher> publisher;
+    std::unique_ptr<ZmqHandler> handler;
+};
+
+} // namespace
+
+// Test that a trailing stream id applies the command to that stream alone, with the
+// original one-line response
+TEST_F(ZmqHandlerTest, TrailingIdSelectsOneStream) {
+    EXPECT_EQ(handler->handleCommand("SET_BUFFER_MS 2000 room"), "OK: Buffer set to 2000 ms");
+    EXPECT_EQ(room->getHistoryMs(), 2000);
+    EXPECT_EQ(mic->getHistoryMs(), AudioSource::kDefaultHistoryMs);
+    EXPECT_EQ(unnamed->getHistoryMs(), AudioSource::kDefaultHistoryMs);
+
+    ASSERT_TRUE(mic->start());
+    EXPECT_EQ(handler->handleCommand("STOP mic"), "OK: Audio capture stopped");
+    EXPECT_FALSE(mic->isRunning());
+
+    // Extra spaces around the id do not matter
+    EXPECT_EQ(handler->handleCommand("SET_BUFFER_MS  3000   mic  "), "OK: Buffer set to 3000 ms");
+    EXPECT_EQ(mic->getHistoryMs(), 3000);
+    EXPECT_EQ(room->getHistoryMs(), 2000);
+}
+
+// Test that without a stream id a command reaches every stream, and the reply has one
+// "[label] response" line per stream in the order they were added, labelling streams
+// without an id by their index
+TEST_F(ZmqHandlerTest, NoIdAppliesToAllStreams) {
+    EXPECT_EQ(handler->handleCommand("SET_BUFFER_MS 1500"),
+              "[mic] OK: Buffer set to 1500 ms\n"
+              "[room] OK: Buffer set to 1500 ms\n"
+              "[stream 2] OK: Buffer set to 1500 ms\n");
+    EXPECT_EQ(mic->getHistoryMs(), 1500);
+    EXPECT_EQ(room->getHistoryMs(), 1500);
+    EXPECT_EQ(unnamed->getHistoryMs(), 1500);
+
+    // Each stream answers for itself
+    EXPECT_EQ(handler->handleCommand("SET_BUFFER_MS 0"),
+              "[mic] ERROR: Invalid buffer size\n"
+              "[room] ERROR: Invalid buffer size\n"
+              "[stream 2] ERROR: Invalid buffer size\n");
+}
+
+// Test that a stream that does not exist is refused without touching any stream, and that
+// a stream without an id cannot be named by its label or index
+TEST_F(ZmqHandlerTest, UnknownStreamIsRefused) {
+    ASSERT_TRUE(mic->start());
+    ASSERT_TRUE(room->start());
+
+    EXPECT_EQ(handler->handleCommand("STOP hall"), "ERROR: Unknown stream: hall");
+    EXPECT_EQ(handler->handleCommand("STOP 2"), "ERROR: Unknown stream: 2");
+    EXPECT_EQ(handler->handleCommand("STOP stream 2"), "ERROR: Unknown stream: stream 2");
+    EXPECT_TRUE(mic->isRunning());
+    EXPECT_TRUE(room->isRunning());
+
+    // For commands with arguments the unmatched word is an argument, not a stream
+    EXPECT_EQ(handler->handleCommand("SET_BUFFER_MS 2000 hall"),
+              "[mic] ERROR: Invalid buffer size\n"
+              "[room] ERROR: Invalid buffer size\n"
+              "[stream 2] ERROR: Invalid buffer size\n");
+    EXPECT_EQ(mic->getHistoryMs(), AudioSource::kDefaultHistoryMs);
+
+    // History needs exactly one stream
+    EXPECT_EQ(handler->handleCommand("GET_HISTORY 0 1000"), "ERROR: GET_HISTORY needs a stream id");
+    EXPECT_EQ(handler->handleCommand("NOT_A_COMMAND mic"), "ERROR: Unknown command");
+
+    mic->stop();
+    room->stop();
+}